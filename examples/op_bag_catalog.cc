@@ -0,0 +1,108 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <string>
+
+#include "openbag/catalog.hpp"
+
+namespace {
+
+void PrintUsage(const char* program)
+{
+    std::cout << "用法:\n"
+              << "  " << program << " build <目录> [-o <索引文件>] [--no-recursive]\n"
+              << "      增量更新目录下 .mcap 文件的索引，并压缩掉已删除文件的记录 (默认索引文件 <目录>/catalog.idx)\n"
+              << "  " << program << " prune <索引文件>\n"
+              << "      压缩索引: 去掉被覆盖的记录和文件已不存在的记录\n"
+              << "  " << program << " query <索引文件> [-t <话题>] [--start <纳秒>] [--end <纳秒>]\n"
+              << "      查询在时间范围内包含指定话题的文件\n";
+}
+
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        PrintUsage(argv[0]);
+        return -1;
+    }
+
+    const std::string command = argv[1];
+    const std::string target = argv[2];
+    std::string catalogPath;
+    std::string topic;
+    uint64_t startTime = 0;
+    uint64_t endTime = std::numeric_limits<uint64_t>::max();
+    bool recursive = true;
+
+    for (int i = 3; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "-o" && hasValue)
+        {
+            catalogPath = argv[++i];
+        } else if (arg == "-t" && hasValue)
+        {
+            topic = argv[++i];
+        } else if (arg == "--start" && hasValue)
+        {
+            startTime = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--end" && hasValue)
+        {
+            endTime = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--no-recursive")
+        {
+            recursive = false;
+        } else
+        {
+            PrintUsage(argv[0]);
+            return -1;
+        }
+    }
+
+    if (command == "build")
+    {
+        if (catalogPath.empty())
+        {
+            catalogPath = target + "/catalog.idx";
+        }
+        openbag::CatalogBuilder builder(catalogPath);
+        const size_t appended = builder.Update(target, recursive);
+        const size_t removed = builder.Prune();
+        std::cout << "索引更新完成: 新增 " << appended << " 个文件，清理 " << removed << " 条记录 -> " << catalogPath << std::endl;
+        return 0;
+    }
+
+    if (command == "prune")
+    {
+        openbag::CatalogBuilder builder(target);
+        std::cout << "索引压缩完成: 清理 " << builder.Prune() << " 条记录 -> " << target << std::endl;
+        return 0;
+    }
+
+    if (command == "query")
+    {
+        openbag::Catalog catalog;
+        if (!catalog.Open(target))
+        {
+            return -1;
+        }
+
+        const auto begin = std::chrono::steady_clock::now();
+        const auto files = catalog.Query(topic, startTime, endTime);
+        const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count();
+
+        for (const auto& file : files)
+        {
+            std::cout << file << std::endl;
+        }
+        std::cerr << "共 " << catalog.GetFileCount() << " 个文件，匹配 " << files.size() << " 个，耗时 " << elapsed << " us" << std::endl;
+        return 0;
+    }
+
+    PrintUsage(argv[0]);
+    return -1;
+}
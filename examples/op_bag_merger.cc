@@ -0,0 +1,101 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "openbag/merger.hpp"
+
+namespace {
+
+void PrintUsage(const char* program)
+{
+    std::cout << "用法: " << program << " [选项] <输入文件> <输入文件> [输入文件...]\n"
+              << "  -o <目录>          输出目录 (默认 ./openbags/)\n"
+              << "  -p <前缀>          输出文件名前缀 (默认 merged)\n"
+              << "  -t <话题>          保留的话题，可重复指定 (默认全部)\n"
+              << "  -c <none|lz4|zstd> 压缩类型 (默认 zstd)\n"
+              << "  -l <0-4>           压缩级别 (默认 2)\n"
+              << "  --chunk-size <MiB> 块大小 (默认 4)\n"
+              << "  --split-size <MiB> 按大小切分输出，0表示不切分 (默认 0)\n";
+}
+
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    openbag::MergerConfig config;
+    config.storage.compression_type = openbag::CompressionType::ZSTD;
+    config.storage.compression_level = 2;
+    config.storage.chunk_size = 4ULL * 1024 * 1024;
+    config.storage.split_by_size = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "-h" || arg == "--help")
+        {
+            PrintUsage(argv[0]);
+            return 0;
+        } else if (arg == "-o" && hasValue)
+        {
+            config.output_path = argv[++i];
+        } else if (arg == "-p" && hasValue)
+        {
+            config.filename_prefix = argv[++i];
+        } else if (arg == "-t" && hasValue)
+        {
+            config.topics.insert(argv[++i]);
+        } else if (arg == "-c" && hasValue)
+        {
+            const std::string type = argv[++i];
+            if (type == "none")
+            {
+                config.storage.compression_type = openbag::CompressionType::NONE;
+            } else if (type == "lz4")
+            {
+                config.storage.compression_type = openbag::CompressionType::LZ4;
+            } else if (type == "zstd")
+            {
+                config.storage.compression_type = openbag::CompressionType::ZSTD;
+            } else
+            {
+                std::cerr << "未知的压缩类型: " << type << std::endl;
+                return -1;
+            }
+        } else if (arg == "-l" && hasValue)
+        {
+            config.storage.compression_level = std::atoi(argv[++i]);
+        } else if (arg == "--chunk-size" && hasValue)
+        {
+            config.storage.chunk_size = std::strtoull(argv[++i], nullptr, 10) * 1024 * 1024;
+        } else if (arg == "--split-size" && hasValue)
+        {
+            const uint64_t splitSize = std::strtoull(argv[++i], nullptr, 10) * 1024 * 1024;
+            config.storage.split_by_size = splitSize > 0;
+            config.storage.max_file_size = splitSize;
+        } else if (!arg.empty() && arg[0] == '-')
+        {
+            PrintUsage(argv[0]);
+            return -1;
+        } else
+        {
+            config.input_files.push_back(arg);
+        }
+    }
+
+    if (config.input_files.size() < 2)
+    {
+        PrintUsage(argv[0]);
+        return -1;
+    }
+
+    openbag::Merger merger(config);
+    if (!merger.Run())
+    {
+        std::cerr << "合并失败！" << std::endl;
+        return -1;
+    }
+
+    std::cout << "合并完成: 写入 " << merger.GetWrittenMessages() << " 条消息，模式冲突丢弃 " << merger.GetConflictMessages() << " 条" << std::endl;
+    return 0;
+}
@@ -0,0 +1,102 @@
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "general.h"
+#include "link/link_transport.hpp"
+#include "openbag/common.hpp"
+#include "openbag/config.hpp"
+#include "openbag/recorder.hpp"
+#include "utils.hpp"
+
+extern openbag::MessageAdapterFactoryPtr GetLinkAdapterFactory();
+
+namespace {
+
+double ElapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief 测量录制器 Start() 的耗时(注册话题、创建订阅者)
+ */
+double MeasureRecorderStart(const openbag::ConfigManager& baseConfig, size_t topicCount, size_t threads, const std::string& prefix)
+{
+    openbag::ConfigManager configManager = baseConfig;
+    openbag::RecorderConfig recorderConfig = configManager.GetRecorderConfig();
+    recorderConfig.output_path = (std::filesystem::temp_directory_path() / "openbag_startup_benchmark").string() + "/";
+    recorderConfig.startup_threads = threads;
+    recorderConfig.topics.clear();
+    for (size_t i = 0; i < topicCount; ++i)
+    {
+        recorderConfig.topics.push_back(openbag::TopicInfo{prefix + std::to_string(i), "test.TestMessage", "test.proto"});
+    }
+    configManager.SetRecorderConfig(recorderConfig);
+
+    openbag::Recorder recorder(configManager, GetLinkAdapterFactory());
+    const auto start = std::chrono::steady_clock::now();
+    const bool started = recorder.Start();
+    const double elapsed = ElapsedMs(start);
+    if (!started)
+    {
+        std::cerr << "启动录制器失败" << std::endl;
+        return -1.0;
+    }
+    recorder.Stop();
+    return elapsed;
+}
+
+/**
+ * @brief 测量创建发布者的耗时
+ */
+double MeasurePublishers(size_t topicCount, size_t threads, const std::string& prefix)
+{
+    auto factory = GetLinkAdapterFactory();
+    std::vector<openbag::OpenbagPublisherPtr> publishers(topicCount);
+    const auto start = std::chrono::steady_clock::now();
+    openbag::ParallelFor(topicCount, threads, [&](size_t i) { publishers[i] = factory->CreatePublisher(prefix + std::to_string(i)); });
+    return ElapsedMs(start);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    const size_t topicCount = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 300;
+    const size_t threads = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 8;
+
+    std::string executablePath = utils::GetCurrentExecutablePath();
+    if (!executablePath.empty())
+    {
+        utils::SetCurrentWorkingDirectory(executablePath + "/../");
+    }
+
+    openbag::ConfigManager configManager;
+    if (!configManager.LoadBufferConfig("config/buffer.yaml") || !configManager.LoadStorageConfig("config/storage.yaml"))
+    {
+        std::cerr << "Failed to load configuration files!" << std::endl;
+        return -1;
+    }
+    auto storageConfig = configManager.GetStorageConfig();
+    storageConfig.proto_search_paths.push_back("examples/message");
+    configManager.SetStorageConfig(storageConfig);
+
+    // 参与者只创建一次，不计入各轮耗时
+    auto start = std::chrono::steady_clock::now();
+    Link::Participant::GetParticipant();
+    std::cout << "participant: " << ElapsedMs(start) << " ms" << std::endl;
+
+    // 每轮使用不同的话题名，避免复用上一轮的实体
+    std::cout << "topics: " << topicCount << std::endl;
+    std::cout << "recorder start, 1 thread:   " << MeasureRecorderStart(configManager, topicCount, 1, "/bench/seq/") << " ms" << std::endl;
+    std::cout << "recorder start, " << threads << " threads:  " << MeasureRecorderStart(configManager, topicCount, threads, "/bench/par/") << " ms"
+              << std::endl;
+    std::cout << "publishers, 1 thread:       " << MeasurePublishers(topicCount, 1, "/bench/pub_seq/") << " ms" << std::endl;
+    std::cout << "publishers, " << threads << " threads:      " << MeasurePublishers(topicCount, threads, "/bench/pub_par/") << " ms" << std::endl;
+    return 0;
+}
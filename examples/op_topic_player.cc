@@ -1,3 +1,4 @@
+#include <cstdlib>
 #include <iostream>
 #include <memory>
 #include <string>
@@ -6,6 +7,7 @@
 #include "link/link_transport.hpp"
 #include "openbag/config.hpp"
 #include "openbag/player.hpp"
+#include "openbag/shm_transport.hpp"
 #include "openbag/transport.hpp"
 
 extern openbag::MessageAdapterFactoryPtr GetLinkAdapterFactory();
@@ -13,26 +15,68 @@ extern openbag::MessageAdapterFactoryPtr GetLinkAdapterFactory();
 int main(int argc, char* argv[])
 {
     openbag::ConfigManager configManager;
-    openbag::PlayerConfig playerConfig = configManager.GetPlayerConfig();
-    playerConfig.input_path = "openbag_test.mcap";
-    configManager.SetPlayerConfig(playerConfig);
+    if (!configManager.LoadPlayerConfig("config/player.yaml"))
+    {
+        openbag::PlayerConfig playerConfig = configManager.GetPlayerConfig();
+        playerConfig.input_path = "openbag_test.mcap";
+        configManager.SetPlayerConfig(playerConfig);
+    }
+    const openbag::PlayerConfig& playerConfig = configManager.GetPlayerConfig();
 
-    auto adapterFactory = GetLinkAdapterFactory();
+    openbag::MessageAdapterFactoryPtr adapterFactory;
+    if (playerConfig.transport.type == "shm")
+    {
+        adapterFactory = std::make_shared<openbag::ShmAdapterFactory>(playerConfig.transport);
+    } else
+    {
+        // 流控器和发布选项须在创建发布者之前设置
+        if (!LinkAdapterFactory::ConfigurePublishers(playerConfig))
+        {
+            std::cerr << "Failed to configure publishers!" << std::endl;
+            return -1;
+        }
+        adapterFactory = GetLinkAdapterFactory();
+    }
     openbag::Player player(playerConfig, adapterFactory);
 
     std::cout << "Starting player..." << std::endl;
     if (player.Start())
     {
-        std::cout << "Player started. Press Enter to stop playback." << std::endl;
-        std::cin.get();
+        std::cout << "Player started. Commands: p = pause/resume, n [N] = step forward, b [N] = step backward, r = toggle reverse, t = playback time, q = stop."
+                  << std::endl;
+
+        std::string line;
+        while (std::getline(std::cin, line) && line != "q")
+        {
+            const char command = line.empty() ? '\0' : line[0];
+            const size_t parsed = line.size() > 2 ? std::strtoul(line.c_str() + 2, nullptr, 10) : 0;
+            const size_t count = parsed > 0 ? parsed : 1;
+            if (command == 'p')
+            {
+                player.GetState() == openbag::PlayerState::PAUSED ? player.Resume() : player.Pause();
+            } else if (command == 'n')
+            {
+                std::cout << "Stepped forward " << player.StepForward(count) << " message(s)." << std::endl;
+            } else if (command == 'b')
+            {
+                std::cout << "Stepped backward " << player.StepBackward(count) << " message(s)." << std::endl;
+            } else if (command == 'r')
+            {
+                player.SetReverse(!player.IsReverse());
+                std::cout << (player.IsReverse() ? "Reverse" : "Forward") << " playback." << std::endl;
+            } else if (command == 't')
+            {
+                std::cout << "Playback time: " << player.GetCurrentPlaybackTime() << " ns." << std::endl;
+            }
+        }
 
         std::cout << "Stopping player..." << std::endl;
         player.Stop();
         std::cout << "Player stopped." << std::endl;
     } else
     {
-        std::cerr << "Failed to start player! Please ensure 'openbag_test.mcap' file exists." << std::endl;
+        std::cerr << "Failed to start player! Please ensure '" << playerConfig.input_path << "' file exists." << std::endl;
     }
 
     return 0;
-}
\ No newline at end of file
+}
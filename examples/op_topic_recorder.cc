@@ -7,6 +7,8 @@
 #include "link/link_transport.hpp"
 #include "openbag/config.hpp"
 #include "openbag/recorder.hpp"
+#include "openbag/shm_transport.hpp"
+#include "openbag/stream_writable.hpp"
 #include "openbag/transport.hpp"
 #include "test.pb.h"
 #include "utils.hpp"
@@ -32,13 +34,31 @@ int main(int argc, char* argv[])
         return -1;
     }
 
+    // 流式输出到标准输出时，在输出任何日志之前预留标准输出，日志改写到标准错误
+    if (configManager.GetStorageConfig().stream_target == openbag::kStreamStdout && !openbag::StreamWritable::ReserveStdout())
+    {
+        return -1;
+    }
+
     auto storageConfig = configManager.GetStorageConfig();
     // Add relative path to protobuf message definitions
     storageConfig.proto_search_paths.push_back("examples/message");
     configManager.SetStorageConfig(storageConfig);
 
-    // 创建消息适配器工厂
-    auto adapterFactory = GetLinkAdapterFactory();
+    // 创建消息适配器工厂: 本机共享内存或DDS
+    const auto& transport = configManager.GetRecorderConfig().transport;
+    openbag::MessageAdapterFactoryPtr adapterFactory;
+    if (transport.type == "shm")
+    {
+        adapterFactory = std::make_shared<openbag::ShmAdapterFactory>(transport);
+    } else
+    {
+        adapterFactory = GetLinkAdapterFactory();
+    }
+    if (transport.type != "shm" && configManager.GetRecorderConfig().receive_threads >= 0)
+    {
+        LinkAdapterFactory::UseReceivePool(static_cast<size_t>(configManager.GetRecorderConfig().receive_threads));
+    }
 
     // 创建录制器
     openbag::Recorder recorder(configManager, adapterFactory);
@@ -42,7 +42,10 @@ int main(int argc, char* argv[])
         std::cerr << "Failed to create string subscriber!" << std::endl;
         return -1;
     }
-    auto proto_subscriber = Link::CreateSubscriber<test::TestMessage>("proto_topic_test", proto_message_callback);
+    // Protobuf 消息在 Arena 上解析，回调中的消息引用只在回调期间有效
+    Link::SubscriberOptions proto_options;
+    proto_options.use_arena = true;
+    auto proto_subscriber = Link::CreateSubscriber<test::TestMessage>("proto_topic_test", proto_message_callback, proto_options);
     if (!proto_subscriber)
     {
         std::cerr << "Failed to create proto subscriber!" << std::endl;
@@ -2,8 +2,21 @@
 
 #include <fastdds/dds/domain/DomainParticipant.hpp>
 #include <fastdds/dds/domain/DomainParticipantFactory.hpp>
+#include <fastdds/dds/publisher/Publisher.hpp>
+#include <fastdds/dds/subscriber/Subscriber.hpp>
+#include <fastdds/dds/topic/TypeSupport.hpp>
+#include <fastdds/rtps/flowcontrol/FlowControllerDescriptor.hpp>
+#include <fastdds/rtps/flowcontrol/FlowControllerSchedulerPolicy.hpp>
+#include <cstdint>
+#include <functional>
+#include <list>
 #include <memory>
+#include <mutex>
 #include <stdexcept>
+#include <string>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
 
 namespace Link {
 
@@ -16,6 +29,113 @@ public:
         return participant.get();
     }
 
+    /**
+     * @brief 注册流控器，须在首次获取参与者之前调用
+     *
+     * 异步发布的数据写入器通过名称引用流控器，按调度策略和带宽限制发送数据。
+     *
+     * @param name 流控器名称
+     * @param scheduler 调度策略
+     * @param max_bytes_per_period 每个周期最多发送的字节数，0表示不限制
+     * @param period_ms 周期(毫秒)
+     * @return 是否成功，参与者已创建时返回false
+     */
+    static bool RegisterFlowController(const std::string& name, eprosima::fastdds::rtps::FlowControllerSchedulerPolicy scheduler, int32_t max_bytes_per_period,
+                                       uint64_t period_ms)
+    {
+        std::lock_guard<std::mutex> lock(flowControllerMutex());
+        if (created())
+        {
+            return false;
+        }
+
+        // 描述符只保存名称指针，名称由这里持有
+        flowControllerNames().push_back(name);
+        auto descriptor = std::make_shared<eprosima::fastdds::rtps::FlowControllerDescriptor>();
+        descriptor->name = flowControllerNames().back().c_str();
+        descriptor->scheduler = scheduler;
+        descriptor->max_bytes_per_period = max_bytes_per_period;
+        descriptor->period_ms = period_ms;
+        flowControllers().push_back(descriptor);
+        return true;
+    }
+
+    /**
+     * @brief 查找已注册的流控器名称
+     * @param name 流控器名称
+     * @return 生命周期与进程相同的名称指针(写入器QoS只保存指针)，未注册时返回nullptr
+     */
+    static const char* FindFlowController(const std::string& name)
+    {
+        std::lock_guard<std::mutex> lock(flowControllerMutex());
+        for (const auto& registered : flowControllerNames())
+        {
+            if (registered == name)
+            {
+                return registered.c_str();
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief 按类型名注册类型支持，每个参与者只注册一次
+     *
+     * register_type 需要加锁并比较已注册类型，逐个实体注册在话题很多时会拖慢启动，
+     * 这里按类型名缓存，之后的实体直接复用。
+     *
+     * @param type_name 类型名
+     * @param create 创建类型支持(只在首次注册时调用)
+     * @return 已注册的类型支持，注册失败时为空
+     */
+    static eprosima::fastdds::dds::TypeSupport RegisterType(const std::string& type_name, const std::function<eprosima::fastdds::dds::TopicDataType*()>& create)
+    {
+        auto* participant = GetParticipant();
+        std::lock_guard<std::mutex> lock(typeMutex());
+        auto it = types().find(type_name);
+        if (it != types().end())
+        {
+            return it->second;
+        }
+
+        eprosima::fastdds::dds::TypeSupport type(create());
+        if (type.register_type(participant) != eprosima::fastrtps::types::ReturnCode_t::RETCODE_OK)
+        {
+            return eprosima::fastdds::dds::TypeSupport();
+        }
+        types().emplace(type_name, type);
+        return type;
+    }
+
+    /**
+     * @brief 按生成代码的类型支持类注册类型，每个参与者只注册一次
+     * @tparam PubSubType fastddsgen 生成的类型支持类
+     * @return 已注册的类型支持，注册失败时为空
+     */
+    template <typename PubSubType>
+    static eprosima::fastdds::dds::TypeSupport RegisterType()
+    {
+        return RegisterType(typeid(PubSubType).name(), []() { return new PubSubType(); });
+    }
+
+    /**
+     * @brief 获取共享的发布者实体，所有数据写入器挂在同一个发布者下
+     */
+    static eprosima::fastdds::dds::Publisher* GetPublisher()
+    {
+        static auto* publisher = GetParticipant()->create_publisher(eprosima::fastdds::dds::PUBLISHER_QOS_DEFAULT, nullptr);
+        return publisher;
+    }
+
+    /**
+     * @brief 获取共享的订阅者实体，所有数据读取器挂在同一个订阅者下
+     */
+    static eprosima::fastdds::dds::Subscriber* GetSubscriber()
+    {
+        static auto* subscriber = GetParticipant()->create_subscriber(eprosima::fastdds::dds::SUBSCRIBER_QOS_DEFAULT, nullptr);
+        return subscriber;
+    }
+
     // 禁止构造、拷贝、赋值
     Participant() = delete;
     ~Participant() = delete;
@@ -25,7 +145,17 @@ public:
 private:
     static std::unique_ptr<eprosima::fastdds::dds::DomainParticipant, void (*)(eprosima::fastdds::dds::DomainParticipant*)> createParticipant()
     {
-        auto* raw_participant = eprosima::fastdds::dds::DomainParticipantFactory::get_instance()->create_participant(0, eprosima::fastdds::dds::PARTICIPANT_QOS_DEFAULT);
+        eprosima::fastdds::dds::DomainParticipantQos qos = eprosima::fastdds::dds::PARTICIPANT_QOS_DEFAULT;
+        {
+            std::lock_guard<std::mutex> lock(flowControllerMutex());
+            for (const auto& descriptor : flowControllers())
+            {
+                qos.flow_controllers().push_back(descriptor);
+            }
+            created() = true;
+        }
+
+        auto* raw_participant = eprosima::fastdds::dds::DomainParticipantFactory::get_instance()->create_participant(0, qos);
 
         if (!raw_participant)
         {
@@ -36,10 +166,48 @@ private:
             raw_participant, [](eprosima::fastdds::dds::DomainParticipant* p) {
                 if (p)
                 {
+                    // 共享的发布者/订阅者随参与者一起删除
+                    p->delete_contained_entities();
                     eprosima::fastdds::dds::DomainParticipantFactory::get_instance()->delete_participant(p);
                 }
             });
     }
+
+    static std::mutex& flowControllerMutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    static bool& created()
+    {
+        static bool value = false;
+        return value;
+    }
+
+    static std::mutex& typeMutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    static std::unordered_map<std::string, eprosima::fastdds::dds::TypeSupport>& types()
+    {
+        static std::unordered_map<std::string, eprosima::fastdds::dds::TypeSupport> registered;
+        return registered;
+    }
+
+    static std::list<std::string>& flowControllerNames()
+    {
+        static std::list<std::string> names;
+        return names;
+    }
+
+    static std::vector<std::shared_ptr<eprosima::fastdds::rtps::FlowControllerDescriptor>>& flowControllers()
+    {
+        static std::vector<std::shared_ptr<eprosima::fastdds::rtps::FlowControllerDescriptor>> descriptors;
+        return descriptors;
+    }
 };
 
 }  // namespace Link
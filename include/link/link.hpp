@@ -3,6 +3,7 @@
 #include <memory>
 
 #include "link_publisher.hpp"
+#include "link_raw.hpp"
 #include "link_subscriber.hpp"
 
 namespace Link {
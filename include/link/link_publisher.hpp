@@ -11,6 +11,7 @@
  *
  * 主要类与方法
  * - PublisherBase: 发布者基类接口
+ * - PublisherOptions: 发布者选项(异步发布、流控器、批量发送等)
  * - DDSPublisher: FastDDS发布者实现类
  *   - Publish: 发布消息
  *   - GetTopicName: 获取主题名称
@@ -27,16 +28,57 @@
 #include <fastdds/dds/publisher/DataWriterListener.hpp>
 #include <fastdds/dds/publisher/Publisher.hpp>
 #include <fastdds/dds/topic/TypeSupport.hpp>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <limits>
+#include <mutex>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <type_traits>
 #include <vector>
 
 #include "dds_participant.hpp"
 #include "general.h"
 #include "generalPubSubTypes.h"
+#include "message_batch.hpp"
 
 namespace Link {
+/**
+ * @brief 发布者选项
+ */
+struct PublisherOptions
+{
+    /**
+     * @brief 是否异步发布
+     *
+     * 同步发布时 Publish 在调用线程中完成分片和发送，大负载会阻塞调用方；
+     * 异步发布时 Publish 只把样本放入发送队列即返回，由FastDDS发送线程按流控器发送。
+     */
+    bool async = false;
+
+    std::string flow_controller;  ///< 异步发布使用的流控器名称(须已通过 Participant::RegisterFlowController 注册)，为空时使用默认流控器
+    int32_t priority = 10;        ///< 在优先级调度的流控器中的优先级(-10最高 ~ 10最低)
+    int32_t history_depth = 10;   ///< 发送历史深度，异步发布且带宽受限时应足以容纳突发数据
+
+    /**
+     * @brief 批量发送的最大消息数，0表示不批量发送
+     *
+     * 批量发送时多条消息打包进一个样本(格式见 message_batch.hpp)，达到消息数、字节数
+     * 或最早一条消息等待超过最大延迟时发送。订阅端自动拆包，逐条调用回调。
+     *
+     * 批量帧不携带每条消息的时间，同一批次的消息在订阅端几乎同时回调：以接收时间打时间戳的
+     * 订阅方(如录制)会把批次内最多 batch_max_latency_us 的发布间隔压缩为同一时刻。
+     * 对消息间隔敏感的话题不应开启批量发送，或应在消息体中自带时间戳。
+     */
+    size_t batch_max_messages = 0;
+
+    size_t batch_max_bytes = 64 * 1024;    ///< 批量发送的最大字节数
+    uint32_t batch_max_latency_us = 1000;  ///< 批量发送的最大延迟(微秒)
+};
+
 /**
  * @brief 发布者基类接口，定义了发布消息的通用契约。
  */
@@ -86,27 +128,42 @@ public:
     /**
      * @brief 构造函数，初始化DDSPublisher实例。
      * @param topic_name 要发布的主题名称
+     * @param options 发布者选项
      * @exception std::runtime_error 如果DomainParticipant为null或创建DDS实体失败
      */
-    DDSPublisher(const std::string& topic_name)
+    DDSPublisher(const std::string& topic_name, const PublisherOptions& options = PublisherOptions())
         : m_topicName(topic_name),
           m_participant(Link::Participant::GetParticipant()),
           m_ddsPublisher(nullptr),
           m_topic(nullptr),
           m_writer(nullptr),
-          m_typeSupport(new General::MessagePubSubType())
+          m_typeSupport(Link::Participant::RegisterType<General::MessagePubSubType>()),
+          m_batchMaxMessages(options.batch_max_messages),
+          m_batchMaxBytes(options.batch_max_bytes),
+          m_batchMaxLatency(options.batch_max_latency_us)
     {
         if (!m_participant)
         {
             throw std::runtime_error("DdsPublisher: DomainParticipant is null for topic " + m_topicName + "!");
         }
 
-        if (m_typeSupport.register_type(m_participant) != eprosima::fastrtps::types::ReturnCode_t::RETCODE_OK)
+        const char* flowController = nullptr;
+        if (options.async && !options.flow_controller.empty())
+        {
+            flowController = Link::Participant::FindFlowController(options.flow_controller);
+            if (flowController == nullptr)
+            {
+                throw std::runtime_error("DdsPublisher: Flow controller " + options.flow_controller + " is not registered for topic " + m_topicName);
+            }
+        }
+
+        if (m_typeSupport.empty())
         {
             throw std::runtime_error("DdsPublisher: Failed to register type for topic " + m_topicName);
         }
 
-        m_ddsPublisher = m_participant->create_publisher(eprosima::fastdds::dds::PUBLISHER_QOS_DEFAULT, nullptr);
+        // 类型和发布者实体在参与者内共享，每个话题只创建主题和数据写入器
+        m_ddsPublisher = Link::Participant::GetPublisher();
         if (m_ddsPublisher == nullptr)
         {
             throw std::runtime_error("DdsPublisher: Failed to create DDS Publisher for topic " + m_topicName);
@@ -115,25 +172,38 @@ public:
         m_topic = m_participant->create_topic(m_topicName, m_typeSupport.get_type_name(), eprosima::fastdds::dds::TOPIC_QOS_DEFAULT);
         if (m_topic == nullptr)
         {
-            m_participant->delete_publisher(m_ddsPublisher);
-            m_ddsPublisher = nullptr;
             throw std::runtime_error("DdsPublisher: Failed to create DDS Topic " + m_topicName);
         }
 
         eprosima::fastdds::dds::DataWriterQos wqos = eprosima::fastdds::dds::DATAWRITER_QOS_DEFAULT;
         wqos.reliability().kind = eprosima::fastdds::dds::RELIABLE_RELIABILITY_QOS;
         wqos.history().kind = eprosima::fastdds::dds::KEEP_LAST_HISTORY_QOS;
-        wqos.history().depth = 10;
+        wqos.history().depth = options.history_depth > 0 ? options.history_depth : 10;
+        if (options.async)
+        {
+            wqos.publish_mode().kind = eprosima::fastdds::dds::ASYNCHRONOUS_PUBLISH_MODE;
+            if (flowController != nullptr)
+            {
+                wqos.publish_mode().flow_controller_name = flowController;
+            }
+            wqos.properties().properties().emplace_back("fastdds.sfc.priority", std::to_string(options.priority));
+        }
 
         m_writer = m_ddsPublisher->create_datawriter(m_topic, wqos, &m_listener);
         if (m_writer == nullptr)
         {
             m_participant->delete_topic(m_topic);
             m_topic = nullptr;
-            m_participant->delete_publisher(m_ddsPublisher);
-            m_ddsPublisher = nullptr;
             throw std::runtime_error("DdsPublisher: Failed to create DDS DataWriter for topic " + m_topicName);
         }
+
+        // 批量发送时由刷新线程在最大延迟到达时发送未满的批次
+        if (m_batchMaxMessages > 0)
+        {
+            m_generalMsgInstance.header().type(BatchType(std::is_same<T, std::string>::value ? "string" : "proto"));
+            m_batchRunning = true;
+            m_batchThread = std::thread(&DDSPublisher::BatchFlushLoop, this);
+        }
     }
 
     /**
@@ -141,6 +211,16 @@ public:
      */
     ~DDSPublisher() override
     {
+        // 先发送剩余的批次再删除写入器
+        if (m_batchThread.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_batchMutex);
+                m_batchRunning = false;
+            }
+            m_batchCV.notify_all();
+            m_batchThread.join();
+        }
         if (m_writer != nullptr && m_ddsPublisher != nullptr)
         {
             m_ddsPublisher->delete_datawriter(m_writer);
@@ -149,10 +229,6 @@ public:
         {
             m_participant->delete_topic(m_topic);
         }
-        if (m_ddsPublisher != nullptr && m_participant != nullptr)
-        {
-            m_participant->delete_publisher(m_ddsPublisher);
-        }
     }
 
     /**
@@ -170,13 +246,121 @@ public:
         return SerializeAndPublish(message);
     }
 
+    /**
+     * @brief 把字符串消息封装为待发送的通用消息，不访问发布者状态，可在任意线程调用。
+     * @param string_message 消息数据
+     * @param message 输出的通用消息
+     */
+    static void PrepareMessage(const std::string& string_message, General::Message& message)
+    {
+        message.header().type("string");
+        message.payload().assign(string_message.begin(), string_message.end());
+    }
+
+    /**
+     * @brief 发布已封装好的通用消息，发布时只剩DDS写入。
+     * @param message 由 PrepareMessage 封装的消息
+     * @return true表示发布成功
+     */
+    bool PublishPrepared(const General::Message& message)
+    {
+        if (m_writer == nullptr)
+        {
+            return false;
+        }
+        if (m_batchMaxMessages > 0)
+        {
+            const auto& payload = message.payload();
+            return AppendToBatch(payload.size(), [&payload](uint8_t* out) {
+                std::copy(payload.begin(), payload.end(), out);
+                return true;
+            });
+        }
+        return m_writer->write(const_cast<General::Message*>(&message));
+    }
+
     /**
      * @brief 获取当前发布者关联的主题名称。
      * @return 主题名称的常量引用。
      */
     const std::string& GetTopicName() const override { return m_topicName; }
 
+    /**
+     * @brief 立即发送未满的批次(未开启批量发送时无操作)。
+     * @return true表示发送成功或没有待发送的消息
+     */
+    bool Flush()
+    {
+        std::lock_guard<std::mutex> lock(m_batchMutex);
+        return FlushBatchLocked();
+    }
+
 private:
+    /**
+     * @brief 把一条消息加入批次，写入函数负责把消息写到预留的位置。
+     * @param size 消息字节数
+     * @param write 写入函数，参数为预留空间的起始位置，返回是否成功
+     * @return true表示加入(或随批次发送)成功
+     */
+    template <typename Writer>
+    bool AppendToBatch(size_t size, Writer&& write)
+    {
+        std::lock_guard<std::mutex> lock(m_batchMutex);
+        auto& payload = m_generalMsgInstance.payload();
+        const size_t rollback = payload.size();
+        if (!write(BeginBatchFrame(payload, size)))
+        {
+            payload.resize(rollback);
+            return false;
+        }
+
+        if (m_batchCount++ == 0)
+        {
+            m_batchDeadline = std::chrono::steady_clock::now() + m_batchMaxLatency;
+            m_batchCV.notify_one();
+        }
+        if (m_batchCount >= m_batchMaxMessages || payload.size() >= m_batchMaxBytes)
+        {
+            return FlushBatchLocked();
+        }
+        return true;
+    }
+
+    /**
+     * @brief 发送当前批次(需持有 m_batchMutex)。
+     */
+    bool FlushBatchLocked()
+    {
+        if (m_batchCount == 0)
+        {
+            return true;
+        }
+        const bool written = m_writer->write(&m_generalMsgInstance);
+        m_generalMsgInstance.payload().clear();  // 保留容量，下一批次复用
+        m_batchCount = 0;
+        m_batchCV.notify_one();
+        return written;
+    }
+
+    /**
+     * @brief 批次刷新线程：最早一条消息等待超过最大延迟时发送批次。
+     */
+    void BatchFlushLoop()
+    {
+        std::unique_lock<std::mutex> lock(m_batchMutex);
+        while (m_batchRunning)
+        {
+            if (m_batchCount == 0)
+            {
+                m_batchCV.wait(lock, [this] { return !m_batchRunning || m_batchCount > 0; });
+            } else if (!m_batchCV.wait_until(lock, m_batchDeadline, [this] { return !m_batchRunning || m_batchCount == 0; }))
+            {
+                FlushBatchLocked();
+            }
+        }
+        FlushBatchLocked();
+    }
+
     /**
      * @brief 序列化Protobuf消息并发布。
      * @tparam U 消息类型，必须是google::protobuf::Message的派生类
@@ -187,13 +371,32 @@ private:
     bool SerializeAndPublish(const U& proto_message)
     {
         static_assert(std::is_same<T, U>::value, "Type mismatch in Protobuf publish specialization.");
-        m_generalMsgInstance.header().type("proto");
-        std::string serializedData;
-        if (!proto_message.SerializeToString(&serializedData))
+
+        // 直接序列化到负载缓冲区，缓冲区容量在多次发布间复用
+        const size_t byteSize = proto_message.ByteSizeLong();
+        if (byteSize > static_cast<size_t>(std::numeric_limits<int>::max()))
         {
             return false;
         }
-        m_generalMsgInstance.payload().assign(serializedData.begin(), serializedData.end());
+        if (m_batchMaxMessages > 0)
+        {
+            return AppendToBatch(byteSize, [&proto_message, byteSize](uint8_t* out) {
+                return static_cast<size_t>(proto_message.SerializeWithCachedSizesToArray(out) - out) == byteSize;
+            });
+        }
+
+        m_generalMsgInstance.header().type("proto");
+        auto& payload = m_generalMsgInstance.payload();
+        payload.resize(byteSize);
+        if (byteSize > 0)
+        {
+            // ByteSizeLong 已缓存各层大小，无需再次计算
+            auto* end = proto_message.SerializeWithCachedSizesToArray(reinterpret_cast<uint8_t*>(payload.data()));
+            if (static_cast<size_t>(end - reinterpret_cast<uint8_t*>(payload.data())) != byteSize)
+            {
+                return false;  // 序列化期间消息被修改
+            }
+        }
         return m_writer->write(&m_generalMsgInstance);
     }
 
@@ -207,6 +410,14 @@ private:
     bool SerializeAndPublish(const U& string_message)
     {
         static_assert(std::is_same<T, U>::value, "Type mismatch in std::string publish specialization.");
+        if (m_batchMaxMessages > 0)
+        {
+            return AppendToBatch(string_message.size(), [&string_message](uint8_t* out) {
+                std::copy(string_message.begin(), string_message.end(), out);
+                return true;
+            });
+        }
+
         m_generalMsgInstance.header().type("string");
         m_generalMsgInstance.payload().assign(string_message.begin(), string_message.end());
         return m_writer->write(&m_generalMsgInstance);
@@ -214,24 +425,35 @@ private:
 
     std::string m_topicName;                                   ///< 用于存储主题名称
     eprosima::fastdds::dds::DomainParticipant* m_participant;  ///< FastDDS域参与者
-    eprosima::fastdds::dds::Publisher* m_ddsPublisher;         ///< FastDDS发布者
+    eprosima::fastdds::dds::Publisher* m_ddsPublisher;         ///< FastDDS发布者(参与者内共享)
     eprosima::fastdds::dds::Topic* m_topic;                    ///< FastDDS主题
     eprosima::fastdds::dds::DataWriter* m_writer;              ///< FastDDS数据写入器
     eprosima::fastdds::dds::TypeSupport m_typeSupport;         ///< FastDDS类型支持
     General::Message m_generalMsgInstance;                     ///< 通用消息实例，用于序列化和发布
     DDSPublisherListener m_listener;                           ///< 发布者监听器
+
+    size_t m_batchMaxMessages;                                 ///< 批量发送的最大消息数，0表示不批量发送
+    size_t m_batchMaxBytes;                                    ///< 批量发送的最大字节数
+    std::chrono::microseconds m_batchMaxLatency;               ///< 批量发送的最大延迟
+    size_t m_batchCount = 0;                                   ///< 当前批次中的消息数
+    std::chrono::steady_clock::time_point m_batchDeadline;     ///< 当前批次的发送期限
+    bool m_batchRunning = false;                               ///< 刷新线程运行标志
+    std::mutex m_batchMutex;                                   ///< 保护批次和通用消息实例
+    std::condition_variable m_batchCV;                         ///< 刷新线程条件变量
+    std::thread m_batchThread;                                 ///< 批次刷新线程
 };
 
 /**
  * @brief 创建Link::PublisherBase<T>的共享指针实例的工厂函数。
  * @tparam T 消息类型
  * @param topic_name 要发布的主题名称
+ * @param options 发布者选项
  * @return Link::PublisherBase<T>的共享指针
  */
 template <typename T>
-std::shared_ptr<Link::PublisherBase<T>> CreatePublisher(const std::string& topic_name)
+std::shared_ptr<Link::PublisherBase<T>> CreatePublisher(const std::string& topic_name, const PublisherOptions& options = PublisherOptions())
 {
-    return std::make_shared<DDSPublisher<T>>(topic_name);
+    return std::make_shared<DDSPublisher<T>>(topic_name, options);
 }
 
 }  // namespace Link
@@ -0,0 +1,347 @@
+/**
+ * @author Zhao Jun (zwhy2025@gmail.com)
+ * @version 0.1
+ * @date 2024-07-30
+ *
+ * @file link_raw.hpp
+ * @brief Link库的原始CDR数据收发
+ *
+ * 按对端的DDS类型名注册一个不解析内容的类型支持，收发的是线上的序列化数据
+ * (含4字节封装头的CDR字节)，可用于录制和回放任意IDL类型的话题，
+ * 不需要对应的生成代码，也不经过protobuf转换。
+ *
+ * 限制: 类型按无键(NO_KEY)注册，只能与无键话题匹配。
+ *
+ * 主要类与方法
+ * - RawTopicDataType: 原始数据类型支持
+ * - RawDDSSubscriber: 原始数据订阅者，回调收到序列化字节
+ * - RawDDSPublisher: 原始数据发布者，按原样发布序列化字节
+ * - CreateRawSubscriber/CreateRawPublisher: 工厂函数
+ */
+
+#pragma once
+
+#include <fastdds/dds/core/policy/QosPolicies.hpp>
+#include <fastdds/dds/domain/DomainParticipant.hpp>
+#include <fastdds/dds/publisher/DataWriter.hpp>
+#include <fastdds/dds/publisher/Publisher.hpp>
+#include <fastdds/dds/subscriber/DataReader.hpp>
+#include <fastdds/dds/subscriber/DataReaderListener.hpp>
+#include <fastdds/dds/subscriber/SampleInfo.hpp>
+#include <fastdds/dds/subscriber/Subscriber.hpp>
+#include <fastdds/dds/topic/TopicDataType.hpp>
+#include <fastdds/dds/topic/TypeSupport.hpp>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+#include "dds_participant.hpp"
+#include "link_publisher.hpp"
+#include "link_subscriber.hpp"
+
+namespace Link {
+
+/**
+ * @brief 原始数据样本，data 为含封装头的序列化字节
+ */
+struct RawSample
+{
+    std::string data;  ///< 序列化数据
+};
+
+/**
+ * @brief 原始数据类型支持：序列化/反序列化只做字节拷贝
+ */
+class RawTopicDataType : public eprosima::fastdds::dds::TopicDataType
+{
+public:
+    /**
+     * @brief 构造函数
+     * @param type_name 对端使用的DDS类型名(须完全一致才能匹配)
+     * @param max_sample_size 最大样本字节数
+     */
+    RawTopicDataType(const std::string& type_name, uint32_t max_sample_size)
+    {
+        setName(type_name.c_str());
+        m_typeSize = max_sample_size;
+        m_isGetKeyDefined = false;
+    }
+
+    bool serialize(void* data, eprosima::fastrtps::rtps::SerializedPayload_t* payload) override
+    {
+        const auto* sample = static_cast<RawSample*>(data);
+        const auto size = static_cast<uint32_t>(sample->data.size());
+        if (size > payload->max_size)
+        {
+            payload->reserve(size);
+        }
+        std::memcpy(payload->data, sample->data.data(), size);
+        payload->length = size;
+
+        // 封装头前两个字节为表示标识(大端存放)，原样保留编码种类(CDR/PL_CDR/CDR2 等)，
+        // 其最低位为字节序(1为小端)；数据不足两字节时按 CDR_LE 处理
+        if (size >= 2)
+        {
+            const auto* bytes = reinterpret_cast<const uint8_t*>(sample->data.data());
+            payload->encapsulation = static_cast<uint16_t>((bytes[0] << 8) | bytes[1]);
+        } else
+        {
+            payload->encapsulation = CDR_LE;
+        }
+        return true;
+    }
+
+    bool deserialize(eprosima::fastrtps::rtps::SerializedPayload_t* payload, void* data) override
+    {
+        auto* sample = static_cast<RawSample*>(data);
+        sample->data.assign(reinterpret_cast<const char*>(payload->data), payload->length);
+        return true;
+    }
+
+    std::function<uint32_t()> getSerializedSizeProvider(void* data) override
+    {
+        return [data]() { return static_cast<uint32_t>(static_cast<RawSample*>(data)->data.size()); };
+    }
+
+    void* createData() override { return new RawSample(); }
+
+    void deleteData(void* data) override { delete static_cast<RawSample*>(data); }
+
+    bool getKey(void* data, eprosima::fastrtps::rtps::InstanceHandle_t* handle, bool force_md5 = false) override { return false; }
+};
+
+/**
+ * @brief 原始数据订阅者
+ */
+class RawDDSSubscriber : public SubscriberBase, public eprosima::fastdds::dds::DataReaderListener
+{
+public:
+    /**
+     * @brief 回调函数类型，参数为含封装头的序列化字节
+     */
+    using UserCallbackType = std::function<void(const std::string&)>;
+
+    /**
+     * @brief 构造函数
+     * @param topic_name 话题名称
+     * @param type_name 对端使用的DDS类型名
+     * @param callback 回调函数
+     * @param max_sample_size 最大样本字节数
+     * @exception std::runtime_error 如果DomainParticipant为null或创建DDS实体失败
+     */
+    RawDDSSubscriber(const std::string& topic_name, const std::string& type_name, UserCallbackType callback, uint32_t max_sample_size = 16 * 1024 * 1024)
+        : m_topicName(topic_name),
+          m_participant(Link::Participant::GetParticipant()),
+          m_typeSupport(Link::Participant::RegisterType(type_name, [&]() { return new RawTopicDataType(type_name, max_sample_size); })),
+          m_userCallback(callback)
+    {
+        if (!m_participant || !m_userCallback)
+        {
+            throw std::runtime_error("RawDdsSubscriber: DomainParticipant or callback is null for topic " + m_topicName + "!");
+        }
+        m_ddsSubscriber = Link::Participant::GetSubscriber();
+        m_topic = m_ddsSubscriber && !m_typeSupport.empty() ? m_participant->create_topic(m_topicName, m_typeSupport.get_type_name(), eprosima::fastdds::dds::TOPIC_QOS_DEFAULT) : nullptr;
+        if (m_topic != nullptr)
+        {
+            eprosima::fastdds::dds::DataReaderQos rqos = eprosima::fastdds::dds::DATAREADER_QOS_DEFAULT;
+            rqos.reliability().kind = eprosima::fastdds::dds::RELIABLE_RELIABILITY_QOS;
+            rqos.history().kind = eprosima::fastdds::dds::KEEP_LAST_HISTORY_QOS;
+            rqos.history().depth = 10;
+            // 样本大小不定，按实际大小分配并复用，避免按最大样本预分配
+            rqos.endpoint().history_memory_policy = eprosima::fastrtps::rtps::DYNAMIC_REUSABLE_MEMORY_MODE;
+            m_reader = m_ddsSubscriber->create_datareader(m_topic, rqos, this);
+        }
+        if (m_reader == nullptr)
+        {
+            Cleanup();
+            throw std::runtime_error("RawDdsSubscriber: Failed to create DDS entities for topic " + m_topicName);
+        }
+    }
+
+    ~RawDDSSubscriber() override { Cleanup(); }
+
+    /**
+     * @brief 获取话题名称
+     */
+    const std::string& GetTopicName() const override { return m_topicName; }
+
+    /**
+     * @brief 数据可用时取出所有样本并调用回调
+     */
+    void on_data_available(eprosima::fastdds::dds::DataReader* reader) override
+    {
+        eprosima::fastdds::dds::SampleInfo info;
+        while (reader->take_next_sample(&m_sample, &info) == eprosima::fastrtps::types::ReturnCode_t::RETCODE_OK)
+        {
+            if (info.valid_data && info.instance_state == eprosima::fastdds::dds::ALIVE_INSTANCE_STATE)
+            {
+                m_userCallback(m_sample.data);
+            }
+        }
+    }
+
+private:
+    void Cleanup()
+    {
+        if (m_reader != nullptr)
+        {
+            m_ddsSubscriber->delete_datareader(m_reader);
+            m_reader = nullptr;
+        }
+        if (m_topic != nullptr)
+        {
+            m_participant->delete_topic(m_topic);
+            m_topic = nullptr;
+        }
+    }
+
+    std::string m_topicName;                                        ///< 话题名称
+    eprosima::fastdds::dds::DomainParticipant* m_participant;       ///< FastDDS域参与者
+    eprosima::fastdds::dds::Subscriber* m_ddsSubscriber = nullptr;  ///< FastDDS订阅者(参与者内共享)
+    eprosima::fastdds::dds::Topic* m_topic = nullptr;               ///< FastDDS主题
+    eprosima::fastdds::dds::DataReader* m_reader = nullptr;         ///< FastDDS数据读取器
+    eprosima::fastdds::dds::TypeSupport m_typeSupport;              ///< 原始数据类型支持
+    UserCallbackType m_userCallback;                                ///< 回调函数
+    RawSample m_sample;                                             ///< 复用的接收样本
+};
+
+/**
+ * @brief 原始数据发布者，Publish 的参数为含封装头的序列化字节
+ */
+class RawDDSPublisher : public PublisherBase<std::string>
+{
+public:
+    /**
+     * @brief 构造函数
+     * @param topic_name 话题名称
+     * @param type_name DDS类型名
+     * @param options 发布者选项(批量发送选项不适用)
+     * @param max_sample_size 最大样本字节数
+     * @exception std::runtime_error 如果DomainParticipant为null或创建DDS实体失败
+     */
+    RawDDSPublisher(const std::string& topic_name, const std::string& type_name, const PublisherOptions& options = PublisherOptions(),
+                    uint32_t max_sample_size = 16 * 1024 * 1024)
+        : m_topicName(topic_name),
+          m_participant(Link::Participant::GetParticipant()),
+          m_typeSupport(Link::Participant::RegisterType(type_name, [&]() { return new RawTopicDataType(type_name, max_sample_size); }))
+    {
+        if (!m_participant)
+        {
+            throw std::runtime_error("RawDdsPublisher: DomainParticipant is null for topic " + m_topicName + "!");
+        }
+
+        const char* flowController = nullptr;
+        if (options.async && !options.flow_controller.empty())
+        {
+            flowController = Link::Participant::FindFlowController(options.flow_controller);
+            if (flowController == nullptr)
+            {
+                throw std::runtime_error("RawDdsPublisher: Flow controller " + options.flow_controller + " is not registered for topic " + m_topicName);
+            }
+        }
+        m_ddsPublisher = Link::Participant::GetPublisher();
+        m_topic = m_ddsPublisher && !m_typeSupport.empty() ? m_participant->create_topic(m_topicName, m_typeSupport.get_type_name(), eprosima::fastdds::dds::TOPIC_QOS_DEFAULT) : nullptr;
+        if (m_topic != nullptr)
+        {
+            eprosima::fastdds::dds::DataWriterQos wqos = eprosima::fastdds::dds::DATAWRITER_QOS_DEFAULT;
+            wqos.reliability().kind = eprosima::fastdds::dds::RELIABLE_RELIABILITY_QOS;
+            wqos.history().kind = eprosima::fastdds::dds::KEEP_LAST_HISTORY_QOS;
+            wqos.history().depth = options.history_depth > 0 ? options.history_depth : 10;
+            wqos.endpoint().history_memory_policy = eprosima::fastrtps::rtps::DYNAMIC_REUSABLE_MEMORY_MODE;
+            if (options.async)
+            {
+                wqos.publish_mode().kind = eprosima::fastdds::dds::ASYNCHRONOUS_PUBLISH_MODE;
+                if (flowController != nullptr)
+                {
+                    wqos.publish_mode().flow_controller_name = flowController;
+                }
+                wqos.properties().properties().emplace_back("fastdds.sfc.priority", std::to_string(options.priority));
+            }
+            m_writer = m_ddsPublisher->create_datawriter(m_topic, wqos, nullptr);
+        }
+        if (m_writer == nullptr)
+        {
+            Cleanup();
+            throw std::runtime_error("RawDdsPublisher: Failed to create DDS entities for topic " + m_topicName);
+        }
+    }
+
+    ~RawDDSPublisher() override { Cleanup(); }
+
+    /**
+     * @brief 按原样发布序列化字节
+     * @param message 含封装头的序列化数据
+     * @return 是否发布成功
+     */
+    bool Publish(const std::string& message) override
+    {
+        if (m_writer == nullptr)
+        {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_sample.data = message;
+        return m_writer->write(&m_sample);
+    }
+
+    /**
+     * @brief 获取话题名称
+     */
+    const std::string& GetTopicName() const override { return m_topicName; }
+
+private:
+    void Cleanup()
+    {
+        if (m_writer != nullptr)
+        {
+            m_ddsPublisher->delete_datawriter(m_writer);
+            m_writer = nullptr;
+        }
+        if (m_topic != nullptr)
+        {
+            m_participant->delete_topic(m_topic);
+            m_topic = nullptr;
+        }
+    }
+
+    std::string m_topicName;                                      ///< 话题名称
+    eprosima::fastdds::dds::DomainParticipant* m_participant;     ///< FastDDS域参与者
+    eprosima::fastdds::dds::Publisher* m_ddsPublisher = nullptr;  ///< FastDDS发布者(参与者内共享)
+    eprosima::fastdds::dds::Topic* m_topic = nullptr;             ///< FastDDS主题
+    eprosima::fastdds::dds::DataWriter* m_writer = nullptr;       ///< FastDDS数据写入器
+    eprosima::fastdds::dds::TypeSupport m_typeSupport;            ///< 原始数据类型支持
+    RawSample m_sample;                                           ///< 复用的发送样本
+    std::mutex m_mutex;                                           ///< 保护发送样本
+};
+
+/**
+ * @brief 创建原始数据订阅者
+ * @param topic_name 话题名称
+ * @param type_name 对端使用的DDS类型名
+ * @param callback 回调函数，参数为含封装头的序列化字节
+ * @return 订阅者共享指针
+ */
+inline std::shared_ptr<Link::SubscriberBase> CreateRawSubscriber(const std::string& topic_name, const std::string& type_name,
+                                                                 std::function<void(const std::string&)> callback)
+{
+    return std::make_shared<RawDDSSubscriber>(topic_name, type_name, callback);
+}
+
+/**
+ * @brief 创建原始数据发布者
+ * @param topic_name 话题名称
+ * @param type_name DDS类型名
+ * @param options 发布者选项
+ * @return 发布者共享指针
+ */
+inline std::shared_ptr<Link::PublisherBase<std::string>> CreateRawPublisher(const std::string& topic_name, const std::string& type_name,
+                                                                           const PublisherOptions& options = PublisherOptions())
+{
+    return std::make_shared<RawDDSPublisher>(topic_name, type_name, options);
+}
+
+}  // namespace Link
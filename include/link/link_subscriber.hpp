@@ -11,6 +11,7 @@
  *
  * 主要类与方法
  * - SubscriberBase: 订阅者基类接口
+ * - SubscriberOptions: 订阅者选项(Arena 复用模式、接收线程池模式等)
  * - DDSSubscriber: FastDDS订阅者实现类
  *   - GetTopicName: 获取主题名称
  * - CreateSubscriber: 创建订阅者实例的工厂函数
@@ -19,6 +20,7 @@
 #pragma once
 
 #include <fastdds/rtps/common/Types.h>
+#include <google/protobuf/arena.h>
 #include <google/protobuf/message.h>
 
 #include <fastdds/dds/domain/DomainParticipant.hpp>
@@ -29,15 +31,20 @@
 #include <fastdds/dds/subscriber/Subscriber.hpp>
 #include <fastdds/dds/subscriber/qos/DataReaderQos.hpp>
 #include <fastdds/dds/topic/TypeSupport.hpp>
+#include <cstdint>
 #include <functional>
 #include <iostream>
+#include <memory>
 #include <stdexcept>
 #include <string>
 #include <type_traits>
+#include <vector>
 
 #include "dds_participant.hpp"
 #include "general.h"
 #include "generalPubSubTypes.h"
+#include "message_batch.hpp"
+#include "receive_pool.hpp"
 
 namespace Link {
 /**
@@ -55,6 +62,32 @@ public:
     virtual const std::string& GetTopicName() const = 0;
 };
 
+/**
+ * @brief 订阅者选项
+ */
+struct SubscriberOptions
+{
+    /**
+     * @brief 是否在 Arena 上解析 Protobuf 消息(对 std::string 类型无效)
+     *
+     * 开启后每个订阅者持有一个 Arena，每条消息解析前复位 Arena，初始内存块在消息间复用，
+     * 嵌套消息不再逐个向堆分配。回调收到的消息引用仅在回调期间有效，需保留时应自行拷贝。
+     */
+    bool use_arena = false;
+
+    size_t arena_block_size = 64 * 1024;  ///< Arena 初始内存块大小(字节)，超出部分由 Arena 按需分配并在复位时释放
+
+    /**
+     * @brief 是否由接收线程池取数据并调用回调(默认在FastDDS监听器线程中调用)
+     *
+     * 开启后回调在 ReceiveThreadPool 的专用线程中执行，慢回调只阻塞同一线程上的话题，
+     * 不影响FastDDS内部线程。线程数通过 ReceiveThreadPool::SetThreadCount 设置。
+     */
+    bool use_receive_pool = false;
+
+    int receive_thread = -1;  ///< 接收线程序号，小于0时按话题名哈希分配
+};
+
 /**
  * @brief 基于FastDDS的通用订阅者实现类，支持Protobuf和std::string类型。
  * @tparam T 消息类型，可以是Protobuf消息或std::string
@@ -78,8 +111,24 @@ public:
          * @brief 构造函数，初始化DDSSubscriberListener实例。
          * @param owner_subscriber 拥有此监听器的DDSSubscriber实例指针
          * @param user_callback 用户提供的消息处理回调函数
+         * @param options 订阅者选项
          */
-        DDSSubscriberListener(DDSSubscriber<T>* owner_subscriber, UserCallbackType user_callback) : m_ownerSubscriber(owner_subscriber), m_userCallback(user_callback) {}
+        DDSSubscriberListener(DDSSubscriber<T>* owner_subscriber, UserCallbackType user_callback, const SubscriberOptions& options = SubscriberOptions())
+            : m_ownerSubscriber(owner_subscriber), m_userCallback(user_callback)
+        {
+            if constexpr (std::is_base_of<google::protobuf::Message, T>::value)
+            {
+                if (options.use_arena)
+                {
+                    // 用户提供的初始块在 Reset 后保留，稳定状态下解析不再向堆申请内存
+                    m_arenaBlock.resize(options.arena_block_size);
+                    google::protobuf::ArenaOptions arenaOptions;
+                    arenaOptions.initial_block = m_arenaBlock.empty() ? nullptr : m_arenaBlock.data();
+                    arenaOptions.initial_block_size = m_arenaBlock.size();
+                    m_arena = std::make_unique<google::protobuf::Arena>(arenaOptions);
+                }
+            }
+        }
 
         /**
          * @brief 当数据可用时调用的回调函数。
@@ -98,6 +147,22 @@ public:
             }
         }
 
+        /**
+         * @brief 取出读取器中所有可用数据并逐条调用回调(接收线程池模式使用)。
+         * @param reader 数据读取器
+         */
+        void TakeAll(eprosima::fastdds::dds::DataReader* reader)
+        {
+            eprosima::fastdds::dds::SampleInfo info;
+            while (reader->take_next_sample(&m_receivedMsg, &info) == eprosima::fastrtps::types::ReturnCode_t::RETCODE_OK)
+            {
+                if (info.valid_data && info.instance_state == eprosima::fastdds::dds::ALIVE_INSTANCE_STATE)
+                {
+                    DeserializeAndInvoke(m_receivedMsg);
+                }
+            }
+        }
+
         /**
          * @brief 当订阅者与发布者匹配时调用的回调函数。
          * @param reader 发生匹配事件的数据读取器
@@ -114,7 +179,7 @@ public:
 
     private:
         /**
-         * @brief 反序列化Protobuf消息并调用用户回调函数。
+         * @brief 反序列化Protobuf消息并调用用户回调函数，批量消息拆包后逐条调用。
          * @tparam U 消息类型，必须是google::protobuf::Message的派生类
          * @param general_msg 包含序列化数据的通用消息
          * @return true表示成功反序列化并调用回调，false表示失败
@@ -123,23 +188,59 @@ public:
         bool DeserializeAndInvoke(const General::Message& general_msg)
         {
             static_assert(std::is_same<T, U>::value, "Type mismatch in Protobuf deserialize specialization.");
+            const auto* data = reinterpret_cast<const uint8_t*>(general_msg.payload().data());
+            const size_t size = general_msg.payload().size();
             if (general_msg.header().type() == "proto")
             {
-                T specificMessage;
-                if (specificMessage.ParseFromArray(general_msg.payload().data(), static_cast<int>(general_msg.payload().size())))
-                {
-                    if (m_userCallback)
+                return ParseAndInvoke(data, size);
+            }
+            if (IsBatchType(general_msg.header().type(), "proto"))
+            {
+                bool invoked = true;
+                const bool complete = ForEachBatchFrame(data, size, [this, &invoked](const uint8_t* frame, size_t frameSize) {
+                    if (!ParseAndInvoke(frame, frameSize))
                     {
-                        m_userCallback(specificMessage);
-                        return true;
+                        invoked = false;
                     }
+                });
+                return complete && invoked;
+            }
+            return false;
+        }
+
+        /**
+         * @brief 解析一条Protobuf消息并调用用户回调函数。
+         */
+        template <typename U = T, typename std::enable_if<std::is_base_of<google::protobuf::Message, U>::value, int>::type = 0>
+        bool ParseAndInvoke(const uint8_t* data, size_t size)
+        {
+            if (m_arena)
+            {
+                // 复位 Arena 回收上一条消息，新消息在复用的内存块上解析
+                m_arena->Reset();
+                T* arenaMessage = google::protobuf::Arena::CreateMessage<T>(m_arena.get());
+                if (arenaMessage->ParseFromArray(data, static_cast<int>(size)) && m_userCallback)
+                {
+                    m_userCallback(*arenaMessage);
+                    return true;
+                }
+                return false;
+            }
+
+            T specificMessage;
+            if (specificMessage.ParseFromArray(data, static_cast<int>(size)))
+            {
+                if (m_userCallback)
+                {
+                    m_userCallback(specificMessage);
+                    return true;
                 }
             }
             return false;
         }
 
         /**
-         * @brief 反序列化std::string消息并调用用户回调函数。
+         * @brief 反序列化std::string消息并调用用户回调函数，批量消息拆包后逐条调用。
          * @tparam U 消息类型，必须是std::string
          * @param general_msg 包含序列化数据的通用消息
          * @return true表示成功反序列化并调用回调，false表示失败
@@ -148,37 +249,53 @@ public:
         bool DeserializeAndInvoke(const General::Message& general_msg)
         {
             static_assert(std::is_same<T, U>::value, "Type mismatch in std::string deserialize specialization.");
+            if (!m_userCallback)
+            {
+                return false;
+            }
             if (general_msg.header().type() == "string")
             {
                 U receivedString(general_msg.payload().begin(), general_msg.payload().end());
-                if (m_userCallback)
-                {
-                    m_userCallback(receivedString);
-                    return true;
-                }
+                m_userCallback(receivedString);
+                return true;
+            }
+            if (IsBatchType(general_msg.header().type(), "string"))
+            {
+                // 拆包时复用同一个字符串，避免每条消息重新分配
+                const auto* data = reinterpret_cast<const uint8_t*>(general_msg.payload().data());
+                return ForEachBatchFrame(data, general_msg.payload().size(), [this](const uint8_t* frame, size_t frameSize) {
+                    m_batchString.assign(reinterpret_cast<const char*>(frame), frameSize);
+                    m_userCallback(m_batchString);
+                });
             }
             return false;
         }
 
-        DDSSubscriber<T>* m_ownerSubscriber;  ///< 拥有此监听器的DDSSubscriber实例指针
-        UserCallbackType m_userCallback;      ///< 用户提供的消息处理回调函数
+        DDSSubscriber<T>* m_ownerSubscriber;               ///< 拥有此监听器的DDSSubscriber实例指针
+        UserCallbackType m_userCallback;                   ///< 用户提供的消息处理回调函数
+        std::vector<char> m_arenaBlock;                    ///< Arena 初始内存块(在消息间复用)
+        std::unique_ptr<google::protobuf::Arena> m_arena;  ///< 消息解析用 Arena，未开启时为空
+        General::Message m_receivedMsg;                    ///< 接收线程池模式下复用的接收缓冲
+        std::string m_batchString;                         ///< 字符串批量消息拆包时复用的缓冲
     };
 
     /**
      * @brief 构造函数，初始化DDSSubscriber实例。
      * @param topic_name 要订阅的主题名称
      * @param callback 用户提供的消息处理回调函数
+     * @param options 订阅者选项
      * @exception std::runtime_error 如果DomainParticipant为null或用户回调为null或创建DDS实体失败
      */
-    DDSSubscriber(const std::string& topic_name, UserCallbackType callback)
+    DDSSubscriber(const std::string& topic_name, UserCallbackType callback, const SubscriberOptions& options = SubscriberOptions())
         : m_topicName(topic_name),
           m_participant(Link::Participant::GetParticipant()),
           m_ddsSubscriber(nullptr),
           m_topic(nullptr),
           m_reader(nullptr),
-          m_typeSupport(new General::MessagePubSubType()),
-          m_listener(this, callback),
-          m_userCallback(callback)
+          m_typeSupport(Link::Participant::RegisterType<General::MessagePubSubType>()),
+          m_listener(this, callback, options),
+          m_userCallback(callback),
+          m_useReceivePool(options.use_receive_pool)
     {
         if (!m_participant)
         {
@@ -189,9 +306,13 @@ public:
             throw std::runtime_error("DdsSubscriber: User callback is null for topic " + m_topicName + "!");
         }
 
-        m_typeSupport.register_type(m_participant);
+        if (m_typeSupport.empty())
+        {
+            throw std::runtime_error("DdsSubscriber: Failed to register type for topic " + m_topicName);
+        }
 
-        m_ddsSubscriber = m_participant->create_subscriber(eprosima::fastdds::dds::SUBSCRIBER_QOS_DEFAULT, nullptr);
+        // 类型和订阅者实体在参与者内共享，每个话题只创建主题和数据读取器
+        m_ddsSubscriber = Link::Participant::GetSubscriber();
         if (m_ddsSubscriber == nullptr)
         {
             throw std::runtime_error("DdsSubscriber: Failed to create DDS Subscriber for topic " + m_topicName);
@@ -200,8 +321,6 @@ public:
         m_topic = m_participant->create_topic(m_topicName, m_typeSupport.get_type_name(), eprosima::fastdds::dds::TOPIC_QOS_DEFAULT);
         if (m_topic == nullptr)
         {
-            m_participant->delete_subscriber(m_ddsSubscriber);
-            m_ddsSubscriber = nullptr;
             throw std::runtime_error("DdsSubscriber: Failed to create DDS Topic " + m_topicName);
         }
 
@@ -210,15 +329,28 @@ public:
         rqos.history().kind = eprosima::fastdds::dds::KEEP_LAST_HISTORY_QOS;
         rqos.history().depth = 10;
 
-        m_reader = m_ddsSubscriber->create_datareader(m_topic, rqos, &m_listener);
+        // 接收线程池模式下不设置监听器，由线程池的WaitSet等待DATA_AVAILABLE
+        m_reader = m_ddsSubscriber->create_datareader(m_topic, rqos, m_useReceivePool ? nullptr : &m_listener);
         if (m_reader == nullptr)
         {
             m_participant->delete_topic(m_topic);
             m_topic = nullptr;
-            m_participant->delete_subscriber(m_ddsSubscriber);
-            m_ddsSubscriber = nullptr;
             throw std::runtime_error("DdsSubscriber: Failed to create DDS DataReader for topic " + m_topicName);
         }
+
+        if (m_useReceivePool)
+        {
+            auto& pool = ReceiveThreadPool::Instance();
+            m_receiveThread = pool.ThreadFor(m_topicName, options.receive_thread);
+            if (!pool.Attach(m_reader, m_receiveThread, [this]() { m_listener.TakeAll(m_reader); }))
+            {
+                m_ddsSubscriber->delete_datareader(m_reader);
+                m_reader = nullptr;
+                m_participant->delete_topic(m_topic);
+                m_topic = nullptr;
+                throw std::runtime_error("DdsSubscriber: Failed to attach DataReader to receive pool for topic " + m_topicName);
+            }
+        }
     }
 
     /**
@@ -226,6 +358,10 @@ public:
      */
     ~DDSSubscriber() override
     {
+        if (m_useReceivePool && m_reader != nullptr)
+        {
+            ReceiveThreadPool::Instance().Detach(m_reader, m_receiveThread);
+        }
         if (m_reader != nullptr && m_ddsSubscriber != nullptr)
         {
             m_ddsSubscriber->delete_datareader(m_reader);
@@ -234,10 +370,6 @@ public:
         {
             m_participant->delete_topic(m_topic);
         }
-        if (m_ddsSubscriber != nullptr && m_participant != nullptr)
-        {
-            m_participant->delete_subscriber(m_ddsSubscriber);
-        }
     }
 
     /**
@@ -249,12 +381,14 @@ public:
 private:
     std::string m_topicName;                                   ///< 用于存储主题名称
     eprosima::fastdds::dds::DomainParticipant* m_participant;  ///< FastDDS域参与者
-    eprosima::fastdds::dds::Subscriber* m_ddsSubscriber;       ///< FastDDS订阅者
+    eprosima::fastdds::dds::Subscriber* m_ddsSubscriber;       ///< FastDDS订阅者(参与者内共享)
     eprosima::fastdds::dds::Topic* m_topic;                    ///< FastDDS主题
     eprosima::fastdds::dds::DataReader* m_reader;              ///< FastDDS数据读取器
     eprosima::fastdds::dds::TypeSupport m_typeSupport;         ///< FastDDS类型支持
     DDSSubscriberListener m_listener;                          ///< 订阅者监听器
     UserCallbackType m_userCallback;                           ///< 用户提供的消息处理回调函数
+    bool m_useReceivePool;                                     ///< 是否使用接收线程池
+    size_t m_receiveThread = 0;                                ///< 接收线程池中的线程序号
 };
 
 /**
@@ -262,12 +396,13 @@ private:
  * @tparam T 消息类型
  * @param topic_name 要订阅的主题名称
  * @param callback 用户提供的消息处理回调函数
+ * @param options 订阅者选项
  * @return Link::SubscriberBase<T>的共享指针
  */
 template <typename T>
-std::shared_ptr<Link::SubscriberBase> CreateSubscriber(const std::string& topic_name, std::function<void(const T&)> callback)
+std::shared_ptr<Link::SubscriberBase> CreateSubscriber(const std::string& topic_name, std::function<void(const T&)> callback, const SubscriberOptions& options = SubscriberOptions())
 {
-    return std::make_shared<DDSSubscriber<T>>(topic_name, callback);
+    return std::make_shared<DDSSubscriber<T>>(topic_name, callback, options);
 }
 
 }  // namespace Link
@@ -12,12 +12,16 @@
 #pragma once
 
 #include <functional>
+#include <iostream>
 #include <memory>
 #include <string>
 #include <type_traits>
+#include <unordered_map>
+#include <utility>
 
 #include "general.h"
 #include "link/link.hpp"
+#include "openbag/config.hpp"
 #include "openbag/transport.hpp"
 
 /**
@@ -34,14 +38,27 @@ public:
     LinkSubscriberAdapter(const std::string& topic, std::function<void(const std::string&)> callback) : topic_name_(topic)
     {
         // 使用link库创建字符串订阅者
-        link_subscriber_ = Link::CreateSubscriber<std::string>(topic, callback);
+        link_subscriber_ = Link::CreateSubscriber<std::string>(topic, callback, DefaultSubscriberOptions());
     }
 
+    /**
+     * @brief 构造函数 - 包装已创建的link订阅者
+     * @param topic 话题名称
+     * @param subscriber link订阅者
+     */
+    LinkSubscriberAdapter(const std::string& topic, std::shared_ptr<Link::SubscriberBase> subscriber) : topic_name_(topic), link_subscriber_(std::move(subscriber)) {}
+
     /**
      * @brief 析构函数
      */
     ~LinkSubscriberAdapter() override = default;
 
+    /**
+     * @brief 设置之后创建的订阅者使用的选项
+     * @param options 订阅者选项
+     */
+    static void SetSubscriberOptions(const Link::SubscriberOptions& options) { DefaultSubscriberOptions() = options; }
+
     /**
      * @brief 获取订阅的话题名称
      * @return 话题名称
@@ -49,6 +66,12 @@ public:
     std::string GetTopicName() const override { return topic_name_; }
 
 private:
+    static Link::SubscriberOptions& DefaultSubscriberOptions()
+    {
+        static Link::SubscriberOptions options;
+        return options;
+    }
+
     std::string topic_name_;
     std::shared_ptr<Link::SubscriberBase> link_subscriber_;
 };
@@ -65,8 +88,19 @@ public:
      */
     explicit LinkPublisherAdapter(const std::string& topic) : topic_name_(topic)
     {
-        // 使用link库创建字符串发布者
-        link_publisher_ = Link::CreatePublisher<std::string>(topic);
+        // 使用link库创建字符串发布者，按话题选用发布选项
+        link_publisher_ = Link::CreatePublisher<std::string>(topic, OptionsFor(topic));
+        dds_publisher_ = dynamic_cast<Link::DDSPublisher<std::string>*>(link_publisher_.get());
+    }
+
+    /**
+     * @brief 构造函数 - 包装已创建的link发布者
+     * @param topic 话题名称
+     * @param publisher link发布者
+     */
+    LinkPublisherAdapter(const std::string& topic, std::shared_ptr<Link::PublisherBase<std::string>> publisher)
+        : topic_name_(topic), link_publisher_(std::move(publisher)), dds_publisher_(dynamic_cast<Link::DDSPublisher<std::string>*>(link_publisher_.get()))
+    {
     }
 
     /**
@@ -74,6 +108,30 @@ public:
      */
     ~LinkPublisherAdapter() override = default;
 
+    /**
+     * @brief 设置之后创建的发布者使用的默认选项
+     * @param options 发布者选项
+     */
+    static void SetPublisherOptions(const Link::PublisherOptions& options) { DefaultPublisherOptions() = options; }
+
+    /**
+     * @brief 设置之后创建的指定话题发布者使用的选项
+     * @param topic 话题名称
+     * @param options 发布者选项
+     */
+    static void SetTopicPublisherOptions(const std::string& topic, const Link::PublisherOptions& options) { TopicPublisherOptions()[topic] = options; }
+
+    /**
+     * @brief 获取话题发布者使用的选项
+     * @param topic 话题名称
+     * @return 话题单独设置的选项，未设置时为默认选项
+     */
+    static Link::PublisherOptions OptionsFor(const std::string& topic)
+    {
+        auto it = TopicPublisherOptions().find(topic);
+        return it != TopicPublisherOptions().end() ? it->second : DefaultPublisherOptions();
+    }
+
     /**
      * @brief 获取发布的话题名称
      * @return 话题名称
@@ -94,9 +152,60 @@ public:
         return false;
     }
 
+    /**
+     * @brief 准备待发布的消息，提前封装为通用消息
+     * @param data 消息数据
+     * @return 准备好的消息
+     */
+    ::openbag::PreparedMessagePtr Prepare(std::string data) override
+    {
+        if (!dds_publisher_)
+        {
+            return ::openbag::OpenbagPublisherBase::Prepare(std::move(data));
+        }
+        auto prepared = std::make_unique<PreparedGeneralMessage>();
+        Link::DDSPublisher<std::string>::PrepareMessage(data, prepared->message);
+        return prepared;
+    }
+
+    /**
+     * @brief 发布准备好的消息，只剩DDS写入
+     * @param message 准备好的消息
+     * @return 是否发布成功
+     */
+    bool PublishPrepared(::openbag::PreparedMessage& message) override
+    {
+        if (auto* prepared = dynamic_cast<PreparedGeneralMessage*>(&message); prepared && dds_publisher_)
+        {
+            return dds_publisher_->PublishPrepared(prepared->message);
+        }
+        return Publish(message.data);
+    }
+
 private:
+    /**
+     * @brief 已封装好的通用消息
+     */
+    struct PreparedGeneralMessage : public ::openbag::PreparedMessage
+    {
+        General::Message message;  ///< 通用消息
+    };
+
+    static Link::PublisherOptions& DefaultPublisherOptions()
+    {
+        static Link::PublisherOptions options;
+        return options;
+    }
+
+    static std::unordered_map<std::string, Link::PublisherOptions>& TopicPublisherOptions()
+    {
+        static std::unordered_map<std::string, Link::PublisherOptions> options;
+        return options;
+    }
+
     std::string topic_name_;
     std::shared_ptr<Link::PublisherBase<std::string>> link_publisher_;
+    Link::DDSPublisher<std::string>* dds_publisher_ = nullptr;  // 通用消息发布者，原始数据发布者时为空
 };
 
 /**
@@ -122,6 +231,80 @@ public:
      */
     std::shared_ptr<::openbag::OpenbagPublisherBase> CreatePublisher(const std::string& topic) override { return std::make_shared<LinkPublisherAdapter>(topic); }
 
+    /**
+     * @brief 使用接收线程池接收之后创建的订阅(须在创建订阅者之前调用)
+     * @param threads 线程数，0表示CPU核数
+     */
+    static void UseReceivePool(size_t threads)
+    {
+        Link::ReceiveThreadPool::SetThreadCount(threads);
+        Link::SubscriberOptions options;
+        options.use_receive_pool = true;
+        LinkSubscriberAdapter::SetSubscriberOptions(options);
+    }
+
+    /**
+     * @brief 创建原始CDR数据订阅者
+     * @param topic 话题名称
+     * @param typeName DDS类型名
+     * @param callback 回调函数，参数为含封装头的CDR字节
+     * @return 订阅者基类指针
+     */
+    std::shared_ptr<::openbag::OpenbagSubscriberBase> CreateRawSubscriber(const std::string& topic, const std::string& typeName,
+                                                                          std::function<void(const std::string&)> callback) override
+    {
+        return std::make_shared<LinkSubscriberAdapter>(topic, Link::CreateRawSubscriber(topic, typeName, callback));
+    }
+
+    /**
+     * @brief 创建原始CDR数据发布者
+     * @param topic 话题名称
+     * @param typeName DDS类型名
+     * @return 发布者基类指针
+     */
+    std::shared_ptr<::openbag::OpenbagPublisherBase> CreateRawPublisher(const std::string& topic, const std::string& typeName) override
+    {
+        return std::make_shared<LinkPublisherAdapter>(topic, Link::CreateRawPublisher(topic, typeName, LinkPublisherAdapter::OptionsFor(topic)));
+    }
+
+    /**
+     * @brief 按播放配置注册流控器并设置发布选项(须在创建参与者和发布者之前调用)
+     * @param config 播放配置
+     * @return 是否成功
+     */
+    static bool ConfigurePublishers(const ::openbag::PlayerConfig& config)
+    {
+        for (const auto& controller : config.flow_controllers)
+        {
+            eprosima::fastdds::rtps::FlowControllerSchedulerPolicy scheduler = eprosima::fastdds::rtps::FlowControllerSchedulerPolicy::FIFO;
+            if (controller.scheduler == "round_robin")
+            {
+                scheduler = eprosima::fastdds::rtps::FlowControllerSchedulerPolicy::ROUND_ROBIN;
+            } else if (controller.scheduler == "high_priority")
+            {
+                scheduler = eprosima::fastdds::rtps::FlowControllerSchedulerPolicy::HIGH_PRIORITY;
+            } else if (controller.scheduler == "priority_reservation")
+            {
+                scheduler = eprosima::fastdds::rtps::FlowControllerSchedulerPolicy::PRIORITY_WITH_RESERVATION;
+            } else if (controller.scheduler != "fifo")
+            {
+                std::cerr << "未知的流控调度策略: " << controller.scheduler << " (流控器 " << controller.name << ")" << std::endl;
+                return false;
+            }
+            if (!Link::Participant::RegisterFlowController(controller.name, scheduler, controller.max_bytes_per_period, controller.period_ms))
+            {
+                return false;
+            }
+        }
+
+        LinkPublisherAdapter::SetPublisherOptions(ToPublisherOptions(config.publish));
+        for (const auto& publish : config.topic_publish)
+        {
+            LinkPublisherAdapter::SetTopicPublisherOptions(publish.topic, ToPublisherOptions(publish));
+        }
+        return true;
+    }
+
     /**
      * @brief 获取单例实例
      * @return 工厂实例指针
@@ -131,6 +314,20 @@ public:
         static auto instance = std::make_shared<LinkAdapterFactory>();
         return instance;
     }
+
+private:
+    static Link::PublisherOptions ToPublisherOptions(const ::openbag::PublishConfig& publish)
+    {
+        Link::PublisherOptions options;
+        options.async = publish.async;
+        options.flow_controller = publish.flow_controller;
+        options.priority = publish.priority;
+        options.history_depth = publish.history_depth;
+        options.batch_max_messages = publish.batch_max_messages;
+        options.batch_max_bytes = publish.batch_max_bytes;
+        options.batch_max_latency_us = publish.batch_max_latency_us;
+        return options;
+    }
 };
 
 /**
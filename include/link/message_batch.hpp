@@ -0,0 +1,112 @@
+/**
+ * @author Zhao Jun (zwhy2025@gmail.com)
+ * @version 0.1
+ * @date 2024-07-30
+ *
+ * @file message_batch.hpp
+ * @brief Link库的消息批量打包格式
+ *
+ * 高频小消息逐条发送时，RTPS头、确认报文和监听器分发的开销远大于数据本身。
+ * 批量模式下多条序列化后的消息打包进一个`General::Message`负载，
+ * 每条消息前加 varint 编码的长度(小于128字节的消息只多占1字节)，消息类型为"<类型>.batch"。
+ * 帧中不记录每条消息的发布时间，订阅端拆包后连续回调，批次内消息的接收时间相同。
+ *
+ * 主要函数
+ * - BatchType: 获取批量消息类型名
+ * - IsBatchType: 判断是否为批量消息类型
+ * - BeginBatchFrame: 在批量负载末尾预留一条消息的空间
+ * - ForEachBatchFrame: 依次访问批量负载中的消息
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Link {
+
+constexpr const char* kBatchTypeSuffix = ".batch";  ///< 批量消息类型后缀
+
+/**
+ * @brief 获取批量消息类型名
+ * @param type 单条消息类型("proto"或"string")
+ * @return 批量消息类型名
+ */
+inline std::string BatchType(const std::string& type) { return type + kBatchTypeSuffix; }
+
+/**
+ * @brief 判断消息类型是否为指定类型的批量消息
+ * @param batch_type 收到的消息类型
+ * @param type 单条消息类型
+ */
+inline bool IsBatchType(const std::string& batch_type, const std::string& type)
+{
+    const size_t suffixSize = std::char_traits<char>::length(kBatchTypeSuffix);
+    return batch_type.size() == type.size() + suffixSize && batch_type.compare(0, type.size(), type) == 0 &&
+           batch_type.compare(type.size(), suffixSize, kBatchTypeSuffix) == 0;
+}
+
+/**
+ * @brief 在批量负载末尾追加长度前缀并预留一条消息的空间
+ * @param payload 批量负载
+ * @param size 消息字节数
+ * @return 消息写入位置
+ */
+inline uint8_t* BeginBatchFrame(std::vector<uint8_t>& payload, size_t size)
+{
+    uint64_t value = size;
+    while (value >= 0x80)
+    {
+        payload.push_back(static_cast<uint8_t>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    payload.push_back(static_cast<uint8_t>(value));
+
+    const size_t offset = payload.size();
+    payload.resize(offset + size);
+    return payload.data() + offset;
+}
+
+/**
+ * @brief 依次访问批量负载中的消息
+ * @tparam Visitor 访问函数，签名为 void(const uint8_t* data, size_t size)
+ * @param data 批量负载
+ * @param size 批量负载字节数
+ * @param visitor 访问函数
+ * @return 负载格式是否完整(格式错误时已访问的消息不受影响)
+ */
+template <typename Visitor>
+bool ForEachBatchFrame(const uint8_t* data, size_t size, Visitor&& visitor)
+{
+    size_t pos = 0;
+    while (pos < size)
+    {
+        uint64_t frameSize = 0;
+        int shift = 0;
+        while (true)
+        {
+            if (pos >= size || shift >= 64)
+            {
+                return false;
+            }
+            const uint8_t byte = data[pos++];
+            frameSize |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            shift += 7;
+            if ((byte & 0x80) == 0)
+            {
+                break;
+            }
+        }
+        if (frameSize > size - pos)
+        {
+            return false;
+        }
+        visitor(data + pos, static_cast<size_t>(frameSize));
+        pos += static_cast<size_t>(frameSize);
+    }
+    return true;
+}
+
+}  // namespace Link
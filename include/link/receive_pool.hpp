@@ -0,0 +1,248 @@
+/**
+ * @author Zhao Jun (zwhy2025@gmail.com)
+ * @version 0.1
+ * @date 2024-07-30
+ *
+ * @file receive_pool.hpp
+ * @brief Link库基于WaitSet的接收线程池
+ *
+ * 监听器模式下用户回调运行在FastDDS内部线程上，回调阻塞会拖慢整个传输层。
+ * 接收线程池由若干专用线程组成，每个线程持有一个WaitSet，
+ * 数据读取器的DATA_AVAILABLE状态条件挂到某个线程的WaitSet上，由该线程取数据并调用回调。
+ *
+ * 主要类与方法
+ * - ReceiveThreadPool: 接收线程池(进程内单例)
+ *   - SetThreadCount: 设置线程数(首次使用前调用)
+ *   - Attach/Detach: 挂载/卸载数据读取器
+ *   - ThreadFor: 计算话题对应的线程(按话题名哈希，同一话题固定在同一线程)
+ */
+
+#pragma once
+
+#include <fastdds/dds/core/condition/GuardCondition.hpp>
+#include <fastdds/dds/core/condition/StatusCondition.hpp>
+#include <fastdds/dds/core/condition/WaitSet.hpp>
+#include <fastdds/dds/subscriber/DataReader.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace Link {
+
+/**
+ * @brief 基于WaitSet的接收线程池
+ */
+class ReceiveThreadPool
+{
+public:
+    /**
+     * @brief 数据可读时在接收线程中调用的处理函数，应取完读取器中的所有数据
+     */
+    using Handler = std::function<void()>;
+
+    /**
+     * @brief 获取进程内唯一的线程池，首次调用时按设置的线程数启动线程
+     */
+    static ReceiveThreadPool& Instance()
+    {
+        static ReceiveThreadPool pool(ConfiguredThreadCount());
+        return pool;
+    }
+
+    /**
+     * @brief 设置线程数，须在首次使用线程池前调用
+     * @param count 线程数，0表示使用CPU核数
+     */
+    static void SetThreadCount(size_t count) { ConfiguredThreadCount() = count; }
+
+    ~ReceiveThreadPool()
+    {
+        m_running = false;
+        for (auto& worker : m_workers)
+        {
+            worker->guard.set_trigger_value(true);
+        }
+        for (auto& worker : m_workers)
+        {
+            if (worker->thread.joinable())
+            {
+                worker->thread.join();
+            }
+        }
+    }
+
+    ReceiveThreadPool(const ReceiveThreadPool&) = delete;
+    ReceiveThreadPool& operator=(const ReceiveThreadPool&) = delete;
+
+    /**
+     * @brief 获取线程数
+     */
+    size_t GetThreadCount() const { return m_workers.size(); }
+
+    /**
+     * @brief 计算话题对应的线程序号
+     * @param topic_name 话题名称
+     * @param preferred 指定的线程序号，小于0时按话题名哈希
+     * @return 线程序号
+     */
+    size_t ThreadFor(const std::string& topic_name, int preferred = -1) const
+    {
+        if (preferred >= 0)
+        {
+            return static_cast<size_t>(preferred) % m_workers.size();
+        }
+        return std::hash<std::string>{}(topic_name) % m_workers.size();
+    }
+
+    /**
+     * @brief 挂载数据读取器
+     * @param reader 数据读取器(创建时不应设置处理DATA_AVAILABLE的监听器)
+     * @param thread_index 线程序号(由ThreadFor计算)
+     * @param handler 数据可读时调用的处理函数
+     * @return 是否成功
+     */
+    bool Attach(eprosima::fastdds::dds::DataReader* reader, size_t thread_index, Handler handler)
+    {
+        if (reader == nullptr || !handler)
+        {
+            return false;
+        }
+
+        auto& worker = *m_workers[thread_index % m_workers.size()];
+        auto& condition = reader->get_statuscondition();
+        condition.set_enabled_statuses(eprosima::fastdds::dds::StatusMask::data_available());
+
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.handlers[&condition] = std::make_shared<Handler>(std::move(handler));
+        if (worker.waitset.attach_condition(condition) != eprosima::fastrtps::types::ReturnCode_t::RETCODE_OK)
+        {
+            worker.handlers.erase(&condition);
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief 卸载数据读取器，返回后处理函数不会再被调用
+     *
+     * 处理函数在锁外执行，可以在处理函数内挂载/卸载同一线程上的其他读取器。
+     * 在其他线程调用时等待正在执行的该处理函数返回；在接收线程内(处理函数中)调用时不等待，
+     * 此时若卸载的是正在执行的处理函数自身，其捕获的对象须在处理函数返回后才能销毁。
+     *
+     * @param reader 数据读取器
+     * @param thread_index 挂载时的线程序号
+     */
+    void Detach(eprosima::fastdds::dds::DataReader* reader, size_t thread_index)
+    {
+        if (reader == nullptr)
+        {
+            return;
+        }
+
+        auto& worker = *m_workers[thread_index % m_workers.size()];
+        auto& condition = reader->get_statuscondition();
+
+        std::unique_lock<std::mutex> lock(worker.mutex);
+        worker.waitset.detach_condition(condition);
+        worker.handlers.erase(&condition);
+        if (std::this_thread::get_id() != worker.thread.get_id())
+        {
+            worker.idle.wait(lock, [&worker, &condition] { return worker.running != &condition; });
+        }
+    }
+
+private:
+    /**
+     * @brief 单个接收线程
+     */
+    struct Worker
+    {
+        eprosima::fastdds::dds::WaitSet waitset;                                                          ///< 等待集
+        eprosima::fastdds::dds::GuardCondition guard;                                                     ///< 用于唤醒线程退出
+        std::mutex mutex;                                                                                 ///< 保护处理函数表和 running
+        std::condition_variable idle;                                                                     ///< 处理函数返回时通知
+        std::unordered_map<const eprosima::fastdds::dds::Condition*, std::shared_ptr<Handler>> handlers;  ///< 状态条件到处理函数
+        const eprosima::fastdds::dds::Condition* running = nullptr;                                       ///< 正在执行处理函数的条件
+        std::thread thread;                                                                               ///< 线程
+    };
+
+    explicit ReceiveThreadPool(size_t count) : m_running(true)
+    {
+        if (count == 0)
+        {
+            count = std::max<size_t>(1, std::thread::hardware_concurrency());
+        }
+
+        m_workers.reserve(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            auto worker = std::make_unique<Worker>();
+            worker->waitset.attach_condition(worker->guard);
+            m_workers.push_back(std::move(worker));
+        }
+        for (auto& worker : m_workers)
+        {
+            worker->thread = std::thread(&ReceiveThreadPool::Run, this, worker.get());
+        }
+    }
+
+    static size_t& ConfiguredThreadCount()
+    {
+        static size_t count = 0;
+        return count;
+    }
+
+    void Run(Worker* worker)
+    {
+        eprosima::fastdds::dds::ConditionSeq active;
+        while (m_running)
+        {
+            if (worker->waitset.wait(active, eprosima::fastrtps::c_TimeInfinite) != eprosima::fastrtps::types::ReturnCode_t::RETCODE_OK)
+            {
+                continue;
+            }
+
+            for (auto* condition : active)
+            {
+                if (condition == &worker->guard)
+                {
+                    worker->guard.set_trigger_value(false);
+                    continue;
+                }
+
+                // 条件可能已被卸载，按表查找，找不到时跳过；处理函数在锁外执行，
+                // 期间 Detach 等待 running 清除，保证返回后不再调用
+                std::shared_ptr<Handler> handler;
+                {
+                    std::lock_guard<std::mutex> lock(worker->mutex);
+                    auto it = worker->handlers.find(condition);
+                    if (it == worker->handlers.end())
+                    {
+                        continue;
+                    }
+                    handler = it->second;
+                    worker->running = condition;
+                }
+                (*handler)();
+                {
+                    std::lock_guard<std::mutex> lock(worker->mutex);
+                    worker->running = nullptr;
+                }
+                worker->idle.notify_all();
+            }
+        }
+    }
+
+    std::atomic<bool> m_running;                   ///< 线程运行标志
+    std::vector<std::unique_ptr<Worker>> m_workers;  ///< 接收线程
+};
+
+}  // namespace Link
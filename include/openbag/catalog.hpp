@@ -0,0 +1,937 @@
+/**
+ * @copyright Copyright (c) 2025 openbag
+ *
+ * @author Zhao Jun(zwhy2025@gmail.com)
+ * @version 0.1
+ * @date 2025-05-22
+ *
+ * @file catalog.hpp
+ * @brief 目录级索引：记录每个文件的话题、时间范围和消息数，支持按话题/时间快速查找文件
+ *
+ * 索引文件只追加写入，格式(小端序)：
+ * - 文件头: 魔数 "OBCATLG1"(8) + 版本(uint32) + 保留(uint32)
+ * - 记录:   长度(uint32，不含自身) + 起止时间(uint64 x2) + 消息数(uint64) + 文件大小(uint64) + 修改时间(int64)
+ *           + 话题布隆过滤器(uint64 x8) + 路径(uint16 长度 + 字节) + 话题数(uint32)
+ *           + 每个话题: 名称(uint16 长度 + 字节) + 消息数(uint64) + 起止时间(uint64 x2)
+ *
+ * 同一路径的后续记录覆盖之前的记录，文件重新生成后只需追加一条新记录。
+ * 被覆盖的记录和已删除文件的记录由 CatalogBuilder::Prune 压缩掉(写临时文件后原子替换)。
+ */
+
+#pragma once
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "openbag/codec.hpp"
+#include "openbag/reader.hpp"
+
+namespace openbag {
+
+constexpr char kCatalogMagic[8] = {'O', 'B', 'C', 'A', 'T', 'L', 'G', '1'};  ///< 索引文件魔数
+constexpr uint32_t kCatalogVersion = 1;                                     ///< 索引文件版本
+constexpr size_t kCatalogHeaderSize = sizeof(kCatalogMagic) + 2 * sizeof(uint32_t);
+constexpr size_t kCatalogBloomWords = 8;  ///< 布隆过滤器大小(512位)
+
+/**
+ * @brief 文件内单个话题的统计
+ */
+struct CatalogTopic
+{
+    std::string name;            ///< 话题名称
+    uint64_t message_count = 0;  ///< 消息数
+    uint64_t start_time = 0;     ///< 起始时间(纳秒，按块粒度)
+    uint64_t end_time = 0;       ///< 结束时间(纳秒，按块粒度)
+};
+
+/**
+ * @brief 单个文件的索引项
+ */
+struct CatalogEntry
+{
+    std::string path;                  ///< 文件绝对路径
+    uint64_t start_time = 0;           ///< 起始时间(纳秒)
+    uint64_t end_time = 0;             ///< 结束时间(纳秒)
+    uint64_t message_count = 0;        ///< 消息总数
+    uint64_t file_size = 0;            ///< 文件大小
+    int64_t mtime = 0;                 ///< 文件修改时间
+    std::vector<CatalogTopic> topics;  ///< 话题统计
+};
+
+/**
+ * @brief 话题名称布隆过滤器
+ *
+ * 固定512位，话题多时误判率很高；仅为兼容版本1的读取端而继续写入，Catalog 查询使用话题倒排索引。
+ */
+struct TopicBloom
+{
+    uint64_t words[kCatalogBloomWords] = {};
+
+    void Add(std::string_view topic)
+    {
+        const uint64_t hash = HashPayload(topic.data(), topic.size());
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            const uint32_t bit = Bit(hash, i);
+            words[bit / 64] |= 1ULL << (bit % 64);
+        }
+    }
+
+    bool MayContain(std::string_view topic) const
+    {
+        const uint64_t hash = HashPayload(topic.data(), topic.size());
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            const uint32_t bit = Bit(hash, i);
+            if ((words[bit / 64] & (1ULL << (bit % 64))) == 0)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    // 双重哈希: h1 + i * h2
+    static uint32_t Bit(uint64_t hash, uint32_t i)
+    {
+        const uint32_t h1 = static_cast<uint32_t>(hash);
+        const uint32_t h2 = static_cast<uint32_t>(hash >> 32) | 1;
+        return (h1 + i * h2) % (kCatalogBloomWords * 64);
+    }
+};
+
+/**
+ * @brief 索引文件读取与查询
+ *
+ * 以只读 mmap 打开索引文件，加载时把每条记录的定长部分(时间范围、偏移)复制到连续数组中，
+ * 同时建立话题到记录的倒排索引(含话题的时间范围)；按话题查询只访问包含该话题的记录。
+ */
+class Catalog
+{
+public:
+    Catalog() = default;
+    ~Catalog() { Close(); }
+
+    Catalog(const Catalog&) = delete;
+    Catalog& operator=(const Catalog&) = delete;
+
+    /**
+     * @brief 打开索引文件
+     * @param path 索引文件路径
+     * @return 是否成功
+     */
+    bool Open(const std::string& path)
+    {
+        Close();
+        m_path = path;
+        return Refresh();
+    }
+
+    /**
+     * @brief 关闭索引文件
+     */
+    void Close()
+    {
+        Unmap();
+        m_records.clear();
+        m_latest.clear();
+        m_topicRecords.clear();
+        m_parsedSize = 0;
+        m_inode = 0;
+    }
+
+    /**
+     * @brief 增量加载索引文件中新追加的记录
+     * @return 是否成功
+     */
+    bool Refresh()
+    {
+        const int fd = ::open(m_path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            std::cerr << "打开索引文件失败: " << m_path << std::endl;
+            return false;
+        }
+
+        struct stat st;
+        if (::fstat(fd, &st) != 0)
+        {
+            ::close(fd);
+            return false;
+        }
+
+        // 索引文件被压缩替换后从头重新解析
+        if (m_inode != 0 && static_cast<uint64_t>(st.st_ino) != m_inode)
+        {
+            Unmap();
+            m_records.clear();
+            m_latest.clear();
+            m_topicRecords.clear();
+            m_parsedSize = 0;
+        }
+        m_inode = static_cast<uint64_t>(st.st_ino);
+
+        const size_t size = static_cast<size_t>(st.st_size);
+        if (size != m_mapSize)
+        {
+            Unmap();
+            if (size > 0)
+            {
+                void* data = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+                if (data == MAP_FAILED)
+                {
+                    ::close(fd);
+                    std::cerr << "映射索引文件失败: " << m_path << std::endl;
+                    return false;
+                }
+                m_data = static_cast<const char*>(data);
+                m_mapSize = size;
+            }
+        }
+        ::close(fd);
+
+        if (m_parsedSize == 0)
+        {
+            if (m_mapSize < kCatalogHeaderSize || std::memcmp(m_data, kCatalogMagic, sizeof(kCatalogMagic)) != 0)
+            {
+                std::cerr << "索引文件格式错误: " << m_path << std::endl;
+                return false;
+            }
+            m_parsedSize = kCatalogHeaderSize;
+        }
+        ParseRecords();
+        return true;
+    }
+
+    /**
+     * @brief 获取已索引的文件数
+     */
+    size_t GetFileCount() const { return m_latest.size(); }
+
+    /**
+     * @brief 查询在时间范围内包含指定话题的文件
+     *
+     * 指定话题时只遍历该话题的倒排列表，代价与包含该话题的记录数成正比；
+     * 不指定话题时顺序扫描全部定长记录。被覆盖的记录过多时先用 CatalogBuilder::Prune 压缩。
+     *
+     * @param topic 话题名称，为空表示任意话题
+     * @param startTime 起始时间(纳秒)
+     * @param endTime 结束时间(纳秒)
+     * @return 文件路径，按起始时间排序
+     */
+    std::vector<std::string> Query(const std::string& topic, uint64_t startTime = 0, uint64_t endTime = std::numeric_limits<uint64_t>::max()) const
+    {
+        std::vector<const RecordRef*> matches;
+        if (topic.empty())
+        {
+            for (const auto& record : m_records)
+            {
+                if (!record.superseded && record.endTime >= startTime && record.startTime <= endTime)
+                {
+                    matches.push_back(&record);
+                }
+            }
+        } else
+        {
+            auto it = m_topicRecords.find(topic);
+            if (it != m_topicRecords.end())
+            {
+                for (const auto& posting : it->second)
+                {
+                    const auto& record = m_records[posting.record];
+                    if (!record.superseded && posting.endTime >= startTime && posting.startTime <= endTime)
+                    {
+                        matches.push_back(&record);
+                    }
+                }
+            }
+        }
+
+        std::sort(matches.begin(), matches.end(), [](const RecordRef* a, const RecordRef* b) { return a->startTime < b->startTime; });
+        std::vector<std::string> paths;
+        paths.reserve(matches.size());
+        for (const auto* record : matches)
+        {
+            paths.emplace_back(ReadString16(record->pathOffset));
+        }
+        return paths;
+    }
+
+    /**
+     * @brief 获取文件的索引项
+     * @param path 文件绝对路径
+     * @param[out] entry 索引项
+     * @return 是否存在
+     */
+    bool GetEntry(const std::string& path, CatalogEntry& entry) const
+    {
+        auto it = m_latest.find(path);
+        if (it == m_latest.end())
+        {
+            return false;
+        }
+
+        const auto& record = m_records[it->second];
+        entry = CatalogEntry{};
+        entry.path = path;
+        entry.start_time = record.startTime;
+        entry.end_time = record.endTime;
+        entry.message_count = ReadValue<uint64_t>(record.offset + 16);
+        entry.file_size = ReadValue<uint64_t>(record.offset + 24);
+        entry.mtime = ReadValue<int64_t>(record.offset + 32);
+
+        size_t offset = record.topicsOffset + sizeof(uint32_t);
+        const uint32_t topicCount = ReadValue<uint32_t>(record.topicsOffset);
+        for (uint32_t i = 0; i < topicCount; ++i)
+        {
+            CatalogTopic topic;
+            topic.name = ReadString16(offset);
+            offset += sizeof(uint16_t) + topic.name.size();
+            topic.message_count = ReadValue<uint64_t>(offset);
+            topic.start_time = ReadValue<uint64_t>(offset + 8);
+            topic.end_time = ReadValue<uint64_t>(offset + 16);
+            offset += 24;
+            entry.topics.push_back(std::move(topic));
+        }
+        return true;
+    }
+
+private:
+    /**
+     * @brief 记录的定长部分
+     */
+    struct RecordRef
+    {
+        size_t offset = 0;        ///< 记录体在映射区中的偏移(长度字段之后)
+        size_t pathOffset = 0;    ///< 路径偏移
+        size_t topicsOffset = 0;  ///< 话题表偏移
+        size_t end = 0;           ///< 记录结束偏移
+        uint64_t startTime = 0;   ///< 起始时间
+        uint64_t endTime = 0;     ///< 结束时间
+        bool superseded = false;  ///< 是否已被同路径的新记录覆盖
+    };
+
+    /**
+     * @brief 倒排索引项: 包含某话题(消息数大于0)的记录及该话题的时间范围
+     */
+    struct TopicPosting
+    {
+        size_t record = 0;       ///< 记录在 m_records 中的下标
+        uint64_t startTime = 0;  ///< 话题起始时间
+        uint64_t endTime = 0;    ///< 话题结束时间
+    };
+
+    static constexpr size_t kFixedSize = 5 * sizeof(uint64_t) + sizeof(TopicBloom::words);  ///< 记录体定长部分(含布隆过滤器)
+
+    template <typename T>
+    T ReadValue(size_t offset) const
+    {
+        T value;
+        std::memcpy(&value, m_data + offset, sizeof(value));
+        return value;
+    }
+
+    std::string_view ReadString16(size_t offset) const { return std::string_view(m_data + offset + sizeof(uint16_t), ReadValue<uint16_t>(offset)); }
+
+    void ParseRecords()
+    {
+        // 只解析完整的记录，末尾未写完的记录留待下次刷新
+        while (m_parsedSize + sizeof(uint32_t) <= m_mapSize)
+        {
+            const uint32_t length = ReadValue<uint32_t>(m_parsedSize);
+            const size_t begin = m_parsedSize + sizeof(uint32_t);
+            if (length < kFixedSize + sizeof(uint16_t) + sizeof(uint32_t) || begin + length > m_mapSize)
+            {
+                break;
+            }
+
+            RecordRef record;
+            record.offset = begin;
+            record.end = begin + length;
+            record.startTime = ReadValue<uint64_t>(begin);
+            record.endTime = ReadValue<uint64_t>(begin + 8);
+            record.pathOffset = begin + kFixedSize;
+            record.topicsOffset = record.pathOffset + sizeof(uint16_t) + ReadValue<uint16_t>(record.pathOffset);
+
+            const std::string path(ReadString16(record.pathOffset));
+            auto it = m_latest.find(path);
+            if (it != m_latest.end())
+            {
+                m_records[it->second].superseded = true;
+            }
+            m_latest[path] = m_records.size();
+            m_records.push_back(record);
+            IndexTopics(m_records.size() - 1);
+            m_parsedSize = record.end;
+        }
+    }
+
+    /**
+     * @brief 把记录的话题表加入倒排索引，越界的话题表在越界处截止
+     */
+    void IndexTopics(size_t index)
+    {
+        const auto& record = m_records[index];
+        if (record.topicsOffset + sizeof(uint32_t) > record.end)
+        {
+            return;
+        }
+        size_t offset = record.topicsOffset + sizeof(uint32_t);
+        const uint32_t topicCount = ReadValue<uint32_t>(record.topicsOffset);
+        for (uint32_t i = 0; i < topicCount && offset + sizeof(uint16_t) <= record.end; ++i)
+        {
+            const size_t nameSize = ReadValue<uint16_t>(offset);
+            if (offset + sizeof(uint16_t) + nameSize + 24 > record.end)
+            {
+                break;
+            }
+            const std::string_view name = ReadString16(offset);
+            offset += sizeof(uint16_t) + nameSize;
+            if (ReadValue<uint64_t>(offset) > 0)
+            {
+                m_topicRecords[std::string(name)].push_back(TopicPosting{index, ReadValue<uint64_t>(offset + 8), ReadValue<uint64_t>(offset + 16)});
+            }
+            offset += 24;
+        }
+    }
+
+    void Unmap()
+    {
+        if (m_data)
+        {
+            ::munmap(const_cast<char*>(m_data), m_mapSize);
+            m_data = nullptr;
+        }
+        m_mapSize = 0;
+    }
+
+    std::string m_path;                                                         ///< 索引文件路径
+    uint64_t m_inode = 0;                                                       ///< 已映射文件的 inode，用于发现压缩替换
+    const char* m_data = nullptr;                                               ///< 映射区
+    size_t m_mapSize = 0;                                                       ///< 映射区大小
+    size_t m_parsedSize = 0;                                                    ///< 已解析的字节数
+    std::vector<RecordRef> m_records;                                           ///< 记录(按追加顺序)
+    std::unordered_map<std::string, size_t> m_latest;                           ///< 路径到最新记录
+    std::unordered_map<std::string, std::vector<TopicPosting>> m_topicRecords;  ///< 话题到包含该话题的记录
+};
+
+/**
+ * @brief 索引文件生成器
+ */
+class CatalogBuilder
+{
+public:
+    /**
+     * @brief 构造函数
+     * @param catalogPath 索引文件路径
+     */
+    explicit CatalogBuilder(std::string catalogPath) : m_catalogPath(std::move(catalogPath)) {}
+
+    /**
+     * @brief 从文件摘要生成索引项
+     *
+     * 时间范围与消息数来自统计记录，话题时间范围由包含该通道的块的时间范围合并而来；
+     * 文件缺少摘要时退化为扫描消息。
+     *
+     * @param bagPath 文件路径
+     * @param[out] entry 索引项
+     * @return 是否成功
+     */
+    static bool BuildEntry(const std::string& bagPath, CatalogEntry& entry)
+    {
+        std::error_code ec;
+        const auto absolute = std::filesystem::absolute(bagPath, ec);
+        entry = CatalogEntry{};
+        entry.path = absolute.lexically_normal().string();
+        entry.file_size = std::filesystem::file_size(absolute, ec);
+        entry.mtime = static_cast<int64_t>(std::filesystem::last_write_time(absolute, ec).time_since_epoch().count());
+
+        Reader reader;
+        if (!reader.Open(entry.path))
+        {
+            return false;
+        }
+
+        std::unordered_map<mcap::ChannelId, CatalogTopic> topics;
+        for (const auto& [channelId, channel] : reader.GetChannels())
+        {
+            topics[channelId].name = channel->topic;
+            topics[channelId].start_time = std::numeric_limits<uint64_t>::max();
+        }
+
+        const auto& statistics = reader.GetStatistics();
+        const auto& chunkIndexes = reader.GetChunkIndexes();
+        if (statistics && !chunkIndexes.empty())
+        {
+            entry.start_time = statistics->messageStartTime;
+            entry.end_time = statistics->messageEndTime;
+            entry.message_count = statistics->messageCount;
+            for (const auto& [channelId, count] : statistics->channelMessageCounts)
+            {
+                topics[channelId].message_count = count;
+            }
+            for (const auto& index : chunkIndexes)
+            {
+                for (const auto& [channelId, offset] : index.messageIndexOffsets)
+                {
+                    auto& topic = topics[channelId];
+                    topic.start_time = std::min<uint64_t>(topic.start_time, index.messageStartTime);
+                    topic.end_time = std::max<uint64_t>(topic.end_time, index.messageEndTime);
+                }
+            }
+        } else
+        {
+            entry.start_time = std::numeric_limits<uint64_t>::max();
+            for (const auto& view : reader.GetMessages())
+            {
+                auto& topic = topics[view.message.channelId];
+                topic.message_count++;
+                topic.start_time = std::min<uint64_t>(topic.start_time, view.message.logTime);
+                topic.end_time = std::max<uint64_t>(topic.end_time, view.message.logTime);
+                entry.message_count++;
+                entry.start_time = std::min<uint64_t>(entry.start_time, view.message.logTime);
+                entry.end_time = std::max<uint64_t>(entry.end_time, view.message.logTime);
+            }
+            if (entry.message_count == 0)
+            {
+                entry.start_time = 0;
+            }
+        }
+
+        // 同名话题的多个通道合并
+        std::unordered_map<std::string, size_t> topicIndex;
+        for (auto& [channelId, topic] : topics)
+        {
+            if (topic.message_count == 0 || topic.name.empty())
+            {
+                continue;
+            }
+            auto it = topicIndex.find(topic.name);
+            if (it == topicIndex.end())
+            {
+                topicIndex[topic.name] = entry.topics.size();
+                entry.topics.push_back(topic);
+                continue;
+            }
+            auto& merged = entry.topics[it->second];
+            merged.message_count += topic.message_count;
+            merged.start_time = std::min(merged.start_time, topic.start_time);
+            merged.end_time = std::max(merged.end_time, topic.end_time);
+        }
+        return true;
+    }
+
+    /**
+     * @brief 追加一条索引项
+     *
+     * 以 O_APPEND 单次 write 写入整条记录，并用文件锁与其他写入进程互斥，
+     * 读取端不会看到交错的记录。
+     *
+     * @param entry 索引项
+     * @return 是否成功
+     */
+    bool Append(const CatalogEntry& entry)
+    {
+        std::string record;
+        EncodeRecord(entry, record);
+
+        const std::filesystem::path catalogPath(m_catalogPath);
+        if (catalogPath.has_parent_path())
+        {
+            std::error_code ec;
+            std::filesystem::create_directories(catalogPath.parent_path(), ec);
+        }
+
+        const int fd = OpenLocked(O_WRONLY | O_CREAT | O_APPEND);
+        if (fd < 0)
+        {
+            std::cerr << "打开索引文件失败: " << m_catalogPath << std::endl;
+            return false;
+        }
+
+        bool success = true;
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && st.st_size == 0)
+        {
+            std::string header(kCatalogMagic, sizeof(kCatalogMagic));
+            AppendValue(header, kCatalogVersion);
+            AppendValue(header, uint32_t{0});
+            success = WriteAll(fd, header);
+        }
+        success = success && WriteAll(fd, record);
+
+        ::flock(fd, LOCK_UN);
+        ::close(fd);
+        if (!success)
+        {
+            std::cerr << "写入索引文件失败: " << m_catalogPath << std::endl;
+        }
+        return success;
+    }
+
+    /**
+     * @brief 为单个文件生成索引项并追加
+     * @param bagPath 文件路径
+     * @return 是否成功
+     */
+    bool AddFile(const std::string& bagPath)
+    {
+        CatalogEntry entry;
+        if (!BuildEntry(bagPath, entry))
+        {
+            std::cerr << "生成索引项失败: " << bagPath << std::endl;
+            return false;
+        }
+        return Append(entry);
+    }
+
+    /**
+     * @brief 增量更新目录下所有 .mcap 文件的索引
+     *
+     * 大小与修改时间未变化的文件跳过，只为新增或变化的文件追加记录。
+     *
+     * @param directory 目录
+     * @param recursive 是否递归子目录
+     * @return 新追加的记录数
+     */
+    size_t Update(const std::string& directory, bool recursive = true)
+    {
+        Catalog catalog;
+        const bool hasCatalog = std::filesystem::exists(m_catalogPath) && catalog.Open(m_catalogPath);
+
+        std::vector<std::string> files;
+        std::error_code ec;
+        const auto collect = [&files](const std::filesystem::directory_entry& item) {
+            if (item.is_regular_file() && item.path().extension() == ".mcap")
+            {
+                files.push_back(std::filesystem::absolute(item.path()).lexically_normal().string());
+            }
+        };
+        if (recursive)
+        {
+            for (const auto& item : std::filesystem::recursive_directory_iterator(directory, ec))
+            {
+                collect(item);
+            }
+        } else
+        {
+            for (const auto& item : std::filesystem::directory_iterator(directory, ec))
+            {
+                collect(item);
+            }
+        }
+        std::sort(files.begin(), files.end());
+
+        size_t appended = 0;
+        for (const auto& file : files)
+        {
+            CatalogEntry existing;
+            if (hasCatalog && catalog.GetEntry(file, existing))
+            {
+                const auto size = std::filesystem::file_size(file, ec);
+                const auto mtime = static_cast<int64_t>(std::filesystem::last_write_time(file, ec).time_since_epoch().count());
+                if (existing.file_size == size && existing.mtime == mtime)
+                {
+                    continue;
+                }
+            }
+            if (AddFile(file))
+            {
+                appended++;
+            }
+        }
+        return appended;
+    }
+
+    /**
+     * @brief 压缩索引文件：去掉被覆盖的记录和文件已不存在的记录
+     *
+     * 持有文件锁读出全部记录，把保留的记录写入临时文件后 rename 替换原文件；
+     * 已打开的 Catalog 在下次 Refresh 时发现 inode 变化并重新加载。
+     *
+     * @return 删除的记录数，失败时为0
+     */
+    size_t Prune()
+    {
+        std::error_code ec;
+        if (!std::filesystem::exists(m_catalogPath, ec))
+        {
+            return 0;
+        }
+
+        const int fd = OpenLocked(O_RDONLY);
+        if (fd < 0)
+        {
+            std::cerr << "打开索引文件失败: " << m_catalogPath << std::endl;
+            return 0;
+        }
+
+        std::string data;
+        struct stat st;
+        bool success = ::fstat(fd, &st) == 0;
+        if (success)
+        {
+            data.resize(static_cast<size_t>(st.st_size));
+            success = static_cast<size_t>(::pread(fd, data.data(), data.size(), 0)) == data.size();
+        }
+        if (!success || data.size() < kCatalogHeaderSize || std::memcmp(data.data(), kCatalogMagic, sizeof(kCatalogMagic)) != 0)
+        {
+            ::close(fd);
+            std::cerr << "索引文件格式错误: " << m_catalogPath << std::endl;
+            return 0;
+        }
+
+        // 每个路径只保留最后一条记录，末尾不完整的记录丢弃
+        std::vector<std::pair<size_t, size_t>> records;  // 记录的起始偏移与长度(含长度字段)
+        std::unordered_map<std::string, size_t> latest;
+        size_t offset = kCatalogHeaderSize;
+        while (offset + sizeof(uint32_t) <= data.size())
+        {
+            uint32_t length = 0;
+            std::memcpy(&length, data.data() + offset, sizeof(length));
+            const size_t pathOffset = offset + sizeof(uint32_t) + 5 * sizeof(uint64_t) + sizeof(TopicBloom::words);
+            if (pathOffset + sizeof(uint16_t) > data.size() || offset + sizeof(uint32_t) + length > data.size())
+            {
+                break;
+            }
+            uint16_t pathSize = 0;
+            std::memcpy(&pathSize, data.data() + pathOffset, sizeof(pathSize));
+            latest[data.substr(pathOffset + sizeof(uint16_t), pathSize)] = records.size();
+            records.emplace_back(offset, sizeof(uint32_t) + length);
+            offset += sizeof(uint32_t) + length;
+        }
+
+        std::vector<bool> keep(records.size(), false);
+        for (const auto& [path, index] : latest)
+        {
+            keep[index] = std::filesystem::exists(path, ec);
+        }
+
+        std::string pruned = data.substr(0, kCatalogHeaderSize);
+        size_t removed = 0;
+        for (size_t i = 0; i < records.size(); ++i)
+        {
+            if (keep[i])
+            {
+                pruned.append(data, records[i].first, records[i].second);
+            } else
+            {
+                removed++;
+            }
+        }
+
+        if (removed > 0)
+        {
+            const std::string tmpPath = m_catalogPath + ".tmp";
+            const int tmpFd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            success = tmpFd >= 0 && WriteAll(tmpFd, pruned) && ::fsync(tmpFd) == 0;
+            if (tmpFd >= 0)
+            {
+                ::close(tmpFd);
+            }
+            success = success && ::rename(tmpPath.c_str(), m_catalogPath.c_str()) == 0;
+            if (!success)
+            {
+                ::unlink(tmpPath.c_str());
+                std::cerr << "压缩索引文件失败: " << m_catalogPath << std::endl;
+                removed = 0;
+            }
+        }
+
+        ::flock(fd, LOCK_UN);
+        ::close(fd);
+        return removed;
+    }
+
+private:
+    /**
+     * @brief 打开索引文件并加排他锁
+     *
+     * 加锁期间文件可能已被 Prune 替换，此时锁住的是旧 inode，需要重新打开。
+     */
+    int OpenLocked(int flags) const
+    {
+        while (true)
+        {
+            const int fd = ::open(m_catalogPath.c_str(), flags, 0644);
+            if (fd < 0)
+            {
+                return -1;
+            }
+            ::flock(fd, LOCK_EX);
+
+            struct stat opened;
+            struct stat current;
+            if (::fstat(fd, &opened) == 0 && ::stat(m_catalogPath.c_str(), &current) == 0 && opened.st_ino == current.st_ino)
+            {
+                return fd;
+            }
+            ::flock(fd, LOCK_UN);
+            ::close(fd);
+        }
+    }
+
+    template <typename T>
+    static void AppendValue(std::string& buffer, T value)
+    {
+        buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    static void AppendString16(std::string& buffer, const std::string& value)
+    {
+        const uint16_t size = static_cast<uint16_t>(std::min<size_t>(value.size(), std::numeric_limits<uint16_t>::max()));
+        AppendValue(buffer, size);
+        buffer.append(value.data(), size);
+    }
+
+    static void EncodeRecord(const CatalogEntry& entry, std::string& record)
+    {
+        TopicBloom bloom;
+        for (const auto& topic : entry.topics)
+        {
+            bloom.Add(topic.name);
+        }
+
+        std::string body;
+        AppendValue(body, entry.start_time);
+        AppendValue(body, entry.end_time);
+        AppendValue(body, entry.message_count);
+        AppendValue(body, entry.file_size);
+        AppendValue(body, entry.mtime);
+        body.append(reinterpret_cast<const char*>(bloom.words), sizeof(bloom.words));
+        AppendString16(body, entry.path);
+        AppendValue(body, static_cast<uint32_t>(entry.topics.size()));
+        for (const auto& topic : entry.topics)
+        {
+            AppendString16(body, topic.name);
+            AppendValue(body, topic.message_count);
+            AppendValue(body, topic.start_time);
+            AppendValue(body, topic.end_time);
+        }
+
+        record.clear();
+        AppendValue(record, static_cast<uint32_t>(body.size()));
+        record.append(body);
+    }
+
+    static bool WriteAll(int fd, const std::string& data)
+    {
+        size_t written = 0;
+        while (written < data.size())
+        {
+            const ssize_t n = ::write(fd, data.data() + written, data.size() - written);
+            if (n <= 0)
+            {
+                return false;
+            }
+            written += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    std::string m_catalogPath;  ///< 索引文件路径
+};
+
+/**
+ * @brief 后台追加索引项
+ *
+ * 生成索引项需要打开并读取刚关闭的文件摘要，放在后台线程中执行，
+ * 避免文件分割时阻塞写入。析构时处理完队列中剩余的文件。
+ */
+class CatalogWriter
+{
+public:
+    /**
+     * @brief 构造函数
+     * @param catalogPath 索引文件路径
+     */
+    explicit CatalogWriter(std::string catalogPath) : m_builder(std::move(catalogPath)), m_thread([this] { Run(); }) {}
+
+    ~CatalogWriter()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopped = true;
+        }
+        m_cv.notify_all();
+        m_thread.join();
+    }
+
+    CatalogWriter(const CatalogWriter&) = delete;
+    CatalogWriter& operator=(const CatalogWriter&) = delete;
+
+    /**
+     * @brief 将文件加入待索引队列
+     * @param bagPath 文件路径
+     */
+    void Add(const std::string& bagPath)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pending.push_back(bagPath);
+        }
+        m_cv.notify_all();
+    }
+
+    /**
+     * @brief 等待队列中的文件全部写入索引
+     */
+    void Wait()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, [this] { return m_pending.empty() && !m_busy; });
+    }
+
+private:
+    void Run()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true)
+        {
+            m_cv.wait(lock, [this] { return !m_pending.empty() || m_stopped; });
+            if (m_pending.empty())
+            {
+                return;
+            }
+
+            const std::string bagPath = std::move(m_pending.front());
+            m_pending.pop_front();
+            m_busy = true;
+            lock.unlock();
+            m_builder.AddFile(bagPath);
+            lock.lock();
+            m_busy = false;
+            m_cv.notify_all();
+        }
+    }
+
+    CatalogBuilder m_builder;            ///< 索引生成器
+    std::mutex m_mutex;                  ///< 保护队列
+    std::condition_variable m_cv;        ///< 队列变化通知
+    std::deque<std::string> m_pending;   ///< 待索引的文件
+    bool m_busy = false;                 ///< 是否正在处理
+    bool m_stopped = false;              ///< 是否停止
+    std::thread m_thread;                ///< 后台线程(最后初始化)
+};
+
+}  // namespace openbag
@@ -0,0 +1,147 @@
+/**
+ * @copyright Copyright (c) 2025 openbag
+ *
+ * @author Zhao Jun(zwhy2025@gmail.com)
+ * @version 0.1
+ * @date 2025-05-22
+ *
+ * @file chunk_cache.hpp
+ * @brief 解压后数据块的 LRU 缓存
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "mcap/mcap.hpp"
+
+namespace openbag {
+
+/**
+ * @brief 解压后的数据块
+ */
+struct DecodedChunk
+{
+    mcap::ByteArray records;              ///< 解压后的记录区
+    std::vector<mcap::Message> messages;  ///< 块内消息(按文件顺序)，数据指针指向 records
+};
+
+/**
+ * @brief 解压块的 LRU 缓存(线程安全)
+ *
+ * 按块在摘要中的序号缓存，容量以字节计。取出的块以 shared_ptr 持有，
+ * 被淘汰后仍在使用的块在最后一个引用释放时才析构。
+ */
+class ChunkCache
+{
+public:
+    using ChunkPtr = std::shared_ptr<const DecodedChunk>;
+
+    /**
+     * @brief 构造函数
+     * @param capacity 缓存容量(字节)
+     */
+    explicit ChunkCache(size_t capacity = 256ULL * 1024 * 1024) : m_capacity(capacity) {}
+
+    /**
+     * @brief 获取缓存的块，并标记为最近使用
+     * @param key 块序号
+     * @return 缓存的块，未命中时为空
+     */
+    ChunkPtr Get(size_t key)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_index.find(key);
+        if (it == m_index.end())
+        {
+            return nullptr;
+        }
+        m_lru.splice(m_lru.begin(), m_lru, it->second);
+        return it->second->second;
+    }
+
+    /**
+     * @brief 判断块是否已缓存(不改变使用顺序)
+     */
+    bool Contains(size_t key) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_index.count(key) > 0;
+    }
+
+    /**
+     * @brief 放入块，超出容量时淘汰最久未使用的块(至少保留刚放入的块)
+     * @param key 块序号
+     * @param chunk 解压后的块
+     */
+    void Put(size_t key, ChunkPtr chunk)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_index.find(key);
+        if (it != m_index.end())
+        {
+            m_lru.splice(m_lru.begin(), m_lru, it->second);
+            return;
+        }
+
+        m_bytes += SizeOf(*chunk);
+        m_lru.emplace_front(key, std::move(chunk));
+        m_index[key] = m_lru.begin();
+        Evict(1);
+    }
+
+    /**
+     * @brief 设置缓存容量，超出新容量的块立即淘汰
+     * @param capacity 缓存容量(字节)
+     */
+    void SetCapacity(size_t capacity)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_capacity = capacity;
+        Evict(0);
+    }
+
+    /**
+     * @brief 清空缓存
+     */
+    void Clear()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_lru.clear();
+        m_index.clear();
+        m_bytes = 0;
+    }
+
+private:
+    /**
+     * @brief 淘汰最久未使用的块直到不超出容量(需持有锁)
+     * @param keep 至少保留的块数
+     */
+    void Evict(size_t keep)
+    {
+        while (m_bytes > m_capacity && m_lru.size() > keep)
+        {
+            m_bytes -= SizeOf(*m_lru.back().second);
+            m_index.erase(m_lru.back().first);
+            m_lru.pop_back();
+        }
+    }
+
+    static size_t SizeOf(const DecodedChunk& chunk) { return chunk.records.size() + chunk.messages.size() * sizeof(mcap::Message); }
+
+    using Entry = std::pair<size_t, ChunkPtr>;
+
+    size_t m_capacity;                                               ///< 容量(字节)
+    size_t m_bytes = 0;                                              ///< 当前占用(字节)
+    std::list<Entry> m_lru;                                          ///< 按使用时间排序，最近使用在前
+    std::unordered_map<size_t, std::list<Entry>::iterator> m_index;  ///< 块序号到链表节点
+    mutable std::mutex m_mutex;                                      ///< 互斥锁
+};
+
+}  // namespace openbag
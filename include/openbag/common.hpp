@@ -12,14 +12,19 @@
 
 #include <yaml-cpp/yaml.h>
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cstring>
 #include <ctime>
+#include <exception>
+#include <functional>
 #include <iomanip>
 #include <mcap/mcap.hpp>
 #include <memory>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace openbag {
@@ -41,16 +46,68 @@ enum class StorageFormat {
   PROTOBUF ///< 原生Protobuf格式
 };
 
+/**
+ * @brief 重复消息去重模式
+ */
+enum class DedupMode {
+  NONE,      ///< 不去重
+  REFERENCE, ///< 重复消息写入引用帧，读取时透明还原
+  SKIP       ///< 重复消息直接跳过，仅记录计数
+};
+
+constexpr const char* kRawEncoding = "cdr";            ///< 原始CDR话题的消息编码
+constexpr const char* kRawSchemaEncoding = "omgidl";   ///< 原始CDR话题的模式编码(IDL文本)
+constexpr const char* kRawTypeNameSchemaEncoding = "openbag.typename";  ///< 原始CDR话题没有IDL文件时的模式编码，模式数据只有DDS类型名
+
 /**
  * @brief 话题信息结构
  */
 struct TopicInfo {
   std::string topic_name;            ///< 话题名称
   std::string proto_type;            ///< Protobuf类型
-  std::string proto_file;            ///< Protobuf文件
+  std::string proto_file;            ///< Protobuf文件(原始CDR话题为IDL文件，可为空)
   mcap::SchemaId schema_id;          ///< 模式ID
   mcap::ChannelId channel_id;        ///< 通道ID
   std::string encoding = "protobuf"; ///< 编码格式，默认为protobuf
+  std::string schema_encoding = "protobuf"; ///< 模式编码格式
+  std::string schema_data;                  ///< 序列化后的模式数据(为空时由proto导入器生成)
+  DedupMode dedup_mode = DedupMode::NONE;   ///< 重复消息去重模式
+  uint32_t delta_keyframe_interval = 0;     ///< 差分编码的关键帧间隔(消息数)，0表示不做差分
+};
+
+/**
+ * @brief 附件信息(标定文件、URDF、地图等静态数据)
+ */
+struct AttachmentInfo {
+  std::string name;                  ///< 附件名称，为空时使用文件名
+  std::string media_type;            ///< 媒体类型，为空时按扩展名推断
+  std::string path;                  ///< 源文件路径
+};
+
+/**
+ * @brief 元数据记录信息
+ */
+struct MetadataInfo {
+  std::string name;                  ///< 元数据名称
+  mcap::KeyValueMap values;          ///< 键值对
+};
+
+/**
+ * @brief 回放话题重映射规则
+ *
+ * from 以 '/' 结尾时按前缀匹配并替换前缀，否则按话题名精确匹配
+ */
+struct TopicRemapRule {
+  std::string from;                  ///< 原话题名或前缀
+  std::string to;                    ///< 目标话题名或前缀
+};
+
+/**
+ * @brief 回放时改写时间戳字段的规则
+ */
+struct TimestampRewriteRule {
+  std::string topic;                 ///< 原话题名
+  std::string field;                 ///< 字段路径，如 "header.stamp"
 };
 
 /**
@@ -208,4 +265,55 @@ inline std::string ConvertToString(const std::byte *data, size_t size) {
 
   return result;
 }
+/**
+ * @brief 用多个线程并行执行 func(0) ~ func(count - 1)
+ *
+ * 用于启动时批量创建传输层实体等互不依赖、单个耗时较长的任务。
+ * 所有任务结束后返回，任一任务抛出异常时在返回前重新抛出第一个异常。
+ *
+ * @param count 任务数
+ * @param threads 线程数，0表示CPU核数
+ * @param func 任务函数，参数为任务序号
+ */
+inline void ParallelFor(size_t count, size_t threads,
+                        const std::function<void(size_t)> &func) {
+  if (threads == 0) {
+    threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+  }
+  threads = std::min(threads, count);
+  if (threads <= 1) {
+    for (size_t i = 0; i < count; ++i) {
+      func(i);
+    }
+    return;
+  }
+
+  std::atomic<size_t> next{0};
+  std::exception_ptr error;
+  std::atomic<bool> failed{false};
+  auto worker = [&]() {
+    for (size_t i = next++; i < count && !failed; i = next++) {
+      try {
+        func(i);
+      } catch (...) {
+        if (!failed.exchange(true)) {
+          error = std::current_exception();
+        }
+      }
+    }
+  };
+
+  std::vector<std::thread> pool;
+  pool.reserve(threads - 1);
+  for (size_t i = 1; i < threads; ++i) {
+    pool.emplace_back(worker);
+  }
+  worker();
+  for (auto &thread : pool) {
+    thread.join();
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
 } // namespace openbag
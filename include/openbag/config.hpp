@@ -13,16 +13,27 @@
 
 #include <yaml-cpp/yaml.h>
 
+#include <algorithm>
 #include <cstdint>
 #include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "openbag/codec.hpp"
 #include "openbag/common.hpp"
 
 namespace openbag {
 
+/**
+ * @brief tee 存储后端的一个子目标
+ */
+struct StorageTeeTarget
+{
+    std::string backend = "mcap";  ///< 子后端名称
+    std::string output_path;       ///< 输出路径，为空时沿用录制配置的路径
+};
+
 /**
  * @brief 存储配置
  */
@@ -30,12 +41,21 @@ struct StorageConfig
 {
     int compression_level = 0;                                 ///< 压缩级别
     CompressionType compression_type = CompressionType::NONE;  ///< 压缩类型
+    size_t compression_threads = 1;                            ///< 块压缩线程数，1为在写入线程中压缩
     std::vector<std::string> proto_search_paths;               ///< proto搜索路径
 
     size_t write_batch_size = 1000;
     uint64_t max_file_size = 1024 * 1024 * 1024;
     uint64_t chunk_size = 1024;
     bool split_by_size = true;
+    std::string catalog_path;  ///< 目录索引文件路径，非空时每关闭一个文件追加一条索引
+    std::string backend = "mcap";                   ///< 存储后端: mcap / null / tee，或自行注册的后端
+    std::vector<StorageTeeTarget> tee_targets;      ///< 多路存储(tee)的子后端
+    std::vector<std::string> mirror_paths;          ///< 镜像目录，每个目录写一份与输出文件相同的文件
+    uint64_t mirror_queue_size = 64 * 1024 * 1024;  ///< 每个镜像写队列的上限(字节)
+    uint32_t live_flush_interval = 0;               ///< 实时落盘间隔(毫秒)，0为不启用
+    std::string stream_target;                      ///< 流式输出目标(stream 后端): - / unix:<路径> / 命名管道路径
+    uint64_t stream_queue_size = 16 * 1024 * 1024;  ///< 流式输出写队列的上限(字节)
 
     /**
      * @brief 构造函数，设置默认值
@@ -43,6 +63,16 @@ struct StorageConfig
     StorageConfig() {}
 };
 
+/**
+ * @brief 传输配置
+ */
+struct TransportConfig
+{
+    std::string type = "link";                    ///< 传输类型: link(DDS) / shm(本机共享内存)
+    uint64_t shm_ring_size = 4 * 1024 * 1024;     ///< 每个话题的共享内存环容量(字节)
+    std::string shm_prefix = "openbag";           ///< 共享内存名称前缀(/dev/shm/<前缀>.<话题>)
+};
+
 /**
  * @brief 录制配置
  */
@@ -55,10 +85,43 @@ struct RecorderConfig
 
     /** record */
     std::vector<TopicInfo> topics;  ///< 订阅的话题列表
+    int receive_threads = -1;       ///< 接收线程数: 小于0时在传输层回调线程中接收，0为CPU核数
+    TransportConfig transport;      ///< 传输配置
+    size_t startup_threads = 8;     ///< 启动时并行创建订阅者的线程数，0为CPU核数，1为逐个创建
+
+    /** static data */
+    std::vector<AttachmentInfo> attachments;  ///< 开始录制时写入的附件
+    std::vector<MetadataInfo> metadata;       ///< 开始录制时写入的元数据
 
     void LoadConfig(const std::string& config_file) { YAML::Node config = YAML::LoadFile(config_file); }
 };
 
+/**
+ * @brief 流控器配置(异步发布时限制带宽和调度发送顺序)
+ */
+struct FlowControllerConfig
+{
+    std::string name;                   ///< 流控器名称
+    std::string scheduler = "fifo";     ///< 调度策略: fifo / round_robin / high_priority / priority_reservation
+    int32_t max_bytes_per_period = 0;   ///< 每个周期最多发送的字节数，0表示不限制
+    uint64_t period_ms = 100;           ///< 周期(毫秒)
+};
+
+/**
+ * @brief 发布配置
+ */
+struct PublishConfig
+{
+    std::string topic;            ///< 发布话题名(重映射后)，为空时为默认配置
+    bool async = false;           ///< 是否异步发布(发布调用只入队即返回)
+    std::string flow_controller;  ///< 异步发布使用的流控器，为空时使用默认流控器
+    int32_t priority = 10;        ///< 优先级调度时的优先级(-10最高 ~ 10最低)
+    int32_t history_depth = 10;   ///< 发送历史深度
+    size_t batch_max_messages = 0;         ///< 批量发送的最大消息数，0表示不批量发送
+    size_t batch_max_bytes = 64 * 1024;    ///< 批量发送的最大字节数
+    uint32_t batch_max_latency_us = 1000;  ///< 批量发送的最大延迟(微秒)
+};
+
 /**
  * @brief 播放配置
  */
@@ -67,12 +130,38 @@ struct PlayerConfig
     std::string input_path;  ///< 输入文件路径
     bool loop_playback;      ///< 是否循环播放
     double playback_rate;    ///< 播放速率
+    bool reverse_playback;   ///< 是否反向播放
+    bool as_fast_as_possible;  ///< 是否尽快回放(不按时间间隔等待)
+    double clock_frequency;    ///< 时钟话题发布频率(Hz)，0表示不发布
+    std::string clock_topic;   ///< 时钟话题名称
+    std::string topic_namespace;                          ///< 回放话题命名空间前缀(未匹配重映射规则的话题)
+    std::vector<TopicRemapRule> topic_remaps;             ///< 回放话题重映射规则
+    std::vector<TimestampRewriteRule> timestamp_rewrites;  ///< 回放时改写为当前时间的时间戳字段
+    PublishConfig publish;                                ///< 默认发布配置
+    std::vector<PublishConfig> topic_publish;             ///< 按话题的发布配置
+    std::vector<FlowControllerConfig> flow_controllers;   ///< 流控器
     StorageConfig storage;   ///< 存储配置
+    TransportConfig transport;  ///< 传输配置
+    size_t startup_threads;     ///< 启动时并行创建发布者的线程数，0为CPU核数，1为逐个创建
+    uint64_t prepare_window_ms;  ///< 提前准备消息的文件时间窗口(毫秒)，0表示只提前准备下一条
+    bool preload;                ///< 是否预加载: 开始回放前把消息一次性还原到内存，之后只从内存发布
+    std::string preload_cache;   ///< 预加载缓存文件路径，为空时不使用缓存文件
 
     /**
      * @brief 构造函数，设置默认值
      */
-    PlayerConfig() : loop_playback(false), playback_rate(1.0) {}
+    PlayerConfig()
+        : loop_playback(false),
+          playback_rate(1.0),
+          reverse_playback(false),
+          as_fast_as_possible(false),
+          clock_frequency(0.0),
+          clock_topic("/clock"),
+          startup_threads(8),
+          prepare_window_ms(20),
+          preload(false)
+    {
+    }
 };
 
 struct BufferConfig
@@ -120,19 +209,106 @@ public:
                 m_recorderConfig.output_format = config["output"]["output_format"].as<std::string>();
             }
 
+            // 解析接收线程数
+            if (config["receive_threads"])
+            {
+                m_recorderConfig.receive_threads = config["receive_threads"].as<int>();
+            }
+
+            // 解析传输配置
+            if (config["transport"])
+            {
+                ParseTransportConfig(config["transport"], m_recorderConfig.transport);
+            }
+
+            // 解析启动时并行创建订阅者的线程数
+            if (config["startup_threads"])
+            {
+                m_recorderConfig.startup_threads = config["startup_threads"].as<size_t>();
+            }
+
             // 解析主题到消息类型的映射和主题到proto文件的映射
             if (config["topics"] && config["topics"].IsSequence())
             {
                 m_recorderConfig.topics.clear();
                 for (const auto& topic : config["topics"])
                 {
-                    if (topic["name"] && topic["type"] && topic["proto_file"])
+                    // 原始CDR话题: type 为DDS类型名，按原样录制线上字节，不需要proto文件
+                    const bool raw = topic["encoding"] && topic["encoding"].as<std::string>() == kRawEncoding;
+                    if (raw && topic["name"] && topic["type"])
+                    {
+                        TopicInfo topicInfo{topic["name"].as<std::string>(), topic["type"].as<std::string>()};
+                        topicInfo.encoding = kRawEncoding;
+                        topicInfo.schema_encoding = kRawTypeNameSchemaEncoding;
+                        if (topic["schema_file"])
+                        {
+                            topicInfo.proto_file = topic["schema_file"].as<std::string>();
+                            topicInfo.schema_encoding = kRawSchemaEncoding;
+                        }
+                        m_recorderConfig.topics.push_back(topicInfo);
+                    } else if (topic["name"] && topic["type"] && topic["proto_file"])
                     {
                         std::string name = topic["name"].as<std::string>();
                         std::string type = topic["type"].as<std::string>();
                         std::string proto_file = topic["proto_file"].as<std::string>();
-                        m_recorderConfig.topics.push_back(TopicInfo{name, type, proto_file});
+                        TopicInfo topicInfo{name, type, proto_file};
+
+                        // 可选: 重复消息去重模式 (none / reference / skip)
+                        if (topic["dedup"])
+                        {
+                            topicInfo.dedup_mode = DedupModeFromString(topic["dedup"].as<std::string>());
+                        }
+                        // 可选: 差分编码，每N条消息一个关键帧
+                        if (topic["delta_keyframe_interval"])
+                        {
+                            topicInfo.delta_keyframe_interval = topic["delta_keyframe_interval"].as<uint32_t>();
+                        }
+                        m_recorderConfig.topics.push_back(topicInfo);
+                    }
+                }
+            }
+
+            // 解析附件: 开始录制时以 Attachment 记录写入，不占用数据区的消息流
+            if (config["attachments"] && config["attachments"].IsSequence())
+            {
+                m_recorderConfig.attachments.clear();
+                for (const auto& attachment : config["attachments"])
+                {
+                    if (!attachment["path"])
+                    {
+                        continue;
+                    }
+                    AttachmentInfo info;
+                    info.path = attachment["path"].as<std::string>();
+                    if (attachment["name"])
+                    {
+                        info.name = attachment["name"].as<std::string>();
+                    }
+                    if (attachment["media_type"])
+                    {
+                        info.media_type = attachment["media_type"].as<std::string>();
                     }
+                    m_recorderConfig.attachments.push_back(info);
+                }
+            }
+
+            // 解析元数据
+            if (config["metadata"] && config["metadata"].IsSequence())
+            {
+                m_recorderConfig.metadata.clear();
+                for (const auto& item : config["metadata"])
+                {
+                    if (!item["name"] || !item["values"] || !item["values"].IsMap())
+                    {
+                        continue;
+                    }
+                    MetadataInfo info;
+                    info.name = item["name"].as<std::string>();
+                    for (const auto& value : item["values"])
+                    {
+                        info.values[value.first.as<std::string>()] = value.second.as<std::string>();
+                    }
+                    m_recorderConfig.metadata.push_back(info);
                 }
             }
 
@@ -172,6 +348,132 @@ public:
                 m_playerConfig.playback_rate = config["playback_rate"].as<double>();
             }
 
+            // 解析是否反向播放
+            if (config["reverse_playback"])
+            {
+                m_playerConfig.reverse_playback = config["reverse_playback"].as<bool>();
+            }
+
+            // 解析是否尽快回放
+            if (config["as_fast_as_possible"])
+            {
+                m_playerConfig.as_fast_as_possible = config["as_fast_as_possible"].as<bool>();
+            }
+
+            // 解析时钟话题
+            if (config["clock"])
+            {
+                if (config["clock"]["frequency"])
+                {
+                    m_playerConfig.clock_frequency = config["clock"]["frequency"].as<double>();
+                }
+                if (config["clock"]["topic"])
+                {
+                    m_playerConfig.clock_topic = config["clock"]["topic"].as<std::string>();
+                }
+            }
+
+            // 解析话题重映射
+            if (config["remap"])
+            {
+                if (config["remap"]["namespace"])
+                {
+                    m_playerConfig.topic_namespace = config["remap"]["namespace"].as<std::string>();
+                }
+                if (config["remap"]["rules"])
+                {
+                    m_playerConfig.topic_remaps.clear();
+                    for (const auto& ruleNode : config["remap"]["rules"])
+                    {
+                        TopicRemapRule rule;
+                        rule.from = ruleNode["from"].as<std::string>();
+                        rule.to = ruleNode["to"].as<std::string>();
+                        m_playerConfig.topic_remaps.push_back(rule);
+                    }
+                }
+            }
+
+            // 解析传输配置
+            if (config["transport"])
+            {
+                ParseTransportConfig(config["transport"], m_playerConfig.transport);
+            }
+
+            // 解析启动时并行创建发布者的线程数
+            if (config["startup_threads"])
+            {
+                m_playerConfig.startup_threads = config["startup_threads"].as<size_t>();
+            }
+
+            // 解析提前准备消息的时间窗口
+            if (config["prepare_window_ms"])
+            {
+                m_playerConfig.prepare_window_ms = config["prepare_window_ms"].as<uint64_t>();
+            }
+
+            // 解析预加载配置
+            if (config["preload"])
+            {
+                m_playerConfig.preload = config["preload"].as<bool>();
+            }
+            if (config["preload_cache"])
+            {
+                m_playerConfig.preload_cache = config["preload_cache"].as<std::string>();
+            }
+
+            // 解析发布配置
+            if (config["publish"])
+            {
+                const auto& publishNode = config["publish"];
+                ParsePublishConfig(publishNode, m_playerConfig.publish);
+                if (publishNode["topics"])
+                {
+                    m_playerConfig.topic_publish.clear();
+                    for (const auto& topicNode : publishNode["topics"])
+                    {
+                        PublishConfig topicConfig = m_playerConfig.publish;
+                        topicConfig.topic = topicNode["topic"].as<std::string>();
+                        ParsePublishConfig(topicNode, topicConfig);
+                        m_playerConfig.topic_publish.push_back(topicConfig);
+                    }
+                }
+                if (publishNode["flow_controllers"])
+                {
+                    m_playerConfig.flow_controllers.clear();
+                    for (const auto& controllerNode : publishNode["flow_controllers"])
+                    {
+                        FlowControllerConfig controller;
+                        controller.name = controllerNode["name"].as<std::string>();
+                        if (controllerNode["scheduler"])
+                        {
+                            controller.scheduler = controllerNode["scheduler"].as<std::string>();
+                        }
+                        if (controllerNode["max_bytes_per_period"])
+                        {
+                            controller.max_bytes_per_period = controllerNode["max_bytes_per_period"].as<int32_t>();
+                        }
+                        if (controllerNode["period_ms"])
+                        {
+                            controller.period_ms = controllerNode["period_ms"].as<uint64_t>();
+                        }
+                        m_playerConfig.flow_controllers.push_back(controller);
+                    }
+                }
+            }
+
+            // 解析时间戳改写规则
+            if (config["rewrite_timestamps"])
+            {
+                m_playerConfig.timestamp_rewrites.clear();
+                for (const auto& ruleNode : config["rewrite_timestamps"])
+                {
+                    TimestampRewriteRule rule;
+                    rule.topic = ruleNode["topic"].as<std::string>();
+                    rule.field = ruleNode["field"].as<std::string>();
+                    m_playerConfig.timestamp_rewrites.push_back(rule);
+                }
+            }
+
             return true;
         } catch (const YAML::Exception& e)
         {
@@ -222,6 +524,11 @@ public:
                 {
                     m_storageConfig.compression_level = config["compression"]["level"].as<int>();
                 }
+
+                if (config["compression"]["threads"])
+                {
+                    m_storageConfig.compression_threads = config["compression"]["threads"].as<size_t>();
+                }
             }
 
             // 解析写入批次大小
@@ -241,11 +548,80 @@ public:
                 m_storageConfig.chunk_size *= config["chunk_size"].as<uint64_t>();
             }
 
+            // 解析存储后端
+            if (config["backend"])
+            {
+                m_storageConfig.backend = config["backend"].as<std::string>();
+            }
+            if (config["tee"] && config["tee"].IsSequence())
+            {
+                m_storageConfig.tee_targets.clear();
+                for (const auto& targetNode : config["tee"])
+                {
+                    StorageTeeTarget target;
+                    if (targetNode["backend"])
+                    {
+                        target.backend = targetNode["backend"].as<std::string>();
+                    }
+                    if (targetNode["output_path"])
+                    {
+                        target.output_path = targetNode["output_path"].as<std::string>();
+                    }
+                    m_storageConfig.tee_targets.push_back(target);
+                }
+            }
+
+            // 解析镜像写入配置
+            if (config["mirror"])
+            {
+                const auto& mirrorNode = config["mirror"];
+                if (mirrorNode["paths"] && mirrorNode["paths"].IsSequence())
+                {
+                    m_storageConfig.mirror_paths.clear();
+                    for (const auto& path : mirrorNode["paths"])
+                    {
+                        m_storageConfig.mirror_paths.push_back(path.as<std::string>());
+                    }
+                }
+                if (mirrorNode["queue_size"])
+                {
+                    // 至少 1 MiB: 队列上限为 0 时每个块都要等镜像写空队列，主文件写入退化为同步
+                    m_storageConfig.mirror_queue_size = std::max<uint64_t>(mirrorNode["queue_size"].as<uint64_t>(), 1) * 1024 * 1024;
+                }
+            }
+
+            // 解析流式输出配置
+            if (config["stream"])
+            {
+                const auto& streamNode = config["stream"];
+                if (streamNode["target"])
+                {
+                    m_storageConfig.stream_target = streamNode["target"].as<std::string>();
+                }
+                if (streamNode["queue_size"])
+                {
+                    // 至少 1 MiB，与块大小相当，队列上限为 0 时写入与下游读取完全同步
+                    m_storageConfig.stream_queue_size = std::max<uint64_t>(streamNode["queue_size"].as<uint64_t>(), 1) * 1024 * 1024;
+                }
+            }
+
+            // 解析实时落盘间隔
+            if (config["live_flush_interval"])
+            {
+                m_storageConfig.live_flush_interval = config["live_flush_interval"].as<uint32_t>();
+            }
+
             // 解析是否按大小分割文件
             if (config["split_by_size"])
             {
                 m_storageConfig.split_by_size = config["split_by_size"].as<bool>();
             }
+
+            // 解析目录索引文件路径
+            if (config["catalog_path"])
+            {
+                m_storageConfig.catalog_path = config["catalog_path"].as<std::string>();
+            }
             return true;
         } catch (const YAML::Exception& e)
         {
@@ -314,6 +690,64 @@ public:
     void SetStorageConfig(const StorageConfig& config) { m_storageConfig = config; }
 
 private:
+    /**
+     * @brief 解析传输配置中出现的字段，未出现的字段保持原值
+     */
+    static void ParseTransportConfig(const YAML::Node& node, TransportConfig& transport)
+    {
+        if (node["type"])
+        {
+            transport.type = node["type"].as<std::string>();
+        }
+        if (node["shm"] && node["shm"]["ring_size"])
+        {
+            transport.shm_ring_size = node["shm"]["ring_size"].as<uint64_t>();
+        }
+        if (node["shm"] && node["shm"]["prefix"])
+        {
+            transport.shm_prefix = node["shm"]["prefix"].as<std::string>();
+        }
+    }
+
+    /**
+     * @brief 解析发布配置中出现的字段，未出现的字段保持原值
+     */
+    static void ParsePublishConfig(const YAML::Node& node, PublishConfig& publish)
+    {
+        if (node["async"])
+        {
+            publish.async = node["async"].as<bool>();
+        }
+        if (node["flow_controller"])
+        {
+            publish.flow_controller = node["flow_controller"].as<std::string>();
+        }
+        if (node["priority"])
+        {
+            publish.priority = node["priority"].as<int32_t>();
+        }
+        if (node["history_depth"])
+        {
+            publish.history_depth = node["history_depth"].as<int32_t>();
+        }
+        if (node["batch"])
+        {
+            const auto& batch = node["batch"];
+            if (batch["max_messages"])
+            {
+                publish.batch_max_messages = batch["max_messages"].as<size_t>();
+            }
+            if (batch["max_bytes"])
+            {
+                publish.batch_max_bytes = batch["max_bytes"].as<size_t>();
+            }
+            if (batch["max_latency_us"])
+            {
+                publish.batch_max_latency_us = batch["max_latency_us"].as<uint32_t>();
+            }
+        }
+    }
+
     RecorderConfig m_recorderConfig;  ///< 录制配置
     PlayerConfig m_playerConfig;      ///< 播放配置
     StorageConfig m_storageConfig;    ///< 存储配置
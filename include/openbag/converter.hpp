@@ -0,0 +1,663 @@
+/**
+ * @copyright Copyright (c) 2025 openbag
+ *
+ * @author Zhao Jun(zwhy2025@gmail.com)
+ * @version 0.1
+ * @date 2025-05-22
+ *
+ * @file converter.hpp
+ * @brief 离线转换器：按话题/时间过滤，重新压缩、重新分块，合并或切分文件，Protobuf流文件转为MCAP
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "openbag/common.hpp"
+#include "openbag/config.hpp"
+#include "openbag/proto_stream.hpp"
+#include "openbag/reader.hpp"
+#include "openbag/storage.hpp"
+
+namespace openbag {
+
+/**
+ * @brief 转换配置
+ */
+struct ConverterConfig
+{
+    std::vector<std::string> input_files;                          ///< 输入文件，按顺序合并到同一输出
+    std::string output_path = "./openbags/";                       ///< 输出路径
+    std::string filename_prefix = "converted";                     ///< 输出文件名前缀
+    std::unordered_set<std::string> topics;                        ///< 保留的话题，为空表示全部
+    uint64_t start_time = 0;                                       ///< 起始时间(纳秒，含)
+    uint64_t end_time = std::numeric_limits<uint64_t>::max();      ///< 结束时间(纳秒，含)
+    StorageConfig storage;                                         ///< 输出的压缩/分块/切分配置
+    size_t num_workers = 0;                                        ///< 解压线程数和输出的块压缩线程数，0表示使用全部核心
+    size_t max_inflight_chunks = 0;                                ///< 同时在途的块数，0表示线程数的两倍
+};
+
+/**
+ * @brief 离线转换器
+ *
+ * 流水线分四级：
+ * - I/O线程按文件顺序读取块的原始字节
+ * - 多个工作线程并行解压、过滤块内消息
+ * - 调用线程按块序号依次还原负载、写入 Storage
+ * - Storage 的压缩线程池(ParallelMcapWriter)并行压缩写满的输出块，按顺序写出
+ *
+ * 块按序号重排后写出，因此输出保持输入的消息顺序；在途块数有上限，内存占用有界。
+ */
+class Converter
+{
+public:
+    /**
+     * @brief 构造函数
+     * @param config 转换配置
+     */
+    explicit Converter(const ConverterConfig& config) : m_config(config)
+    {
+        if (m_config.num_workers == 0)
+        {
+            m_config.num_workers = std::max(1u, std::thread::hardware_concurrency());
+        }
+        if (m_config.max_inflight_chunks == 0)
+        {
+            m_config.max_inflight_chunks = m_config.num_workers * 2;
+        }
+        // 输出压缩(如 zstd 高级别)通常是转换的瓶颈，与解压使用同样多的线程
+        m_config.storage.compression_threads = m_config.num_workers;
+    }
+
+    /**
+     * @brief 执行转换
+     * @return 是否成功
+     */
+    bool Run()
+    {
+        if (m_config.input_files.empty())
+        {
+            std::cerr << "转换失败: 未指定输入文件" << std::endl;
+            return false;
+        }
+
+        m_stopped = false;
+        m_writtenMessages = 0;
+        m_skippedMessages = 0;
+        m_storage = std::make_shared<Storage>(m_config.storage);
+
+        FileInfo fileInfo;
+        fileInfo.prefix = m_config.filename_prefix;
+        fileInfo.extension = "mcap";
+        fileInfo.output_path = m_config.output_path;
+        if (!m_storage->Open(fileInfo))
+        {
+            std::cerr << "转换失败: 无法打开输出文件" << std::endl;
+            return false;
+        }
+
+        bool success = true;
+        for (const auto& inputFile : m_config.input_files)
+        {
+            if (m_stopped)
+            {
+                break;
+            }
+            if (!ConvertFile(inputFile))
+            {
+                std::cerr << "转换文件失败: " << inputFile << std::endl;
+                success = false;
+                break;
+            }
+        }
+
+        m_storage->Close();
+        return success;
+    }
+
+    /**
+     * @brief 请求中止转换
+     */
+    void Stop() { m_stopped = true; }
+
+    /**
+     * @brief 获取已写入的消息数量
+     * @return 消息数量
+     */
+    uint64_t GetWrittenMessages() const { return m_writtenMessages; }
+
+    /**
+     * @brief 获取被过滤掉的消息数量
+     * @return 消息数量
+     */
+    uint64_t GetSkippedMessages() const { return m_skippedMessages; }
+
+private:
+    /**
+     * @brief 流水线中的一个块
+     */
+    struct ChunkJob
+    {
+        mcap::ByteArray raw;   ///< 原始块记录
+        DecodedChunk decoded;  ///< 解压并过滤后的块
+        bool done = false;     ///< 是否处理完成
+        bool ok = false;       ///< 是否处理成功
+    };
+
+    /**
+     * @brief 转换单个输入文件
+     * @param inputFile 输入文件
+     * @return 是否成功
+     */
+    bool ConvertFile(const std::string& inputFile)
+    {
+        if (ProtoStreamReader::IsProtoStream(inputFile))
+        {
+            return ConvertProtoStream(inputFile);
+        }
+
+        Reader reader;
+        if (!reader.Open(inputFile))
+        {
+            return false;
+        }
+
+        std::cout << "转换文件: " << inputFile << std::endl;
+
+        // 注册需要保留的通道，记录通道ID到话题的映射
+        std::unordered_map<mcap::ChannelId, std::string> channelTopics;
+        if (!RegisterChannels(reader, channelTopics))
+        {
+            return false;
+        }
+        CopyStaticRecords(reader);
+        if (channelTopics.empty())
+        {
+            return true;
+        }
+
+        const auto& chunkIndexes = reader.GetChunkIndexes();
+        if (chunkIndexes.empty())
+        {
+            // 无块索引(未分块或无摘要)时退化为顺序读取
+            return ConvertLinear(reader, channelTopics);
+        }
+
+        // 按文件顺序挑选与时间范围、话题有交集的块
+        std::vector<const mcap::ChunkIndex*> selected;
+        for (const auto& index : chunkIndexes)
+        {
+            if (index.messageEndTime < m_config.start_time || index.messageStartTime > m_config.end_time)
+            {
+                continue;
+            }
+            if (!index.messageIndexOffsets.empty() &&
+                std::none_of(index.messageIndexOffsets.begin(), index.messageIndexOffsets.end(), [&](const auto& entry) { return channelTopics.count(entry.first) > 0; }))
+            {
+                continue;
+            }
+            selected.push_back(&index);
+        }
+        std::sort(selected.begin(), selected.end(), [](const auto* a, const auto* b) { return a->chunkStartOffset < b->chunkStartOffset; });
+
+        return RunPipeline(reader, selected, channelTopics);
+    }
+
+    /**
+     * @brief 复制输入文件的附件和元数据，同名的只保留第一个
+     * @param reader 读取器
+     */
+    void CopyStaticRecords(Reader& reader)
+    {
+        for (const auto& name : reader.GetAttachmentNames())
+        {
+            AttachmentData attachment;
+            if (!m_storage->HasAttachment(name) && reader.ReadAttachment(name, attachment))
+            {
+                m_storage->AddAttachment(attachment.name, attachment.media_type, std::move(attachment.data), attachment.log_time);
+            }
+        }
+        for (const auto& name : reader.GetMetadataNames())
+        {
+            // 去重统计只对原文件有效
+            mcap::KeyValueMap values;
+            if (name != kDedupMetadataKey && !m_storage->HasMetadata(name) && reader.ReadMetadata(name, values))
+            {
+                m_storage->AddMetadata(name, values);
+            }
+        }
+    }
+
+    /**
+     * @brief 将输入文件的通道注册到输出存储
+     * @param reader 读取器
+     * @param[out] channelTopics 保留的通道ID到话题的映射
+     * @return 是否成功
+     */
+    bool RegisterChannels(Reader& reader, std::unordered_map<mcap::ChannelId, std::string>& channelTopics)
+    {
+        const auto schemas = reader.GetSchemas();
+        for (const auto& [channelId, channel] : reader.GetChannels())
+        {
+            auto schemaIt = schemas.find(channel->schemaId);
+            if (!RegisterChannel(*channel, schemaIt != schemas.end() ? schemaIt->second.get() : nullptr, channelTopics))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief 将单个通道注册到输出存储，不保留的话题直接跳过
+     * @param channel 通道
+     * @param schema 通道的模式，缺失时为空
+     * @param[out] channelTopics 保留的通道ID到话题的映射
+     * @return 是否成功
+     */
+    bool RegisterChannel(const mcap::Channel& channel, const mcap::Schema* schema, std::unordered_map<mcap::ChannelId, std::string>& channelTopics)
+    {
+        if (!m_config.topics.empty() && m_config.topics.count(channel.topic) == 0)
+        {
+            return true;
+        }
+
+        channelTopics[channel.id] = channel.topic;
+        if (m_storage->HasTopic(channel.topic))
+        {
+            return true;
+        }
+
+        if (!schema)
+        {
+            std::cerr << "通道缺少模式信息: " << channel.topic << std::endl;
+            return false;
+        }
+
+        TopicInfo topicInfo;
+        topicInfo.topic_name = channel.topic;
+        topicInfo.proto_type = schema->name;
+        topicInfo.encoding = UnframedEncoding(channel.messageEncoding);
+        topicInfo.schema_encoding = schema->encoding;
+        topicInfo.schema_data.assign(reinterpret_cast<const char*>(schema->data.data()), schema->data.size());
+        topicInfo.dedup_mode = DedupModeFromMetadata(channel.metadata);
+        topicInfo.delta_keyframe_interval = DeltaIntervalFromMetadata(channel.metadata);
+        return m_storage->RegisterTopicWithSchema(topicInfo);
+    }
+
+    /**
+     * @brief 转换Protobuf流文件: 按写入顺序读取记录，只含消息且与时间范围不相交的索引段整段跳过
+     * @param inputFile 输入文件
+     * @return 是否成功(末尾记录不完整时忽略该记录)
+     */
+    bool ConvertProtoStream(const std::string& inputFile)
+    {
+        ProtoStreamReader reader;
+        if (!reader.Open(inputFile))
+        {
+            return false;
+        }
+
+        std::cout << "转换文件: " << inputFile << std::endl;
+
+        std::vector<ProtoStreamIndexEntry> index;
+        ProtoStreamReader::LoadIndex(inputFile, index);
+        size_t nextEntry = 0;
+
+        std::unordered_map<mcap::SchemaId, mcap::Schema> schemas;
+        std::unordered_map<mcap::ChannelId, mcap::Channel> channels;
+        std::unordered_map<mcap::ChannelId, std::string> channelTopics;
+        PayloadResolver resolver;  // 按写入顺序读取，被引用帧总在缓存中，无需取回
+        bool framed = false;       // 有帧格式通道时不能整段跳过，否则后续引用帧无法还原
+        ProtoStreamRecordType type;
+        std::string_view body;
+        while (!m_stopped)
+        {
+            while (nextEntry < index.size() && index[nextEntry].offset < reader.Offset())
+            {
+                nextEntry++;
+            }
+            if (nextEntry < index.size() && index[nextEntry].offset == reader.Offset())
+            {
+                const auto& entry = index[nextEntry];
+                if (!framed && entry.records == entry.messages && (entry.end_time < m_config.start_time || entry.start_time > m_config.end_time))
+                {
+                    m_skippedMessages += entry.messages;
+                    reader.Seek(entry.offset + entry.length);
+                    continue;
+                }
+            }
+
+            if (!reader.Next(type, body))
+            {
+                break;
+            }
+
+            bool ok = true;
+            switch (type)
+            {
+                case ProtoStreamRecordType::SCHEMA:
+                {
+                    mcap::Schema schema;
+                    ok = ProtoStreamCodec::DecodeSchema(body, schema);
+                    if (ok)
+                    {
+                        schemas[schema.id] = std::move(schema);
+                    }
+                    break;
+                }
+                case ProtoStreamRecordType::CHANNEL:
+                {
+                    mcap::Channel channel;
+                    ok = ProtoStreamCodec::DecodeChannel(body, channel);
+                    if (ok)
+                    {
+                        auto schemaIt = schemas.find(channel.schemaId);
+                        ok = RegisterChannel(channel, schemaIt != schemas.end() ? &schemaIt->second : nullptr, channelTopics);
+                        if (ok && channelTopics.count(channel.id) > 0)
+                        {
+                            framed = framed || IsFramedEncoding(channel.messageEncoding) || channel.metadata.count(kFramingMetadataKey) > 0;
+                            channels[channel.id] = std::move(channel);
+                        }
+                    }
+                    break;
+                }
+                case ProtoStreamRecordType::MESSAGE:
+                {
+                    mcap::Message message;
+                    ok = ProtoStreamCodec::DecodeMessage(body, message);
+                    if (!ok)
+                    {
+                        break;
+                    }
+
+                    // 保留话题的消息都要还原(包括时间范围外的)，以维持引用帧缓存
+                    auto channelIt = channels.find(message.channelId);
+                    std::string_view payload;
+                    if (channelIt != channels.end() &&
+                        !resolver.Resolve(channelIt->second, message.logTime, message.sequence, std::string_view(reinterpret_cast<const char*>(message.data), message.dataSize), payload))
+                    {
+                        std::cerr << "还原消息负载失败，已跳过: " << channelIt->second.topic << " @ " << message.logTime << std::endl;
+                        m_skippedMessages++;
+                    } else if (!Accept(message, channelTopics))
+                    {
+                        m_skippedMessages++;
+                    } else
+                    {
+                        ok = WriteResolvedMessage(channelTopics.at(message.channelId), message, payload);
+                    }
+                    break;
+                }
+                case ProtoStreamRecordType::ATTACHMENT:
+                {
+                    mcap::Attachment attachment;
+                    ok = ProtoStreamCodec::DecodeAttachment(body, attachment);
+                    if (ok && !m_storage->HasAttachment(attachment.name))
+                    {
+                        m_storage->AddAttachment(attachment.name, attachment.mediaType,
+                                                 std::string(reinterpret_cast<const char*>(attachment.data), attachment.dataSize), attachment.logTime);
+                    }
+                    break;
+                }
+                case ProtoStreamRecordType::METADATA:
+                {
+                    // 去重统计只对原文件有效
+                    mcap::Metadata metadata;
+                    ok = ProtoStreamCodec::DecodeMetadata(body, metadata);
+                    if (ok && metadata.name != kDedupMetadataKey && !m_storage->HasMetadata(metadata.name))
+                    {
+                        m_storage->AddMetadata(metadata.name, metadata.metadata);
+                    }
+                    break;
+                }
+                default:
+                    break;  // 未知记录类型，跳过
+            }
+
+            if (!ok)
+            {
+                std::cerr << "Protobuf流记录无效，偏移 " << reader.Offset() << ": " << inputFile << std::endl;
+                return false;
+            }
+        }
+
+        if (reader.IsTruncated())
+        {
+            std::cerr << "文件末尾记录不完整(录制中断)，已忽略: " << inputFile << std::endl;
+        }
+        return true;
+    }
+
+    /**
+     * @brief 判断消息是否需要保留
+     */
+    bool Accept(const mcap::Message& message, const std::unordered_map<mcap::ChannelId, std::string>& channelTopics) const
+    {
+        return message.logTime >= m_config.start_time && message.logTime <= m_config.end_time && channelTopics.count(message.channelId) > 0;
+    }
+
+    /**
+     * @brief 顺序读取并写出(无块索引时使用)
+     */
+    bool ConvertLinear(Reader& reader, const std::unordered_map<mcap::ChannelId, std::string>& channelTopics)
+    {
+        mcap::ReadMessageOptions options;
+        options.startTime = m_config.start_time;
+        options.endTime = m_config.end_time == std::numeric_limits<uint64_t>::max() ? mcap::MaxTime : m_config.end_time + 1;
+
+        auto messageView = reader.GetMessages(options);
+        for (auto it = messageView.begin(); it != messageView.end() && !m_stopped; ++it)
+        {
+            if (!Accept(it->message, channelTopics))
+            {
+                m_skippedMessages++;
+                continue;
+            }
+            std::string_view payload;
+            if (!reader.ResolvePayload(*it, payload))
+            {
+                std::cerr << "还原消息负载失败，已跳过: " << it->channel->topic << " @ " << it->message.logTime << std::endl;
+                m_skippedMessages++;
+                continue;
+            }
+            if (!WriteResolvedMessage(channelTopics.at(it->message.channelId), it->message, payload))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief 以还原后的负载写出消息，输出存储按本文件的话题配置重新编码
+     */
+    bool WriteResolvedMessage(const std::string& topic, const mcap::Message& message, std::string_view payload)
+    {
+        mcap::Message resolved = message;
+        resolved.data = reinterpret_cast<const std::byte*>(payload.data());
+        resolved.dataSize = payload.size();
+        if (!m_storage->WriteRawMessage(topic, resolved))
+        {
+            return false;
+        }
+        m_writtenMessages++;
+        return true;
+    }
+
+    /**
+     * @brief 运行 读取 -> 并行解压过滤 -> 顺序写入 流水线
+     */
+    bool RunPipeline(Reader& reader, const std::vector<const mcap::ChunkIndex*>& selected, const std::unordered_map<mcap::ChannelId, std::string>& channelTopics)
+    {
+        std::mutex mutex;
+        std::condition_variable readyCV;    ///< 有新块待解压 / 有块处理完成
+        std::condition_variable capacityCV; ///< 在途块数下降
+        std::map<size_t, ChunkJob> jobs;    ///< 在途块，按序号排序
+        std::deque<size_t> pending;         ///< 待解压的块序号
+        bool readerDone = false;
+        bool failed = false;
+
+        // I/O线程：顺序读取原始块
+        std::thread ioThread([&] {
+            for (size_t seq = 0; seq < selected.size(); ++seq)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    capacityCV.wait(lock, [&] { return jobs.size() < m_config.max_inflight_chunks || failed || m_stopped; });
+                    if (failed || m_stopped)
+                    {
+                        break;
+                    }
+                }
+
+                mcap::ByteArray raw;
+                const bool ok = reader.ReadChunk(*selected[seq], raw);
+
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!ok)
+                {
+                    failed = true;
+                    break;
+                }
+                jobs[seq].raw = std::move(raw);
+                pending.push_back(seq);
+                readyCV.notify_all();
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            readerDone = true;
+            readyCV.notify_all();
+        });
+
+        // 工作线程：解压并过滤
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < m_config.num_workers; ++i)
+        {
+            workers.emplace_back([&] {
+                while (true)
+                {
+                    ChunkJob* job = nullptr;
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        readyCV.wait(lock, [&] { return !pending.empty() || readerDone || failed; });
+                        if (pending.empty() || failed)
+                        {
+                            return;
+                        }
+                        job = &jobs[pending.front()];
+                        pending.pop_front();
+                    }
+
+                    // std::map 的元素地址在插入/删除其他元素时保持不变，可在锁外处理
+                    const bool ok = Reader::DecodeChunk(job->raw, job->decoded);
+                    uint64_t skipped = 0;
+                    if (ok)
+                    {
+                        auto& messages = job->decoded.messages;
+                        const auto keep = std::remove_if(messages.begin(), messages.end(), [&](const mcap::Message& message) { return !Accept(message, channelTopics); });
+                        skipped = static_cast<uint64_t>(messages.end() - keep);
+                        messages.erase(keep, messages.end());
+                    }
+                    mcap::ByteArray().swap(job->raw);
+                    m_skippedMessages += skipped;
+
+                    std::lock_guard<std::mutex> lock(mutex);
+                    job->done = true;
+                    job->ok = ok;
+                    readyCV.notify_all();
+                }
+            });
+        }
+
+        // 调用线程：按序号写出
+        bool success = true;
+        for (size_t seq = 0; seq < selected.size() && success; ++seq)
+        {
+            ChunkJob* job = nullptr;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                readyCV.wait(lock, [&] {
+                    auto it = jobs.find(seq);
+                    return (it != jobs.end() && it->second.done) || failed || (readerDone && it == jobs.end());
+                });
+                auto it = jobs.find(seq);
+                if (it == jobs.end() || !it->second.done)
+                {
+                    success = false;
+                    break;
+                }
+                job = &it->second;
+            }
+
+            if (!job->ok)
+            {
+                std::cerr << "解压块失败, 序号: " << seq << std::endl;
+                success = false;
+            }
+            for (const auto& message : job->decoded.messages)
+            {
+                if (!success || m_stopped)
+                {
+                    break;
+                }
+                std::string_view payload;
+                if (!reader.ResolvePayload(message, payload))
+                {
+                    std::cerr << "还原消息负载失败，已跳过: " << channelTopics.at(message.channelId) << " @ " << message.logTime << std::endl;
+                    m_skippedMessages++;
+                    continue;
+                }
+                if (!WriteResolvedMessage(channelTopics.at(message.channelId), message, payload))
+                {
+                    success = false;
+                    break;
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.erase(seq);
+            if (!success || m_stopped)
+            {
+                failed = true;
+                readyCV.notify_all();
+            }
+            capacityCV.notify_all();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            failed = failed || !success;
+            readyCV.notify_all();
+            capacityCV.notify_all();
+        }
+        ioThread.join();
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+        return success && !failed;
+    }
+
+private:
+    ConverterConfig m_config;                    ///< 转换配置
+    StoragePtr m_storage;                        ///< 输出存储
+    std::atomic<bool> m_stopped{false};          ///< 中止标志
+    std::atomic<uint64_t> m_writtenMessages{0};  ///< 已写入消息数
+    std::atomic<uint64_t> m_skippedMessages{0};  ///< 被过滤消息数
+};
+
+}  // namespace openbag
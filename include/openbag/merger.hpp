@@ -0,0 +1,297 @@
+/**
+ * @copyright Copyright (c) 2025 openbag
+ *
+ * @author Zhao Jun(zwhy2025@gmail.com)
+ * @version 0.1
+ * @date 2025-05-22
+ *
+ * @file merger.hpp
+ * @brief 多文件合并：按 logTime 做 k 路归并
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <queue>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "openbag/common.hpp"
+#include "openbag/config.hpp"
+#include "openbag/reader.hpp"
+#include "openbag/storage.hpp"
+
+namespace openbag {
+
+/**
+ * @brief 合并配置
+ */
+struct MergerConfig
+{
+    std::vector<std::string> input_files;    ///< 输入文件
+    std::string output_path = "./openbags/";  ///< 输出路径
+    std::string filename_prefix = "merged";  ///< 输出文件名前缀
+    std::unordered_set<std::string> topics;  ///< 保留的话题，为空表示全部
+    StorageConfig storage;                   ///< 输出的压缩/分块/切分配置
+};
+
+/**
+ * @brief 多文件合并器
+ *
+ * 每个输入以 LogTimeOrder 打开一个块级的流式迭代器(只加载与当前时间重叠的块)，
+ * 再用最小堆在各输入的当前消息间做 k 路归并，内存占用与输入文件总大小无关。
+ * 相同话题且模式一致的通道合并为一个输出通道，相同模式只写入一次。
+ */
+class Merger
+{
+public:
+    /**
+     * @brief 构造函数
+     * @param config 合并配置
+     */
+    explicit Merger(const MergerConfig& config) : m_config(config) {}
+
+    /**
+     * @brief 执行合并
+     * @return 是否成功
+     */
+    bool Run()
+    {
+        if (m_config.input_files.empty())
+        {
+            std::cerr << "合并失败: 未指定输入文件" << std::endl;
+            return false;
+        }
+
+        m_stopped = false;
+        m_writtenMessages = 0;
+        m_conflictMessages = 0;
+        m_topicSchemas.clear();
+        m_inputs.clear();
+
+        m_storage = std::make_shared<Storage>(m_config.storage);
+        FileInfo fileInfo;
+        fileInfo.prefix = m_config.filename_prefix;
+        fileInfo.extension = "mcap";
+        fileInfo.output_path = m_config.output_path;
+        if (!m_storage->Open(fileInfo))
+        {
+            std::cerr << "合并失败: 无法打开输出文件" << std::endl;
+            return false;
+        }
+
+        // 打开所有输入并建立通道映射
+        for (size_t i = 0; i < m_config.input_files.size(); ++i)
+        {
+            auto input = OpenInput(m_config.input_files[i]);
+            if (!input)
+            {
+                m_storage->Close();
+                return false;
+            }
+            m_inputs.push_back(std::move(input));
+        }
+
+        // 以各输入的当前消息时间建立最小堆，时间相同时按输入顺序
+        using HeapEntry = std::pair<mcap::Timestamp, size_t>;
+        std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<HeapEntry>> heap;
+        for (size_t i = 0; i < m_inputs.size(); ++i)
+        {
+            if (m_inputs[i]->Valid())
+            {
+                heap.emplace(m_inputs[i]->Current().message.logTime, i);
+            }
+        }
+
+        bool success = true;
+        while (!heap.empty() && !m_stopped)
+        {
+            const size_t index = heap.top().second;
+            heap.pop();
+
+            auto& input = *m_inputs[index];
+            const auto& view = input.Current();
+            auto topicIt = input.channelTopics.find(view.message.channelId);
+            if (topicIt != input.channelTopics.end())
+            {
+                // 各输入的帧相互独立，先还原为原始负载，再由输出话题的编码器统一重新编码
+                std::string_view payload;
+                if (input.reader.ResolvePayload(view, payload))
+                {
+                    mcap::Message message = view.message;
+                    message.data = reinterpret_cast<const std::byte*>(payload.data());
+                    message.dataSize = payload.size();
+                    if (!m_storage->WriteRawMessage(topicIt->second, message))
+                    {
+                        success = false;
+                        break;
+                    }
+                    m_writtenMessages++;
+                } else
+                {
+                    std::cerr << "还原消息负载失败，已跳过: " << topicIt->second << " @ " << view.message.logTime << std::endl;
+                }
+            } else if (input.conflictChannels.count(view.message.channelId) > 0)
+            {
+                m_conflictMessages++;
+            }
+
+            input.Next();
+            if (input.Valid())
+            {
+                heap.emplace(input.Current().message.logTime, index);
+            }
+        }
+
+        m_inputs.clear();
+        m_storage->Close();
+        return success;
+    }
+
+    /**
+     * @brief 请求中止合并
+     */
+    void Stop() { m_stopped = true; }
+
+    /**
+     * @brief 获取已写入的消息数量
+     * @return 消息数量
+     */
+    uint64_t GetWrittenMessages() const { return m_writtenMessages; }
+
+    /**
+     * @brief 获取因模式冲突被丢弃的消息数量
+     * @return 消息数量
+     */
+    uint64_t GetConflictMessages() const { return m_conflictMessages; }
+
+private:
+    /**
+     * @brief 单个输入文件的归并游标
+     */
+    struct InputCursor
+    {
+        Reader reader;                                                  ///< 读取器
+        std::optional<mcap::LinearMessageView> view;                    ///< 按时间排序的消息视图
+        std::optional<mcap::LinearMessageView::Iterator> it;            ///< 当前位置
+        std::unordered_map<mcap::ChannelId, std::string> channelTopics;  ///< 输入通道到输出话题
+        std::unordered_set<mcap::ChannelId> conflictChannels;          ///< 模式冲突的通道
+
+        bool Valid() { return it && *it != view->end(); }
+        const mcap::MessageView& Current() const { return **it; }
+        void Next() { ++(*it); }
+    };
+
+    /**
+     * @brief 复制输入文件的附件和元数据，同名的只保留第一个
+     * @param reader 读取器
+     */
+    void CopyStaticRecords(Reader& reader)
+    {
+        for (const auto& name : reader.GetAttachmentNames())
+        {
+            AttachmentData attachment;
+            if (!m_storage->HasAttachment(name) && reader.ReadAttachment(name, attachment))
+            {
+                m_storage->AddAttachment(attachment.name, attachment.media_type, std::move(attachment.data), attachment.log_time);
+            }
+        }
+        for (const auto& name : reader.GetMetadataNames())
+        {
+            // 去重统计只对原文件有效
+            mcap::KeyValueMap values;
+            if (name != kDedupMetadataKey && !m_storage->HasMetadata(name) && reader.ReadMetadata(name, values))
+            {
+                m_storage->AddMetadata(name, values);
+            }
+        }
+    }
+
+    /**
+     * @brief 打开输入文件并注册通道
+     * @param filename 文件名
+     * @return 输入游标，失败时为空
+     */
+    std::unique_ptr<InputCursor> OpenInput(const std::string& filename)
+    {
+        auto input = std::make_unique<InputCursor>();
+        if (!input->reader.Open(filename))
+        {
+            return nullptr;
+        }
+
+        const auto schemas = input->reader.GetSchemas();
+        for (const auto& [channelId, channel] : input->reader.GetChannels())
+        {
+            if (!m_config.topics.empty() && m_config.topics.count(channel->topic) == 0)
+            {
+                continue;
+            }
+
+            auto schemaIt = schemas.find(channel->schemaId);
+            if (schemaIt == schemas.end())
+            {
+                std::cerr << "通道缺少模式信息: " << filename << " " << channel->topic << std::endl;
+                return nullptr;
+            }
+            const auto& schema = schemaIt->second;
+            std::string schemaKey = schema->name + '\0' + schema->encoding + '\0' + UnframedEncoding(channel->messageEncoding) + '\0';
+            schemaKey.append(reinterpret_cast<const char*>(schema->data.data()), schema->data.size());
+
+            // 同名话题要求模式一致，否则无法合并为同一通道
+            auto existing = m_topicSchemas.find(channel->topic);
+            if (existing != m_topicSchemas.end())
+            {
+                if (existing->second != schemaKey)
+                {
+                    std::cerr << "话题模式冲突，丢弃该输入中的此话题: " << filename << " " << channel->topic << std::endl;
+                    input->conflictChannels.insert(channelId);
+                    continue;
+                }
+                input->channelTopics[channelId] = channel->topic;
+                continue;
+            }
+
+            TopicInfo topicInfo;
+            topicInfo.topic_name = channel->topic;
+            topicInfo.proto_type = schema->name;
+            topicInfo.encoding = UnframedEncoding(channel->messageEncoding);
+            topicInfo.schema_encoding = schema->encoding;
+            topicInfo.schema_data.assign(reinterpret_cast<const char*>(schema->data.data()), schema->data.size());
+            topicInfo.dedup_mode = DedupModeFromMetadata(channel->metadata);
+            topicInfo.delta_keyframe_interval = DeltaIntervalFromMetadata(channel->metadata);
+            if (!m_storage->RegisterTopicWithSchema(topicInfo))
+            {
+                return nullptr;
+            }
+            m_topicSchemas[channel->topic] = std::move(schemaKey);
+            input->channelTopics[channelId] = channel->topic;
+        }
+
+        CopyStaticRecords(input->reader);
+
+        mcap::ReadMessageOptions options;
+        options.readOrder = mcap::ReadMessageOptions::ReadOrder::LogTimeOrder;
+        input->view.emplace(input->reader.GetMessages(options));
+        input->it.emplace(input->view->begin());
+        return input;
+    }
+
+private:
+    MergerConfig m_config;                                         ///< 合并配置
+    StoragePtr m_storage;                                          ///< 输出存储
+    std::vector<std::unique_ptr<InputCursor>> m_inputs;            ///< 输入游标
+    std::unordered_map<std::string, std::string> m_topicSchemas;  ///< 已注册话题的模式
+    std::atomic<bool> m_stopped{false};                            ///< 中止标志
+    std::atomic<uint64_t> m_writtenMessages{0};                    ///< 已写入消息数
+    std::atomic<uint64_t> m_conflictMessages{0};                   ///< 冲突丢弃消息数
+};
+
+}  // namespace openbag
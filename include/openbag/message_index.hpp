@@ -0,0 +1,237 @@
+/**
+ * @copyright Copyright (c) 2025 openbag
+ *
+ * @author Zhao Jun(zwhy2025@gmail.com)
+ * @version 0.1
+ * @date 2025-05-22
+ *
+ * @file message_index.hpp
+ * @brief 按话题的消息偏移索引及其旁路文件
+ *
+ * 索引项记录消息所在块的序号及其在解压后记录区中的偏移，按 logTime 排序，
+ * 第N条消息可直接定位，按时间查找为二分查找。
+ *
+ * 旁路文件(<文件名>.obidx)用于没有 MessageIndex 记录的文件，格式(小端序)：
+ * - 文件头: 魔数 "OBMIDX01"(8) + 源文件大小(uint64) + 源文件修改时间(int64) + 块数(uint32) + 话题数(uint32)
+ * - 每个话题: 名称(uint16 长度 + 字节) + 消息数(uint64) + 索引项(logTime uint64, offset uint64, chunk uint32, channel uint16)
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace openbag {
+
+constexpr char kMessageIndexMagic[8] = {'O', 'B', 'M', 'I', 'D', 'X', '0', '1'};  ///< 旁路文件魔数
+constexpr const char* kMessageIndexExtension = ".obidx";                         ///< 旁路文件后缀
+constexpr uint32_t kUnchunkedMessage = 0xFFFFFFFF;                               ///< 索引项的块序号: 消息不在块中
+
+/**
+ * @brief 消息索引项
+ */
+struct MessageIndexEntry
+{
+    uint64_t log_time = 0;    ///< 消息时间(纳秒)
+    uint64_t offset = 0;      ///< 消息记录在解压后记录区中的偏移(不在块中时为文件偏移)
+    uint32_t chunk = 0;       ///< 块在摘要块索引中的序号，不在块中时为 kUnchunkedMessage
+    uint16_t channel_id = 0;  ///< 通道ID
+
+    bool operator<(const MessageIndexEntry& other) const
+    {
+        if (log_time != other.log_time) return log_time < other.log_time;
+        if (chunk != other.chunk) return chunk < other.chunk;
+        return offset < other.offset;
+    }
+};
+
+/**
+ * @brief 话题到消息索引的映射，每个话题的索引项按时间排序
+ */
+using TopicMessageIndex = std::unordered_map<std::string, std::vector<MessageIndexEntry>>;
+
+/**
+ * @brief 在话题索引中查找时间最接近的消息
+ * @param entries 按时间排序的索引项
+ * @param logTime 目标时间(纳秒)
+ * @return 索引项序号，entries 为空时返回 0
+ */
+inline size_t FindNearestEntry(const std::vector<MessageIndexEntry>& entries, uint64_t logTime)
+{
+    auto it = std::lower_bound(entries.begin(), entries.end(), logTime, [](const MessageIndexEntry& entry, uint64_t time) { return entry.log_time < time; });
+    if (it == entries.end())
+    {
+        return entries.empty() ? 0 : entries.size() - 1;
+    }
+    if (it != entries.begin() && logTime - std::prev(it)->log_time < it->log_time - logTime)
+    {
+        --it;
+    }
+    return static_cast<size_t>(it - entries.begin());
+}
+
+/**
+ * @brief 消息索引旁路文件
+ */
+class MessageIndexSidecar
+{
+public:
+    /**
+     * @brief 获取源文件对应的旁路文件路径
+     */
+    static std::string PathFor(const std::string& bagPath) { return bagPath + kMessageIndexExtension; }
+
+    /**
+     * @brief 加载旁路文件，源文件大小/修改时间/块数不一致时视为失效
+     * @param bagPath 源文件路径
+     * @param chunkCount 源文件块数
+     * @param[out] index 消息索引
+     * @return 是否成功
+     */
+    static bool Load(const std::string& bagPath, uint32_t chunkCount, TopicMessageIndex& index)
+    {
+        std::ifstream file(PathFor(bagPath), std::ios::binary);
+        if (!file)
+        {
+            return false;
+        }
+
+        char magic[sizeof(kMessageIndexMagic)];
+        uint64_t bagSize = 0;
+        int64_t bagMtime = 0;
+        uint32_t storedChunks = 0;
+        uint32_t topicCount = 0;
+        file.read(magic, sizeof(magic));
+        Read(file, bagSize);
+        Read(file, bagMtime);
+        Read(file, storedChunks);
+        Read(file, topicCount);
+        if (!file || std::memcmp(magic, kMessageIndexMagic, sizeof(magic)) != 0)
+        {
+            return false;
+        }
+
+        uint64_t currentSize = 0;
+        int64_t currentMtime = 0;
+        if (!Stat(bagPath, currentSize, currentMtime) || bagSize != currentSize || bagMtime != currentMtime || storedChunks != chunkCount)
+        {
+            return false;
+        }
+
+        index.clear();
+        for (uint32_t i = 0; i < topicCount && file; ++i)
+        {
+            uint16_t nameSize = 0;
+            Read(file, nameSize);
+            std::string name(nameSize, '\0');
+            file.read(name.data(), nameSize);
+
+            uint64_t count = 0;
+            Read(file, count);
+            auto& entries = index[name];
+            entries.resize(count);
+            for (auto& entry : entries)
+            {
+                Read(file, entry.log_time);
+                Read(file, entry.offset);
+                Read(file, entry.chunk);
+                Read(file, entry.channel_id);
+            }
+        }
+
+        if (!file)
+        {
+            index.clear();
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief 保存旁路文件(先写临时文件再改名，避免读取到写了一半的文件)
+     * @param bagPath 源文件路径
+     * @param chunkCount 源文件块数
+     * @param index 消息索引
+     * @return 是否成功
+     */
+    static bool Save(const std::string& bagPath, uint32_t chunkCount, const TopicMessageIndex& index)
+    {
+        uint64_t bagSize = 0;
+        int64_t bagMtime = 0;
+        if (!Stat(bagPath, bagSize, bagMtime))
+        {
+            return false;
+        }
+
+        const std::string path = PathFor(bagPath);
+        const std::string tmpPath = path + ".tmp";
+        {
+            std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+            if (!file)
+            {
+                return false;
+            }
+
+            file.write(kMessageIndexMagic, sizeof(kMessageIndexMagic));
+            Write(file, bagSize);
+            Write(file, bagMtime);
+            Write(file, chunkCount);
+            Write(file, static_cast<uint32_t>(index.size()));
+            for (const auto& [topic, entries] : index)
+            {
+                Write(file, static_cast<uint16_t>(topic.size()));
+                file.write(topic.data(), static_cast<std::streamsize>(topic.size()));
+                Write(file, static_cast<uint64_t>(entries.size()));
+                for (const auto& entry : entries)
+                {
+                    Write(file, entry.log_time);
+                    Write(file, entry.offset);
+                    Write(file, entry.chunk);
+                    Write(file, entry.channel_id);
+                }
+            }
+            if (!file)
+            {
+                return false;
+            }
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(tmpPath, path, ec);
+        return !ec;
+    }
+
+private:
+    template <typename T>
+    static void Read(std::ifstream& file, T& value)
+    {
+        file.read(reinterpret_cast<char*>(&value), sizeof(value));
+    }
+
+    template <typename T>
+    static void Write(std::ofstream& file, const T& value)
+    {
+        file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    static bool Stat(const std::string& path, uint64_t& size, int64_t& mtime)
+    {
+        std::error_code ec;
+        size = std::filesystem::file_size(path, ec);
+        if (ec)
+        {
+            return false;
+        }
+        mtime = static_cast<int64_t>(std::filesystem::last_write_time(path, ec).time_since_epoch().count());
+        return !ec;
+    }
+};
+
+}  // namespace openbag
@@ -0,0 +1,324 @@
+/**
+ * @copyright Copyright (c) 2025 openbag
+ *
+ * @author Zhao Jun(zwhy2025@gmail.com)
+ * @version 0.1
+ * @date 2025-05-22
+ *
+ * @file mirror_writable.hpp
+ * @brief 镜像写入: MCAP写入器只构建、压缩一次，同样的字节由独立的I/O线程写入多个文件
+ *
+ * 写入器输出的字节按 kBlockSize 聚成块，块在各镜像之间共享(不复制)，放入每个镜像自己的写队列。
+ * 每个镜像有独立的队列上限：附加镜像所在的盘跟不上导致队列满时，该镜像降级
+ * (停止写入，文件改名为 .incomplete)，录制和其他镜像不受影响；
+ * 主文件(第一个路径)或只剩最后一个正常镜像时不降级，而是等待它写出，与不开镜像时的行为一致。
+ * 写入出错(如磁盘故障)的镜像同样降级。
+ */
+
+#pragma once
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <iostream>
+#include <mcap/mcap.hpp>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace openbag {
+
+constexpr const char* kIncompleteMirrorSuffix = ".incomplete";  ///< 降级镜像文件的后缀
+
+/**
+ * @brief 镜像写入目标
+ */
+class MirrorWritable : public mcap::IWritable
+{
+public:
+    static constexpr size_t kBlockSize = 1024 * 1024;  ///< 分发给各镜像的块大小
+
+    /**
+     * @brief 构造函数
+     * @param paths 各镜像的文件路径，第一个为主文件
+     * @param maxQueueBytes 每个镜像写队列的上限(字节)
+     */
+    MirrorWritable(const std::vector<std::string>& paths, uint64_t maxQueueBytes) : m_maxQueueBytes(maxQueueBytes)
+    {
+        for (const auto& path : paths)
+        {
+            auto mirror = std::make_unique<Mirror>();
+            mirror->path = path;
+            m_mirrors.push_back(std::move(mirror));
+        }
+    }
+
+    ~MirrorWritable() override { end(); }
+
+    /**
+     * @brief 打开所有镜像文件并启动I/O线程，打不开的镜像直接降级
+     * @return 是否至少有一个镜像打开成功
+     */
+    bool Open()
+    {
+        for (auto& mirror : m_mirrors)
+        {
+            std::error_code ec;
+            std::filesystem::create_directories(std::filesystem::path(mirror->path).parent_path(), ec);
+            mirror->fd = ::open(mirror->path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (mirror->fd < 0)
+            {
+                std::cerr << "打开镜像文件失败: " << mirror->path << " " << std::strerror(errno) << std::endl;
+                mirror->failed = true;
+                continue;
+            }
+            m_healthy++;
+            mirror->thread = std::thread(&MirrorWritable::IoLoop, this, std::ref(*mirror));
+        }
+        m_pending.reserve(kBlockSize);
+        return m_healthy > 0;
+    }
+
+    /**
+     * @brief 写入数据(由 mcap::IWritable::write 调用)
+     */
+    void handleWrite(const std::byte* data, uint64_t size) override
+    {
+        m_pending.append(reinterpret_cast<const char*>(data), size);
+        m_size += size;
+        if (m_pending.size() >= kBlockSize)
+        {
+            FlushPending();
+        }
+    }
+
+    /**
+     * @brief 写出剩余数据，等待所有镜像落盘并关闭文件
+     */
+    void end() override
+    {
+        if (m_ended)
+        {
+            return;
+        }
+        m_ended = true;
+        FlushPending();
+        for (auto& mirror : m_mirrors)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mirror->mutex);
+                mirror->done = true;
+            }
+            mirror->cv.notify_all();
+        }
+        for (auto& mirror : m_mirrors)
+        {
+            if (mirror->thread.joinable())
+            {
+                mirror->thread.join();
+            }
+        }
+    }
+
+    /**
+     * @brief 把不足一块的数据也分发给各镜像，不等待写出
+     */
+    void Flush() { FlushPending(); }
+
+    /**
+     * @brief 已写入的字节数(即文件的逻辑大小)
+     */
+    uint64_t size() const override { return m_size; }
+
+    /**
+     * @brief 正常(未降级)的镜像数
+     */
+    size_t HealthyCount() const { return m_healthy; }
+
+    /**
+     * @brief 第一个完整写出的镜像路径(主文件优先)，须在 end() 之后调用
+     * @return 文件路径，所有镜像都已降级时为空
+     */
+    std::string CompletePath() const
+    {
+        for (const auto& mirror : m_mirrors)
+        {
+            if (!mirror->failed)
+            {
+                return mirror->path;
+            }
+        }
+        return std::string();
+    }
+
+private:
+    /**
+     * @brief 单个镜像
+     */
+    struct Mirror
+    {
+        std::string path;                                      ///< 文件路径
+        int fd = -1;                                           ///< 文件描述符
+        std::thread thread;                                    ///< I/O线程
+        std::mutex mutex;                                      ///< 队列互斥锁
+        std::condition_variable cv;                            ///< 队列条件变量
+        std::deque<std::shared_ptr<const std::string>> queue;  ///< 写队列
+        uint64_t queuedBytes = 0;                              ///< 队列中的字节数
+        bool failed = false;                                   ///< 是否已降级
+        bool done = false;                                     ///< 写入已结束
+    };
+
+    /**
+     * @brief 把聚合的数据作为一个块分发给所有正常的镜像
+     */
+    void FlushPending()
+    {
+        if (m_pending.empty())
+        {
+            return;
+        }
+        auto block = std::make_shared<const std::string>(std::move(m_pending));
+        m_pending = std::string();
+        m_pending.reserve(kBlockSize);
+
+        for (size_t i = 0; i < m_mirrors.size(); ++i)
+        {
+            auto& mirror = m_mirrors[i];
+            std::unique_lock<std::mutex> lock(mirror->mutex);
+            if (mirror->failed)
+            {
+                continue;
+            }
+            // 空队列总能放入一个块，否则大于队列上限的块(如超大的消息)会永远等不到空间
+            const auto hasRoom = [&] { return mirror->queuedBytes == 0 || mirror->queuedBytes + block->size() <= m_maxQueueBytes; };
+            if (!hasRoom())
+            {
+                // 块本身超过上限时镜像并非跟不上，只是需要先写空队列，不降级
+                if (i > 0 && m_healthy > 1 && block->size() <= m_maxQueueBytes)
+                {
+                    MarkFailed(*mirror, "写入跟不上，写队列已满");
+                    lock.unlock();
+                    mirror->cv.notify_all();
+                    continue;
+                }
+                // 主文件或最后一个正常的镜像，等待它写出
+                mirror->cv.wait(lock, [&] { return mirror->failed || hasRoom(); });
+                if (mirror->failed)
+                {
+                    continue;
+                }
+            }
+            mirror->queue.push_back(block);
+            mirror->queuedBytes += block->size();
+            lock.unlock();
+            mirror->cv.notify_all();
+        }
+
+        if (m_healthy == 0)
+        {
+            std::cerr << "所有镜像均已降级，数据丢失" << std::endl;
+        }
+    }
+
+    /**
+     * @brief 镜像I/O线程
+     */
+    void IoLoop(Mirror& mirror)
+    {
+        std::unique_lock<std::mutex> lock(mirror.mutex);
+        while (true)
+        {
+            mirror.cv.wait(lock, [&mirror] { return mirror.failed || mirror.done || !mirror.queue.empty(); });
+            if (mirror.failed || mirror.queue.empty())
+            {
+                break;  // 已降级，或写入结束且队列已写完
+            }
+
+            auto block = mirror.queue.front();
+            lock.unlock();
+            const bool ok = WriteAll(mirror.fd, *block);
+            lock.lock();
+
+            if (!ok)
+            {
+                MarkFailed(mirror, std::string("写入失败: ") + std::strerror(errno));
+                break;
+            }
+            if (!mirror.queue.empty())
+            {
+                mirror.queue.pop_front();
+                mirror.queuedBytes -= block->size();
+            }
+            mirror.cv.notify_all();
+        }
+        const bool failed = mirror.failed;
+        lock.unlock();
+        mirror.cv.notify_all();
+
+        if (!failed && ::fsync(mirror.fd) != 0)
+        {
+            std::cerr << "镜像落盘失败: " << mirror.path << " " << std::strerror(errno) << std::endl;
+        }
+        ::close(mirror.fd);
+        mirror.fd = -1;
+
+        // 降级的镜像文件不完整，改名避免被当作有效文件
+        if (failed)
+        {
+            std::error_code ec;
+            std::filesystem::rename(mirror.path, mirror.path + kIncompleteMirrorSuffix, ec);
+        }
+    }
+
+    /**
+     * @brief 镜像降级(需持有 mirror.mutex)
+     */
+    void MarkFailed(Mirror& mirror, const std::string& reason)
+    {
+        if (mirror.failed)
+        {
+            return;
+        }
+        mirror.failed = true;
+        mirror.queue.clear();
+        mirror.queuedBytes = 0;
+        m_healthy--;
+        std::cerr << "镜像降级: " << mirror.path << " " << reason << std::endl;
+    }
+
+    static bool WriteAll(int fd, const std::string& data)
+    {
+        size_t written = 0;
+        while (written < data.size())
+        {
+            const ssize_t result = ::write(fd, data.data() + written, data.size() - written);
+            if (result < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                return false;
+            }
+            written += static_cast<size_t>(result);
+        }
+        return true;
+    }
+
+    std::vector<std::unique_ptr<Mirror>> m_mirrors;  ///< 镜像
+    uint64_t m_maxQueueBytes;                        ///< 每个镜像写队列的上限
+    std::atomic<size_t> m_healthy{0};                ///< 正常的镜像数
+    std::string m_pending;                           ///< 尚未分发的数据
+    uint64_t m_size = 0;                             ///< 已写入的字节数
+    bool m_ended = false;                            ///< 是否已结束
+};
+
+}  // namespace openbag
@@ -14,13 +14,28 @@
 
 // 核心组件
 #include "buffer.hpp"
+#include "catalog.hpp"
+#include "chunk_cache.hpp"
 #include "common.hpp"
 #include "config.hpp"
+#include "converter.hpp"
+#include "merger.hpp"
+#include "message_index.hpp"
+#include "mirror_writable.hpp"
+#include "parallel_writer.hpp"
+#include "playback_clock.hpp"
 #include "player.hpp"
+#include "preload.hpp"
+#include "proto_stream.hpp"
 #include "proto_utils.hpp"
 #include "reader.hpp"
 #include "recorder.hpp"
+#include "shm_transport.hpp"
 #include "storage.hpp"
+#include "storage_backend.hpp"
+#include "stream_writable.hpp"
+#include "tail_reader.hpp"
+#include "transform.hpp"
 #include "transport.hpp"
 
 /**
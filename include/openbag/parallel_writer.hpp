@@ -0,0 +1,577 @@
+/**
+ * @copyright Copyright (c) 2025 openbag
+ *
+ * @author Zhao Jun(zwhy2025@gmail.com)
+ * @version 0.1
+ * @date 2025-05-22
+ *
+ * @file parallel_writer.hpp
+ * @brief 多线程压缩块的MCAP写入器
+ *
+ * mcap::McapWriter 在调用 write 的线程内压缩写满的块，zstd 高级别时单核压缩速度就是写入的上限。
+ * 本写入器在调用线程中把消息序列化进当前块，块写满后交给压缩线程池，压缩完成的块仍按写入顺序
+ * 由调用线程写出，因此输出的消息顺序、块索引、消息索引和摘要与单线程写入一致。
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mcap/mcap.hpp>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace openbag {
+
+/**
+ * @brief 多线程压缩块的MCAP写入器，接口与 mcap::McapWriter 相同
+ *
+ * - 模式和通道在注册时直接写在数据区(不在块内)，摘要区同样包含全部模式和通道
+ * - 在途(已写满、未写出)的块数不超过线程数的两倍，内存占用有界
+ * - 块、附件的CRC与 McapWriter 的默认行为一致: 块计算CRC，附件和摘要区不计算(记为0)
+ * - 始终分块并写摘要，McapWriterOptions 中的 noChunking/noSummary 等选项不生效
+ */
+class ParallelMcapWriter
+{
+public:
+    /**
+     * @brief 构造函数
+     * @param numThreads 压缩线程数
+     */
+    explicit ParallelMcapWriter(size_t numThreads) : m_numThreads(std::max<size_t>(numThreads, 1)) {}
+
+    /**
+     * @brief 析构函数，未关闭时写出摘要并关闭
+     */
+    ~ParallelMcapWriter() { close(); }
+
+    ParallelMcapWriter(const ParallelMcapWriter&) = delete;
+    ParallelMcapWriter& operator=(const ParallelMcapWriter&) = delete;
+
+    /**
+     * @brief 打开输出文件
+     * @param filename 文件名
+     * @param options 写入选项(压缩方式、级别、块大小)
+     * @return 打开状态
+     */
+    mcap::Status open(std::string_view filename, const mcap::McapWriterOptions& options)
+    {
+        close();
+        auto file = std::make_unique<mcap::FileWriter>();
+        const auto status = file->open(filename);
+        if (!status.ok())
+        {
+            return status;
+        }
+        m_file = std::move(file);
+        Start(*m_file, options);
+        return status;
+    }
+
+    /**
+     * @brief 写入到自定义输出(镜像、流式输出等)，关闭时调用其 end()
+     * @param writer 输出目标，须在关闭前保持有效
+     * @param options 写入选项
+     */
+    void open(mcap::IWritable& writer, const mcap::McapWriterOptions& options)
+    {
+        close();
+        Start(writer, options);
+    }
+
+    /**
+     * @brief 写出所有块和摘要，关闭输出
+     */
+    void close()
+    {
+        if (!m_output)
+        {
+            return;
+        }
+        SubmitChunk();
+        DrainChunks(true);
+        StopWorkers();
+        WriteSummary();
+        m_output->end();
+        Reset();
+    }
+
+    /**
+     * @brief 丢弃未写出的块，不写摘要直接关闭输出
+     */
+    void terminate()
+    {
+        if (!m_output)
+        {
+            return;
+        }
+        StopWorkers();
+        Reset();
+    }
+
+    /**
+     * @brief 注册模式，分配模式ID并写入数据区
+     * @param schema 模式，id 字段被赋值
+     */
+    void addSchema(mcap::Schema& schema)
+    {
+        schema.id = static_cast<mcap::SchemaId>(m_schemas.size() + 1);
+        m_schemas.push_back(schema);
+        m_statistics.schemaCount++;
+        if (m_output)
+        {
+            mcap::McapWriter::write(*m_output, schema);
+        }
+    }
+
+    /**
+     * @brief 注册通道，分配通道ID并写入数据区
+     * @param channel 通道，id 字段被赋值
+     */
+    void addChannel(mcap::Channel& channel)
+    {
+        channel.id = static_cast<mcap::ChannelId>(m_channels.size() + 1);
+        m_channels.push_back(channel);
+        m_statistics.channelCount++;
+        if (m_output)
+        {
+            mcap::McapWriter::write(*m_output, channel);
+        }
+    }
+
+    /**
+     * @brief 写入消息: 序列化进当前块，块写满时交给压缩线程
+     * @param message 消息，数据在调用返回后即可释放
+     * @return 写入状态
+     */
+    mcap::Status write(const mcap::Message& message)
+    {
+        if (!m_output)
+        {
+            return mcap::Status(mcap::StatusCode::NotOpen);
+        }
+        if (message.channelId == 0 || message.channelId > m_channels.size())
+        {
+            return mcap::Status(mcap::StatusCode::InvalidChannelId);
+        }
+
+        auto& chunk = *m_current;
+        if (chunk.writer->empty())
+        {
+            chunk.startTime = message.logTime;
+            chunk.endTime = message.logTime;
+        } else
+        {
+            chunk.startTime = std::min(chunk.startTime, message.logTime);
+            chunk.endTime = std::max(chunk.endTime, message.logTime);
+        }
+        auto& index = chunk.indexes[message.channelId];
+        index.channelId = message.channelId;
+        index.records.emplace_back(message.logTime, chunk.writer->size());
+        mcap::McapWriter::write(*chunk.writer, message);
+
+        if (m_statistics.messageCount == 0)
+        {
+            m_statistics.messageStartTime = message.logTime;
+            m_statistics.messageEndTime = message.logTime;
+        } else
+        {
+            m_statistics.messageStartTime = std::min(m_statistics.messageStartTime, message.logTime);
+            m_statistics.messageEndTime = std::max(m_statistics.messageEndTime, message.logTime);
+        }
+        m_statistics.messageCount++;
+        m_statistics.channelMessageCounts[message.channelId]++;
+
+        if (chunk.writer->size() >= m_options.chunkSize)
+        {
+            SubmitChunk();
+        }
+        DrainChunks(false);
+        return mcap::Status();
+    }
+
+    /**
+     * @brief 写入附件(直接写在数据区)
+     * @param attachment 附件，crc 字段被置为0
+     * @return 写入状态
+     */
+    mcap::Status write(mcap::Attachment& attachment)
+    {
+        if (!m_output)
+        {
+            return mcap::Status(mcap::StatusCode::NotOpen);
+        }
+        attachment.crc = 0;
+
+        mcap::AttachmentIndex index;
+        index.offset = m_output->size();
+        index.length = mcap::McapWriter::write(*m_output, attachment);
+        index.logTime = attachment.logTime;
+        index.createTime = attachment.createTime;
+        index.dataSize = attachment.dataSize;
+        index.name = attachment.name;
+        index.mediaType = attachment.mediaType;
+        m_attachmentIndexes.push_back(std::move(index));
+        m_statistics.attachmentCount++;
+        return mcap::Status();
+    }
+
+    /**
+     * @brief 写入元数据(直接写在数据区)
+     * @param metadata 元数据
+     * @return 写入状态
+     */
+    mcap::Status write(const mcap::Metadata& metadata)
+    {
+        if (!m_output)
+        {
+            return mcap::Status(mcap::StatusCode::NotOpen);
+        }
+
+        mcap::MetadataIndex index;
+        index.offset = m_output->size();
+        index.length = mcap::McapWriter::write(*m_output, metadata);
+        index.name = metadata.name;
+        m_metadataIndexes.push_back(std::move(index));
+        m_statistics.metadataCount++;
+        return mcap::Status();
+    }
+
+    /**
+     * @brief 统计信息，chunkCount 为已写出到输出的块数
+     */
+    const mcap::Statistics& statistics() const { return m_statistics; }
+
+    /**
+     * @brief 输出目标，未打开时为空
+     */
+    mcap::IWritable* dataSink() { return m_output; }
+
+    /**
+     * @brief 封闭当前块并等待所有在途的块压缩、写出
+     */
+    void closeLastChunk()
+    {
+        if (!m_output)
+        {
+            return;
+        }
+        SubmitChunk();
+        DrainChunks(true);
+    }
+
+private:
+    /**
+     * @brief 在途的块
+     */
+    struct PendingChunk
+    {
+        std::unique_ptr<mcap::IChunkWriter> writer;              ///< 块内记录，压缩线程调用 end() 压缩
+        std::string compression;                                 ///< 压缩方式名称
+        std::map<mcap::ChannelId, mcap::MessageIndex> indexes;   ///< 每个通道的消息索引(偏移相对于块内记录)
+        mcap::Timestamp startTime = 0;                           ///< 最早的消息时间
+        mcap::Timestamp endTime = 0;                             ///< 最晚的消息时间
+        bool compressed = false;                                 ///< 是否已压缩
+    };
+
+    /**
+     * @brief 写入文件头，启动压缩线程
+     */
+    void Start(mcap::IWritable& output, const mcap::McapWriterOptions& options)
+    {
+        m_output = &output;
+        m_options = options;
+        m_maxInflight = m_numThreads * 2;
+        m_stop = false;
+
+        mcap::McapWriter::writeMagic(*m_output);
+        mcap::Header header;
+        header.profile = m_options.profile;
+        header.library = m_options.library;
+        mcap::McapWriter::write(*m_output, header);
+
+        // 先于第一次 write 注册的模式和通道补写到数据区
+        for (const auto& schema : m_schemas)
+        {
+            mcap::McapWriter::write(*m_output, schema);
+        }
+        for (const auto& channel : m_channels)
+        {
+            mcap::McapWriter::write(*m_output, channel);
+        }
+
+        m_current = NewChunk();
+        for (size_t i = 0; i < m_numThreads; ++i)
+        {
+            m_workers.emplace_back([this] { CompressLoop(); });
+        }
+    }
+
+    /**
+     * @brief 取一个空块，优先复用已写出的块的缓冲区
+     */
+    std::unique_ptr<PendingChunk> NewChunk()
+    {
+        if (!m_freeChunks.empty())
+        {
+            auto chunk = std::move(m_freeChunks.back());
+            m_freeChunks.pop_back();
+            return chunk;
+        }
+
+        auto chunk = std::make_unique<PendingChunk>();
+        switch (m_options.compression)
+        {
+#ifndef MCAP_COMPRESSION_NO_LZ4
+            case mcap::Compression::Lz4:
+                chunk->writer = std::make_unique<mcap::LZ4Writer>(m_options.compressionLevel, m_options.chunkSize);
+                chunk->compression = "lz4";
+                break;
+#endif
+#ifndef MCAP_COMPRESSION_NO_ZSTD
+            case mcap::Compression::Zstd:
+                chunk->writer = std::make_unique<mcap::ZStdWriter>(m_options.compressionLevel, m_options.chunkSize);
+                chunk->compression = "zstd";
+                break;
+#endif
+            default:
+                chunk->writer = std::make_unique<mcap::BufferWriter>();
+                break;
+        }
+        chunk->writer->crcEnabled = !m_options.noChunkCRC;
+        return chunk;
+    }
+
+    /**
+     * @brief 把当前块交给压缩线程，换一个空块
+     */
+    void SubmitChunk()
+    {
+        if (!m_current || m_current->writer->empty())
+        {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_jobs.push_back(m_current.get());
+            m_chunks.push_back(std::move(m_current));
+        }
+        m_jobCV.notify_one();
+        m_current = NewChunk();
+    }
+
+    /**
+     * @brief 按顺序写出已压缩的块
+     * @param all true 时等待并写出所有在途的块，否则只写出队首已压缩的块(在途块数超限时等待)
+     */
+    void DrainChunks(bool all)
+    {
+        while (true)
+        {
+            std::unique_ptr<PendingChunk> chunk;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                if (m_chunks.empty())
+                {
+                    return;
+                }
+                PendingChunk* front = m_chunks.front().get();
+                if (!front->compressed)
+                {
+                    if (!all && m_chunks.size() <= m_maxInflight)
+                    {
+                        return;
+                    }
+                    m_doneCV.wait(lock, [front] { return front->compressed; });
+                }
+                chunk = std::move(m_chunks.front());
+                m_chunks.pop_front();
+            }
+
+            WriteChunk(*chunk);
+            chunk->writer->clear();
+            chunk->indexes.clear();
+            chunk->compressed = false;
+            m_freeChunks.push_back(std::move(chunk));
+        }
+    }
+
+    /**
+     * @brief 压缩线程: 依次压缩提交的块
+     */
+    void CompressLoop()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true)
+        {
+            m_jobCV.wait(lock, [this] { return m_stop || !m_jobs.empty(); });
+            if (m_jobs.empty())
+            {
+                return;
+            }
+            PendingChunk* chunk = m_jobs.front();
+            m_jobs.pop_front();
+
+            lock.unlock();
+            chunk->writer->end();
+            lock.lock();
+
+            chunk->compressed = true;
+            m_doneCV.notify_all();
+        }
+    }
+
+    /**
+     * @brief 写出块记录及其消息索引，记录块索引
+     */
+    void WriteChunk(PendingChunk& chunk)
+    {
+        auto& writer = *chunk.writer;
+
+        // 压缩后不变小时按未压缩存储，与 McapWriter 一致
+        const bool compressed = m_options.forceCompression || writer.compressedSize() < writer.size();
+        mcap::Chunk record;
+        record.messageStartTime = chunk.startTime;
+        record.messageEndTime = chunk.endTime;
+        record.uncompressedSize = writer.size();
+        record.uncompressedCrc = writer.crcEnabled ? writer.crc() : 0;
+        record.compression = compressed ? chunk.compression : std::string();
+        record.compressedSize = compressed ? writer.compressedSize() : writer.size();
+        record.records = compressed ? writer.compressedData() : writer.data();
+
+        mcap::ChunkIndex index;
+        index.messageStartTime = chunk.startTime;
+        index.messageEndTime = chunk.endTime;
+        index.chunkStartOffset = m_output->size();
+        index.chunkLength = mcap::McapWriter::write(*m_output, record);
+        index.compression = record.compression;
+        index.compressedSize = record.compressedSize;
+        index.uncompressedSize = record.uncompressedSize;
+
+        const uint64_t messageIndexStart = m_output->size();
+        for (const auto& [channelId, messageIndex] : chunk.indexes)
+        {
+            index.messageIndexOffsets[channelId] = m_output->size();
+            mcap::McapWriter::write(*m_output, messageIndex);
+        }
+        index.messageIndexLength = m_output->size() - messageIndexStart;
+
+        m_chunkIndexes.push_back(std::move(index));
+        m_statistics.chunkCount++;
+    }
+
+    /**
+     * @brief 写出数据区结束记录、摘要区、摘要偏移和文件尾
+     */
+    void WriteSummary()
+    {
+        auto& output = *m_output;
+        mcap::DataEnd dataEnd;
+        dataEnd.dataSectionCrc = 0;
+        mcap::McapWriter::write(output, dataEnd);
+
+        const uint64_t summaryStart = output.size();
+        std::vector<mcap::SummaryOffset> summaryOffsets;
+        const auto writeGroup = [&](mcap::OpCode opcode, const auto& records) {
+            const uint64_t groupStart = output.size();
+            for (const auto& record : records)
+            {
+                mcap::McapWriter::write(output, record);
+            }
+            if (output.size() > groupStart)
+            {
+                mcap::SummaryOffset summaryOffset;
+                summaryOffset.groupOpCode = opcode;
+                summaryOffset.groupStart = groupStart;
+                summaryOffset.groupLength = output.size() - groupStart;
+                summaryOffsets.push_back(summaryOffset);
+            }
+        };
+        writeGroup(mcap::OpCode::Schema, m_schemas);
+        writeGroup(mcap::OpCode::Channel, m_channels);
+        writeGroup(mcap::OpCode::Statistics, std::vector<mcap::Statistics>{m_statistics});
+        writeGroup(mcap::OpCode::ChunkIndex, m_chunkIndexes);
+        writeGroup(mcap::OpCode::AttachmentIndex, m_attachmentIndexes);
+        writeGroup(mcap::OpCode::MetadataIndex, m_metadataIndexes);
+
+        const uint64_t summaryOffsetStart = output.size();
+        for (const auto& summaryOffset : summaryOffsets)
+        {
+            mcap::McapWriter::write(output, summaryOffset);
+        }
+
+        mcap::Footer footer;
+        footer.summaryStart = summaryStart;
+        footer.summaryOffsetStart = summaryOffsetStart;
+        footer.summaryCrc = 0;
+        mcap::McapWriter::write(output, footer, false);
+        mcap::McapWriter::writeMagic(output);
+    }
+
+    /**
+     * @brief 等待压缩线程处理完已提交的块后退出
+     */
+    void StopWorkers()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_jobCV.notify_all();
+        for (auto& worker : m_workers)
+        {
+            worker.join();
+        }
+        m_workers.clear();
+    }
+
+    /**
+     * @brief 清空本文件的状态，模式和通道须在下一个文件中重新注册
+     */
+    void Reset()
+    {
+        m_output = nullptr;
+        m_file.reset();
+        m_current.reset();
+        m_chunks.clear();
+        m_jobs.clear();
+        m_schemas.clear();
+        m_channels.clear();
+        m_chunkIndexes.clear();
+        m_attachmentIndexes.clear();
+        m_metadataIndexes.clear();
+        m_statistics = mcap::Statistics();
+    }
+
+private:
+    size_t m_numThreads;                                     ///< 压缩线程数
+    size_t m_maxInflight = 0;                                ///< 在途块数上限
+    mcap::McapWriterOptions m_options{""};                   ///< 写入选项
+    mcap::IWritable* m_output = nullptr;                     ///< 输出目标
+    std::unique_ptr<mcap::FileWriter> m_file;                ///< 按文件名打开时拥有的文件输出
+    std::unique_ptr<PendingChunk> m_current;                 ///< 正在填充的块
+    std::vector<std::unique_ptr<PendingChunk>> m_freeChunks; ///< 可复用的块
+    std::vector<mcap::Schema> m_schemas;                     ///< 已注册的模式，下标为ID-1
+    std::vector<mcap::Channel> m_channels;                   ///< 已注册的通道，下标为ID-1
+    std::vector<mcap::ChunkIndex> m_chunkIndexes;            ///< 已写出的块的索引
+    std::vector<mcap::AttachmentIndex> m_attachmentIndexes;  ///< 附件索引
+    std::vector<mcap::MetadataIndex> m_metadataIndexes;      ///< 元数据索引
+    mcap::Statistics m_statistics{};                         ///< 统计信息
+
+    std::mutex m_mutex;                                      ///< 保护以下成员和块的 compressed 标志
+    std::condition_variable m_jobCV;                         ///< 有块待压缩 / 停止
+    std::condition_variable m_doneCV;                        ///< 有块压缩完成
+    std::deque<std::unique_ptr<PendingChunk>> m_chunks;      ///< 在途的块，按写入顺序
+    std::deque<PendingChunk*> m_jobs;                        ///< 待压缩的块
+    std::vector<std::thread> m_workers;                      ///< 压缩线程
+    bool m_stop = false;                                     ///< 停止压缩线程
+};
+
+}  // namespace openbag
@@ -0,0 +1,210 @@
+/**
+ * @copyright Copyright (c) 2025 openbag
+ *
+ * @author Zhao Jun(zwhy2025@gmail.com)
+ * @version 0.1
+ * @date 2025-05-22
+ *
+ * @file playback_clock.hpp
+ * @brief 回放时钟：文件时间与单调时钟之间的映射
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+namespace openbag {
+
+/**
+ * @brief 回放时钟
+ *
+ * 以一个锚点(单调时钟时刻, 文件时间)加上速率与方向描述文件时间的推进，
+ * 速率/方向改变或暂停恢复时在当前文件时间处重新设置锚点，时间连续不跳变。
+ * 尽快回放模式下不按单调时钟推进，文件时间即最后一条已发布消息的时间。
+ * 所有接口线程安全，回放线程用于计时，其他线程可随时查询当前回放时间。
+ */
+class PlaybackClock
+{
+public:
+    using SteadyClock = std::chrono::steady_clock;
+
+    /**
+     * @brief 构造函数
+     * @param rate 播放速率
+     * @param reverse 是否反向
+     * @param asFastAsPossible 是否尽快回放(不按时间间隔等待)
+     */
+    explicit PlaybackClock(double rate = 1.0, bool reverse = false, bool asFastAsPossible = false)
+        : m_rate(rate > 0.0 ? rate : 1.0), m_reverse(reverse), m_asFastAsPossible(asFastAsPossible)
+    {
+    }
+
+    /**
+     * @brief 重新配置并清除锚点(开始新一次回放时调用)
+     * @param rate 播放速率
+     * @param reverse 是否反向
+     * @param asFastAsPossible 是否尽快回放
+     */
+    void Configure(double rate, bool reverse, bool asFastAsPossible)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_rate = rate > 0.0 ? rate : 1.0;
+        m_reverse = reverse;
+        m_asFastAsPossible = asFastAsPossible;
+        m_paused = false;
+        m_started = false;
+        m_bagAnchor = 0;
+    }
+
+    /**
+     * @brief 以当前时刻为锚点，设置文件时间
+     * @param bagTime 文件时间(纳秒)
+     */
+    void Reset(uint64_t bagTime)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_wallAnchor = SteadyClock::now();
+        m_bagAnchor = bagTime;
+        m_started = true;
+    }
+
+    /**
+     * @brief 设置播放速率，在当前文件时间处重新设置锚点
+     */
+    void SetRate(double rate)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Reanchor();
+        m_rate = rate > 0.0 ? rate : 1.0;
+    }
+
+    /**
+     * @brief 设置播放方向，在当前文件时间处重新设置锚点
+     */
+    void SetReverse(bool reverse)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Reanchor();
+        m_reverse = reverse;
+    }
+
+    /**
+     * @brief 暂停，冻结当前文件时间
+     */
+    void Pause()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_paused)
+        {
+            Reanchor();
+            m_paused = true;
+        }
+    }
+
+    /**
+     * @brief 恢复，从冻结的文件时间继续推进
+     */
+    void Resume()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_paused)
+        {
+            m_wallAnchor = SteadyClock::now();
+            m_paused = false;
+        }
+    }
+
+    /**
+     * @brief 记录已发布消息的文件时间(尽快回放模式及单步时以此作为当前时间)
+     * @param bagTime 文件时间(纳秒)
+     */
+    void Observe(uint64_t bagTime)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_paused || m_asFastAsPossible)
+        {
+            m_bagAnchor = bagTime;
+        }
+    }
+
+    /**
+     * @brief 获取当前文件时间
+     * @return 文件时间(纳秒)，尚未开始时为0
+     */
+    uint64_t Now() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return NowLocked(SteadyClock::now());
+    }
+
+    /**
+     * @brief 计算文件时间对应的单调时钟时刻
+     * @param bagTime 文件时间(纳秒)
+     * @return 单调时钟时刻，已经过去的时间返回锚点时刻
+     */
+    SteadyClock::time_point WallTimeFor(uint64_t bagTime) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const uint64_t elapsed = m_reverse ? (m_bagAnchor > bagTime ? m_bagAnchor - bagTime : 0) : (bagTime > m_bagAnchor ? bagTime - m_bagAnchor : 0);
+        return m_wallAnchor + std::chrono::nanoseconds(static_cast<int64_t>(static_cast<double>(elapsed) / m_rate));
+    }
+
+    /**
+     * @brief 是否已设置锚点
+     */
+    bool IsStarted() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_started;
+    }
+
+    /**
+     * @brief 是否尽快回放
+     */
+    bool IsAsFastAsPossible() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_asFastAsPossible;
+    }
+
+private:
+    uint64_t NowLocked(SteadyClock::time_point now) const
+    {
+        if (!m_started)
+        {
+            return 0;
+        }
+        if (m_paused || m_asFastAsPossible)
+        {
+            return m_bagAnchor;
+        }
+
+        const auto wallElapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_wallAnchor).count();
+        const auto bagElapsed = static_cast<uint64_t>(static_cast<double>(wallElapsed > 0 ? wallElapsed : 0) * m_rate);
+        if (m_reverse)
+        {
+            return m_bagAnchor > bagElapsed ? m_bagAnchor - bagElapsed : 0;
+        }
+        return m_bagAnchor + bagElapsed;
+    }
+
+    void Reanchor()
+    {
+        const auto now = SteadyClock::now();
+        m_bagAnchor = NowLocked(now);
+        m_wallAnchor = now;
+    }
+
+    double m_rate;                         ///< 播放速率
+    bool m_reverse;                        ///< 是否反向
+    bool m_asFastAsPossible;               ///< 是否尽快回放
+    bool m_paused = false;                 ///< 是否暂停
+    bool m_started = false;                ///< 是否已设置锚点
+    SteadyClock::time_point m_wallAnchor;  ///< 锚点单调时钟时刻
+    uint64_t m_bagAnchor = 0;              ///< 锚点文件时间
+    mutable std::mutex m_mutex;            ///< 互斥锁
+};
+
+}  // namespace openbag
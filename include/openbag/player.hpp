@@ -11,10 +11,12 @@
 
 #pragma once
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <condition_variable>
 #include <cstddef>
+#include <deque>
 #include <functional>
 #include <iostream>
 #include <memory>
@@ -23,10 +25,17 @@
 #include <string_view>
 #include <thread>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include <google/protobuf/timestamp.pb.h>
+
 #include "openbag/config.hpp"
+#include "openbag/playback_clock.hpp"
+#include "openbag/preload.hpp"
+#include "openbag/proto_utils.hpp"
 #include "openbag/reader.hpp"
+#include "openbag/transform.hpp"
 #include "openbag/transport.hpp"
 
 namespace openbag {
@@ -53,14 +62,27 @@ public:
      * @brief 构造函数
      * @param config 播放配置
      * @param adapterFactory 消息适配器工厂
-     * @param publisherFunc 发布者创建函数
+     * @param publisherFunc 发布者创建函数，为空时使用适配器工厂创建
+     * @param concurrentPublisherFunc publisherFunc 是否可被多个线程同时调用
+     *
+     * 启动时发布者由 startup_threads 个线程并行创建；自定义的 publisherFunc 默认加锁逐个调用，
+     * 确认其线程安全时传入 true 才会被并发调用。
      */
-    explicit Player(const PlayerConfig& config, MessageAdapterFactoryPtr adapterFactory = nullptr, PublisherFunc publisherFunc = nullptr)
-        : m_config(config), m_state(PlayerState::STOPPED), m_running(false), m_playedMessages(0), m_adapterFactory(adapterFactory), m_publisherFunc(publisherFunc)
+    explicit Player(const PlayerConfig& config, MessageAdapterFactoryPtr adapterFactory = nullptr, PublisherFunc publisherFunc = nullptr,
+                    bool concurrentPublisherFunc = false)
+        : m_config(config),
+          m_state(PlayerState::STOPPED),
+          m_running(false),
+          m_playedMessages(0),
+          m_reverse(config.reverse_playback),
+          m_adapterFactory(adapterFactory),
+          m_publisherFunc(publisherFunc),
+          m_concurrentPublisherFunc(concurrentPublisherFunc)
     {
         if (!m_publisherFunc)
         {
             m_publisherFunc = [this](const std::string& topic) { return this->DefaultPublisherCallback(topic); };
+            m_concurrentPublisherFunc = true;
         }
 
         if (!m_adapterFactory)
@@ -77,8 +99,13 @@ public:
     /**
      * @brief 设置发布者函数
      * @param publisherFunc 发布者创建函数
+     * @param concurrent 是否可被多个线程同时调用，默认 false: 启动时加锁逐个调用
      */
-    void SetPublisherFunc(PublisherFunc publisherFunc) { m_publisherFunc = publisherFunc; }
+    void SetPublisherFunc(PublisherFunc publisherFunc, bool concurrent = false)
+    {
+        m_publisherFunc = publisherFunc;
+        m_concurrentPublisherFunc = concurrent;
+    }
 
     /**
      * @brief 启动播放
@@ -96,6 +123,25 @@ public:
             return false;  // 未指定输入文件
         }
 
+        // 上一次播放自然结束时线程已退出，回收线程与游标(时钟线程仍在运行，需先通知退出)
+        // 暂停状态下播放线程在 m_playPauseCV 上等待，同样需要唤醒
+        m_running = false;
+        NotifyPlayThreads();
+        if (m_playThread.joinable())
+        {
+            m_playThread.join();
+        }
+        if (m_sendThread.joinable())
+        {
+            m_sendThread.join();
+        }
+        StopClockThread();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_cursor.reset();
+            m_preloadCursor.reset();
+        }
+
         // 创建MCAP读取器
         m_mcapReader = std::make_unique<Reader>();
         if (!m_mcapReader)
@@ -116,17 +162,132 @@ public:
             return false;  // 没有可用话题
         }
 
-        // 创建话题发布者
+        // 创建话题发布者，按重映射后的话题名创建，多个话题映射到同一话题时共用发布者
+        m_remapper = TopicRemapper(m_config.topic_remaps, m_config.topic_namespace);
         m_publishers.clear();
+        const auto schemas = m_mcapReader->GetSchemas();
+
+        // 原始CDR通道按录制时的DDS类型名创建原始发布者，负载按原样发布
+        std::unordered_map<std::string, std::string> rawTypes;
+        for (const auto& [channelId, channel] : m_mcapReader->GetChannels())
+        {
+            if (UnframedEncoding(channel->messageEncoding) == kRawEncoding)
+            {
+                auto schemaIt = schemas.find(channel->schemaId);
+                rawTypes.emplace(channel->topic, schemaIt != schemas.end() ? schemaIt->second->name : std::string());
+            }
+        }
+
+        // 收集要创建的发布者，并行创建: 每个传输层实体的创建耗时毫秒级，话题多时逐个创建启动很慢
+        std::vector<std::string> publishTopics;
+        std::vector<std::string> publishTypes;  // 原始CDR发布者的类型名，空表示普通发布者
+        std::unordered_map<std::string, size_t> publishIndex;
+        std::vector<std::pair<std::string, size_t>> topicPublishers;
         for (const auto& topic : availableTopics)
         {
-            std::string publishTopic = topic;
+            auto rawIt = rawTypes.find(topic);
+            if (rawIt != rawTypes.end() && rawIt->second.empty())
+            {
+                std::cerr << "原始数据话题缺少类型名，跳过: " << topic << std::endl;
+                continue;
+            }
+            const std::string publishTopic = m_remapper.Remap(topic);
+            auto [it, inserted] = publishIndex.emplace(publishTopic, publishTopics.size());
+            if (inserted)
+            {
+                publishTopics.push_back(publishTopic);
+                publishTypes.push_back(rawIt != rawTypes.end() ? rawIt->second : std::string());
+            }
+            topicPublishers.emplace_back(topic, it->second);
+        }
+
+        std::vector<OpenbagPublisherPtr> publishers(publishTopics.size());
+        std::mutex publisherFuncMutex;  // 未声明可并发调用的自定义发布者函数逐个调用
+        ParallelFor(publishTopics.size(), m_config.startup_threads, [&](size_t i) {
+            if (publishTypes[i].empty())
+            {
+                // 使用发布者函数创建发布者
+                std::unique_lock<std::mutex> lock(publisherFuncMutex, std::defer_lock);
+                if (!m_concurrentPublisherFunc)
+                {
+                    lock.lock();
+                }
+                publishers[i] = m_publisherFunc(publishTopics[i]);
+            } else if (m_adapterFactory)
+            {
+                publishers[i] = m_adapterFactory->CreateRawPublisher(publishTopics[i], publishTypes[i]);
+            }
+        });
+        for (const auto& [topic, index] : topicPublishers)
+        {
+            if (publishers[index])
+            {
+                m_publishers[topic] = publishers[index];
+            } else if (!publishTypes[index].empty())
+            {
+                std::cerr << "创建原始数据发布者失败，跳过话题: " << topic << std::endl;
+            }
+        }
 
-            // 使用发布者函数创建发布者
-            auto publisher = m_publisherFunc(publishTopic);
-            if (publisher)
+        // 只回放 protobuf 编码和原始CDR且有发布者的通道，原始CDR通道不做负载变换
+        m_channelPublishers.clear();
+        m_channelTransforms.clear();
+        SchemaDescriptorPool descriptorPool;
+        for (const auto& [channelId, channel] : m_mcapReader->GetChannels())
+        {
+            auto schemaIt = schemas.find(channel->schemaId);
+            auto publisherIt = m_publishers.find(channel->topic);
+            if (UnframedEncoding(channel->messageEncoding) == kRawEncoding)
+            {
+                if (publisherIt != m_publishers.end())
+                {
+                    m_channelPublishers[channelId] = publisherIt->second;
+                }
+            } else if (schemaIt != schemas.end() && schemaIt->second->encoding == "protobuf" && publisherIt != m_publishers.end())
             {
-                m_publishers[topic] = publisher;
+                m_channelPublishers[channelId] = publisherIt->second;
+                SetupChannelTransforms(channelId, channel->topic, *schemaIt->second, descriptorPool);
+            }
+        }
+
+        // 预加载模式下先把要回放的消息一次性还原到内存
+        if (m_config.preload && !LoadPreload())
+        {
+            std::cerr << "预加载失败，文件中没有可回放的消息: " << m_config.input_path << std::endl;
+            return false;
+        }
+
+        // 创建双向游标(预加载时为内存中的计划游标)，定位到播放起点
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_config.preload)
+            {
+                m_preloadCursor = std::make_unique<PreloadedBag::Cursor>(*m_preloaded);
+            } else
+            {
+                m_cursor = std::make_unique<Reader::Cursor>(*m_mcapReader);
+            }
+            if (!SeekCursor(!m_reverse))
+            {
+                std::cerr << "文件中没有可回放的消息: " << m_config.input_path << std::endl;
+                m_cursor.reset();
+                m_preloadCursor.reset();
+                return false;
+            }
+            m_positioned = false;
+        }
+
+        // 时钟话题发布者
+        m_clock.Configure(m_config.playback_rate, m_reverse, m_config.as_fast_as_possible);
+        m_clockPublisher.reset();
+        m_clockPublished = false;
+        if (m_config.clock_frequency > 0)
+        {
+            const std::string clockTopic = m_remapper.Remap(m_config.clock_topic);
+            m_clockPublisher = m_publisherFunc(clockTopic);
+            if (!m_clockPublisher)
+            {
+                std::cerr << "创建时钟发布者失败: " << clockTopic << std::endl;
             }
         }
 
@@ -136,9 +297,24 @@ public:
         // 设置状态为播放中
         m_state = PlayerState::PLAYING;
 
-        // 启动播放线程
+        // 清空预备队列
+        {
+            std::lock_guard<std::mutex> lock(m_queueMutex);
+            m_prepared.clear();
+            m_prepareDone = false;
+        }
+        m_trailingSteps = 0;
+        m_trailingPositioning = false;
+        m_prepareForward = !m_reverse;
+
+        // 启动准备线程和发送线程，按实际时间回放时另起线程按固定频率发布时钟
         m_running = true;
         m_playThread = std::thread(&Player::PlayLoop, this);
+        m_sendThread = std::thread(&Player::SendLoop, this);
+        if (m_clockPublisher && !m_config.as_fast_as_possible)
+        {
+            m_clockThread = std::thread(&Player::ClockLoop, this);
+        }
 
         return true;
     }
@@ -155,7 +331,7 @@ public:
      */
     void Stop()
     {
-        if (m_state == PlayerState::STOPPED)
+        if (m_state == PlayerState::STOPPED && !m_playThread.joinable() && !m_sendThread.joinable() && !m_clockThread.joinable())
         {
             return;  // 已经停止
         }
@@ -163,16 +339,29 @@ public:
         // 设置状态为已停止
         m_state = PlayerState::STOPPED;
 
-        // 停止播放线程
+        // 停止准备线程和发送线程
         m_running = false;
-        m_playPauseCV.notify_all();
+        NotifyPlayThreads();
         if (m_playThread.joinable())
         {
             m_playThread.join();
         }
+        if (m_sendThread.joinable())
+        {
+            m_sendThread.join();
+        }
+        StopClockThread();
 
-        // 清理发布者
+        // 清理游标和发布者，预加载的数据保留到下一次 Start 复用
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_cursor.reset();
+            m_preloadCursor.reset();
+        }
+        m_channelPublishers.clear();
+        m_channelTransforms.clear();
         m_publishers.clear();
+        m_clockPublisher.reset();
 
         // 关闭MCAP读取器
         if (m_mcapReader)
@@ -192,6 +381,8 @@ public:
         }
 
         m_state = PlayerState::PAUSED;
+        m_clock.Pause();
+        NotifyPlayThreads();
     }
 
     /**
@@ -205,7 +396,7 @@ public:
         }
 
         m_state = PlayerState::PLAYING;
-        m_playPauseCV.notify_all();
+        NotifyPlayThreads();
     }
 
     /**
@@ -245,6 +436,8 @@ public:
             rate = 1.0;
         }
         m_config.playback_rate = rate;
+        m_clock.SetRate(rate);
+        NotifyPlayThreads(true);
     }
 
     /**
@@ -253,114 +446,683 @@ public:
      */
     double GetPlaybackRate() const { return m_config.playback_rate; }
 
-private:
     /**
-     * @brief 播放线程循环
+     * @brief 添加消息变换钩子(在下一次 Start 时生效)
+     *
+     * 钩子按添加顺序在播放线程中执行，时间戳改写规则先于钩子执行。
+     *
+     * @param topic 原话题名，为空时作用于所有话题
+     * @param transform 变换钩子
      */
-    void PlayLoop()
+    void AddTransform(const std::string& topic, MessageTransform transform)
     {
-        // 检查MCAP读取器是否有效
-        if (!m_mcapReader)
+        if (transform)
         {
-            std::cerr << "MCAP读取器无效，停止播放" << std::endl;
-            m_state = PlayerState::STOPPED;
-            return;
+            m_transforms.emplace_back(topic, std::move(transform));
         }
+    }
+
+    /**
+     * @brief 清除所有变换钩子(在下一次 Start 时生效)
+     */
+    void ClearTransforms() { m_transforms.clear(); }
+
+    /**
+     * @brief 添加时间戳改写规则(在下一次 Start 时生效)
+     *
+     * 发布前按线格式把字段原地改写为当前时间，不解码整条消息。
+     *
+     * @param topic 原话题名
+     * @param field 字段路径，如 "header.stamp"
+     */
+    void AddTimestampRewrite(const std::string& topic, const std::string& field) { m_config.timestamp_rewrites.push_back({topic, field}); }
 
-        // 使用流式读取，避免一次性加载所有消息到内存
-        auto messageView = m_mcapReader->GetMessages();
+    /**
+     * @brief 获取话题回放时的发布名称
+     * @param topic 原话题名
+     * @return 重映射后的话题名
+     */
+    std::string RemapTopic(const std::string& topic) const { return TopicRemapper(m_config.topic_remaps, m_config.topic_namespace).Remap(topic); }
 
-        // 获取回放开始的系统时间
-        auto playStartTime = std::chrono::steady_clock::now();
-        int64_t lastTimestamp = 0;
-        bool firstMessage = true;
+    /**
+     * @brief 获取当前回放时间
+     *
+     * 按实际时间回放时随单调时钟连续推进(已乘以播放速率，反向播放时递减)，暂停时冻结；
+     * 尽快回放时为最后一条已发布消息的时间。可在任意线程调用。
+     *
+     * @return 文件时间(纳秒)，尚未开始回放时为0
+     */
+    uint64_t GetCurrentPlaybackTime() const { return m_clock.Now(); }
 
-        // 流式处理消息
-        for (auto it = messageView.begin(); it != messageView.end() && m_running; ++it)
+    /**
+     * @brief 设置播放方向
+     * @param reverse 是否反向播放(按时间倒序以实际时间间隔回放)
+     */
+    void SetReverse(bool reverse)
+    {
+        m_reverse = reverse;
+        m_clock.SetReverse(reverse);
+        NotifyPlayThreads(true);
+    }
+
+    /**
+     * @brief 是否反向播放
+     */
+    bool IsReverse() const { return m_reverse; }
+
+    /**
+     * @brief 向前单步发布消息(暂停或播放结束后有效)
+     * @param count 步数
+     * @return 实际发布的消息数
+     */
+    size_t StepForward(size_t count = 1) { return Step(count, true); }
+
+    /**
+     * @brief 向后单步发布消息(暂停或播放结束后有效)
+     * @param count 步数
+     * @return 实际发布的消息数
+     */
+    size_t StepBackward(size_t count = 1) { return Step(count, false); }
+
+private:
+    /**
+     * @brief 预先准备好的待发布样本
+     */
+    struct PreparedSample
+    {
+        uint64_t log_time = 0;           ///< 文件时间
+        OpenbagPublisherPtr publisher;   ///< 发布者
+        PreparedMessagePtr message;      ///< 准备好的消息
+        bool forward = true;             ///< 准备时的播放方向
+        size_t steps = 0;                ///< 准备该样本时游标移动的步数(含跳过的消息)
+        bool positioning = false;        ///< 其中是否包含定位到起点的一步
+    };
+
+    static constexpr size_t kMaxPreparedMessages = 4096;  ///< 预备队列的最大消息数
+
+    /**
+     * @brief 准备线程循环
+     *
+     * 按播放方向移动游标，提前完成负载还原、变换钩子和传输层封装，放入预备队列，
+     * 预备队列覆盖到当前回放时间之后 prepare_window_ms 的文件时间为止。
+     * 暂停或改变方向时撤回尚未发送的消息，游标退回最后发布的位置。
+     */
+    void PlayLoop()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (m_running)
         {
-            // 检查是否暂停
+            if (!HasCursor())
+            {
+                break;
+            }
+
+            // 检查是否暂停，暂停期间回放时钟冻结
             if (m_state == PlayerState::PAUSED)
             {
-                std::unique_lock<std::mutex> lock(m_mutex);
-                // 记录暂停开始时间
-                auto pauseStartTime = std::chrono::steady_clock::now();
-                // 等待恢复播放
+                DiscardPrepared();
+                m_clock.Pause();
                 m_playPauseCV.wait(lock, [this] { return m_state != PlayerState::PAUSED || !m_running; });
+                m_clock.Resume();
+                continue;
+            }
 
-                if (!m_running)
+            // 方向改变，已准备的消息作废
+            const bool forward = !m_reverse;
+            if (forward != m_prepareForward)
+            {
+                DiscardPrepared();
+                m_prepareForward = forward;
+            }
+
+            // 预备窗口已满，等待发送线程取走消息(回放时钟推进时窗口随之前移，因此定时检查)
+            {
+                std::unique_lock<std::mutex> queueLock(m_queueMutex);
+                if (!HasPrepareRoomLocked())
+                {
+                    lock.unlock();
+                    m_queueCV.wait_for(queueLock, std::chrono::milliseconds(1),
+                                       [this, forward] { return !m_running || m_state != PlayerState::PLAYING || m_reverse == forward || HasPrepareRoomLocked(); });
+                    queueLock.unlock();
+                    lock.lock();
+                    continue;
+                }
+            }
+
+            const bool wasPositioned = m_positioned;
+            if (!Advance(forward))
+            {
+                // 等发送线程发完已准备的消息，期间被暂停或改变方向时回到循环开头处理
+                lock.unlock();
+                const bool drained = WaitPreparedDrained(forward);
+                lock.lock();
+                if (!drained)
+                {
+                    continue;
+                }
+                if (!m_config.loop_playback)
                 {
                     break;
                 }
 
-                // 计算暂停持续时间并调整播放起始时间
-                auto pauseDuration = std::chrono::steady_clock::now() - pauseStartTime;
-                playStartTime += pauseDuration;
+                // 循环播放: 正向从头、反向从尾重新开始，时钟在下一条消息处重新对齐
+                m_playedMessages = 0;
+                m_trailingSteps = 0;
+                m_trailingPositioning = false;
+                if (!SeekCursor(forward))
+                {
+                    break;
+                }
+                m_positioned = false;
+                m_mcapReader->ResetPayloadCache();
+                m_clock.Configure(m_config.playback_rate, !forward, m_config.as_fast_as_possible);
+                continue;
             }
+            m_trailingSteps++;
+            m_trailingPositioning = m_trailingPositioning || !wasPositioned;
 
-            // 跳过非 protobuf 编码的消息
-            if (!it->schema || it->schema->encoding != "protobuf")
+            // 跳过不回放的通道(没有发布者)，不参与计时
+            if (m_channelPublishers.count(CurrentChannelId()) == 0)
             {
                 continue;
             }
 
-            // 获取消息信息
-            const auto& mcapMessage = it->message;
-            int64_t currentTimestamp = mcapMessage.logTime;
+            PreparedSample sample;
+            if (!PrepareCurrent(sample, ExpectedPublishTime(CurrentLogTime())))
+            {
+                continue;  // 钩子丢弃了该消息
+            }
+            sample.forward = forward;
+            sample.steps = m_trailingSteps;
+            sample.positioning = m_trailingPositioning;
+            m_trailingSteps = 0;
+            m_trailingPositioning = false;
+            {
+                std::lock_guard<std::mutex> queueLock(m_queueMutex);
+                m_prepared.push_back(std::move(sample));
+            }
+            m_queueCV.notify_all();
+        }
+
+        // 完成播放，时钟停在最后位置，游标保留在最后发布的位置，可继续单步
+        m_trailingSteps = 0;
+        m_trailingPositioning = false;
+        {
+            std::lock_guard<std::mutex> queueLock(m_queueMutex);
+            m_prepareDone = true;
+        }
+        m_queueCV.notify_all();
+        m_clock.Pause();
+        m_state = PlayerState::STOPPED;
+    }
+
+    /**
+     * @brief 发送线程循环: 到预备队列队首消息的发布时刻时只做发送
+     */
+    void SendLoop()
+    {
+        std::unique_lock<std::mutex> lock(m_queueMutex);
+        while (m_running)
+        {
+            const uint64_t epoch = m_queueEpoch;
+            if (!ReadyToSendLocked())
+            {
+                if (m_prepareDone && m_prepared.empty())
+                {
+                    break;
+                }
+                m_queueCV.wait(lock, [this, epoch] { return !m_running || m_queueEpoch != epoch || (m_prepareDone && m_prepared.empty()) || ReadyToSendLocked(); });
+                continue;
+            }
 
-            // 计算时间差并延迟
-            if (!firstMessage && m_config.playback_rate > 0)
+            // 按回放时钟计算发布时刻，第一条消息对齐时钟
+            const uint64_t logTime = m_prepared.front().log_time;
+            if (!m_clock.IsStarted())
+            {
+                m_clock.Reset(logTime);
+            } else if (!m_clock.IsAsFastAsPossible())
             {
-                int64_t deltaTime = currentTimestamp - lastTimestamp;
-                if (deltaTime > 0)
+                const auto target = m_clock.WallTimeFor(logTime);
+                if (m_queueCV.wait_until(lock, target, [this, epoch] { return !m_running || m_queueEpoch != epoch || !ReadyToSendLocked(); }))
                 {
-                    auto delayMs = static_cast<int64_t>(deltaTime / 1000000.0 / m_config.playback_rate);
-                    std::this_thread::sleep_for(std::chrono::milliseconds(delayMs));
+                    // 等待期间被暂停/停止/改变方向或速率，或队列被撤回，重新计算
+                    continue;
                 }
             }
-            firstMessage = false;
-            lastTimestamp = currentTimestamp;
 
-            // 查找通道信息获取话题名称
-            std::string topic;
-            auto channels = m_mcapReader->GetChannels();
-            auto channelIt = channels.find(mcapMessage.channelId);
-            if (channelIt != channels.end())
+            PreparedSample sample = std::move(m_prepared.front());
+            m_prepared.pop_front();
+            lock.unlock();
+            m_queueCV.notify_all();
+
+            SendPrepared(sample);
+            if (m_clock.IsAsFastAsPossible())
             {
-                topic = channelIt->second->topic;
+                // 尽快回放时按文件时间推进发布时钟
+                PublishClockIfDue(logTime);
             }
+            lock.lock();
+        }
+    }
 
-            // 如果没有找到话题，跳过这条消息
-            if (topic.empty())
+    /**
+     * @brief 队首消息是否可以发送(需持有 m_queueMutex)
+     */
+    bool ReadyToSendLocked() const { return m_state == PlayerState::PLAYING && !m_prepared.empty() && m_prepared.front().forward != m_reverse; }
+
+    /**
+     * @brief 预备窗口是否还有空间(需持有 m_queueMutex)
+     */
+    bool HasPrepareRoomLocked() const
+    {
+        if (m_prepared.empty())
+        {
+            return true;
+        }
+        if (m_prepared.size() >= kMaxPreparedMessages)
+        {
+            return false;
+        }
+        if (!m_clock.IsStarted() || m_clock.IsAsFastAsPossible())
+        {
+            return true;
+        }
+
+        const uint64_t now = m_clock.Now();
+        const uint64_t last = m_prepared.back().log_time;
+        const uint64_t ahead = m_prepared.back().forward ? (last > now ? last - now : 0) : (now > last ? now - last : 0);
+        return ahead < m_config.prepare_window_ms * 1000000ULL;
+    }
+
+    /**
+     * @brief 等待预备队列发送完毕
+     * @return 是否已发送完毕(被暂停、停止或改变方向时返回false)
+     */
+    bool WaitPreparedDrained(bool forward)
+    {
+        std::unique_lock<std::mutex> lock(m_queueMutex);
+        m_queueCV.wait(lock, [this, forward] { return m_prepared.empty() || !m_running || m_state != PlayerState::PLAYING || m_reverse == forward; });
+        return m_prepared.empty() && m_running;
+    }
+
+    /**
+     * @brief 撤回尚未发送的消息，游标退回最后发布的位置(需持有 m_mutex)
+     */
+    void DiscardPrepared()
+    {
+        size_t steps = m_trailingSteps;
+        bool positioning = m_trailingPositioning;
+        {
+            std::lock_guard<std::mutex> lock(m_queueMutex);
+            for (const auto& sample : m_prepared)
             {
-                continue;
+                steps += sample.steps;
+                positioning = positioning || sample.positioning;
+            }
+            m_prepared.clear();
+            ++m_queueEpoch;
+        }
+        m_queueCV.notify_all();
+        m_trailingSteps = 0;
+        m_trailingPositioning = false;
+        if (!HasCursor())
+        {
+            return;
+        }
+
+        // 定位到起点的一步不移动游标，只需恢复为未定位
+        if (positioning)
+        {
+            steps--;
+        }
+        for (size_t i = 0; i < steps; ++i)
+        {
+            MoveCursor(!m_prepareForward);
+        }
+        if (positioning)
+        {
+            m_positioned = false;
+        }
+    }
+
+    /**
+     * @brief 预计的发布时间(系统时间，纳秒)，供时间戳改写等变换钩子使用
+     */
+    uint64_t ExpectedPublishTime(uint64_t logTime) const
+    {
+        const uint64_t now = GetCurrentTimestampNs();
+        if (!m_clock.IsStarted() || m_clock.IsAsFastAsPossible())
+        {
+            return now;
+        }
+        const auto delay = std::chrono::duration_cast<std::chrono::nanoseconds>(m_clock.WallTimeFor(logTime) - std::chrono::steady_clock::now()).count();
+        return delay > 0 ? now + static_cast<uint64_t>(delay) : now;
+    }
+
+    /**
+     * @brief 唤醒准备线程和发送线程
+     * @param timingChanged 速率或方向改变，等待中的发布时刻需重新计算
+     */
+    void NotifyPlayThreads(bool timingChanged = false)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_queueMutex);
+            if (timingChanged)
+            {
+                ++m_queueEpoch;
             }
+        }
+        m_queueCV.notify_all();
+        m_playPauseCV.notify_all();
+    }
 
-            // 查找对应的发布者
-            auto publisherIt = m_publishers.find(topic);
-            if (publisherIt != m_publishers.end())
+    /**
+     * @brief 时钟发布线程(按单调时钟以固定频率发布当前回放时间)
+     */
+    void ClockLoop()
+    {
+        const auto period = std::chrono::nanoseconds(static_cast<int64_t>(1e9 / m_config.clock_frequency));
+        auto next = std::chrono::steady_clock::now();
+        std::unique_lock<std::mutex> lock(m_clockMutex);
+        while (m_running)
+        {
+            if (m_clock.IsStarted())
             {
-                auto msg_str = as_string_view(mcapMessage.data, mcapMessage.dataSize);
+                PublishClock(m_clock.Now());
+            }
+            next += period;
+            m_clockCV.wait_until(lock, next, [this] { return !m_running; });
+        }
+    }
 
-                publisherIt->second->Publish(std::string(msg_str));
+    /**
+     * @brief 尽快回放时，文件时间每前进一个时钟周期发布一次时钟
+     */
+    void PublishClockIfDue(uint64_t logTime)
+    {
+        if (!m_clockPublisher)
+        {
+            return;
+        }
+        const auto period = static_cast<uint64_t>(1e9 / m_config.clock_frequency);
+        const uint64_t elapsed = logTime > m_lastClockTime ? logTime - m_lastClockTime : m_lastClockTime - logTime;
+        if (!m_clockPublished || elapsed >= period)
+        {
+            PublishClock(logTime);
+            m_lastClockTime = logTime;
+            m_clockPublished = true;
+        }
+    }
 
-                // 增加已播放消息计数
-                m_playedMessages++;
+    /**
+     * @brief 发布时钟消息(google.protobuf.Timestamp)
+     */
+    void PublishClock(uint64_t bagTime)
+    {
+        google::protobuf::Timestamp timestamp;
+        timestamp.set_seconds(static_cast<int64_t>(bagTime / 1000000000ULL));
+        timestamp.set_nanos(static_cast<int32_t>(bagTime % 1000000000ULL));
+        m_clockPublisher->Publish(timestamp.SerializeAsString());
+    }
+
+    /**
+     * @brief 停止时钟发布线程
+     */
+    void StopClockThread()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_clockMutex);
+        }
+        m_clockCV.notify_all();
+        if (m_clockThread.joinable())
+        {
+            m_clockThread.join();
+        }
+    }
+
+    /**
+     * @brief 单步发布
+     */
+    size_t Step(size_t count, bool forward)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!HasCursor() || m_state == PlayerState::PLAYING)
+        {
+            return 0;
+        }
+
+        // 暂停后准备线程可能还未撤回已准备的消息
+        DiscardPrepared();
+
+        size_t published = 0;
+        while (published < count && Advance(forward))
+        {
+            if (PublishCurrent())
+            {
+                published++;
             }
         }
+        return published;
+    }
 
-        // 是否需要循环播放
-        if (m_running && m_config.loop_playback)
+    /**
+     * @brief 游标移动一步(需持有 m_mutex)，游标始终指向最后发布的消息
+     */
+    bool Advance(bool forward)
+    {
+        if (!m_positioned)
+        {
+            // 尚未发布任何消息，起点本身即为第一条
+            m_positioned = m_preloadCursor ? m_preloadCursor->Valid() : m_cursor->Valid();
+            return m_positioned;
+        }
+        return MoveCursor(forward);
+    }
+
+    /**
+     * @brief 是否已创建游标
+     */
+    bool HasCursor() const { return m_cursor || m_preloadCursor; }
+
+    /**
+     * @brief 游标定位到起点: 正向为第一条消息，反向为最后一条消息
+     */
+    bool SeekCursor(bool forward)
+    {
+        if (m_preloadCursor)
         {
-            // 重置播放状态并重新开始
-            m_playedMessages = 0;
-            // 递归调用实现循环播放
-            PlayLoop();
+            return forward ? m_preloadCursor->SeekBegin() : m_preloadCursor->SeekEnd();
+        }
+        return forward ? m_cursor->SeekBegin() : m_cursor->SeekEnd();
+    }
+
+    /**
+     * @brief 游标移动一条消息
+     */
+    bool MoveCursor(bool forward)
+    {
+        if (m_preloadCursor)
+        {
+            return forward ? m_preloadCursor->Next() : m_preloadCursor->Prev();
+        }
+        return forward ? m_cursor->Next() : m_cursor->Prev();
+    }
+
+    /**
+     * @brief 游标当前消息的通道ID
+     */
+    mcap::ChannelId CurrentChannelId() const { return m_preloadCursor ? m_preloadCursor->ChannelId() : m_cursor->Current().message.channelId; }
+
+    /**
+     * @brief 游标当前消息的时间(纳秒)
+     */
+    uint64_t CurrentLogTime() const { return m_preloadCursor ? m_preloadCursor->LogTime() : m_cursor->Current().message.logTime; }
+
+    /**
+     * @brief 还原游标当前消息的负载，预加载时直接指向内存中的负载
+     */
+    bool ResolveCurrent(std::string_view& payload)
+    {
+        if (m_preloadCursor)
+        {
+            payload = m_preloadCursor->Payload();
+            return true;
+        }
+        return m_mcapReader->ResolvePayload(m_cursor->Current(), payload);
+    }
+
+    /**
+     * @brief 预加载回放通道的全部消息，优先复用内存中已有的数据和缓存文件
+     * @return 是否成功
+     */
+    bool LoadPreload()
+    {
+        std::vector<mcap::ChannelId> channels;
+        for (const auto& [channelId, _] : m_channelPublishers)
+        {
+            channels.push_back(channelId);
+        }
+        std::sort(channels.begin(), channels.end());
+
+        // 同一文件和通道已经预加载过(同一播放器再次 Start)，直接复用
+        if (m_preloaded && m_preloadedPath == m_config.input_path && m_preloaded->Channels() == channels)
+        {
+            return true;
+        }
+
+        m_preloaded = std::make_unique<PreloadedBag>();
+        m_preloadedPath.clear();
+        const std::string& cachePath = m_config.preload_cache;
+        if (cachePath.empty() || !m_preloaded->Load(cachePath, m_config.input_path, channels))
+        {
+            if (!m_preloaded->Build(*m_mcapReader, channels))
+            {
+                m_preloaded.reset();
+                return false;
+            }
+            if (!cachePath.empty() && !m_preloaded->Save(cachePath, m_config.input_path))
+            {
+                std::cerr << "保存预加载缓存失败: " << cachePath << std::endl;
+            }
+        }
+        m_preloadedPath = m_config.input_path;
+        return true;
+    }
+
+    /**
+     * @brief 为通道组装时间戳改写和变换钩子
+     */
+    void SetupChannelTransforms(mcap::ChannelId channelId, const std::string& topic, const mcap::Schema& schema, SchemaDescriptorPool& descriptorPool)
+    {
+        ChannelTransforms channel;
+        for (const auto& rule : m_config.timestamp_rewrites)
+        {
+            if (rule.topic != topic)
+            {
+                continue;
+            }
+
+            const std::string schemaData(reinterpret_cast<const char*>(schema.data.data()), schema.data.size());
+            ProtoTimeFieldPath path;
+            if (!ResolveProtoTimeField(descriptorPool.Load(schema.name, schemaData), rule.field, path))
+            {
+                std::cerr << "无法解析时间戳字段: " << topic << " " << rule.field << std::endl;
+                continue;
+            }
+            channel.transforms.push_back([path](const PlaybackMessageInfo& info, PayloadView& payload) {
+                RewriteProtoTimeField(payload.Mutable(), path, info.publish_time);
+                return true;
+            });
+        }
+
+        for (const auto& [transformTopic, transform] : m_transforms)
+        {
+            if (transformTopic.empty() || transformTopic == topic)
+            {
+                channel.transforms.push_back(transform);
+            }
+        }
+
+        if (!channel.transforms.empty())
+        {
+            channel.topic = topic;
+            channel.publish_topic = m_remapper.Remap(topic);
+            m_channelTransforms[channelId] = std::move(channel);
+        }
+    }
+
+    /**
+     * @brief 发布游标当前消息(需持有 m_mutex)
+     */
+    bool PublishCurrent()
+    {
+        PreparedSample sample;
+        return PrepareCurrent(sample, GetCurrentTimestampNs()) && SendPrepared(sample);
+    }
+
+    /**
+     * @brief 准备游标当前消息: 还原负载、执行变换钩子并交给发布者封装(需持有 m_mutex)
+     * @param sample 输出的预备样本
+     * @param publishTime 预计的发布时间(系统时间，纳秒)
+     * @return 是否需要发布(没有发布者或被钩子丢弃时返回false)
+     */
+    bool PrepareCurrent(PreparedSample& sample, uint64_t publishTime)
+    {
+        const mcap::ChannelId channelId = CurrentChannelId();
+        const uint64_t logTime = CurrentLogTime();
+        auto publisherIt = m_channelPublishers.find(channelId);
+        if (publisherIt == m_channelPublishers.end())
+        {
+            return false;
+        }
+
+        // 还原去重等编码后的原始负载
+        std::string_view payload;
+        if (!ResolveCurrent(payload))
+        {
+            return false;
+        }
+
+        // 依次执行变换钩子，只有需要修改负载时才复制到复用缓冲区
+        std::string data;
+        auto transformIt = m_channelTransforms.find(channelId);
+        if (transformIt == m_channelTransforms.end())
+        {
+            data.assign(payload);
         } else
         {
-            // 完成播放
-            m_state = PlayerState::STOPPED;
+            const auto& channel = transformIt->second;
+            PayloadView view(payload, m_payloadBuffer);
+            const PlaybackMessageInfo info{channel.topic, channel.publish_topic, logTime, publishTime};
+            for (const auto& transform : channel.transforms)
+            {
+                if (!transform(info, view))
+                {
+                    return false;  // 钩子丢弃了该消息
+                }
+            }
+            data.assign(view.IsModified() ? std::string_view(m_payloadBuffer) : payload);
         }
+
+        sample.log_time = logTime;
+        sample.publisher = publisherIt->second;
+        sample.message = publisherIt->second->Prepare(std::move(data));
+        return sample.message != nullptr;
+    }
+
+    /**
+     * @brief 发送准备好的消息
+     */
+    bool SendPrepared(PreparedSample& sample)
+    {
+        sample.publisher->PublishPrepared(*sample.message);
+        m_clock.Observe(sample.log_time);
+
+        // 增加已播放消息计数
+        m_playedMessages++;
+        return true;
     }
+
     inline std::string_view as_string_view(const std::byte* data, size_t size) { return {reinterpret_cast<const char*>(data), size}; }
 
 private:
@@ -369,13 +1131,55 @@ private:
     std::unordered_map<std::string, OpenbagPublisherPtr> m_publishers;  ///< 发布者映射
     MessageAdapterFactoryPtr m_adapterFactory;                          ///< 消息适配器工厂
     PublisherFunc m_publisherFunc;                                      ///< 发布者函数
+    bool m_concurrentPublisherFunc = false;                             ///< 发布者函数是否可并发调用
 
     std::atomic<PlayerState> m_state;        ///< 播放状态
     std::atomic<bool> m_running;             ///< 线程运行标志
     std::atomic<uint64_t> m_playedMessages;  ///< 已播放消息数
-    std::thread m_playThread;                ///< 播放线程
-    std::mutex m_mutex;                      ///< 互斥锁
+    std::atomic<bool> m_reverse;             ///< 是否反向播放
+    std::thread m_playThread;                ///< 准备线程(移动游标并准备消息)
+    std::thread m_sendThread;                ///< 发送线程(到发布时刻发送消息)
+    std::mutex m_mutex;                      ///< 互斥锁(保护游标)
     std::condition_variable m_playPauseCV;   ///< 播放/暂停条件变量
+
+    std::unique_ptr<Reader::Cursor> m_cursor;                                     ///< 双向消息游标
+    std::unique_ptr<PreloadedBag> m_preloaded;                                    ///< 预加载的消息(跨 Start 保留)
+    std::string m_preloadedPath;                                                  ///< 预加载数据对应的文件
+    std::unique_ptr<PreloadedBag::Cursor> m_preloadCursor;                        ///< 预加载时的计划游标
+    bool m_positioned = false;                                                    ///< 游标是否指向已发布的消息
+    std::unordered_map<mcap::ChannelId, OpenbagPublisherPtr> m_channelPublishers;  ///< 回放通道到发布者
+
+    /**
+     * @brief 通道的变换钩子
+     */
+    struct ChannelTransforms
+    {
+        std::string topic;                         ///< 原话题名
+        std::string publish_topic;                 ///< 发布话题名
+        std::vector<MessageTransform> transforms;  ///< 变换钩子(含时间戳改写)
+    };
+
+    TopicRemapper m_remapper;                                                   ///< 话题重映射
+    std::vector<std::pair<std::string, MessageTransform>> m_transforms;         ///< 用户变换钩子(话题, 钩子)
+    std::unordered_map<mcap::ChannelId, ChannelTransforms> m_channelTransforms;  ///< 回放通道到变换钩子
+    std::string m_payloadBuffer;                                                ///< 变换时复用的负载缓冲区
+
+    std::mutex m_queueMutex;               ///< 预备队列互斥锁
+    std::condition_variable m_queueCV;     ///< 预备队列条件变量
+    std::deque<PreparedSample> m_prepared;  ///< 预备队列(m_queueMutex)
+    uint64_t m_queueEpoch = 0;             ///< 队列被撤回或发布时刻需重算时递增(m_queueMutex)
+    bool m_prepareDone = false;            ///< 准备线程已结束(m_queueMutex)
+    size_t m_trailingSteps = 0;            ///< 最后一个预备样本之后游标移动的步数(m_mutex)
+    bool m_trailingPositioning = false;    ///< 其中是否包含定位到起点的一步(m_mutex)
+    bool m_prepareForward = true;          ///< 预备队列对应的播放方向(m_mutex)
+
+    PlaybackClock m_clock;                ///< 回放时钟
+    OpenbagPublisherPtr m_clockPublisher;  ///< 时钟话题发布者
+    std::thread m_clockThread;            ///< 时钟发布线程
+    std::mutex m_clockMutex;              ///< 时钟线程互斥锁
+    std::condition_variable m_clockCV;    ///< 时钟线程条件变量
+    uint64_t m_lastClockTime = 0;         ///< 尽快回放时上次发布的时钟
+    bool m_clockPublished = false;        ///< 尽快回放时是否已发布过时钟
 };
 
 }  // namespace openbag
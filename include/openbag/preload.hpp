@@ -0,0 +1,404 @@
+/**
+ * @copyright Copyright (c) 2025 openbag
+ *
+ * @author Zhao Jun(zwhy2025@gmail.com)
+ * @version 0.1
+ * @date 2025-05-22
+ *
+ * @file preload.hpp
+ * @brief 预加载回放: 一次性还原到内存的消息负载及按时间排序的发布计划
+ *
+ * 所选通道的消息负载(已解压、已还原去重等编码)依次存放在一块连续内存中，
+ * 发布计划为按 logTime 排序的扁平数组，每项记录 (时间, 通道槽位, 偏移, 长度)，
+ * 回放与循环播放只在内存中移动下标，不再读取和解压文件。
+ *
+ * 缓存文件按本机字节序写入，字节序标记与本机不一致时视为失效(重新预加载)，格式：
+ * - 文件头: 魔数 "OBPREL02"(8) + 字节序标记(uint32) + 源文件大小(uint64) + 源文件修改时间(int64) + 通道数(uint32) + 计划项数(uint64) + 负载总长(uint64)
+ * - 通道ID(uint16 x 通道数) + 计划项(logTime uint64, offset uint64, size uint32, slot uint16) + 负载
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <unistd.h>
+
+#include "openbag/reader.hpp"
+
+namespace openbag {
+
+constexpr char kPreloadMagic[8] = {'O', 'B', 'P', 'R', 'E', 'L', '0', '2'};  ///< 缓存文件魔数
+constexpr uint32_t kPreloadByteOrder = 0x01020304;                            ///< 字节序标记，按本机字节序写入
+
+/**
+ * @brief 发布计划项
+ */
+struct PreloadEntry
+{
+    uint64_t log_time = 0;  ///< 消息时间(纳秒)
+    uint64_t offset = 0;    ///< 负载在内存区中的偏移
+    uint32_t size = 0;      ///< 负载长度
+    uint16_t slot = 0;      ///< 通道槽位(在通道列表中的序号)
+};
+
+/**
+ * @brief 预加载到内存的消息
+ */
+class PreloadedBag
+{
+public:
+    /**
+     * @brief 计划游标，语义与 Reader::Cursor 相同: 停在首条/末条消息时 Next/Prev 返回 false 且位置不变
+     */
+    class Cursor
+    {
+    public:
+        /**
+         * @brief 构造函数
+         * @param bag 预加载的消息，游标使用期间需保持有效
+         */
+        explicit Cursor(const PreloadedBag& bag) : m_bag(bag) {}
+
+        /**
+         * @brief 定位到第一条消息
+         */
+        bool SeekBegin()
+        {
+            m_valid = !m_bag.m_schedule.empty();
+            m_pos = 0;
+            return m_valid;
+        }
+
+        /**
+         * @brief 定位到最后一条消息
+         */
+        bool SeekEnd()
+        {
+            m_valid = !m_bag.m_schedule.empty();
+            m_pos = m_valid ? m_bag.m_schedule.size() - 1 : 0;
+            return m_valid;
+        }
+
+        /**
+         * @brief 移动到下一条消息
+         */
+        bool Next()
+        {
+            if (!m_valid || m_pos + 1 >= m_bag.m_schedule.size())
+            {
+                return false;
+            }
+            m_pos++;
+            return true;
+        }
+
+        /**
+         * @brief 移动到上一条消息
+         */
+        bool Prev()
+        {
+            if (!m_valid || m_pos == 0)
+            {
+                return false;
+            }
+            m_pos--;
+            return true;
+        }
+
+        /**
+         * @brief 游标是否指向有效消息
+         */
+        bool Valid() const { return m_valid; }
+
+        /**
+         * @brief 当前消息时间(纳秒)
+         */
+        uint64_t LogTime() const { return m_bag.m_schedule[m_pos].log_time; }
+
+        /**
+         * @brief 当前消息的通道ID
+         */
+        mcap::ChannelId ChannelId() const { return m_bag.m_channels[m_bag.m_schedule[m_pos].slot]; }
+
+        /**
+         * @brief 当前消息负载，预加载数据有效期间一直有效
+         */
+        std::string_view Payload() const { return m_bag.Payload(m_bag.m_schedule[m_pos]); }
+
+    private:
+        const PreloadedBag& m_bag;
+        size_t m_pos = 0;
+        bool m_valid = false;
+    };
+
+    /**
+     * @brief 从文件读取所选通道的全部消息，还原负载后放入内存
+     * @param reader 已打开的读取器
+     * @param channels 要预加载的通道
+     * @return 是否成功(没有可回放的消息时返回false)
+     */
+    bool Build(Reader& reader, const std::vector<mcap::ChannelId>& channels)
+    {
+        Clear();
+        m_channels = channels;
+        std::unordered_map<mcap::ChannelId, uint16_t> slots;
+        for (size_t i = 0; i < m_channels.size(); ++i)
+        {
+            slots.emplace(m_channels[i], static_cast<uint16_t>(i));
+        }
+
+        Reader::Cursor cursor(reader);
+        for (bool valid = cursor.SeekBegin(); valid; valid = cursor.Next())
+        {
+            const auto& current = cursor.Current();
+            auto slotIt = slots.find(current.message.channelId);
+            if (slotIt == slots.end())
+            {
+                continue;
+            }
+
+            std::string_view payload;
+            if (!reader.ResolvePayload(current, payload))
+            {
+                continue;
+            }
+            m_schedule.push_back(PreloadEntry{current.message.logTime, m_arena.size(), static_cast<uint32_t>(payload.size()), slotIt->second});
+            m_arena.append(payload);
+        }
+        reader.ResetPayloadCache();
+
+        // 块之间的时间范围可能重叠，扁平计划整体按时间稳定排序
+        std::stable_sort(m_schedule.begin(), m_schedule.end(), [](const PreloadEntry& a, const PreloadEntry& b) { return a.log_time < b.log_time; });
+        m_arena.shrink_to_fit();
+        m_schedule.shrink_to_fit();
+        return !m_schedule.empty();
+    }
+
+    /**
+     * @brief 加载缓存文件，源文件大小/修改时间或通道列表不一致时视为失效
+     * @param cachePath 缓存文件路径
+     * @param bagPath 源文件路径
+     * @param channels 要预加载的通道
+     * @return 是否成功
+     */
+    bool Load(const std::string& cachePath, const std::string& bagPath, const std::vector<mcap::ChannelId>& channels)
+    {
+        std::ifstream file(cachePath, std::ios::binary);
+        if (!file)
+        {
+            return false;
+        }
+
+        char magic[sizeof(kPreloadMagic)];
+        uint32_t byteOrder = 0;
+        uint64_t bagSize = 0;
+        int64_t bagMtime = 0;
+        uint32_t channelCount = 0;
+        uint64_t entryCount = 0;
+        uint64_t arenaSize = 0;
+        file.read(magic, sizeof(magic));
+        Read(file, byteOrder);
+        Read(file, bagSize);
+        Read(file, bagMtime);
+        Read(file, channelCount);
+        Read(file, entryCount);
+        Read(file, arenaSize);
+        if (!file || std::memcmp(magic, kPreloadMagic, sizeof(magic)) != 0 || byteOrder != kPreloadByteOrder)
+        {
+            return false;
+        }
+
+        // 按文件实际大小检查计划项数和负载总长，避免损坏的文件头导致超大分配
+        std::error_code ec;
+        const uint64_t cacheSize = std::filesystem::file_size(cachePath, ec);
+        const uint64_t bodySize = static_cast<uint64_t>(channelCount) * sizeof(mcap::ChannelId);
+        if (ec || cacheSize < kHeaderSize + bodySize)
+        {
+            return false;
+        }
+        const uint64_t remaining = cacheSize - kHeaderSize - bodySize;
+        if (entryCount > remaining / kEntrySize || arenaSize != remaining - entryCount * kEntrySize)
+        {
+            std::cerr << "预加载缓存文件长度与文件头不一致: " << cachePath << std::endl;
+            return false;
+        }
+
+        uint64_t currentSize = 0;
+        int64_t currentMtime = 0;
+        if (!Stat(bagPath, currentSize, currentMtime) || bagSize != currentSize || bagMtime != currentMtime || channelCount != channels.size())
+        {
+            return false;
+        }
+        std::vector<mcap::ChannelId> stored(channelCount);
+        file.read(reinterpret_cast<char*>(stored.data()), static_cast<std::streamsize>(stored.size() * sizeof(mcap::ChannelId)));
+        if (!file || stored != channels)
+        {
+            return false;
+        }
+
+        Clear();
+        m_channels = std::move(stored);
+        m_schedule.resize(entryCount);
+        for (auto& entry : m_schedule)
+        {
+            Read(file, entry.log_time);
+            Read(file, entry.offset);
+            Read(file, entry.size);
+            Read(file, entry.slot);
+        }
+        m_arena.resize(arenaSize);
+        file.read(m_arena.data(), static_cast<std::streamsize>(arenaSize));
+        if (!file || !Validate())
+        {
+            Clear();
+            return false;
+        }
+        return !m_schedule.empty();
+    }
+
+    /**
+     * @brief 保存缓存文件(先写临时文件再改名，多个进程共用缓存时不会读到写了一半的文件)
+     * @param cachePath 缓存文件路径
+     * @param bagPath 源文件路径
+     * @return 是否成功
+     */
+    bool Save(const std::string& cachePath, const std::string& bagPath) const
+    {
+        uint64_t bagSize = 0;
+        int64_t bagMtime = 0;
+        if (!Stat(bagPath, bagSize, bagMtime))
+        {
+            return false;
+        }
+
+        const std::string tmpPath = cachePath + ".tmp." + std::to_string(::getpid());
+        {
+            std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+            if (!file)
+            {
+                return false;
+            }
+
+            file.write(kPreloadMagic, sizeof(kPreloadMagic));
+            Write(file, kPreloadByteOrder);
+            Write(file, bagSize);
+            Write(file, bagMtime);
+            Write(file, static_cast<uint32_t>(m_channels.size()));
+            Write(file, static_cast<uint64_t>(m_schedule.size()));
+            Write(file, static_cast<uint64_t>(m_arena.size()));
+            file.write(reinterpret_cast<const char*>(m_channels.data()), static_cast<std::streamsize>(m_channels.size() * sizeof(mcap::ChannelId)));
+            for (const auto& entry : m_schedule)
+            {
+                Write(file, entry.log_time);
+                Write(file, entry.offset);
+                Write(file, entry.size);
+                Write(file, entry.slot);
+            }
+            file.write(m_arena.data(), static_cast<std::streamsize>(m_arena.size()));
+            if (!file)
+            {
+                file.close();
+                std::error_code ec;
+                std::filesystem::remove(tmpPath, ec);
+                return false;
+            }
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(tmpPath, cachePath, ec);
+        if (ec)
+        {
+            std::filesystem::remove(tmpPath, ec);
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief 释放预加载的数据
+     */
+    void Clear()
+    {
+        m_channels.clear();
+        m_schedule.clear();
+        m_arena.clear();
+    }
+
+    /**
+     * @brief 预加载的通道
+     */
+    const std::vector<mcap::ChannelId>& Channels() const { return m_channels; }
+
+    /**
+     * @brief 计划中的消息数
+     */
+    size_t Size() const { return m_schedule.size(); }
+
+    /**
+     * @brief 负载占用的内存(字节)
+     */
+    size_t ArenaBytes() const { return m_arena.size(); }
+
+    /**
+     * @brief 获取计划项的负载
+     */
+    std::string_view Payload(const PreloadEntry& entry) const { return std::string_view(m_arena).substr(entry.offset, entry.size); }
+
+private:
+    static constexpr uint64_t kHeaderSize = sizeof(kPreloadMagic) + 4 + 8 + 8 + 4 + 8 + 8;  ///< 文件头大小
+    static constexpr uint64_t kEntrySize = 8 + 8 + 4 + 2;                                 ///< 计划项大小
+
+    /**
+     * @brief 检查缓存文件中的计划项是否都落在负载区和通道列表内
+     */
+    bool Validate() const
+    {
+        for (const auto& entry : m_schedule)
+        {
+            if (entry.slot >= m_channels.size() || entry.offset > m_arena.size() || entry.size > m_arena.size() - entry.offset)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    template <typename T>
+    static void Read(std::ifstream& file, T& value)
+    {
+        file.read(reinterpret_cast<char*>(&value), sizeof(value));
+    }
+
+    template <typename T>
+    static void Write(std::ofstream& file, const T& value)
+    {
+        file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    static bool Stat(const std::string& path, uint64_t& size, int64_t& mtime)
+    {
+        std::error_code ec;
+        size = std::filesystem::file_size(path, ec);
+        if (ec)
+        {
+            return false;
+        }
+        mtime = static_cast<int64_t>(std::filesystem::last_write_time(path, ec).time_since_epoch().count());
+        return !ec;
+    }
+
+    std::vector<mcap::ChannelId> m_channels;  ///< 槽位到通道ID
+    std::vector<PreloadEntry> m_schedule;     ///< 按时间排序的发布计划
+    std::string m_arena;                      ///< 连续存放的负载
+};
+
+}  // namespace openbag
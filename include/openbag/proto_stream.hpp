@@ -0,0 +1,615 @@
+/**
+ * @copyright Copyright (c) 2025 openbag
+ *
+ * @author Zhao Jun(zwhy2025@gmail.com)
+ * @version 0.1
+ * @date 2025-05-22
+ *
+ * @file proto_stream.hpp
+ * @brief 长度前缀的Protobuf流存储格式(只追加写入，不分块，不压缩)
+ *
+ * 面向边缘设备的最高吞吐录制: 每条记录直接追加到文件，没有块缓冲和压缩，
+ * 每条消息的额外开销约十几字节。归档时用转换器转为MCAP。
+ *
+ * 数据文件(<文件名>.pbs)，小端序，整数为 varint：
+ * - 文件头: 魔数 "OBPBS001"(8)
+ * - 记录: 类型(uint8) + 记录体长度(varint) + 记录体
+ *   - SCHEMA: id, 名称, 编码, 模式数据(剩余字节)
+ *   - CHANNEL: id, 模式id, 话题, 消息编码, 键值对数 + 键值对
+ *   - MESSAGE: 通道id, 序列号, logTime(fixed64), publishTime - logTime(zigzag), 负载(剩余字节)
+ *   - ATTACHMENT: logTime(fixed64), createTime(fixed64), 名称, 媒体类型, 内容(剩余字节)
+ *   - METADATA: 名称, 键值对数 + 键值对
+ *   字符串为 varint 长度 + 字节。
+ *
+ * 索引文件(<数据文件>.idx)随写入增量追加，每次把写缓冲落盘时追加一项：
+ * - 文件头: 魔数 "OBPBI001"(8)
+ * - 索引项: 数据偏移(uint64) + 长度(uint64) + 最早 logTime(uint64) + 最晚 logTime(uint64) + 记录数(uint32) + 消息数(uint32)
+ *
+ * 写入中断时数据文件末尾可能有不完整的记录，读取时忽略；索引只覆盖已落盘的数据。
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <mcap/mcap.hpp>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace openbag {
+
+constexpr char kProtoStreamMagic[8] = {'O', 'B', 'P', 'B', 'S', '0', '0', '1'};       ///< 数据文件魔数
+constexpr char kProtoStreamIndexMagic[8] = {'O', 'B', 'P', 'B', 'I', '0', '0', '1'};  ///< 索引文件魔数
+constexpr const char* kProtoStreamExtension = "pbs";                                  ///< 数据文件扩展名
+constexpr const char* kProtoStreamIndexExtension = ".idx";                            ///< 索引文件后缀
+
+/**
+ * @brief 记录类型
+ */
+enum class ProtoStreamRecordType : uint8_t
+{
+    SCHEMA = 1,      ///< 模式
+    CHANNEL = 2,     ///< 通道
+    MESSAGE = 3,     ///< 消息
+    ATTACHMENT = 4,  ///< 附件
+    METADATA = 5     ///< 元数据
+};
+
+/**
+ * @brief 索引项，对应数据文件中一段连续的记录
+ */
+struct ProtoStreamIndexEntry
+{
+    uint64_t offset = 0;                                          ///< 数据偏移
+    uint64_t length = 0;                                          ///< 长度
+    uint64_t start_time = std::numeric_limits<uint64_t>::max();  ///< 最早 logTime
+    uint64_t end_time = 0;                                        ///< 最晚 logTime
+    uint32_t records = 0;                                         ///< 记录数
+    uint32_t messages = 0;                                        ///< 其中的消息数
+};
+
+/**
+ * @brief 记录编解码
+ */
+class ProtoStreamCodec
+{
+public:
+    static size_t VarintSize(uint64_t value)
+    {
+        size_t size = 1;
+        while (value >= 0x80)
+        {
+            value >>= 7;
+            size++;
+        }
+        return size;
+    }
+
+    static void AppendVarint(std::string& out, uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            out.push_back(static_cast<char>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    static void AppendFixed64(std::string& out, uint64_t value)
+    {
+        char bytes[sizeof(value)];
+        std::memcpy(bytes, &value, sizeof(value));
+        out.append(bytes, sizeof(bytes));
+    }
+
+    static void AppendString(std::string& out, std::string_view value)
+    {
+        AppendVarint(out, value.size());
+        out.append(value);
+    }
+
+    static void AppendKeyValues(std::string& out, const mcap::KeyValueMap& values)
+    {
+        AppendVarint(out, values.size());
+        for (const auto& [key, value] : values)
+        {
+            AppendString(out, key);
+            AppendString(out, value);
+        }
+    }
+
+    static bool ReadVarint(std::string_view& in, uint64_t& value)
+    {
+        value = 0;
+        for (size_t i = 0; i < in.size() && i < 10; ++i)
+        {
+            const auto byte = static_cast<uint8_t>(in[i]);
+            value |= static_cast<uint64_t>(byte & 0x7F) << (7 * i);
+            if ((byte & 0x80) == 0)
+            {
+                in.remove_prefix(i + 1);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool ReadFixed64(std::string_view& in, uint64_t& value)
+    {
+        if (in.size() < sizeof(value))
+        {
+            return false;
+        }
+        std::memcpy(&value, in.data(), sizeof(value));
+        in.remove_prefix(sizeof(value));
+        return true;
+    }
+
+    static bool ReadString(std::string_view& in, std::string& value)
+    {
+        uint64_t size = 0;
+        if (!ReadVarint(in, size) || size > in.size())
+        {
+            return false;
+        }
+        value.assign(in.substr(0, size));
+        in.remove_prefix(size);
+        return true;
+    }
+
+    static bool ReadKeyValues(std::string_view& in, mcap::KeyValueMap& values)
+    {
+        uint64_t count = 0;
+        if (!ReadVarint(in, count))
+        {
+            return false;
+        }
+        values.clear();
+        for (uint64_t i = 0; i < count; ++i)
+        {
+            std::string key;
+            std::string value;
+            if (!ReadString(in, key) || !ReadString(in, value))
+            {
+                return false;
+            }
+            values[std::move(key)] = std::move(value);
+        }
+        return true;
+    }
+
+    static uint64_t ZigZag(int64_t value) { return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63); }
+
+    static int64_t UnZigZag(uint64_t value) { return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1); }
+
+    /**
+     * @brief 解码模式记录
+     */
+    static bool DecodeSchema(std::string_view body, mcap::Schema& schema)
+    {
+        uint64_t id = 0;
+        if (!ReadVarint(body, id) || !ReadString(body, schema.name) || !ReadString(body, schema.encoding))
+        {
+            return false;
+        }
+        schema.id = static_cast<mcap::SchemaId>(id);
+        schema.data.assign(reinterpret_cast<const std::byte*>(body.data()), reinterpret_cast<const std::byte*>(body.data() + body.size()));
+        return true;
+    }
+
+    /**
+     * @brief 解码通道记录
+     */
+    static bool DecodeChannel(std::string_view body, mcap::Channel& channel)
+    {
+        uint64_t id = 0;
+        uint64_t schemaId = 0;
+        if (!ReadVarint(body, id) || !ReadVarint(body, schemaId) || !ReadString(body, channel.topic) || !ReadString(body, channel.messageEncoding) ||
+            !ReadKeyValues(body, channel.metadata))
+        {
+            return false;
+        }
+        channel.id = static_cast<mcap::ChannelId>(id);
+        channel.schemaId = static_cast<mcap::SchemaId>(schemaId);
+        return true;
+    }
+
+    /**
+     * @brief 解码消息记录，负载指向记录体，在读取下一条记录前有效
+     */
+    static bool DecodeMessage(std::string_view body, mcap::Message& message)
+    {
+        uint64_t channelId = 0;
+        uint64_t sequence = 0;
+        uint64_t logTime = 0;
+        uint64_t publishDelta = 0;
+        if (!ReadVarint(body, channelId) || !ReadVarint(body, sequence) || !ReadFixed64(body, logTime) || !ReadVarint(body, publishDelta))
+        {
+            return false;
+        }
+        message.channelId = static_cast<mcap::ChannelId>(channelId);
+        message.sequence = static_cast<uint32_t>(sequence);
+        message.logTime = logTime;
+        message.publishTime = logTime + static_cast<uint64_t>(UnZigZag(publishDelta));
+        message.data = reinterpret_cast<const std::byte*>(body.data());
+        message.dataSize = body.size();
+        return true;
+    }
+
+    /**
+     * @brief 解码附件记录，内容指向记录体，在读取下一条记录前有效
+     */
+    static bool DecodeAttachment(std::string_view body, mcap::Attachment& attachment)
+    {
+        if (!ReadFixed64(body, attachment.logTime) || !ReadFixed64(body, attachment.createTime) || !ReadString(body, attachment.name) ||
+            !ReadString(body, attachment.mediaType))
+        {
+            return false;
+        }
+        attachment.data = reinterpret_cast<const std::byte*>(body.data());
+        attachment.dataSize = body.size();
+        return true;
+    }
+
+    /**
+     * @brief 解码元数据记录
+     */
+    static bool DecodeMetadata(std::string_view body, mcap::Metadata& metadata) { return ReadString(body, metadata.name) && ReadKeyValues(body, metadata.metadata); }
+};
+
+/**
+ * @brief Protobuf流写入器，接口与 mcap::McapWriter 对应，供 Storage 按输出格式切换
+ *
+ * 记录先追加到写缓冲，缓冲满 kFlushSize 时一次写入文件，并在索引文件追加对应的索引项。
+ */
+class ProtoStreamWriter
+{
+public:
+    static constexpr size_t kFlushSize = 1024 * 1024;  ///< 写缓冲落盘阈值
+
+    ~ProtoStreamWriter() { close(); }
+
+    /**
+     * @brief 打开数据文件和索引文件(已存在时覆盖)
+     * @param filename 数据文件路径
+     */
+    mcap::Status open(const std::string& filename)
+    {
+        close();
+        m_file.open(filename, std::ios::binary | std::ios::trunc);
+        m_index.open(filename + kProtoStreamIndexExtension, std::ios::binary | std::ios::trunc);
+        if (!m_file || !m_index)
+        {
+            m_file.close();
+            m_index.close();
+            return mcap::Status(mcap::StatusCode::OpenFailed, "failed to open " + filename);
+        }
+        m_file.write(kProtoStreamMagic, sizeof(kProtoStreamMagic));
+        m_index.write(kProtoStreamIndexMagic, sizeof(kProtoStreamIndexMagic));
+        m_offset = sizeof(kProtoStreamMagic);
+        m_buffer.clear();
+        m_buffer.reserve(kFlushSize + 64 * 1024);
+        m_block = ProtoStreamIndexEntry{};
+        m_schemaCount = 0;
+        m_channelCount = 0;
+        return mcap::Status();
+    }
+
+    /**
+     * @brief 落盘并关闭文件
+     */
+    void close()
+    {
+        if (!m_file.is_open())
+        {
+            return;
+        }
+        Flush();
+        m_file.close();
+        m_index.close();
+    }
+
+    /**
+     * @brief 写入模式记录，与 McapWriter 一样按顺序分配ID
+     */
+    void addSchema(mcap::Schema& schema)
+    {
+        schema.id = ++m_schemaCount;
+        std::string body;
+        ProtoStreamCodec::AppendVarint(body, schema.id);
+        ProtoStreamCodec::AppendString(body, schema.name);
+        ProtoStreamCodec::AppendString(body, schema.encoding);
+        body.append(reinterpret_cast<const char*>(schema.data.data()), schema.data.size());
+        AppendRecord(ProtoStreamRecordType::SCHEMA, body);
+    }
+
+    /**
+     * @brief 写入通道记录，与 McapWriter 一样按顺序分配ID
+     */
+    void addChannel(mcap::Channel& channel)
+    {
+        channel.id = ++m_channelCount;
+        std::string body;
+        ProtoStreamCodec::AppendVarint(body, channel.id);
+        ProtoStreamCodec::AppendVarint(body, channel.schemaId);
+        ProtoStreamCodec::AppendString(body, channel.topic);
+        ProtoStreamCodec::AppendString(body, channel.messageEncoding);
+        ProtoStreamCodec::AppendKeyValues(body, channel.metadata);
+        AppendRecord(ProtoStreamRecordType::CHANNEL, body);
+    }
+
+    /**
+     * @brief 写入消息记录，头部直接编码进写缓冲，负载只复制一次
+     */
+    mcap::Status write(const mcap::Message& message)
+    {
+        if (!m_file.is_open())
+        {
+            return mcap::Status(mcap::StatusCode::NotOpen);
+        }
+
+        const uint64_t publishDelta = ProtoStreamCodec::ZigZag(static_cast<int64_t>(message.publishTime - message.logTime));
+        const size_t headerSize = ProtoStreamCodec::VarintSize(message.channelId) + ProtoStreamCodec::VarintSize(message.sequence) + sizeof(uint64_t) +
+                                  ProtoStreamCodec::VarintSize(publishDelta);
+        m_buffer.push_back(static_cast<char>(ProtoStreamRecordType::MESSAGE));
+        ProtoStreamCodec::AppendVarint(m_buffer, headerSize + message.dataSize);
+        ProtoStreamCodec::AppendVarint(m_buffer, message.channelId);
+        ProtoStreamCodec::AppendVarint(m_buffer, message.sequence);
+        ProtoStreamCodec::AppendFixed64(m_buffer, message.logTime);
+        ProtoStreamCodec::AppendVarint(m_buffer, publishDelta);
+        m_buffer.append(reinterpret_cast<const char*>(message.data), message.dataSize);
+
+        m_block.records++;
+        m_block.messages++;
+        m_block.start_time = std::min(m_block.start_time, message.logTime);
+        m_block.end_time = std::max(m_block.end_time, message.logTime);
+        return FlushIfNeeded();
+    }
+
+    /**
+     * @brief 写入附件记录
+     */
+    mcap::Status write(mcap::Attachment& attachment)
+    {
+        std::string body;
+        ProtoStreamCodec::AppendFixed64(body, attachment.logTime);
+        ProtoStreamCodec::AppendFixed64(body, attachment.createTime);
+        ProtoStreamCodec::AppendString(body, attachment.name);
+        ProtoStreamCodec::AppendString(body, attachment.mediaType);
+        body.append(reinterpret_cast<const char*>(attachment.data), attachment.dataSize);
+        return AppendRecord(ProtoStreamRecordType::ATTACHMENT, body);
+    }
+
+    /**
+     * @brief 写入元数据记录
+     */
+    mcap::Status write(const mcap::Metadata& metadata)
+    {
+        std::string body;
+        ProtoStreamCodec::AppendString(body, metadata.name);
+        ProtoStreamCodec::AppendKeyValues(body, metadata.metadata);
+        return AppendRecord(ProtoStreamRecordType::METADATA, body);
+    }
+
+    /**
+     * @brief 把写缓冲写入文件，并追加索引项
+     * @return 是否成功
+     */
+    bool Flush()
+    {
+        if (m_buffer.empty())
+        {
+            return true;
+        }
+
+        m_file.write(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+        m_file.flush();
+        m_block.offset = m_offset;
+        m_block.length = m_buffer.size();
+        m_offset += m_buffer.size();
+        m_buffer.clear();
+
+        const uint64_t startTime = m_block.messages > 0 ? m_block.start_time : 0;
+        m_index.write(reinterpret_cast<const char*>(&m_block.offset), sizeof(m_block.offset));
+        m_index.write(reinterpret_cast<const char*>(&m_block.length), sizeof(m_block.length));
+        m_index.write(reinterpret_cast<const char*>(&startTime), sizeof(startTime));
+        m_index.write(reinterpret_cast<const char*>(&m_block.end_time), sizeof(m_block.end_time));
+        m_index.write(reinterpret_cast<const char*>(&m_block.records), sizeof(m_block.records));
+        m_index.write(reinterpret_cast<const char*>(&m_block.messages), sizeof(m_block.messages));
+        m_index.flush();
+        m_block = ProtoStreamIndexEntry{};
+        return static_cast<bool>(m_file) && static_cast<bool>(m_index);
+    }
+
+private:
+    mcap::Status AppendRecord(ProtoStreamRecordType type, const std::string& body)
+    {
+        if (!m_file.is_open())
+        {
+            return mcap::Status(mcap::StatusCode::NotOpen);
+        }
+        m_buffer.push_back(static_cast<char>(type));
+        ProtoStreamCodec::AppendVarint(m_buffer, body.size());
+        m_buffer.append(body);
+        m_block.records++;
+        return FlushIfNeeded();
+    }
+
+    mcap::Status FlushIfNeeded()
+    {
+        if (m_buffer.size() >= kFlushSize && !Flush())
+        {
+            return mcap::Status(mcap::StatusCode::InvalidFile, "failed to write proto stream");
+        }
+        return mcap::Status();
+    }
+
+    std::ofstream m_file;          ///< 数据文件
+    std::ofstream m_index;         ///< 索引文件
+    std::string m_buffer;          ///< 写缓冲
+    uint64_t m_offset = 0;         ///< 写缓冲在数据文件中的起始偏移
+    ProtoStreamIndexEntry m_block;  ///< 写缓冲对应的索引项
+    mcap::SchemaId m_schemaCount = 0;
+    mcap::ChannelId m_channelCount = 0;
+};
+
+/**
+ * @brief Protobuf流读取器，按写入顺序逐条读取记录
+ */
+class ProtoStreamReader
+{
+public:
+    /**
+     * @brief 打开数据文件
+     * @param filename 数据文件路径
+     * @return 是否成功
+     */
+    bool Open(const std::string& filename)
+    {
+        m_file.close();
+        m_file.clear();
+        m_file.open(filename, std::ios::binary);
+        char magic[sizeof(kProtoStreamMagic)];
+        if (!m_file || !m_file.read(magic, sizeof(magic)) || std::memcmp(magic, kProtoStreamMagic, sizeof(magic)) != 0)
+        {
+            std::cerr << "不是Protobuf流文件: " << filename << std::endl;
+            m_file.close();
+            return false;
+        }
+        m_offset = sizeof(kProtoStreamMagic);
+        m_truncated = false;
+        m_filename = filename;
+        std::error_code ec;
+        m_fileSize = std::filesystem::file_size(filename, ec);
+        return true;
+    }
+
+    /**
+     * @brief 判断文件是否为Protobuf流格式
+     */
+    static bool IsProtoStream(const std::string& filename)
+    {
+        std::ifstream file(filename, std::ios::binary);
+        char magic[sizeof(kProtoStreamMagic)];
+        return file.read(magic, sizeof(magic)) && std::memcmp(magic, kProtoStreamMagic, sizeof(magic)) == 0;
+    }
+
+    /**
+     * @brief 读取下一条记录
+     * @param[out] type 记录类型
+     * @param[out] body 记录体，在读取下一条记录前有效
+     * @return 是否读到记录(文件结束、末尾记录不完整或记录长度超出文件时返回false)
+     */
+    bool Next(ProtoStreamRecordType& type, std::string_view& body)
+    {
+        char opcode = 0;
+        if (!m_file.get(opcode))
+        {
+            return false;
+        }
+
+        uint64_t size = 0;
+        int shift = 0;
+        for (char byte = 0;; shift += 7)
+        {
+            if (shift >= 64 || !m_file.get(byte))
+            {
+                m_truncated = true;
+                return false;
+            }
+            size |= static_cast<uint64_t>(static_cast<uint8_t>(byte) & 0x7F) << shift;
+            if ((static_cast<uint8_t>(byte) & 0x80) == 0)
+            {
+                break;
+            }
+        }
+
+        // 长度来自文件内容，超出文件剩余长度(文件可能仍在增长，先重新获取大小)时按不完整记录处理，避免按损坏的长度分配内存
+        const uint64_t position = static_cast<uint64_t>(m_file.tellg());
+        if (size > m_fileSize - std::min(position, m_fileSize))
+        {
+            std::error_code ec;
+            m_fileSize = std::filesystem::file_size(m_filename, ec);
+            if (ec || size > m_fileSize - std::min(position, m_fileSize))
+            {
+                m_truncated = true;
+                return false;
+            }
+        }
+
+        m_body.resize(size);
+        if (!m_file.read(m_body.data(), static_cast<std::streamsize>(size)))
+        {
+            m_truncated = true;
+            return false;
+        }
+        m_offset = static_cast<uint64_t>(m_file.tellg());
+        type = static_cast<ProtoStreamRecordType>(opcode);
+        body = m_body;
+        return true;
+    }
+
+    /**
+     * @brief 跳到数据文件中的指定偏移(须为索引项的起始偏移)
+     */
+    bool Seek(uint64_t offset)
+    {
+        m_file.clear();
+        m_file.seekg(static_cast<std::streamoff>(offset));
+        m_offset = offset;
+        return static_cast<bool>(m_file);
+    }
+
+    /**
+     * @brief 当前读取位置
+     */
+    uint64_t Offset() const { return m_offset; }
+
+    /**
+     * @brief 末尾是否有不完整的记录(录制中断)
+     */
+    bool IsTruncated() const { return m_truncated; }
+
+    /**
+     * @brief 加载索引文件，末尾不完整的索引项忽略
+     * @param filename 数据文件路径
+     * @param[out] entries 索引项
+     * @return 是否成功
+     */
+    static bool LoadIndex(const std::string& filename, std::vector<ProtoStreamIndexEntry>& entries)
+    {
+        entries.clear();
+        std::ifstream file(filename + kProtoStreamIndexExtension, std::ios::binary);
+        char magic[sizeof(kProtoStreamIndexMagic)];
+        if (!file.read(magic, sizeof(magic)) || std::memcmp(magic, kProtoStreamIndexMagic, sizeof(magic)) != 0)
+        {
+            return false;
+        }
+
+        ProtoStreamIndexEntry entry;
+        while (file.read(reinterpret_cast<char*>(&entry.offset), sizeof(entry.offset)) && file.read(reinterpret_cast<char*>(&entry.length), sizeof(entry.length)) &&
+               file.read(reinterpret_cast<char*>(&entry.start_time), sizeof(entry.start_time)) &&
+               file.read(reinterpret_cast<char*>(&entry.end_time), sizeof(entry.end_time)) &&
+               file.read(reinterpret_cast<char*>(&entry.records), sizeof(entry.records)) && file.read(reinterpret_cast<char*>(&entry.messages), sizeof(entry.messages)))
+        {
+            entries.push_back(entry);
+        }
+        return true;
+    }
+
+private:
+    std::ifstream m_file;      ///< 数据文件
+    std::string m_filename;    ///< 数据文件路径
+    uint64_t m_fileSize = 0;   ///< 数据文件大小
+    std::string m_body;        ///< 当前记录体
+    uint64_t m_offset = 0;     ///< 下一条记录的偏移
+    bool m_truncated = false;  ///< 末尾记录是否不完整
+};
+
+}  // namespace openbag
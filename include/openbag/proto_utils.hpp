@@ -14,9 +14,13 @@
 #include <google/protobuf/compiler/importer.h>
 #include <google/protobuf/descriptor.h>
 #include <google/protobuf/descriptor.pb.h>
+#include <google/protobuf/descriptor_database.h>
 #include <google/protobuf/dynamic_message.h>
 
+#include <cstdint>
+#include <cstring>
 #include <iostream>
+#include <sstream>
 #include <queue>
 #include <string>
 #include <unordered_set>
@@ -135,6 +139,460 @@ inline google::protobuf::FileDescriptorSet BuildFileDescriptorSet(const google::
     return fdSet;
 }
 
+/**
+ * @brief 由文件中的模式数据(序列化的 FileDescriptorSet)构建的描述符池
+ *
+ * 多个模式共用同一个池，依赖文件按名称去重，描述符在首次查找时才构建。
+ */
+class SchemaDescriptorPool
+{
+public:
+    SchemaDescriptorPool() : m_pool(&m_database) {}
+
+    /**
+     * @brief 加载模式并查找消息描述符
+     * @param typeName 消息类型全名
+     * @param schemaData 序列化的 FileDescriptorSet
+     * @return 消息描述符，失败时为空
+     */
+    const google::protobuf::Descriptor* Load(const std::string& typeName, const std::string& schemaData)
+    {
+        google::protobuf::FileDescriptorSet fdSet;
+        if (!fdSet.ParseFromString(schemaData))
+        {
+            return nullptr;
+        }
+
+        for (const auto& file : fdSet.file())
+        {
+            google::protobuf::FileDescriptorProto existing;
+            if (!m_database.FindFileByName(file.name(), &existing))
+            {
+                m_database.Add(file);
+            }
+        }
+        return m_pool.FindMessageTypeByName(typeName);
+    }
+
+private:
+    google::protobuf::SimpleDescriptorDatabase m_database;  ///< 文件描述符数据库
+    google::protobuf::DescriptorPool m_pool;                ///< 描述符池
+};
+
+/**
+ * @brief 时间字段的编码方式
+ */
+enum class ProtoTimeFieldKind
+{
+    TIMESTAMP,         ///< google.protobuf.Timestamp 消息
+    VARINT_NANOS,      ///< int64/uint64 纳秒
+    FIXED64_NANOS,     ///< fixed64/sfixed64 纳秒
+    DOUBLE_SECONDS     ///< double 秒
+};
+
+/**
+ * @brief 解析后的时间字段路径(字段编号序列)
+ */
+struct ProtoTimeFieldPath
+{
+    std::vector<int> numbers;                             ///< 从顶层消息到时间字段的字段编号
+    ProtoTimeFieldKind kind = ProtoTimeFieldKind::TIMESTAMP;  ///< 时间字段编码方式
+};
+
+/**
+ * @brief 按字段名路径(如 "header.stamp")解析时间字段
+ * @param descriptor 顶层消息描述符
+ * @param fieldPath 以 '.' 分隔的字段名路径
+ * @param[out] path 字段编号路径
+ * @return 是否成功(中间字段须为非 repeated 消息，末端须为受支持的时间字段)
+ */
+inline bool ResolveProtoTimeField(const google::protobuf::Descriptor* descriptor, const std::string& fieldPath, ProtoTimeFieldPath& path)
+{
+    using google::protobuf::FieldDescriptor;
+
+    path.numbers.clear();
+    std::istringstream stream(fieldPath);
+    std::string name;
+    const FieldDescriptor* field = nullptr;
+    while (std::getline(stream, name, '.'))
+    {
+        if (!descriptor)
+        {
+            return false;  // 上一级不是消息
+        }
+        field = descriptor->FindFieldByName(name);
+        if (!field || field->is_repeated())
+        {
+            return false;
+        }
+        path.numbers.push_back(field->number());
+        descriptor = field->type() == FieldDescriptor::TYPE_MESSAGE ? field->message_type() : nullptr;
+    }
+    if (!field)
+    {
+        return false;
+    }
+
+    switch (field->type())
+    {
+        case FieldDescriptor::TYPE_MESSAGE:
+            path.kind = ProtoTimeFieldKind::TIMESTAMP;
+            return field->message_type()->full_name() == "google.protobuf.Timestamp";
+        case FieldDescriptor::TYPE_INT64:
+        case FieldDescriptor::TYPE_UINT64:
+            path.kind = ProtoTimeFieldKind::VARINT_NANOS;
+            return true;
+        case FieldDescriptor::TYPE_FIXED64:
+        case FieldDescriptor::TYPE_SFIXED64:
+            path.kind = ProtoTimeFieldKind::FIXED64_NANOS;
+            return true;
+        case FieldDescriptor::TYPE_DOUBLE:
+            path.kind = ProtoTimeFieldKind::DOUBLE_SECONDS;
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * @brief protobuf 线格式原地改写
+ *
+ * 直接在序列化数据上定位并改写字段，不做完整的解码/编码。新值能放进原 varint
+ * 的字节数时按原宽度写入(varint 允许多余的 0x80 续位字节)，数据长度不变；
+ * 否则替换该段字节并自内向外修正各层消息的长度前缀。
+ */
+class ProtoWireEditor
+{
+public:
+    /**
+     * @brief 构造函数
+     * @param buffer 序列化的消息数据，原地修改
+     */
+    explicit ProtoWireEditor(std::string& buffer) : m_buffer(buffer) {}
+
+    /**
+     * @brief 进入当前消息中的子消息字段，不存在时在末尾追加空的子消息
+     * @param number 字段编号
+     * @return 是否成功(字段存在但不是长度前缀类型或数据损坏时失败)
+     */
+    bool Enter(int number)
+    {
+        Field field;
+        const bool found = FindLast(number, field);
+        if (m_error || (found && field.wireType != kWireLength))
+        {
+            return false;
+        }
+        if (!found)
+        {
+            std::string bytes;
+            AppendVarint(bytes, MakeTag(number, kWireLength));
+            AppendVarint(bytes, 0);
+            Splice(End(), 0, bytes);
+            // 修正外层长度前缀可能改变其宽度使数据后移，按追加后的末尾重新定位(空长度前缀占1字节)
+            field.valuePos = End();
+            field.lenPos = field.valuePos - 1;
+            field.valueSize = 0;
+        }
+
+        Scope scope;
+        scope.lenPos = field.lenPos;
+        scope.lenSize = field.valuePos - field.lenPos;
+        scope.valuePos = field.valuePos;
+        scope.length = field.valueSize;
+        m_scopes.push_back(scope);
+        return true;
+    }
+
+    /**
+     * @brief 设置当前消息中的 varint 字段，不存在时在末尾追加
+     */
+    bool SetVarint(int number, uint64_t value)
+    {
+        Field field;
+        const bool found = FindLast(number, field);
+        if (m_error || (found && field.wireType != kWireVarint))
+        {
+            return false;
+        }
+
+        std::string bytes;
+        if (found)
+        {
+            if (VarintSize(value) <= field.valueSize)
+            {
+                WriteVarint(&m_buffer[field.valuePos], value, field.valueSize);
+                return true;
+            }
+            AppendVarint(bytes, value);
+            Splice(field.valuePos, field.valueSize, bytes);
+            return true;
+        }
+
+        AppendVarint(bytes, MakeTag(number, kWireVarint));
+        AppendVarint(bytes, value);
+        Splice(End(), 0, bytes);
+        return true;
+    }
+
+    /**
+     * @brief 设置当前消息中的 64 位定长字段，不存在时在末尾追加
+     */
+    bool SetFixed64(int number, uint64_t value)
+    {
+        Field field;
+        const bool found = FindLast(number, field);
+        if (m_error || (found && field.wireType != kWireFixed64))
+        {
+            return false;
+        }
+
+        char bytes[8];
+        std::memcpy(bytes, &value, sizeof(bytes));  // 小端序
+        if (found)
+        {
+            std::memcpy(&m_buffer[field.valuePos], bytes, sizeof(bytes));
+            return true;
+        }
+
+        std::string encoded;
+        AppendVarint(encoded, MakeTag(number, kWireFixed64));
+        encoded.append(bytes, sizeof(bytes));
+        Splice(End(), 0, encoded);
+        return true;
+    }
+
+private:
+    static constexpr uint32_t kWireVarint = 0;
+    static constexpr uint32_t kWireFixed64 = 1;
+    static constexpr uint32_t kWireLength = 2;
+    static constexpr uint32_t kWireFixed32 = 5;
+    static constexpr uint32_t kWireNone = 0xFF;
+
+    struct Field
+    {
+        uint32_t wireType = kWireNone;  ///< 线格式类型
+        size_t lenPos = 0;              ///< 长度前缀位置(仅长度前缀类型)
+        size_t valuePos = 0;            ///< 值起始位置(长度前缀类型为长度之后)
+        size_t valueSize = 0;           ///< 值字节数
+    };
+
+    struct Scope
+    {
+        size_t lenPos = 0;    ///< 长度前缀位置
+        size_t lenSize = 0;   ///< 长度前缀字节数
+        size_t valuePos = 0;  ///< 子消息起始位置
+        size_t length = 0;    ///< 子消息长度
+    };
+
+    static uint64_t MakeTag(int number, uint32_t wireType) { return (static_cast<uint64_t>(number) << 3) | wireType; }
+
+    static size_t VarintSize(uint64_t value)
+    {
+        size_t size = 1;
+        while (value >= 0x80)
+        {
+            value >>= 7;
+            size++;
+        }
+        return size;
+    }
+
+    static void AppendVarint(std::string& out, uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    static void WriteVarint(char* out, uint64_t value, size_t width)
+    {
+        for (size_t i = 0; i + 1 < width; ++i)
+        {
+            out[i] = static_cast<char>((value & 0x7F) | 0x80);
+            value >>= 7;
+        }
+        out[width - 1] = static_cast<char>(value & 0x7F);
+    }
+
+    bool ReadVarint(size_t& pos, size_t end, uint64_t& value) const
+    {
+        value = 0;
+        for (int shift = 0; shift < 64 && pos < end; shift += 7)
+        {
+            const auto byte = static_cast<uint8_t>(m_buffer[pos++]);
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    size_t Begin() const { return m_scopes.empty() ? 0 : m_scopes.back().valuePos; }
+    size_t End() const { return m_scopes.empty() ? m_buffer.size() : m_scopes.back().valuePos + m_scopes.back().length; }
+
+    /**
+     * @brief 在当前消息中查找字段的最后一次出现(与解析时后者覆盖前者的语义一致)
+     */
+    bool FindLast(int number, Field& result)
+    {
+        bool found = false;
+        size_t pos = Begin();
+        const size_t end = End();
+        while (pos < end)
+        {
+            uint64_t tag = 0;
+            if (!ReadVarint(pos, end, tag))
+            {
+                m_error = true;
+                return false;
+            }
+
+            Field field;
+            field.wireType = static_cast<uint32_t>(tag & 0x7);
+            uint64_t size = 0;
+            switch (field.wireType)
+            {
+                case kWireVarint:
+                {
+                    const size_t start = pos;
+                    if (!ReadVarint(pos, end, size))
+                    {
+                        m_error = true;
+                        return false;
+                    }
+                    field.valuePos = start;
+                    field.valueSize = pos - start;
+                    break;
+                }
+                case kWireFixed64:
+                    field.valuePos = pos;
+                    field.valueSize = 8;
+                    break;
+                case kWireLength:
+                    field.lenPos = pos;
+                    if (!ReadVarint(pos, end, size))
+                    {
+                        m_error = true;
+                        return false;
+                    }
+                    field.valuePos = pos;
+                    field.valueSize = size;
+                    break;
+                case kWireFixed32:
+                    field.valuePos = pos;
+                    field.valueSize = 4;
+                    break;
+                default:
+                    m_error = true;  // 不支持 group
+                    return false;
+            }
+
+            if (field.wireType != kWireVarint)
+            {
+                if (field.valueSize > end - pos)
+                {
+                    m_error = true;
+                    return false;
+                }
+                pos += field.valueSize;
+            }
+            if (static_cast<int>(tag >> 3) == number)
+            {
+                result = field;
+                found = true;
+            }
+        }
+        return found;
+    }
+
+    /**
+     * @brief 替换一段字节，并自内向外修正各层长度前缀
+     */
+    void Splice(size_t pos, size_t oldSize, const std::string& bytes)
+    {
+        m_buffer.replace(pos, oldSize, bytes);
+        int64_t delta = static_cast<int64_t>(bytes.size()) - static_cast<int64_t>(oldSize);
+        for (auto it = m_scopes.rbegin(); it != m_scopes.rend() && delta != 0; ++it)
+        {
+            it->length = static_cast<size_t>(static_cast<int64_t>(it->length) + delta);
+            const size_t needed = VarintSize(it->length);
+            if (needed <= it->lenSize)
+            {
+                WriteVarint(&m_buffer[it->lenPos], it->length, it->lenSize);
+                continue;
+            }
+
+            std::string prefix;
+            AppendVarint(prefix, it->length);
+            m_buffer.replace(it->lenPos, it->lenSize, prefix);
+            const int64_t grown = static_cast<int64_t>(needed - it->lenSize);
+            it->lenSize = needed;
+            delta += grown;
+
+            // 内层位置都在该长度前缀之后，随之后移
+            for (auto inner = m_scopes.rbegin(); inner != it; ++inner)
+            {
+                inner->lenPos += static_cast<size_t>(grown);
+                inner->valuePos += static_cast<size_t>(grown);
+            }
+            it->valuePos += static_cast<size_t>(grown);
+        }
+    }
+
+    std::string& m_buffer;        ///< 序列化数据
+    std::vector<Scope> m_scopes;  ///< 已进入的子消息(由外向内)
+    bool m_error = false;         ///< 数据是否损坏
+};
+
+/**
+ * @brief 在序列化的 protobuf 消息中原地改写时间字段
+ * @param buffer 序列化的消息数据
+ * @param path 时间字段路径
+ * @param timeNs 新的时间(纳秒)
+ * @return 是否成功，失败时数据可能已部分改写
+ */
+inline bool RewriteProtoTimeField(std::string& buffer, const ProtoTimeFieldPath& path, uint64_t timeNs)
+{
+    if (path.numbers.empty())
+    {
+        return false;
+    }
+
+    ProtoWireEditor editor(buffer);
+    for (size_t i = 0; i + 1 < path.numbers.size(); ++i)
+    {
+        if (!editor.Enter(path.numbers[i]))
+        {
+            return false;
+        }
+    }
+
+    const int number = path.numbers.back();
+    switch (path.kind)
+    {
+        case ProtoTimeFieldKind::TIMESTAMP:
+            return editor.Enter(number) && editor.SetVarint(1, timeNs / 1000000000ULL) && editor.SetVarint(2, timeNs % 1000000000ULL);
+        case ProtoTimeFieldKind::VARINT_NANOS:
+            return editor.SetVarint(number, timeNs);
+        case ProtoTimeFieldKind::FIXED64_NANOS:
+            return editor.SetFixed64(number, timeNs);
+        case ProtoTimeFieldKind::DOUBLE_SECONDS:
+        {
+            const double seconds = static_cast<double>(timeNs) / 1e9;
+            uint64_t bits = 0;
+            std::memcpy(&bits, &seconds, sizeof(bits));
+            return editor.SetFixed64(number, bits);
+        }
+    }
+    return false;
+}
+
 /**
  * @brief 创建Proto导入器
  * @param search_paths Proto文件搜索路径
@@ -16,16 +16,54 @@
 #include <google/protobuf/dynamic_message.h>
 #include <google/protobuf/message.h>
 
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
 #include "mcap/reader.hpp"
+#include "openbag/chunk_cache.hpp"
+#include "openbag/codec.hpp"
+#include "openbag/message_index.hpp"
 
 namespace openbag {
 
+/**
+ * @brief 按索引读取的消息
+ */
+struct IndexedMessage
+{
+    mcap::Message message;       ///< 消息，数据指针指向 chunk 中的记录区
+    mcap::ChannelPtr channel;    ///< 所属通道
+    ChunkCache::ChunkPtr chunk;  ///< 持有消息所在的解压块
+    size_t index = 0;            ///< 在话题中的序号
+};
+
+/**
+ * @brief 读取出的附件
+ */
+struct AttachmentData
+{
+    std::string name;          ///< 附件名称
+    std::string media_type;    ///< 媒体类型
+    uint64_t log_time = 0;     ///< 附件时间(纳秒)
+    uint64_t create_time = 0;  ///< 创建时间(纳秒)
+    std::string data;          ///< 附件内容
+};
+
 /**
  * @brief MCAP 读取器类，支持 Protobuf 消息动态解析 - 简化版实现
  */
@@ -38,6 +76,7 @@ public:
     Reader() : m_isOpen(false)
     {
         // 延迟初始化protobuf相关对象
+        m_resolver.SetFetchFunc([this](const mcap::Channel &channel, uint64_t logTime, std::vector<StoredFrame> &frames) { return FetchStoredPayloads(channel, logTime, frames); });
     }
 
     /**
@@ -72,6 +111,9 @@ public:
             return false;
         }
 
+        m_filename = filename;
+        m_resolver.Reset();
+        m_chunkFd = ::open(filename.c_str(), O_RDONLY);
         m_isOpen = true;
         return true;
     }
@@ -81,11 +123,27 @@ public:
      */
     void Close()
     {
+        // 预读线程使用 m_reader 和块文件描述符，先停止并等待它退出
+        StopPrefetch();
         if (m_isOpen)
         {
             m_reader.close();
             m_isOpen = false;
         }
+        if (m_fetchReader)
+        {
+            m_fetchReader->close();
+            m_fetchReader.reset();
+        }
+        m_resolver.Reset();
+        if (m_chunkFd >= 0)
+        {
+            ::close(m_chunkFd);
+            m_chunkFd = -1;
+        }
+        m_chunkCache.Clear();
+        m_messageIndex.clear();
+        m_indexBuilt = false;
     }
 
     /**
@@ -122,6 +180,819 @@ public:
         return m_reader.readMessages();
     }
 
+    /**
+     * @brief 按读取选项获取流式消息视图
+     * @param options 读取选项(时间范围、话题过滤、读取顺序)
+     * @return 消息视图
+     */
+    auto GetMessages(const mcap::ReadMessageOptions &options) -> mcap::LinearMessageView
+    {
+        if (!m_isOpen)
+        {
+            return mcap::McapReader{}.readMessages();
+        }
+        const auto onProblem = [](const mcap::Status &status) { std::cerr << "读取消息出错: " << status.message << std::endl; };
+        return m_reader.readMessages(onProblem, options);
+    }
+
+    /**
+     * @brief 还原消息负载
+     *
+     * 对启用了去重等编码的通道，去掉帧头并把引用帧还原为原始负载；
+     * 其他通道直接返回存储的负载。
+     *
+     * @param view 消息视图
+     * @param[out] payload 原始负载，在下一次调用前有效
+     * @return 是否成功
+     */
+    bool ResolvePayload(const mcap::MessageView &view, std::string_view &payload)
+    {
+        const std::string_view stored(reinterpret_cast<const char *>(view.message.data), view.message.dataSize);
+        if (!view.channel)
+        {
+            payload = stored;
+            return true;
+        }
+        return m_resolver.Resolve(*view.channel, view.message.logTime, view.message.sequence, stored, payload);
+    }
+
+    /**
+     * @brief 还原本文件中一条消息的负载(按 channelId 查找通道)
+     * @param message MCAP消息
+     * @param[out] payload 原始负载，在下一次调用前有效
+     * @return 是否成功
+     */
+    bool ResolvePayload(const mcap::Message &message, std::string_view &payload)
+    {
+        const std::string_view stored(reinterpret_cast<const char *>(message.data), message.dataSize);
+        const auto channel = m_reader.channel(message.channelId);
+        if (!channel)
+        {
+            payload = stored;
+            return true;
+        }
+        return m_resolver.Resolve(*channel, message.logTime, message.sequence, stored, payload);
+    }
+
+    /**
+     * @brief 重置负载还原缓存(跳转播放位置后调用)
+     */
+    void ResetPayloadCache() { m_resolver.Reset(); }
+
+    /**
+     * @brief 获取摘要中的块索引
+     * @return 块索引列表，文件无摘要时为空
+     */
+    const std::vector<mcap::ChunkIndex> &GetChunkIndexes() const { return m_reader.chunkIndexes(); }
+
+    /**
+     * @brief 获取模式信息
+     * @return 模式映射
+     */
+    auto GetSchemas() const
+    {
+        if (!m_isOpen)
+        {
+            return std::unordered_map<mcap::SchemaId, mcap::SchemaPtr>{};
+        }
+        return m_reader.schemas();
+    }
+
+    /**
+     * @brief 获取统计信息
+     * @return 统计信息，文件无统计记录时为空
+     */
+    const std::optional<mcap::Statistics> &GetStatistics() const { return m_reader.statistics(); }
+
+    /**
+     * @brief 读取块记录的原始字节(未解压)
+     * @param index 块索引
+     * @param[out] raw 块记录字节(包含操作码与长度)
+     * @return 是否成功
+     * @note 只做顺序I/O，解压由 DecodeChunk 完成，便于在多个线程中并行解压
+     */
+    bool ReadChunk(const mcap::ChunkIndex &index, mcap::ByteArray &raw)
+    {
+        if (!m_isOpen || !m_reader.dataSource())
+        {
+            return false;
+        }
+
+        std::byte *data = nullptr;
+        const uint64_t bytesRead = m_reader.dataSource()->read(&data, index.chunkStartOffset, index.chunkLength);
+        if (bytesRead != index.chunkLength || data == nullptr)
+        {
+            std::cerr << "读取块失败, 偏移: " << index.chunkStartOffset << std::endl;
+            return false;
+        }
+
+        raw.assign(data, data + bytesRead);
+        return true;
+    }
+
+    /**
+     * @brief 解压并解析块记录
+     * @param raw ReadChunk 读取的块记录字节
+     * @param[out] chunk 解压后的块
+     * @return 是否成功
+     */
+    static bool DecodeChunk(const mcap::ByteArray &raw, DecodedChunk &chunk)
+    {
+        chunk.messages.clear();
+        if (!DecompressChunk(raw, chunk.records))
+        {
+            return false;
+        }
+
+        // 遍历块内记录，只保留消息记录
+        uint64_t offset = 0;
+        const uint64_t size = chunk.records.size();
+        while (offset + kRecordPrefixSize <= size)
+        {
+            mcap::Record inner;
+            inner.opcode = static_cast<mcap::OpCode>(chunk.records[offset]);
+            inner.dataSize = ReadUint64(chunk.records.data() + offset + 1);
+            inner.data = chunk.records.data() + offset + kRecordPrefixSize;
+            if (inner.dataSize > size - offset - kRecordPrefixSize)
+            {
+                std::cerr << "块内记录被截断, 偏移: " << offset << std::endl;
+                return false;
+            }
+
+            if (inner.opcode == mcap::OpCode::Message)
+            {
+                mcap::Message message;
+                if (mcap::McapReader::ParseMessage(inner, &message).ok())
+                {
+                    chunk.messages.push_back(message);
+                }
+            }
+            offset += kRecordPrefixSize + inner.dataSize;
+        }
+        return true;
+    }
+
+    /**
+     * @brief 解压块记录
+     * @param raw 块记录字节(包含操作码与长度)
+     * @param[out] records 解压后的记录区
+     * @return 是否成功
+     */
+    static bool DecompressChunk(const mcap::ByteArray &raw, mcap::ByteArray &records)
+    {
+        records.clear();
+        if (raw.size() < kRecordPrefixSize || static_cast<mcap::OpCode>(raw[0]) != mcap::OpCode::Chunk)
+        {
+            return false;
+        }
+
+        mcap::Record record;
+        record.opcode = mcap::OpCode::Chunk;
+        record.dataSize = ReadUint64(raw.data() + 1);
+        record.data = const_cast<std::byte *>(raw.data() + kRecordPrefixSize);
+        if (record.dataSize > raw.size() - kRecordPrefixSize)
+        {
+            return false;
+        }
+
+        mcap::Chunk mcapChunk;
+        auto status = mcap::McapReader::ParseChunk(record, &mcapChunk);
+        if (!status.ok())
+        {
+            std::cerr << "解析块失败: " << status.message << std::endl;
+            return false;
+        }
+
+        if (mcapChunk.compression.empty())
+        {
+            records.assign(mcapChunk.records, mcapChunk.records + mcapChunk.compressedSize);
+        } else if (mcapChunk.compression == "zstd")
+        {
+            status = mcap::ZStdReader::DecompressAll(mcapChunk.records, mcapChunk.compressedSize, mcapChunk.uncompressedSize, &records);
+        } else if (mcapChunk.compression == "lz4")
+        {
+            mcap::LZ4Reader lz4Reader;
+            status = lz4Reader.decompressAll(mcapChunk.records, mcapChunk.compressedSize, mcapChunk.uncompressedSize, &records);
+        } else
+        {
+            std::cerr << "不支持的块压缩格式: " << mcapChunk.compression << std::endl;
+            return false;
+        }
+
+        if (!status.ok())
+        {
+            std::cerr << "解压块失败: " << status.message << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief 获取附件名称列表(来自摘要的附件索引，不扫描数据区)
+     * @return 附件名称，同名附件只列出一次
+     */
+    std::vector<std::string> GetAttachmentNames() const
+    {
+        std::vector<std::string> names;
+        if (!m_isOpen)
+        {
+            return names;
+        }
+        const auto &indexes = m_reader.attachmentIndexes();
+        for (auto it = indexes.begin(); it != indexes.end(); it = indexes.upper_bound(it->first))
+        {
+            names.push_back(it->first);
+        }
+        return names;
+    }
+
+    /**
+     * @brief 读取附件
+     *
+     * 通过摘要中的附件索引直接定位附件记录，只读取该记录。
+     *
+     * @param name 附件名称，同名时取第一个
+     * @param[out] attachment 附件内容
+     * @return 是否成功
+     */
+    bool ReadAttachment(const std::string &name, AttachmentData &attachment)
+    {
+        if (!m_isOpen || !m_reader.dataSource())
+        {
+            return false;
+        }
+        auto it = m_reader.attachmentIndexes().find(name);
+        if (it == m_reader.attachmentIndexes().end())
+        {
+            std::cerr << "找不到附件: " << name << std::endl;
+            return false;
+        }
+
+        mcap::Record record;
+        mcap::Attachment parsed;
+        auto status = mcap::McapReader::ReadRecord(*m_reader.dataSource(), it->second.offset, &record);
+        if (status.ok())
+        {
+            status = mcap::McapReader::ParseAttachment(record, &parsed);
+        }
+        if (!status.ok())
+        {
+            std::cerr << "读取附件失败: " << name << " " << status.message << std::endl;
+            return false;
+        }
+
+        attachment.name = parsed.name;
+        attachment.media_type = parsed.mediaType;
+        attachment.log_time = parsed.logTime;
+        attachment.create_time = parsed.createTime;
+        attachment.data.assign(reinterpret_cast<const char *>(parsed.data), parsed.dataSize);
+        return true;
+    }
+
+    /**
+     * @brief 获取元数据名称列表(来自摘要的元数据索引)
+     * @return 元数据名称，同名元数据只列出一次
+     */
+    std::vector<std::string> GetMetadataNames() const
+    {
+        std::vector<std::string> names;
+        if (!m_isOpen)
+        {
+            return names;
+        }
+        const auto &indexes = m_reader.metadataIndexes();
+        for (auto it = indexes.begin(); it != indexes.end(); it = indexes.upper_bound(it->first))
+        {
+            names.push_back(it->first);
+        }
+        return names;
+    }
+
+    /**
+     * @brief 读取元数据
+     * @param name 元数据名称，同名时取第一个
+     * @param[out] values 键值对
+     * @return 是否成功
+     */
+    bool ReadMetadata(const std::string &name, mcap::KeyValueMap &values)
+    {
+        if (!m_isOpen || !m_reader.dataSource())
+        {
+            return false;
+        }
+        auto it = m_reader.metadataIndexes().find(name);
+        if (it == m_reader.metadataIndexes().end())
+        {
+            return false;
+        }
+
+        mcap::Record record;
+        mcap::Metadata parsed;
+        auto status = mcap::McapReader::ReadRecord(*m_reader.dataSource(), it->second.offset, &record);
+        if (status.ok())
+        {
+            status = mcap::McapReader::ParseMetadata(record, &parsed);
+        }
+        if (!status.ok())
+        {
+            std::cerr << "读取元数据失败: " << name << " " << status.message << std::endl;
+            return false;
+        }
+        values = std::move(parsed.metadata);
+        return true;
+    }
+
+    /**
+     * @brief 建立按话题的消息偏移索引
+     *
+     * 优先使用文件中的 MessageIndex 记录(只读取索引记录，不解压块)；文件没有 MessageIndex 时
+     * 加载旁路文件，旁路文件不存在或已失效时扫描所有块建立索引并写入旁路文件。
+     * 文件没有块(消息直接写在数据区)时顺序扫描一遍消息，索引项记录消息的文件偏移。
+     *
+     * @param useSidecar 是否读写旁路文件
+     * @return 是否成功
+     */
+    bool BuildMessageIndex(bool useSidecar = true)
+    {
+        if (!m_isOpen)
+        {
+            return false;
+        }
+        if (m_indexBuilt)
+        {
+            return true;
+        }
+
+        const auto &chunkIndexes = m_reader.chunkIndexes();
+        std::unordered_map<mcap::ChannelId, std::string> channelTopics;
+        for (const auto &[channelId, channel] : m_reader.channels())
+        {
+            channelTopics[channelId] = channel->topic;
+        }
+
+        TopicMessageIndex index;
+        const auto chunkCount = static_cast<uint32_t>(chunkIndexes.size());
+        const bool hasMessageIndexes = !chunkIndexes.empty() && std::all_of(chunkIndexes.begin(), chunkIndexes.end(), [](const mcap::ChunkIndex &chunk) { return !chunk.messageIndexOffsets.empty(); });
+        bool loaded = hasMessageIndexes && LoadMessageIndexRecords(channelTopics, index);
+        if (!loaded)
+        {
+            index.clear();
+            loaded = useSidecar && MessageIndexSidecar::Load(m_filename, chunkCount, index);
+        }
+        const bool scanned = !loaded;
+        if (scanned)
+        {
+            index.clear();
+            const bool ok = chunkIndexes.empty() ? ScanUnchunkedMessageIndex(channelTopics, index) : ScanMessageIndex(channelTopics, index);
+            if (!ok)
+            {
+                return false;
+            }
+        }
+
+        for (auto &[topic, entries] : index)
+        {
+            std::sort(entries.begin(), entries.end());
+        }
+        if (scanned && useSidecar && !MessageIndexSidecar::Save(m_filename, chunkCount, index))
+        {
+            std::cerr << "写入消息索引旁路文件失败: " << MessageIndexSidecar::PathFor(m_filename) << std::endl;
+        }
+        m_messageIndex = std::move(index);
+        m_indexBuilt = true;
+        return true;
+    }
+
+    /**
+     * @brief 获取话题的消息数(需先建立消息索引)
+     * @param topic 话题名称
+     * @return 消息数
+     */
+    size_t GetMessageCount(const std::string &topic) const
+    {
+        auto it = m_messageIndex.find(topic);
+        return it == m_messageIndex.end() ? 0 : it->second.size();
+    }
+
+    /**
+     * @brief 查找话题中时间最接近的消息(需先建立消息索引)
+     * @param topic 话题名称
+     * @param logTime 目标时间(纳秒)
+     * @param[out] index 消息在话题中的序号
+     * @return 话题是否存在且非空
+     */
+    bool FindNearestMessage(const std::string &topic, uint64_t logTime, size_t &index) const
+    {
+        auto it = m_messageIndex.find(topic);
+        if (it == m_messageIndex.end() || it->second.empty())
+        {
+            return false;
+        }
+        index = FindNearestEntry(it->second, logTime);
+        return true;
+    }
+
+    /**
+     * @brief 读取话题中的第N条消息(需先建立消息索引)
+     *
+     * 直接定位消息所在块，块经 LRU 缓存，相邻消息的读取不会重复解压。
+     *
+     * @param topic 话题名称
+     * @param index 消息在话题中的序号(从0开始)
+     * @param[out] message 读取的消息
+     * @return 是否成功
+     */
+    bool ReadMessageAt(const std::string &topic, size_t index, IndexedMessage &message)
+    {
+        auto it = m_messageIndex.find(topic);
+        if (it == m_messageIndex.end() || index >= it->second.size())
+        {
+            return false;
+        }
+
+        const auto &entry = it->second[index];
+        const bool unchunked = entry.chunk == kUnchunkedMessage;
+        auto chunk = unchunked ? PreadRecord(entry.offset) : LoadChunk(entry.chunk);
+        const uint64_t offset = unchunked ? 0 : entry.offset;
+        if (!chunk || offset + kRecordPrefixSize > chunk->records.size())
+        {
+            return false;
+        }
+
+        mcap::Record record;
+        record.opcode = static_cast<mcap::OpCode>(chunk->records[offset]);
+        record.dataSize = ReadUint64(chunk->records.data() + offset + 1);
+        record.data = const_cast<std::byte *>(chunk->records.data() + offset + kRecordPrefixSize);
+        if (record.opcode != mcap::OpCode::Message || record.dataSize > chunk->records.size() - offset - kRecordPrefixSize ||
+            !mcap::McapReader::ParseMessage(record, &message.message).ok())
+        {
+            std::cerr << "消息索引与文件内容不一致: " << topic << " #" << index << std::endl;
+            return false;
+        }
+
+        message.channel = m_reader.channel(entry.channel_id);
+        message.chunk = std::move(chunk);
+        message.index = index;
+        return true;
+    }
+
+    /**
+     * @brief 还原按索引读取的消息负载
+     * @param message 按索引读取的消息
+     * @param[out] payload 原始负载，在下一次调用前有效
+     * @return 是否成功
+     */
+    bool ResolvePayload(const IndexedMessage &message, std::string_view &payload)
+    {
+        const std::string_view stored(reinterpret_cast<const char *>(message.message.data), message.message.dataSize);
+        if (!message.channel)
+        {
+            payload = stored;
+            return true;
+        }
+        return m_resolver.Resolve(*message.channel, message.message.logTime, message.message.sequence, stored, payload);
+    }
+
+    /**
+     * @brief 在后台预取第N条消息前后的块(需先建立消息索引)
+     *
+     * 新的预取请求会替换尚未处理的旧请求，离目标越近的块越先处理。
+     *
+     * @param topic 话题名称
+     * @param index 消息在话题中的序号
+     * @param radius 前后各预取的消息数
+     */
+    void Prefetch(const std::string &topic, size_t index, size_t radius)
+    {
+        auto it = m_messageIndex.find(topic);
+        if (it == m_messageIndex.end() || it->second.empty())
+        {
+            return;
+        }
+
+        const auto &entries = it->second;
+        std::vector<size_t> chunks;
+        const auto addChunk = [&](size_t i) {
+            const size_t chunk = entries[i].chunk;
+            if (chunk != kUnchunkedMessage && std::find(chunks.begin(), chunks.end(), chunk) == chunks.end())
+            {
+                chunks.push_back(chunk);
+            }
+        };
+        index = std::min(index, entries.size() - 1);
+        addChunk(index);
+        for (size_t d = 1; d <= radius; ++d)
+        {
+            if (index + d < entries.size()) addChunk(index + d);
+            if (index >= d) addChunk(index - d);
+        }
+
+        PrefetchChunks(chunks);
+    }
+
+    /**
+     * @brief 双向消息游标
+     *
+     * 按块起始时间遍历块，块内按 logTime 排序后正向或反向读取；解压后的块经 LRU 缓存，
+     * 来回拖动不会重复解压，进入新块时在后台预取前后相邻的块。
+     * 块之间的时间范围有重叠时，跨块的顺序以块起始时间为准。
+     * 文件没有块索引(消息直接写在数据区)时，构造时以 LinearMessageView 顺序扫描一遍，
+     * 记录每条消息的时间和文件偏移并按 logTime 排序，之后按偏移以 pread 逐条读取。
+     * 游标停在首条/末条消息时 Next/Prev 返回 false 且位置不变。
+     */
+    class Cursor
+    {
+    public:
+        /**
+         * @brief 构造函数
+         * @param reader 已打开的读取器，游标使用期间需保持有效
+         */
+        explicit Cursor(Reader &reader) : m_reader(reader)
+        {
+            const auto &chunkIndexes = reader.m_reader.chunkIndexes();
+            if (chunkIndexes.empty())
+            {
+                ScanUnchunked();
+                return;
+            }
+            m_chunkOrder.resize(chunkIndexes.size());
+            for (size_t i = 0; i < m_chunkOrder.size(); ++i)
+            {
+                m_chunkOrder[i] = i;
+            }
+            std::sort(m_chunkOrder.begin(), m_chunkOrder.end(), [&chunkIndexes](size_t a, size_t b) {
+                if (chunkIndexes[a].messageStartTime != chunkIndexes[b].messageStartTime)
+                {
+                    return chunkIndexes[a].messageStartTime < chunkIndexes[b].messageStartTime;
+                }
+                return chunkIndexes[a].chunkStartOffset < chunkIndexes[b].chunkStartOffset;
+            });
+        }
+
+        /**
+         * @brief 定位到第一条消息
+         */
+        bool SeekBegin()
+        {
+            if (m_unchunked)
+            {
+                return LoadRecord(0);
+            }
+            for (size_t pos = 0; pos < m_chunkOrder.size(); ++pos)
+            {
+                if (Load(pos, false))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /**
+         * @brief 定位到最后一条消息
+         */
+        bool SeekEnd()
+        {
+            if (m_unchunked)
+            {
+                return !m_records.empty() && LoadRecord(m_records.size() - 1);
+            }
+            for (size_t pos = m_chunkOrder.size(); pos-- > 0;)
+            {
+                if (Load(pos, true))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /**
+         * @brief 定位到第一条 logTime >= 指定时间的消息，不存在时定位到最后一条消息
+         * @param logTime 目标时间(纳秒)
+         */
+        bool SeekTime(uint64_t logTime)
+        {
+            if (m_unchunked)
+            {
+                auto it = std::lower_bound(m_records.begin(), m_records.end(), logTime, [](const RecordEntry &entry, uint64_t time) { return entry.logTime < time; });
+                return it != m_records.end() ? LoadRecord(static_cast<size_t>(it - m_records.begin())) : SeekEnd();
+            }
+            const auto &chunkIndexes = m_reader.m_reader.chunkIndexes();
+            for (size_t pos = 0; pos < m_chunkOrder.size(); ++pos)
+            {
+                if (chunkIndexes[m_chunkOrder[pos]].messageEndTime < logTime || !Load(pos, false))
+                {
+                    continue;
+                }
+                const auto &messages = m_chunk->messages;
+                auto it = std::lower_bound(m_order.begin(), m_order.end(), logTime, [&messages](uint32_t i, uint64_t time) { return messages[i].logTime < time; });
+                if (it != m_order.end())
+                {
+                    m_messagePos = static_cast<size_t>(it - m_order.begin());
+                    Update();
+                    return true;
+                }
+            }
+            return SeekEnd();
+        }
+
+        /**
+         * @brief 移动到下一条消息
+         * @return 是否移动成功
+         */
+        bool Next()
+        {
+            if (!m_valid)
+            {
+                return false;
+            }
+            if (m_unchunked)
+            {
+                return LoadRecord(m_messagePos + 1);
+            }
+            if (m_messagePos + 1 < m_order.size())
+            {
+                m_messagePos++;
+                Update();
+                return true;
+            }
+            for (size_t pos = m_chunkPos + 1; pos < m_chunkOrder.size(); ++pos)
+            {
+                if (Load(pos, false))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /**
+         * @brief 移动到上一条消息
+         * @return 是否移动成功
+         */
+        bool Prev()
+        {
+            if (!m_valid)
+            {
+                return false;
+            }
+            if (m_unchunked)
+            {
+                return m_messagePos > 0 && LoadRecord(m_messagePos - 1);
+            }
+            if (m_messagePos > 0)
+            {
+                m_messagePos--;
+                Update();
+                return true;
+            }
+            for (size_t pos = m_chunkPos; pos-- > 0;)
+            {
+                if (Load(pos, true))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /**
+         * @brief 游标是否指向有效消息
+         */
+        bool Valid() const { return m_valid; }
+
+        /**
+         * @brief 获取当前消息(index 字段不使用)
+         */
+        const IndexedMessage &Current() const { return m_current; }
+
+    private:
+        /**
+         * @brief 加载块并定位到块内首条/末条消息，失败时游标位置不变
+         */
+        bool Load(size_t pos, bool fromEnd)
+        {
+            auto chunk = m_reader.LoadChunk(m_chunkOrder[pos]);
+            if (!chunk || chunk->messages.empty())
+            {
+                return false;
+            }
+
+            // 块内按 logTime 稳定排序，反向读取即为块内反转
+            const auto &messages = chunk->messages;
+            m_order.resize(messages.size());
+            for (uint32_t i = 0; i < m_order.size(); ++i)
+            {
+                m_order[i] = i;
+            }
+            std::stable_sort(m_order.begin(), m_order.end(), [&messages](uint32_t a, uint32_t b) { return messages[a].logTime < messages[b].logTime; });
+
+            m_chunk = std::move(chunk);
+            m_chunkPos = pos;
+            m_messagePos = fromEnd ? m_order.size() - 1 : 0;
+            m_valid = true;
+            Update();
+
+            std::vector<size_t> neighbors;
+            if (pos + 1 < m_chunkOrder.size()) neighbors.push_back(m_chunkOrder[pos + 1]);
+            if (pos > 0) neighbors.push_back(m_chunkOrder[pos - 1]);
+            m_reader.PrefetchChunks(neighbors);
+            return true;
+        }
+
+        /**
+         * @brief 顺序扫描未分块的文件，记录消息的时间和偏移
+         */
+        void ScanUnchunked()
+        {
+            m_unchunked = true;
+            const auto onProblem = [](const mcap::Status &status) { std::cerr << "扫描消息出错: " << status.message << std::endl; };
+            for (const auto &view : m_reader.m_reader.readMessages(onProblem))
+            {
+                if (view.messageOffset.chunkOffset)
+                {
+                    std::cerr << "文件中的块缺少块索引，无法回放: " << m_reader.m_filename << std::endl;
+                    m_records.clear();
+                    return;
+                }
+                m_records.push_back({view.message.logTime, view.messageOffset.offset});
+            }
+            std::stable_sort(m_records.begin(), m_records.end(), [](const RecordEntry &a, const RecordEntry &b) { return a.logTime < b.logTime; });
+        }
+
+        /**
+         * @brief 以 pread 读取未分块文件中的第N条消息，失败时游标位置不变
+         */
+        bool LoadRecord(size_t pos)
+        {
+            if (pos >= m_records.size())
+            {
+                return false;
+            }
+            auto chunk = m_reader.PreadRecord(m_records[pos].offset);
+            if (!chunk || chunk->records.size() < kRecordPrefixSize)
+            {
+                return false;
+            }
+
+            mcap::Record record;
+            mcap::Message message;
+            record.opcode = static_cast<mcap::OpCode>(chunk->records[0]);
+            record.dataSize = ReadUint64(chunk->records.data() + 1);
+            record.data = const_cast<std::byte *>(chunk->records.data() + kRecordPrefixSize);
+            if (record.opcode != mcap::OpCode::Message || !mcap::McapReader::ParseMessage(record, &message).ok())
+            {
+                std::cerr << "读取消息失败, 偏移: " << m_records[pos].offset << std::endl;
+                return false;
+            }
+
+            m_chunk = std::move(chunk);
+            m_messagePos = pos;
+            m_valid = true;
+            SetCurrent(message);
+            return true;
+        }
+
+        void Update() { SetCurrent(m_chunk->messages[m_order[m_messagePos]]); }
+
+        void SetCurrent(const mcap::Message &message)
+        {
+            m_current.message = message;
+            if (!m_current.channel || m_current.channel->id != m_current.message.channelId)
+            {
+                m_current.channel = m_reader.m_reader.channel(m_current.message.channelId);
+            }
+            m_current.chunk = m_chunk;
+        }
+
+        /**
+         * @brief 未分块文件中的消息位置
+         */
+        struct RecordEntry
+        {
+            uint64_t logTime;  ///< 消息时间
+            uint64_t offset;   ///< 记录在文件中的偏移
+        };
+
+        Reader &m_reader;                    ///< 读取器
+        bool m_unchunked = false;            ///< 文件没有块索引，按消息偏移逐条读取
+        std::vector<RecordEntry> m_records;  ///< 未分块时按时间排序的消息位置
+        std::vector<size_t> m_chunkOrder;    ///< 按起始时间排序的块序号
+        size_t m_chunkPos = 0;               ///< 当前块在 m_chunkOrder 中的位置
+        ChunkCache::ChunkPtr m_chunk;        ///< 当前块(未分块时为当前消息记录)
+        std::vector<uint32_t> m_order;       ///< 当前块内按时间排序的消息下标
+        size_t m_messagePos = 0;             ///< 当前消息在 m_order(未分块时为 m_records)中的位置
+        IndexedMessage m_current;            ///< 当前消息
+        bool m_valid = false;                ///< 是否指向有效消息
+    };
+
+    /**
+     * @brief 设置解压块缓存容量
+     * @param capacity 容量(字节)
+     */
+    void SetChunkCacheCapacity(size_t capacity) { m_chunkCache.SetCapacity(capacity); }
+
     /**
      * @brief 获取通道信息
      * @return 通道映射
@@ -137,8 +1008,299 @@ public:
     }
 
 private:
-    bool m_isOpen;              ///< 是否已打开
-    mcap::McapReader m_reader;  ///< MCAP 读取器
+    static constexpr uint64_t kRecordPrefixSize = 9;  ///< 记录头大小: 操作码(1) + 长度(8)
+
+    /**
+     * @brief 读取小端序64位整数
+     */
+    static uint64_t ReadUint64(const std::byte *data)
+    {
+        uint64_t value = 0;
+        std::memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    static constexpr uint64_t kMessageRecordHeaderSize = kRecordPrefixSize + 2 + 4 + 8 + 8;  ///< 消息记录头: 记录头 + 通道/序号/两个时间
+
+    /**
+     * @brief 获取解压后的块(经 LRU 缓存)，可在多个线程中调用
+     * @param chunk 块在摘要块索引中的序号
+     * @return 解压后的块，失败时为空
+     */
+    ChunkCache::ChunkPtr LoadChunk(size_t chunk)
+    {
+        if (auto cached = m_chunkCache.Get(chunk))
+        {
+            return cached;
+        }
+
+        const auto &chunkIndexes = m_reader.chunkIndexes();
+        mcap::ByteArray raw;
+        auto decoded = std::make_shared<DecodedChunk>();
+        if (chunk >= chunkIndexes.size() || !PreadChunk(chunkIndexes[chunk], raw) || !DecodeChunk(raw, *decoded))
+        {
+            return nullptr;
+        }
+        m_chunkCache.Put(chunk, decoded);
+        return decoded;
+    }
+
+    /**
+     * @brief 以 pread 读取不在块中的单条记录，返回只含该记录的块(不进入缓存)
+     * @param offset 记录在文件中的偏移
+     * @return 记录区为该记录的块，失败时为空
+     */
+    ChunkCache::ChunkPtr PreadRecord(uint64_t offset) const
+    {
+        std::byte prefix[kRecordPrefixSize];
+        if (m_chunkFd < 0 || ::pread(m_chunkFd, prefix, sizeof(prefix), static_cast<off_t>(offset)) != static_cast<ssize_t>(sizeof(prefix)))
+        {
+            return nullptr;
+        }
+
+        const uint64_t dataSize = ReadUint64(prefix + 1);
+        struct stat st;
+        if (::fstat(m_chunkFd, &st) != 0 || dataSize > static_cast<uint64_t>(st.st_size) - std::min<uint64_t>(offset + kRecordPrefixSize, st.st_size))
+        {
+            std::cerr << "记录长度超出文件范围, 偏移: " << offset << std::endl;
+            return nullptr;
+        }
+
+        mcap::ChunkIndex index;
+        index.chunkStartOffset = offset;
+        index.chunkLength = kRecordPrefixSize + dataSize;
+        auto decoded = std::make_shared<DecodedChunk>();
+        if (!PreadChunk(index, decoded->records))
+        {
+            return nullptr;
+        }
+        return decoded;
+    }
+
+    /**
+     * @brief 以 pread 读取块记录，不使用 mcap 读取器的共享缓冲区，可与消息迭代及其他线程并发
+     */
+    bool PreadChunk(const mcap::ChunkIndex &index, mcap::ByteArray &raw) const
+    {
+        if (m_chunkFd < 0)
+        {
+            return false;
+        }
+        raw.resize(index.chunkLength);
+        uint64_t done = 0;
+        while (done < index.chunkLength)
+        {
+            const ssize_t n = ::pread(m_chunkFd, raw.data() + done, index.chunkLength - done, static_cast<off_t>(index.chunkStartOffset + done));
+            if (n <= 0)
+            {
+                std::cerr << "读取块失败, 偏移: " << index.chunkStartOffset << std::endl;
+                return false;
+            }
+            done += static_cast<uint64_t>(n);
+        }
+        return true;
+    }
+
+    /**
+     * @brief 从 MessageIndex 记录建立消息索引
+     */
+    bool LoadMessageIndexRecords(const std::unordered_map<mcap::ChannelId, std::string> &channelTopics, TopicMessageIndex &index)
+    {
+        if (!m_reader.dataSource())
+        {
+            return false;
+        }
+
+        const auto &chunkIndexes = m_reader.chunkIndexes();
+        for (size_t i = 0; i < chunkIndexes.size(); ++i)
+        {
+            for (const auto &[channelId, offset] : chunkIndexes[i].messageIndexOffsets)
+            {
+                auto topicIt = channelTopics.find(channelId);
+                if (topicIt == channelTopics.end())
+                {
+                    continue;
+                }
+
+                mcap::Record record;
+                mcap::MessageIndex messageIndex;
+                if (!mcap::McapReader::ReadRecord(*m_reader.dataSource(), offset, &record).ok() || !mcap::McapReader::ParseMessageIndex(record, &messageIndex).ok())
+                {
+                    std::cerr << "读取 MessageIndex 记录失败, 偏移: " << offset << std::endl;
+                    return false;
+                }
+
+                auto &entries = index[topicIt->second];
+                for (const auto &[logTime, recordOffset] : messageIndex.records)
+                {
+                    entries.push_back({logTime, recordOffset, static_cast<uint32_t>(i), channelId});
+                }
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief 扫描所有块建立消息索引(解压后的块不进入缓存)
+     */
+    bool ScanMessageIndex(const std::unordered_map<mcap::ChannelId, std::string> &channelTopics, TopicMessageIndex &index)
+    {
+        const auto &chunkIndexes = m_reader.chunkIndexes();
+        mcap::ByteArray raw;
+        DecodedChunk decoded;
+        for (size_t i = 0; i < chunkIndexes.size(); ++i)
+        {
+            if (!PreadChunk(chunkIndexes[i], raw) || !DecodeChunk(raw, decoded))
+            {
+                return false;
+            }
+            for (const auto &message : decoded.messages)
+            {
+                auto topicIt = channelTopics.find(message.channelId);
+                if (topicIt == channelTopics.end())
+                {
+                    continue;
+                }
+                const uint64_t offset = static_cast<uint64_t>(message.data - decoded.records.data()) - kMessageRecordHeaderSize;
+                index[topicIt->second].push_back({message.logTime, offset, static_cast<uint32_t>(i), message.channelId});
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief 顺序扫描没有块的文件建立消息索引，索引项记录消息的文件偏移
+     */
+    bool ScanUnchunkedMessageIndex(const std::unordered_map<mcap::ChannelId, std::string> &channelTopics, TopicMessageIndex &index)
+    {
+        bool success = true;
+        const auto onProblem = [&success](const mcap::Status &status) {
+            std::cerr << "扫描消息出错: " << status.message << std::endl;
+            success = false;
+        };
+        for (const auto &view : m_reader.readMessages(onProblem))
+        {
+            auto topicIt = channelTopics.find(view.message.channelId);
+            if (topicIt == channelTopics.end())
+            {
+                continue;
+            }
+            if (view.messageOffset.chunkOffset)
+            {
+                std::cerr << "文件中的块缺少块索引，无法建立消息索引: " << m_filename << std::endl;
+                return false;
+            }
+            index[topicIt->second].push_back({view.message.logTime, view.messageOffset.offset, kUnchunkedMessage, view.message.channelId});
+        }
+        return success;
+    }
+
+    /**
+     * @brief 在后台预取指定的块，替换尚未处理的旧请求
+     */
+    void PrefetchChunks(const std::vector<size_t> &chunks)
+    {
+        std::lock_guard<std::mutex> lock(m_prefetchMutex);
+        m_prefetchQueue.assign(chunks.begin(), chunks.end());
+        if (!m_prefetchThread.joinable())
+        {
+            m_prefetchStop = false;
+            m_prefetchThread = std::thread(&Reader::PrefetchLoop, this);
+        }
+        m_prefetchCV.notify_one();
+    }
+
+    void PrefetchLoop()
+    {
+        while (true)
+        {
+            size_t chunk = 0;
+            {
+                std::unique_lock<std::mutex> lock(m_prefetchMutex);
+                m_prefetchCV.wait(lock, [this] { return m_prefetchStop || !m_prefetchQueue.empty(); });
+                if (m_prefetchStop)
+                {
+                    return;
+                }
+                chunk = m_prefetchQueue.front();
+                m_prefetchQueue.pop_front();
+            }
+            if (!m_chunkCache.Contains(chunk))
+            {
+                LoadChunk(chunk);
+            }
+        }
+    }
+
+    void StopPrefetch()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_prefetchMutex);
+            m_prefetchStop = true;
+            m_prefetchQueue.clear();
+        }
+        m_prefetchCV.notify_all();
+        if (m_prefetchThread.joinable())
+        {
+            m_prefetchThread.join();
+        }
+    }
+
+    /**
+     * @brief 取回指定通道上 logTime 相同的所有已存储负载，由还原器按序列号和哈希确认
+     *
+     * 使用独立的读取器，避免打断外部正在进行的消息迭代
+     */
+    bool FetchStoredPayloads(const mcap::Channel &channel, uint64_t logTime, std::vector<StoredFrame> &frames)
+    {
+        if (!m_fetchReader)
+        {
+            m_fetchReader = std::make_unique<mcap::McapReader>();
+            if (!m_fetchReader->open(m_filename).ok() || !m_fetchReader->readSummary(mcap::ReadSummaryMethod::AllowFallbackScan).ok())
+            {
+                m_fetchReader.reset();
+                return false;
+            }
+        }
+
+        mcap::ReadMessageOptions options;
+        options.startTime = logTime;
+        options.endTime = logTime + 1;
+        options.topicFilter = [&channel](std::string_view topic) { return topic == channel.topic; };
+
+        const auto onProblem = [](const mcap::Status &status) { std::cerr << "取回被引用消息出错: " << status.message << std::endl; };
+        for (const auto &view : m_fetchReader->readMessages(onProblem, options))
+        {
+            if (view.message.channelId == channel.id)
+            {
+                auto &frame = frames.emplace_back();
+                frame.sequence = view.message.sequence;
+                frame.stored.assign(reinterpret_cast<const char *>(view.message.data), view.message.dataSize);
+            }
+        }
+        if (frames.empty())
+        {
+            std::cerr << "找不到被引用的消息: " << channel.topic << " @ " << logTime << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    bool m_isOpen;                                   ///< 是否已打开
+    std::string m_filename;                          ///< 文件名
+    mcap::McapReader m_reader;                       ///< MCAP 读取器
+    std::unique_ptr<mcap::McapReader> m_fetchReader;  ///< 取回被引用帧的读取器(按需打开)
+    PayloadResolver m_resolver;                      ///< 负载还原器
+
+    int m_chunkFd = -1;                    ///< 按索引读取块使用的文件描述符
+    ChunkCache m_chunkCache;               ///< 解压块缓存
+    TopicMessageIndex m_messageIndex;      ///< 按话题的消息索引
+    bool m_indexBuilt = false;             ///< 是否已建立消息索引
+    std::thread m_prefetchThread;          ///< 预取线程
+    std::mutex m_prefetchMutex;            ///< 预取队列锁
+    std::condition_variable m_prefetchCV;  ///< 预取队列条件变量
+    std::deque<size_t> m_prefetchQueue;    ///< 待预取的块
+    bool m_prefetchStop = false;           ///< 预取线程停止标志
 };
 
 using ReaderPtr = std::unique_ptr<Reader>;
@@ -55,28 +55,51 @@ public:
      * @brief 构造函数
      * @param config 配置
      * @param adapterFactory 消息适配器工厂
+     * @param subscriberFunc 订阅者创建函数，为空时使用适配器工厂创建
+     * @param concurrentSubscriberFunc subscriberFunc 是否可被多个线程同时调用
+     *
+     * 启动时订阅者由 startup_threads 个线程并行创建；自定义的 subscriberFunc 默认加锁逐个调用，
+     * 确认其线程安全时传入 true 才会被并发调用。
      */
-    explicit Recorder(const ConfigManager &configManager, MessageAdapterFactoryPtr adapterFactory = nullptr, SubscriberFunc subscriberFunc = nullptr)
+    explicit Recorder(const ConfigManager &configManager, MessageAdapterFactoryPtr adapterFactory = nullptr, SubscriberFunc subscriberFunc = nullptr,
+                      bool concurrentSubscriberFunc = false)
         : m_configManager(configManager),
           m_config(configManager.GetRecorderConfig()),
           m_adapterFactory(adapterFactory),
           m_subscriberFunc(subscriberFunc),
-          m_storage(std::make_shared<Storage>(m_configManager.GetStorageConfig())),
+          m_storage(StorageBackendRegistry::Create(m_configManager.GetStorageConfig())),
           m_buffer(std::make_shared<MessageBuffer>(m_configManager.GetBufferConfig()))
     {
-        // 如果订阅者函数为空，则使用默认订阅者函数
+        // 如果订阅者函数为空，则使用默认订阅者函数(适配器工厂可并发调用)
+        m_concurrentSubscriberFunc = concurrentSubscriberFunc;
         if (!m_subscriberFunc)
         {
             m_subscriberFunc = [this](const std::string &topic) { return this->DefaultSubscriptionCallback(topic); };
+            m_concurrentSubscriberFunc = true;
         }
 
         if (!m_adapterFactory)
         {
             throw std::runtime_error("MessageAdapterFactory is nullptr");
         }
+
+        if (!m_storage)
+        {
+            throw std::runtime_error("Failed to create storage backend: " + m_configManager.GetStorageConfig().backend);
+        }
+    }
+
+    /**
+     * @brief 设置订阅者函数
+     * @param subscriberFunc 订阅者创建函数
+     * @param concurrent 是否可被多个线程同时调用，默认 false: 启动时加锁逐个调用
+     */
+    void SetSubscriberFunc(SubscriberFunc subscriberFunc, bool concurrent = false)
+    {
+        m_subscriberFunc = subscriberFunc;
+        m_concurrentSubscriberFunc = concurrent;
     }
 
-    void SetSubscriberFunc(SubscriberFunc subscriberFunc) { m_subscriberFunc = subscriberFunc; }
     /**
      * @brief 析构函数
      */
@@ -101,7 +124,8 @@ public:
         FileInfo fileInfo;
 
         fileInfo.prefix = m_config.filename_prefix;
-        fileInfo.extension = m_config.output_format;
+        fileInfo.format = m_config.output_format == "proto" ? StorageFormat::PROTOBUF : StorageFormat::MCAP;
+        fileInfo.extension = fileInfo.format == StorageFormat::PROTOBUF ? kProtoStreamExtension : m_config.output_format;
         fileInfo.output_path = m_config.output_path;
 
         // 打开存储
@@ -109,6 +133,19 @@ public:
         {
             return false;
         }
+
+        // 写入静态附件和元数据，放在消息之前，读取端通过摘要索引直接定位
+        for (const auto &attachment : m_config.attachments)
+        {
+            if (!m_storage->AddAttachmentFile(attachment))
+            {
+                std::cerr << "添加附件失败，继续录制: " << attachment.path << std::endl;
+            }
+        }
+        for (const auto &metadata : m_config.metadata)
+        {
+            m_storage->AddMetadata(metadata.name, metadata.values);
+        }
         // 启动缓冲区
         m_buffer->Clear();
         m_totalMessages = 0;
@@ -121,7 +158,7 @@ public:
 
         m_buffer->Start();
 
-        // 处理所有话题
+        // 注册所有话题(写入Schema/Channel记录)
         for (auto &topic : m_config.topics)
         {
             if (!m_storage->RegisterTopic(topic))
@@ -135,19 +172,38 @@ public:
 
                 return false;
             }
-
-            // 使用默认字符串订阅者
-            auto subscriber = m_subscriberFunc(topic.topic_name);
-            if (subscriber)
-            {
-                m_subscribers[topic.topic_name] = subscriber;
-            }
         }
 
-        // 启动写入线程
+        // 先启动写入线程，先创建好的订阅者收到的消息可以立即写入
         m_running = true;
         m_writeThread = std::thread(&Recorder::WriteLoop, this);
 
+        // 并行创建订阅者: 每个传输层实体的创建耗时毫秒级，话题多时逐个创建会丢失开头的消息
+        std::vector<OpenbagSubscriberPtr> subscribers(m_config.topics.size());
+        std::mutex subscriberFuncMutex;  // 未声明可并发调用的自定义订阅者函数逐个调用
+        ParallelFor(m_config.topics.size(), m_config.startup_threads, [this, &subscribers, &subscriberFuncMutex](size_t i) {
+            const auto &topic = m_config.topics[i];
+            // 原始CDR话题直接订阅序列化字节，其余使用订阅者函数
+            if (topic.encoding == kRawEncoding)
+            {
+                subscribers[i] = RawSubscriptionCallback(topic);
+                return;
+            }
+            std::unique_lock<std::mutex> lock(subscriberFuncMutex, std::defer_lock);
+            if (!m_concurrentSubscriberFunc)
+            {
+                lock.lock();
+            }
+            subscribers[i] = m_subscriberFunc(topic.topic_name);
+        });
+        for (size_t i = 0; i < subscribers.size(); ++i)
+        {
+            if (subscribers[i])
+            {
+                m_subscribers[m_config.topics[i].topic_name] = subscribers[i];
+            }
+        }
+
         return true;
     }
 
@@ -158,10 +214,37 @@ public:
      */
     std::shared_ptr<OpenbagSubscriberBase> DefaultSubscriptionCallback(const std::string &topic)
     {
-        auto subscriber = m_adapterFactory->CreateSubscriber<std::string>(topic, [this, topic](const std::string &data) {
+        auto callback = [this, topic](const std::string &data) {
             // 发送到缓冲区
             this->OnMessageReceived(topic, data);
+        };
+        // 直接传递字节的传输层优先，否则使用字符串订阅者
+        if (auto subscriber = m_adapterFactory->CreateBytesSubscriber(topic, callback))
+        {
+            return subscriber;
+        }
+        return m_adapterFactory->CreateSubscriber<std::string>(topic, callback);
+    }
+
+    /**
+     * @brief 原始CDR话题订阅者
+     * @param topic 话题信息(proto_type 为DDS类型名)
+     * @return 订阅者，传输层不支持时为空
+     */
+    std::shared_ptr<OpenbagSubscriberBase> RawSubscriptionCallback(const TopicInfo &topic)
+    {
+        if (!m_adapterFactory)
+        {
+            return nullptr;
+        }
+        const std::string topicName = topic.topic_name;
+        auto subscriber = m_adapterFactory->CreateRawSubscriber(topicName, topic.proto_type, [this, topicName](const std::string &data) {
+            this->OnMessageReceived(topicName, data);
         });
+        if (!subscriber)
+        {
+            std::cerr << "传输层不支持原始数据订阅，跳过话题: " << topicName << std::endl;
+        }
         return subscriber;
     }
 
@@ -379,7 +462,7 @@ private:
                     // 写入消息批次
                     try
                     {
-                        if (!m_storage->WriteMessageBatch(batch))
+                        if (!m_storage->WriteBatch(batch))
                         {
                             std::cerr << "写入消息批次失败" << std::endl;
                         } else if (!m_running)
@@ -393,7 +476,8 @@ private:
                     }
                 } else if (m_running)
                 {
-                    // 运行状态下没有消息时短暂休眠
+                    // 运行状态下没有消息时短暂休眠，并把已缓冲的数据写入文件
+                    m_storage->Flush();
                     std::this_thread::sleep_for(std::chrono::milliseconds(10));
                 }
             }
@@ -413,11 +497,12 @@ private:
     ConfigManager m_configManager;  ///< 配置管理器
     RecorderConfig m_config;        ///< 录制配置
     /**  */
-    MessageBufferPtr m_buffer;  ///< 消息缓冲区
-    StoragePtr m_storage;       ///< 存储接口
+    MessageBufferPtr m_buffer;    ///< 消息缓冲区
+    StorageBackendPtr m_storage;  ///< 存储后端
     /**  */
     MessageAdapterFactoryPtr m_adapterFactory;                            ///< 消息适配器工厂
     SubscriberFunc m_subscriberFunc;                                      ///< 订阅者函数
+    bool m_concurrentSubscriberFunc = false;                              ///< 订阅者函数是否可并发调用
     std::unordered_map<std::string, OpenbagSubscriberPtr> m_subscribers;  ///< 订阅者映射
     /**  */
     std::atomic<RecorderState> m_state{RecorderState::STOPPED};  ///< 录制状态
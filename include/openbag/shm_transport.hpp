@@ -0,0 +1,554 @@
+/**
+ * @copyright Copyright (c) 2025 openbag
+ *
+ * @author Zhao Jun(zwhy2025@gmail.com)
+ * @version 0.1
+ * @date 2025-05-22
+ *
+ * @file shm_transport.hpp
+ * @brief 基于POSIX共享内存环形缓冲区的本机消息传输
+ *
+ * 同一台机器上的普通进程不经过DDS，直接把序列化后的字节写入共享内存交给录制器，
+ * 回放时也可以发布到共享内存供本机进程读取。每个话题一个命名环形缓冲区(/dev/shm/<前缀>.<话题>)，
+ * 记录为变长帧，写入方之间用进程间互斥锁串行，读取方在环为空时在futex上等待，写入后按需唤醒。
+ *
+ * 限制: 每个环只允许一个读取方; 环满时新消息被丢弃并计数，不阻塞写入方。
+ */
+
+#pragma once
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "openbag/config.hpp"
+#include "openbag/transport.hpp"
+
+namespace openbag {
+
+/**
+ * @brief 共享内存环形缓冲区
+ *
+ * 读写位置单调递增，按容量(2的幂)取模得到偏移。
+ * 帧格式: [4字节长度][4字节类型][数据]，按8字节对齐; 帧放不下环尾时写一个填充帧后从头开始。
+ */
+class ShmRing
+{
+public:
+    static constexpr uint32_t kMagic = 0x4F425348;  ///< 头部标识 "OBSH"
+    static constexpr uint32_t kVersion = 1;         ///< 格式版本
+
+    ShmRing() = default;
+
+    ~ShmRing() { Close(); }
+
+    ShmRing(const ShmRing&) = delete;
+    ShmRing& operator=(const ShmRing&) = delete;
+
+    /**
+     * @brief 打开或创建环形缓冲区
+     * @param name 共享内存名称(以'/'开头)
+     * @param capacity 数据区容量，向上取整为2的幂; 环已存在时使用已有容量
+     * @return 是否成功
+     */
+    bool Open(const std::string& name, uint64_t capacity)
+    {
+        Close();
+        m_name = name;
+
+        capacity = RoundUpPowerOfTwo(capacity < 4096 ? 4096 : capacity);
+        int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0666);
+        if (fd >= 0)
+        {
+            // 由本进程创建: 设置大小并初始化头部，最后写入标识通知其他进程
+            const size_t size = DataOffset() + capacity;
+            if (ftruncate(fd, static_cast<off_t>(size)) != 0 || !Map(fd, size))
+            {
+                std::cerr << "创建共享内存失败: " << name << " " << std::strerror(errno) << std::endl;
+                ::close(fd);
+                shm_unlink(name.c_str());
+                return false;
+            }
+            ::close(fd);
+            InitHeader(capacity);
+            return true;
+        }
+        if (errno != EEXIST)
+        {
+            std::cerr << "创建共享内存失败: " << name << " " << std::strerror(errno) << std::endl;
+            return false;
+        }
+
+        fd = shm_open(name.c_str(), O_RDWR, 0666);
+        if (fd < 0)
+        {
+            std::cerr << "打开共享内存失败: " << name << " " << std::strerror(errno) << std::endl;
+            return false;
+        }
+
+        // 已有的环可能刚被其他进程创建，等待其完成初始化
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+        struct stat st{};
+        while (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) <= DataOffset() && std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        const bool mapped = static_cast<size_t>(st.st_size) > DataOffset() && Map(fd, static_cast<size_t>(st.st_size));
+        ::close(fd);
+        if (!mapped)
+        {
+            std::cerr << "打开共享内存失败: " << name << " 大小无效" << std::endl;
+            return false;
+        }
+        while (m_header->magic.load(std::memory_order_acquire) != kMagic && std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        if (m_header->magic.load(std::memory_order_acquire) != kMagic || m_header->version != kVersion ||
+            DataOffset() + m_header->capacity > m_mappedSize)
+        {
+            std::cerr << "打开共享内存失败: " << name << " 格式不兼容" << std::endl;
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief 解除映射(不删除共享内存，写入方和读取方可独立重启)
+     */
+    void Close()
+    {
+        if (m_header != nullptr)
+        {
+            munmap(m_header, m_mappedSize);
+            m_header = nullptr;
+            m_mappedSize = 0;
+        }
+    }
+
+    /**
+     * @brief 删除共享内存名称(已映射的进程不受影响)
+     * @param name 共享内存名称
+     */
+    static void Remove(const std::string& name) { shm_unlink(name.c_str()); }
+
+    /**
+     * @brief 是否已打开
+     */
+    bool IsOpen() const { return m_header != nullptr; }
+
+    /**
+     * @brief 获取共享内存名称
+     */
+    const std::string& GetName() const { return m_name; }
+
+    /**
+     * @brief 获取因环满被丢弃的消息数
+     */
+    uint64_t GetDroppedCount() const { return m_header ? m_header->dropped.load(std::memory_order_relaxed) : 0; }
+
+    /**
+     * @brief 写入一条消息，环满时丢弃
+     * @param data 数据
+     * @param size 字节数
+     * @return 是否写入
+     */
+    bool Write(const void* data, size_t size)
+    {
+        if (m_header == nullptr)
+        {
+            return false;
+        }
+
+        const uint64_t capacity = m_header->capacity;
+        const uint64_t total = Align(sizeof(FrameHeader) + size);
+        if (size > UINT32_MAX || total > capacity)
+        {
+            m_header->dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        if (!Lock())
+        {
+            return false;
+        }
+        uint64_t writePos = m_header->write_pos.load(std::memory_order_relaxed);
+        const uint64_t readPos = m_header->read_pos.load(std::memory_order_acquire);
+        uint64_t offset = writePos & (capacity - 1);
+        const uint64_t tail = capacity - offset;
+        const uint64_t needed = tail < total ? total + tail : total;
+        if (writePos + needed - readPos > capacity)
+        {
+            pthread_mutex_unlock(&m_header->write_mutex);
+            m_header->dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        if (tail < total)
+        {
+            // 环尾放不下，写填充帧后从头开始
+            FrameHeader padding{static_cast<uint32_t>(tail - sizeof(FrameHeader)), kFramePadding};
+            std::memcpy(Data() + offset, &padding, sizeof(padding));
+            writePos += tail;
+            offset = 0;
+        }
+        FrameHeader frame{static_cast<uint32_t>(size), kFrameData};
+        std::memcpy(Data() + offset, &frame, sizeof(frame));
+        std::memcpy(Data() + offset + sizeof(frame), data, size);
+        m_header->write_pos.store(writePos + total, std::memory_order_release);
+        pthread_mutex_unlock(&m_header->write_mutex);
+
+        // 序号变化后再唤醒，读取方在等待前读取序号，不会丢失唤醒
+        m_header->sequence.fetch_add(1);
+        if (m_header->waiting.load() != 0)
+        {
+            Futex(FUTEX_WAKE, INT_MAX, nullptr);
+        }
+        return true;
+    }
+
+    /**
+     * @brief 读取当前所有消息，环为空时等待
+     * @tparam Visitor 访问函数，签名为 void(const char* data, size_t size)，数据只在调用期间有效
+     * @param timeout_ms 环为空时的最长等待时间(毫秒)
+     * @param visitor 访问函数
+     * @return 读取的消息数
+     */
+    template <typename Visitor>
+    size_t Read(int timeout_ms, Visitor&& visitor)
+    {
+        if (m_header == nullptr)
+        {
+            return 0;
+        }
+
+        uint64_t readPos = m_header->read_pos.load(std::memory_order_relaxed);
+        uint64_t writePos = m_header->write_pos.load(std::memory_order_acquire);
+        if (readPos == writePos)
+        {
+            const uint32_t sequence = m_header->sequence.load(std::memory_order_acquire);
+            m_header->waiting.fetch_add(1);
+            if (m_header->write_pos.load() == readPos)
+            {
+                struct timespec timeout{timeout_ms / 1000, static_cast<long>(timeout_ms % 1000) * 1000000L};
+                Futex(FUTEX_WAIT, sequence, &timeout);
+            }
+            m_header->waiting.fetch_sub(1, std::memory_order_acq_rel);
+            return 0;
+        }
+
+        const uint64_t capacity = m_header->capacity;
+        const uint64_t mask = capacity - 1;
+        size_t count = 0;
+        while (readPos < writePos)
+        {
+            // 帧头来自其他进程，越过环尾或已发布的写位置时说明环已损坏，丢弃未读数据重新同步
+            FrameHeader frame;
+            const uint64_t offset = readPos & mask;
+            if (writePos - readPos < sizeof(frame) || offset + sizeof(frame) > capacity)
+            {
+                Resync(writePos);
+                return count;
+            }
+            std::memcpy(&frame, Data() + offset, sizeof(frame));
+            const uint64_t total = Align(sizeof(frame) + frame.size);
+            if ((frame.type != kFrameData && frame.type != kFramePadding) || total > capacity - offset || total > writePos - readPos)
+            {
+                Resync(writePos);
+                return count;
+            }
+            if (frame.type == kFrameData)
+            {
+                visitor(reinterpret_cast<const char*>(Data() + (readPos & mask) + sizeof(frame)), static_cast<size_t>(frame.size));
+                ++count;
+            }
+            readPos += total;
+            // 每条消息处理完立即释放空间
+            m_header->read_pos.store(readPos, std::memory_order_release);
+        }
+        return count;
+    }
+
+    /**
+     * @brief 唤醒等待中的读取方(用于停止读取线程)
+     */
+    void Wake()
+    {
+        if (m_header != nullptr)
+        {
+            m_header->sequence.fetch_add(1, std::memory_order_release);
+            Futex(FUTEX_WAKE, INT_MAX, nullptr);
+        }
+    }
+
+private:
+    /**
+     * @brief 环数据损坏时丢弃未读数据，从已发布的写位置继续读取
+     */
+    void Resync(uint64_t writePos)
+    {
+        std::cerr << "共享内存环数据损坏，丢弃未读消息: " << m_name << std::endl;
+        m_header->dropped.fetch_add(1, std::memory_order_relaxed);
+        m_header->read_pos.store(writePos, std::memory_order_release);
+    }
+
+    static constexpr uint32_t kFrameData = 1;     ///< 数据帧
+    static constexpr uint32_t kFramePadding = 2;  ///< 填充帧
+
+    /**
+     * @brief 帧头
+     */
+    struct FrameHeader
+    {
+        uint32_t size;  ///< 数据字节数
+        uint32_t type;  ///< 帧类型
+    };
+
+    /**
+     * @brief 共享内存头部，由创建方初始化
+     */
+    struct Header
+    {
+        std::atomic<uint32_t> magic;                  ///< 头部标识，初始化完成后写入
+        uint32_t version;                             ///< 格式版本
+        uint64_t capacity;                            ///< 数据区容量(2的幂)
+        pthread_mutex_t write_mutex;                  ///< 写入方互斥锁(进程间，健壮)
+        alignas(64) std::atomic<uint64_t> write_pos;  ///< 写位置
+        alignas(64) std::atomic<uint64_t> read_pos;   ///< 读位置
+        alignas(64) std::atomic<uint32_t> sequence;   ///< 写入序号(futex字)
+        std::atomic<uint32_t> waiting;                ///< 等待中的读取方数
+        std::atomic<uint64_t> dropped;                ///< 环满丢弃的消息数
+    };
+
+    static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free, "共享内存需要无锁原子类型");
+
+    static constexpr uint64_t Align(uint64_t size) { return (size + 7) & ~uint64_t(7); }
+
+    static constexpr size_t DataOffset() { return (sizeof(Header) + 63) & ~size_t(63); }
+
+    static uint64_t RoundUpPowerOfTwo(uint64_t value)
+    {
+        uint64_t result = 1;
+        while (result < value)
+        {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    uint8_t* Data() { return reinterpret_cast<uint8_t*>(m_header) + DataOffset(); }
+
+    bool Map(int fd, size_t size)
+    {
+        void* address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (address == MAP_FAILED)
+        {
+            return false;
+        }
+        m_header = static_cast<Header*>(address);
+        m_mappedSize = size;
+        return true;
+    }
+
+    void InitHeader(uint64_t capacity)
+    {
+        // ftruncate 后内存为全零，原子量零值即为初始状态
+        m_header->version = kVersion;
+        m_header->capacity = capacity;
+
+        pthread_mutexattr_t attr;
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+        pthread_mutex_init(&m_header->write_mutex, &attr);
+        pthread_mutexattr_destroy(&attr);
+
+        m_header->magic.store(kMagic, std::memory_order_release);
+    }
+
+    bool Lock()
+    {
+        const int result = pthread_mutex_lock(&m_header->write_mutex);
+        if (result == EOWNERDEAD)
+        {
+            // 持锁的写入方异常退出，未提交的帧不影响写位置，直接恢复
+            pthread_mutex_consistent(&m_header->write_mutex);
+            return true;
+        }
+        return result == 0;
+    }
+
+    void Futex(int op, uint32_t value, const struct timespec* timeout)
+    {
+        // 共享内存跨进程，不能使用 FUTEX_PRIVATE_FLAG
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&m_header->sequence), op, value, timeout, nullptr, 0);
+    }
+
+    std::string m_name;          ///< 共享内存名称
+    Header* m_header = nullptr;  ///< 映射的头部
+    size_t m_mappedSize = 0;     ///< 映射大小
+};
+
+/**
+ * @brief 共享内存订阅者，由专用线程读取环形缓冲区并调用回调
+ */
+class ShmSubscriberAdapter : public OpenbagSubscriberBase
+{
+public:
+    /**
+     * @brief 构造函数
+     * @param topic 话题名称
+     * @param ring 已打开的环形缓冲区
+     * @param callback 回调函数
+     */
+    ShmSubscriberAdapter(const std::string& topic, std::unique_ptr<ShmRing> ring, std::function<void(const std::string&)> callback)
+        : m_topic(topic), m_ring(std::move(ring)), m_callback(std::move(callback)), m_running(true)
+    {
+        m_thread = std::thread(&ShmSubscriberAdapter::ReadLoop, this);
+    }
+
+    ~ShmSubscriberAdapter() override
+    {
+        m_running = false;
+        m_ring->Wake();
+        if (m_thread.joinable())
+        {
+            m_thread.join();
+        }
+    }
+
+    /**
+     * @brief 获取订阅的话题名称
+     */
+    std::string GetTopicName() const override { return m_topic; }
+
+private:
+    void ReadLoop()
+    {
+        while (m_running)
+        {
+            m_ring->Read(100, [this](const char* data, size_t size) {
+                m_message.assign(data, size);
+                m_callback(m_message);
+            });
+        }
+    }
+
+    std::string m_topic;                               ///< 话题名称
+    std::unique_ptr<ShmRing> m_ring;                   ///< 环形缓冲区
+    std::function<void(const std::string&)> m_callback;  ///< 回调函数
+    std::string m_message;                             ///< 复用的消息缓冲
+    std::atomic<bool> m_running;                       ///< 线程运行标志
+    std::thread m_thread;                              ///< 读取线程
+};
+
+/**
+ * @brief 共享内存发布者
+ */
+class ShmPublisherAdapter : public OpenbagPublisherBase
+{
+public:
+    /**
+     * @brief 构造函数
+     * @param topic 话题名称
+     * @param ring 已打开的环形缓冲区
+     */
+    ShmPublisherAdapter(const std::string& topic, std::unique_ptr<ShmRing> ring) : m_topic(topic), m_ring(std::move(ring)) {}
+
+    /**
+     * @brief 获取发布的话题名称
+     */
+    std::string GetTopicName() const override { return m_topic; }
+
+    /**
+     * @brief 写入环形缓冲区，环满时返回false
+     * @param data 消息数据
+     */
+    bool Publish(const std::string& data) override { return m_ring->Write(data.data(), data.size()); }
+
+private:
+    std::string m_topic;              ///< 话题名称
+    std::unique_ptr<ShmRing> m_ring;  ///< 环形缓冲区
+};
+
+/**
+ * @brief 共享内存消息适配器工厂
+ *
+ * 消息按字节原样传递，不区分protobuf和原始CDR话题。
+ */
+class ShmAdapterFactory : public MessageAdapterFactory
+{
+public:
+    /**
+     * @brief 构造函数
+     * @param config 传输配置(使用其中的共享内存参数)
+     */
+    explicit ShmAdapterFactory(const TransportConfig& config = TransportConfig()) : m_config(config) {}
+
+    /**
+     * @brief 获取话题对应的共享内存名称，话题中的'/'替换为'_'
+     * @param topic 话题名称
+     * @return 共享内存名称
+     */
+    std::string RingName(const std::string& topic) const
+    {
+        std::string name = "/" + m_config.shm_prefix + ".";
+        for (char c : topic)
+        {
+            name.push_back(c == '/' ? '_' : c);
+        }
+        return name;
+    }
+
+    std::shared_ptr<OpenbagPublisherBase> CreatePublisher(const std::string& topic) override
+    {
+        auto ring = OpenRing(topic);
+        return ring ? std::make_shared<ShmPublisherAdapter>(topic, std::move(ring)) : nullptr;
+    }
+
+    std::shared_ptr<OpenbagSubscriberBase> CreateBytesSubscriber(const std::string& topic, std::function<void(const std::string&)> callback) override
+    {
+        auto ring = OpenRing(topic);
+        return ring ? std::make_shared<ShmSubscriberAdapter>(topic, std::move(ring), std::move(callback)) : nullptr;
+    }
+
+    std::shared_ptr<OpenbagSubscriberBase> CreateRawSubscriber(const std::string& topic, const std::string& typeName,
+                                                               std::function<void(const std::string&)> callback) override
+    {
+        return CreateBytesSubscriber(topic, std::move(callback));
+    }
+
+    std::shared_ptr<OpenbagPublisherBase> CreateRawPublisher(const std::string& topic, const std::string& typeName) override { return CreatePublisher(topic); }
+
+private:
+    std::unique_ptr<ShmRing> OpenRing(const std::string& topic) const
+    {
+        auto ring = std::make_unique<ShmRing>();
+        if (!ring->Open(RingName(topic), m_config.shm_ring_size))
+        {
+            return nullptr;
+        }
+        return ring;
+    }
+
+    TransportConfig m_config;  ///< 传输配置
+};
+
+}  // namespace openbag
@@ -6,7 +6,7 @@
  * @date 2025-05-22
  *
  * @file storage.hpp
- * @brief Protobuf MCAP存储实现
+ * @brief Protobuf MCAP存储实现(输出格式为 proto 时写入长度前缀的Protobuf流)
  */
 
 #pragma once
@@ -14,23 +14,38 @@
 #include <google/protobuf/compiler/importer.h>
 #include <google/protobuf/descriptor.h>
 
+#include <algorithm>
+#include <cctype>
+#include <chrono>
 #include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
 #include <mcap/mcap.hpp>
 #include <memory>
 #include <mutex>
+#include <span>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "common.hpp"
 #include "config.hpp"
+#include "openbag/catalog.hpp"
+#include "openbag/codec.hpp"
+#include "openbag/mirror_writable.hpp"
+#include "openbag/parallel_writer.hpp"
+#include "openbag/proto_stream.hpp"
 #include "openbag/proto_utils.hpp"
+#include "openbag/storage_backend.hpp"
+#include "openbag/stream_writable.hpp"
 
 namespace openbag {
 
 /**
- * @brief Protobuf MCAP存储实现类
+ * @brief Protobuf MCAP存储实现类(存储后端 mcap)
  */
-class Storage
+class Storage : public StorageBackend
 {
 public:
     /**
@@ -42,7 +57,7 @@ public:
     /**
      * @brief 析构函数
      */
-    ~Storage() { Close(); }
+    ~Storage() override { Close(); }
 
     bool GenFilename(FileInfo& fileInfo)
     {
@@ -59,6 +74,13 @@ public:
             }
 
             fileInfo.filename = fileInfo.output_path + GenerateUniqueFilename(fileInfo.prefix, fileInfo.extension);
+
+            // 同一秒内多次切分时文件名会重复，追加序号避免覆盖已有文件
+            const std::string baseName = fileInfo.filename.substr(0, fileInfo.filename.size() - fileInfo.extension.size() - 1);
+            for (int index = 1; std::filesystem::exists(fileInfo.filename); ++index)
+            {
+                fileInfo.filename = baseName + "_" + std::to_string(index) + "." + fileInfo.extension;
+            }
         }
         return true;
     }
@@ -91,31 +113,40 @@ public:
      * @param filename 文件名
      * @return 是否成功
      */
-    bool Open(FileInfo& fileInfo)
+    bool Open(FileInfo& fileInfo) override
     {
         if (m_fileInfo.is_open)
         {
             return false;
         }
 
-        if (!GenFilename(fileInfo))
+        if (IsStreaming())
         {
-            return false;
-        }
-        std::cout << "-------------------------------------------------------" << std::endl;
-        std::cout << "start bag file path: " << fileInfo.filename << std::endl;
-        std::cout << "-------------------------------------------------------" << std::endl;
-
-        std::filesystem::path filePath(fileInfo.filename);
+            // 流式输出不落盘，文件名记录输出目标
+            if (fileInfo.format != StorageFormat::MCAP)
+            {
+                std::cerr << "流式输出只支持MCAP格式" << std::endl;
+                return false;
+            }
+            fileInfo.filename = m_config.stream_target;
+            std::cerr << "start bag stream: " << fileInfo.filename << std::endl;  // 标准输出可能就是数据流
+        } else
+        {
+            if (!GenFilename(fileInfo))
+            {
+                return false;
+            }
+            std::cout << "-------------------------------------------------------" << std::endl;
+            std::cout << "start bag file path: " << fileInfo.filename << std::endl;
+            std::cout << "-------------------------------------------------------" << std::endl;
 
-        std::filesystem::create_directories(filePath.parent_path());
-        mcap::McapWriterOptions writerOptions = CreateWriterOptions();
+            std::filesystem::path filePath(fileInfo.filename);
 
-        // 创建MCAP写入器
-        m_writer = std::make_unique<mcap::McapWriter>();
+            std::filesystem::create_directories(filePath.parent_path());
+        }
 
-        // 打开文件
-        const auto status = m_writer->open(fileInfo.filename, writerOptions);
+        // 按输出格式创建写入器并打开文件
+        const auto status = OpenWriter(fileInfo);
         if (!status.ok())
         {
             return false;
@@ -125,13 +156,17 @@ public:
         fileInfo.file_size = 0;
         m_fileInfo = fileInfo;
         m_topicInfos.clear();
+        m_schemaIds.clear();
+        m_encoders.clear();
+        m_attachments.clear();
+        m_metadata.clear();
         return true;
     }
 
     /**
      * @brief 关闭存储
      */
-    void Close()
+    void Close() override
     {
         std::lock_guard<std::mutex> lock(m_mutex);
 
@@ -142,13 +177,20 @@ public:
 
         try
         {
-            if (m_writer)
+            if (m_writer || m_parallelWriter || m_streamWriter)
             {
-                // 首先调用close方法
-                m_writer->close();
+                // 首先写入去重统计，再调用close方法
+                WriteDedupMetadata();
+                WithWriter([](auto& writer) { writer.close(); });
+                const std::string closedFile = ClosedFilename();
 
-                // 然后重置指针
+                // 然后重置指针(写入器先于其输出的镜像释放)
                 m_writer.reset();
+                m_parallelWriter.reset();
+                m_streamWriter.reset();
+                m_mirror.reset();
+                m_streamSink.reset();
+                UpdateCatalog(closedFile);
             }
         } catch (const std::exception& e)
         {
@@ -159,6 +201,12 @@ public:
             std::cerr << "Unknown exception occurred while closing MCAP file" << std::endl;
         }
 
+        // 关闭后索引已完整，之后查询目录索引能看到本次录制的所有文件
+        if (m_catalogWriter)
+        {
+            m_catalogWriter->Wait();
+        }
+
         m_fileInfo.is_open = false;
         m_fileInfo.file_size = 0;
     }
@@ -180,8 +228,13 @@ public:
      * @param message_type 消息类型
      * @return 是否成功
      */
-    bool RegisterTopic(TopicInfo& topicInfo)
+    bool RegisterTopic(TopicInfo& topicInfo) override
     {
+        if (topicInfo.encoding == kRawEncoding)
+        {
+            return RegisterRawTopic(topicInfo);
+        }
+
         std::string protoFile = topicInfo.proto_file;
         if (!this->ImportProtoFile(protoFile))
         {
@@ -192,6 +245,177 @@ public:
         return RegisterTopicImpl(topicInfo);
     }
 
+    /**
+     * @brief 使用已有的模式数据注册主题（不经过proto导入器）
+     * @param topicInfo 话题信息，schema_encoding/schema_data 需已填充
+     * @return 是否成功
+     */
+    bool RegisterTopicWithSchema(TopicInfo& topicInfo)
+    {
+        if (topicInfo.schema_data.empty())
+        {
+            std::cerr << "注册话题失败: 模式数据为空: " << topicInfo.topic_name << std::endl;
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_fileInfo.is_open)
+        {
+            return false;
+        }
+        return RegisterTopicImpl(topicInfo);
+    }
+
+    /**
+     * @brief 注册原始CDR话题，模式为IDL文本(proto_file 字段为IDL文件路径)
+     *
+     * 没有IDL文件时模式编码为 openbag.typename，模式数据只有类型名，
+     * 避免通用工具把类型名当作 omgidl 文本解析。
+     *
+     * @param topicInfo 话题信息
+     * @return 是否成功
+     */
+    bool RegisterRawTopic(TopicInfo& topicInfo)
+    {
+        if (topicInfo.schema_data.empty())
+        {
+            if (topicInfo.proto_file.empty())
+            {
+                topicInfo.schema_encoding = kRawTypeNameSchemaEncoding;
+                topicInfo.schema_data = topicInfo.proto_type;
+            } else
+            {
+                std::ifstream file(topicInfo.proto_file, std::ios::binary);
+                if (!file)
+                {
+                    std::cerr << "注册话题失败: 无法读取IDL文件 " << topicInfo.proto_file << std::endl;
+                    return false;
+                }
+                topicInfo.schema_data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            }
+        }
+        return RegisterTopicWithSchema(topicInfo);
+    }
+
+    /**
+     * @brief 判断话题是否已注册
+     * @param topic 话题名称
+     * @return 是否已注册
+     */
+    bool HasTopic(const std::string& topic) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_topicInfos.find(topic) != m_topicInfos.end();
+    }
+
+    /**
+     * @brief 添加附件
+     *
+     * 附件以独立的 Attachment 记录写入(不进入消息块)，并登记到摘要的附件索引中，
+     * 读取端可直接按索引定位。切分文件时会重新写入新文件，使每个文件自包含。
+     *
+     * @param name 附件名称
+     * @param mediaType 媒体类型
+     * @param data 附件内容
+     * @param logTime 附件时间(纳秒)，0表示当前时间
+     * @return 是否成功
+     */
+    bool AddAttachment(const std::string& name, const std::string& mediaType, std::string data, uint64_t logTime = 0)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_fileInfo.is_open)
+        {
+            std::cerr << "添加附件失败: 存储未打开" << std::endl;
+            return false;
+        }
+
+        StoredAttachment attachment;
+        attachment.name = name;
+        attachment.mediaType = mediaType.empty() ? "application/octet-stream" : mediaType;
+        attachment.createTime = GetCurrentTimestampNs();
+        attachment.logTime = logTime == 0 ? attachment.createTime : logTime;
+        attachment.data = std::move(data);
+        if (!WriteAttachment(attachment))
+        {
+            return false;
+        }
+        m_attachments.push_back(std::move(attachment));
+        return true;
+    }
+
+    /**
+     * @brief 从文件添加附件
+     * @param info 附件信息，名称与媒体类型为空时按文件名推断
+     * @return 是否成功
+     */
+    bool AddAttachmentFile(const AttachmentInfo& info) override
+    {
+        std::ifstream file(info.path, std::ios::binary);
+        if (!file)
+        {
+            std::cerr << "添加附件失败: 无法读取文件 " << info.path << std::endl;
+            return false;
+        }
+        std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+        const std::string name = info.name.empty() ? std::filesystem::path(info.path).filename().string() : info.name;
+        const std::string mediaType = info.media_type.empty() ? GuessMediaType(info.path) : info.media_type;
+        return AddAttachment(name, mediaType, std::move(data));
+    }
+
+    /**
+     * @brief 判断附件是否已添加
+     * @param name 附件名称
+     * @return 是否已添加
+     */
+    bool HasAttachment(const std::string& name) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return std::any_of(m_attachments.begin(), m_attachments.end(), [&name](const StoredAttachment& attachment) { return attachment.name == name; });
+    }
+
+    /**
+     * @brief 添加元数据记录
+     *
+     * 元数据登记到摘要的元数据索引中，切分文件时会重新写入新文件。
+     *
+     * @param name 元数据名称
+     * @param values 键值对
+     * @return 是否成功
+     */
+    bool AddMetadata(const std::string& name, const mcap::KeyValueMap& values) override
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_fileInfo.is_open)
+        {
+            std::cerr << "添加元数据失败: 存储未打开" << std::endl;
+            return false;
+        }
+
+        mcap::Metadata metadata;
+        metadata.name = name;
+        metadata.metadata = values;
+        const auto status = WithWriter([&metadata](auto& writer) { return writer.write(metadata); });
+        if (!status.ok())
+        {
+            std::cerr << "写入元数据失败: " << name << " " << status.message << std::endl;
+            return false;
+        }
+        m_metadata.push_back(std::move(metadata));
+        return true;
+    }
+
+    /**
+     * @brief 判断元数据是否已添加
+     * @param name 元数据名称
+     * @return 是否已添加
+     */
+    bool HasMetadata(const std::string& name) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return std::any_of(m_metadata.begin(), m_metadata.end(), [&name](const mcap::Metadata& metadata) { return metadata.name == name; });
+    }
+
     /**
      * @brief 写入消息
      * @param message 消息指针
@@ -211,6 +435,7 @@ public:
         if (!result) return false;
 
         TrySplitFileIfNeeded();
+        CommitLive();
         return true;
     }
 
@@ -219,7 +444,7 @@ public:
      * @param messages 消息列表
      * @return 是否成功
      */
-    bool WriteMessageBatch(const std::vector<MessagePtr>& messages)
+    bool WriteMessageBatch(std::span<const MessagePtr> messages)
     {
         if (!m_fileInfo.is_open || messages.empty())
         {
@@ -241,9 +466,64 @@ public:
         }
 
         TrySplitFileIfNeeded();
+        CommitLive();
         return allSuccess;
     }
 
+    /**
+     * @brief 写入消息批次
+     * @param messages 消息列表
+     * @return 是否成功
+     */
+    bool WriteBatch(std::span<const MessagePtr> messages) override { return WriteMessageBatch(messages); }
+
+    /**
+     * @brief 实时落盘(配置了 live_flush_interval 时)，距上次落盘超过间隔则封闭当前块并写入文件
+     */
+    void Flush() override
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        CommitLive();
+    }
+
+    /**
+     * @brief 写入原始MCAP消息，保留原有纳秒时间戳与序列号
+     *
+     * 负载须为还原后的原始负载(见 Reader::ResolvePayload)，启用去重的话题在本存储中重新编码，
+     * 分割后的新文件从完整帧开始。
+     *
+     * @param topic 话题名称
+     * @param message MCAP消息，channelId 会被替换为本存储中该话题的通道ID
+     * @return 是否成功
+     */
+    bool WriteRawMessage(const std::string& topic, const mcap::Message& message)
+    {
+        if (!m_fileInfo.is_open)
+        {
+            std::cerr << "写入消息失败: 存储未打开" << std::endl;
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto it = m_topicInfos.find(topic);
+        if (it == m_topicInfos.end())
+        {
+            std::cerr << "写入消息失败: 找不到主题对应的Channel ID: " << topic << std::endl;
+            return false;
+        }
+
+        mcap::Message mcapMsg = message;
+        mcapMsg.channelId = it->second.channel_id;
+        if (!EncodeAndWriteMessage(topic, mcapMsg))
+        {
+            return false;
+        }
+
+        TrySplitFileIfNeeded();
+        return true;
+    }
+
     /**
      * @brief 读取消息
      * @param topic 话题名称，为空表示所有话题
@@ -261,7 +541,7 @@ public:
      * @brief 获取存储文件当前大小
      * @return 文件大小(字节)
      */
-    uint64_t GetFileSize() const { return m_fileInfo.file_size; }
+    uint64_t GetFileSize() const override { return m_fileInfo.file_size; }
 
     /**
      * @brief 获取话题列表
@@ -279,7 +559,12 @@ public:
     }
 
 private:
-    bool RegisterTopicImpl(TopicInfo& topicInfo)
+    /**
+     * @brief 通过proto导入器生成并缓存话题的模式数据
+     * @param topicInfo 话题信息
+     * @return 是否成功
+     */
+    bool BuildSchemaData(TopicInfo& topicInfo)
     {
         // 查找或创建消息类型描述符
         const google::protobuf::Descriptor* descriptor = (*m_importer)->pool()->FindMessageTypeByName(topicInfo.proto_type);
@@ -289,39 +574,71 @@ private:
             return false;
         }
 
-        // 构建文件描述符集
+        // 构建并序列化文件描述符集
         auto fileDescriptorSet = BuildFileDescriptorSet(descriptor);
-
-        // 添加Schema
-        mcap::Schema schema;
-        schema.name = topicInfo.proto_type;
-        schema.encoding = "protobuf";
-        schema.id = m_topicInfos.size() + 1;
-
-        // 序列化文件描述符集
-        std::string data;
-        if (!fileDescriptorSet.SerializeToString(&data))
+        if (!fileDescriptorSet.SerializeToString(&topicInfo.schema_data))
         {
             std::cerr << "序列化文件描述符集失败" << std::endl;
             return false;
         }
+        topicInfo.schema_encoding = "protobuf";
+        return true;
+    }
+
+    bool RegisterTopicImpl(TopicInfo& topicInfo)
+    {
+        // 切分文件时直接复用已缓存的模式数据
+        if (topicInfo.schema_data.empty() && !BuildSchemaData(topicInfo))
+        {
+            return false;
+        }
+
+        // 相同的模式只写入一次，多个话题共用同一Schema
+        const std::string schemaKey = topicInfo.proto_type + '\0' + topicInfo.schema_encoding + '\0' + topicInfo.schema_data;
+        auto schemaIt = m_schemaIds.find(schemaKey);
+
+        mcap::Schema schema;
+        if (schemaIt != m_schemaIds.end())
+        {
+            schema.id = schemaIt->second;
+        } else
+        {
+            schema.name = topicInfo.proto_type;
+            schema.encoding = topicInfo.schema_encoding;
 
-        // 设置schema数据
-        schema.data.assign(reinterpret_cast<const std::byte*>(data.data()), reinterpret_cast<const std::byte*>(data.data() + data.size()));
+            // 设置schema数据
+            const std::string& data = topicInfo.schema_data;
+            schema.data.assign(reinterpret_cast<const std::byte*>(data.data()), reinterpret_cast<const std::byte*>(data.data() + data.size()));
 
-        // 添加Schema
-        m_writer->addSchema(schema);
+            // 添加Schema，ID由写入器分配
+            WithWriter([&schema](auto& writer) { writer.addSchema(schema); });
+            m_schemaIds[schemaKey] = schema.id;
+        }
 
         // 添加Channel
         mcap::Channel channel;
         channel.topic = topicInfo.topic_name;
-        channel.messageEncoding = "protobuf";
+        channel.messageEncoding = topicInfo.encoding;
         channel.schemaId = schema.id;
         channel.id = topicInfo.channel_id;
         channel.metadata["message_type"] = topicInfo.proto_type;
+        if (PayloadEncoder::IsEnabled(topicInfo))
+        {
+            channel.metadata[kDedupMetadataKey] = DedupModeToString(topicInfo.dedup_mode);
+            if (topicInfo.delta_keyframe_interval > 0)
+            {
+                channel.metadata[kDeltaMetadataKey] = std::to_string(topicInfo.delta_keyframe_interval);
+            }
+            m_encoders.try_emplace(topicInfo.topic_name, topicInfo);
+        }
+        if (PayloadEncoder::IsFramed(topicInfo))
+        {
+            channel.messageEncoding = FramedEncoding(topicInfo.encoding);
+            channel.metadata[kFramingMetadataKey] = kFramingVersion;
+        }
 
         // 添加Channel
-        m_writer->addChannel(channel);
+        WithWriter([&channel](auto& writer) { writer.addChannel(channel); });
 
         topicInfo.schema_id = schema.id;
         topicInfo.channel_id = channel.id;
@@ -355,8 +672,321 @@ private:
         mcapMsg.data = reinterpret_cast<const std::byte*>(message->data.data());
         mcapMsg.dataSize = message->data.size();
 
+        return EncodeAndWriteMessage(message->topic, mcapMsg);
+    }
+
+    /**
+     * @brief 启用去重的话题先经过编码器，再写入MCAP消息
+     * @param topic 话题名称
+     * @param mcapMsg 负载为原始负载的MCAP消息，编码后 data 指向编码器缓冲区
+     * @return 是否成功(重复消息被跳过时也返回 true)
+     */
+    bool EncodeAndWriteMessage(const std::string& topic, mcap::Message& mcapMsg)
+    {
+        if (!m_encoders.empty())
+        {
+            auto encoderIt = m_encoders.find(topic);
+            if (encoderIt != m_encoders.end())
+            {
+                std::string_view payload;
+                if (!encoderIt->second.Encode(std::string_view(reinterpret_cast<const char*>(mcapMsg.data), mcapMsg.dataSize), mcapMsg.logTime, mcapMsg.sequence, payload))
+                {
+                    return true;  // 重复消息已跳过
+                }
+                mcapMsg.data = reinterpret_cast<const std::byte*>(payload.data());
+                mcapMsg.dataSize = payload.size();
+            }
+        }
+
+        return WriteMcapMessage(mcapMsg);
+    }
+
+    /**
+     * @brief 将当前文件中跳过的重复消息计数写入 metadata，并重置编码器
+     */
+    void WriteDedupMetadata()
+    {
+        mcap::Metadata metadata;
+        metadata.name = kDedupMetadataKey;
+        for (auto& [topic, encoder] : m_encoders)
+        {
+            if (encoder.GetSkipped() > 0)
+            {
+                metadata.metadata[topic] = std::to_string(encoder.GetSkipped());
+            }
+            encoder.Reset();
+        }
+
+        if (!metadata.metadata.empty())
+        {
+            const auto status = WithWriter([&metadata](auto& writer) { return writer.write(metadata); });
+            if (!status.ok())
+            {
+                std::cerr << "写入去重统计失败: " << status.message << std::endl;
+            }
+        }
+    }
+
+    /**
+     * @brief 已添加的附件
+     */
+    struct StoredAttachment
+    {
+        std::string name;         ///< 附件名称
+        std::string mediaType;    ///< 媒体类型
+        uint64_t logTime = 0;     ///< 附件时间
+        uint64_t createTime = 0;  ///< 创建时间
+        std::string data;         ///< 附件内容
+    };
+
+    bool WriteAttachment(const StoredAttachment& stored)
+    {
+        mcap::Attachment attachment;
+        attachment.name = stored.name;
+        attachment.mediaType = stored.mediaType;
+        attachment.logTime = stored.logTime;
+        attachment.createTime = stored.createTime;
+        attachment.dataSize = stored.data.size();
+        attachment.data = reinterpret_cast<const std::byte*>(stored.data.data());
+
+        // 附件不计入切分大小，避免大附件在每个新文件中反复触发切分
+        const auto status = WithWriter([&attachment](auto& writer) { return writer.write(attachment); });
+        if (!status.ok())
+        {
+            std::cerr << "写入附件失败: " << stored.name << " " << status.message << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief 按扩展名推断媒体类型
+     */
+    static std::string GuessMediaType(const std::string& path)
+    {
+        static const std::unordered_map<std::string, std::string> kMediaTypes = {
+            {".urdf", "application/xml"}, {".xml", "application/xml"}, {".yaml", "application/yaml"}, {".yml", "application/yaml"},
+            {".json", "application/json"}, {".txt", "text/plain"},     {".png", "image/png"},         {".jpg", "image/jpeg"},
+            {".jpeg", "image/jpeg"},       {".pgm", "image/x-portable-graymap"},
+        };
+        std::string extension = std::filesystem::path(path).extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return std::tolower(c); });
+        auto it = kMediaTypes.find(extension);
+        return it == kMediaTypes.end() ? "application/octet-stream" : it->second;
+    }
+
+    /**
+     * @brief 按文件格式创建写入器并打开文件
+     */
+    mcap::Status OpenWriter(const FileInfo& fileInfo)
+    {
+        m_liveChunkCount = 0;
+        m_lastLiveCommit = std::chrono::steady_clock::now();
+        if (fileInfo.format == StorageFormat::PROTOBUF)
+        {
+            m_writer.reset();
+            m_parallelWriter.reset();
+            m_mirror.reset();
+            if (!m_config.mirror_paths.empty())
+            {
+                std::cerr << "Protobuf流格式不支持镜像写入，只写入: " << fileInfo.filename << std::endl;
+            }
+            if (!m_streamWriter)
+            {
+                m_streamWriter = std::make_unique<ProtoStreamWriter>();
+            }
+            return m_streamWriter->open(fileInfo.filename);
+        }
+
+        m_streamWriter.reset();
+        if (m_config.compression_threads > 1)
+        {
+            // 多线程压缩块，写入线程只负责序列化和按序写出
+            m_writer.reset();
+            if (!m_parallelWriter)
+            {
+                m_parallelWriter = std::make_unique<ParallelMcapWriter>(m_config.compression_threads);
+            }
+        } else
+        {
+            m_parallelWriter.reset();
+            if (!m_writer)
+            {
+                m_writer = std::make_unique<mcap::McapWriter>();
+            }
+        }
+        if (IsStreaming())
+        {
+            if (!m_config.mirror_paths.empty())
+            {
+                std::cerr << "流式输出忽略镜像配置" << std::endl;
+            }
+            m_streamSink = std::make_unique<StreamWritable>(m_config.stream_target, m_config.stream_queue_size);
+            if (!m_streamSink->Open())
+            {
+                m_streamSink.reset();
+                return mcap::Status(mcap::StatusCode::OpenFailed, "failed to open stream " + m_config.stream_target);
+            }
+            WithMcapWriter([this](auto& writer) { writer.open(*m_streamSink, CreateWriterOptions()); });
+            return mcap::Status();
+        }
+        if (m_config.mirror_paths.empty())
+        {
+            return WithMcapWriter([&](auto& writer) { return writer.open(fileInfo.filename, CreateWriterOptions()); });
+        }
+
+        // 镜像写入: 块只构建、压缩一次，由各镜像的I/O线程分别写入
+        m_mirror = std::make_unique<MirrorWritable>(MirrorFilenames(fileInfo.filename), m_config.mirror_queue_size);
+        if (!m_mirror->Open())
+        {
+            m_mirror.reset();
+            return mcap::Status(mcap::StatusCode::OpenFailed, "failed to open any mirror of " + fileInfo.filename);
+        }
+        WithMcapWriter([this](auto& writer) { writer.open(*m_mirror, CreateWriterOptions()); });
+        return mcap::Status();
+    }
+
+    /**
+     * @brief 实时落盘: 写出了新块时把写缓冲写入文件，使跟随读取器尽快看到完整的块(流式输出总是按块发送)
+     */
+    void CommitLive()
+    {
+        if ((m_config.live_flush_interval == 0 && !m_streamSink) || !m_fileInfo.is_open)
+        {
+            return;
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        const bool due = m_config.live_flush_interval > 0 && now - m_lastLiveCommit >= std::chrono::milliseconds(m_config.live_flush_interval);
+        if (m_streamWriter)
+        {
+            if (due)
+            {
+                m_streamWriter->Flush();
+                m_lastLiveCommit = now;
+            }
+            return;
+        }
+        if (!m_writer && !m_parallelWriter)
+        {
+            return;
+        }
+
+        // 写满的块由写入器自动写出，只需落盘；数据较少时按间隔提前封闭当前块
+        const bool newChunk = WithMcapWriter([](auto& writer) { return writer.statistics().chunkCount; }) != m_liveChunkCount;
+        if (!newChunk && !due)
+        {
+            return;
+        }
+        if (due)
+        {
+            WithMcapWriter([](auto& writer) { writer.closeLastChunk(); });
+        }
+        if (m_streamSink)
+        {
+            m_streamSink->Flush();
+        } else if (m_mirror)
+        {
+            m_mirror->Flush();
+        } else if (auto* fileWriter = dynamic_cast<mcap::FileWriter*>(WithMcapWriter([](auto& writer) { return writer.dataSink(); })))
+        {
+            fileWriter->flush();
+        }
+        m_liveChunkCount = WithMcapWriter([](auto& writer) { return writer.statistics().chunkCount; });
+        m_lastLiveCommit = now;
+    }
+
+    /**
+     * @brief 是否流式输出(不写文件)
+     */
+    bool IsStreaming() const { return !m_config.stream_target.empty(); }
+
+    /**
+     * @brief 镜像文件路径: 输出文件本身加上每个镜像目录下的同名文件
+     */
+    std::vector<std::string> MirrorFilenames(const std::string& filename) const
+    {
+        std::vector<std::string> filenames{filename};
+        const std::string basename = std::filesystem::path(filename).filename().string();
+        for (const auto& path : m_config.mirror_paths)
+        {
+            filenames.push_back((std::filesystem::path(path) / basename).string());
+        }
+        return filenames;
+    }
+
+    /**
+     * @brief 在当前使用的MCAP写入器(单线程或多线程压缩)上执行操作，两种写入器的接口相同
+     */
+    template <typename Func>
+    auto WithMcapWriter(Func&& func) -> decltype(func(std::declval<mcap::McapWriter&>()))
+    {
+        return m_parallelWriter ? func(*m_parallelWriter) : func(*m_writer);
+    }
+
+    /**
+     * @brief 在当前使用的写入器上执行操作，各写入器的接口相同
+     */
+    template <typename Func>
+    auto WithWriter(Func&& func) -> decltype(func(std::declval<mcap::McapWriter&>()))
+    {
+        return m_streamWriter ? func(*m_streamWriter) : WithMcapWriter(std::forward<Func>(func));
+    }
+
+    /**
+     * @brief 刚关闭的文件中完整可用的一个(须在写入器关闭后调用)
+     *
+     * 主文件降级后已改名为 .incomplete，此时返回完整的镜像；所有镜像都降级时返回空。
+     */
+    std::string ClosedFilename() const
+    {
+        if (!m_mirror)
+        {
+            return m_fileInfo.filename;
+        }
+
+        std::string filename = m_mirror->CompletePath();
+        if (filename.empty())
+        {
+            std::cerr << "文件的所有镜像均未完整写出: " << m_fileInfo.filename << std::endl;
+        } else if (filename != m_fileInfo.filename)
+        {
+            std::cerr << "主文件未完整写出，使用镜像: " << filename << std::endl;
+        }
+        return filename;
+    }
+
+    /**
+     * @brief 将刚关闭的文件交给后台线程追加到目录索引(目录索引只收录MCAP文件)
+     * @param filename 文件路径，为空时(没有完整的文件)不追加
+     */
+    void UpdateCatalog(const std::string& filename)
+    {
+        if (!filename.empty() && !m_config.catalog_path.empty() && m_fileInfo.format == StorageFormat::MCAP && !IsStreaming())
+        {
+            if (!m_catalogWriter)
+            {
+                m_catalogWriter = std::make_unique<CatalogWriter>(m_config.catalog_path);
+            }
+            m_catalogWriter->Add(filename);
+        }
+    }
+
+    bool WriteMcapMessage(const mcap::Message& mcapMsg)
+    {
+        if (m_mirror && m_mirror->HealthyCount() == 0)
+        {
+            std::cerr << "写入MCAP消息失败: 所有镜像均已降级" << std::endl;
+            return false;
+        }
+        if (m_streamSink && m_streamSink->IsBroken())
+        {
+            std::cerr << "写入MCAP消息失败: 流式输出已断开" << std::endl;
+            return false;
+        }
+
         // 写入消息
-        const auto status = m_writer->write(mcapMsg);
+        const auto status = WithWriter([&mcapMsg](auto& writer) { return writer.write(mcapMsg); });
         if (!status.ok())
         {
             std::cerr << "写入MCAP消息失败: " << status.message << std::endl;
@@ -372,11 +1002,13 @@ private:
 
     void TrySplitFileIfNeeded()
     {
-        if (m_config.split_by_size && m_fileInfo.file_size >= m_config.max_file_size)
+        if (m_config.split_by_size && !IsStreaming() && m_fileInfo.file_size >= m_config.max_file_size)
         {
             std::cout << "文件大小超过限制，创建新文件..." << std::endl;
-            // 关闭当前文件
-            m_writer->close();
+            // 关闭当前文件，新文件从完整帧重新开始
+            WriteDedupMetadata();
+            WithWriter([](auto& writer) { writer.close(); });
+            UpdateCatalog(ClosedFilename());
 
             FileInfo newFileInfo(m_fileInfo);
             if (!GenFilename(newFileInfo))
@@ -384,11 +1016,10 @@ private:
                 return;
             }
 
-            auto writerOptions = CreateWriterOptions();
-            const auto openStatus = m_writer->open(newFileInfo.filename, writerOptions);
+            const auto openStatus = OpenWriter(newFileInfo);
             if (!openStatus.ok())
             {
-                throw std::runtime_error("Failed to open new MCAP file: " + openStatus.message);
+                throw std::runtime_error("Failed to open new storage file: " + openStatus.message);
             }
 
             m_fileInfo = newFileInfo;
@@ -396,10 +1027,21 @@ private:
             m_fileInfo.is_open = true;
 
             // 重新注册所有主题和消息类型
+            m_schemaIds.clear();
             for (auto& [topic, info] : m_topicInfos)
             {
                 RegisterTopicImpl(info);
             }
+
+            // 重新写入附件和元数据
+            for (const auto& attachment : m_attachments)
+            {
+                WriteAttachment(attachment);
+            }
+            for (const auto& metadata : m_metadata)
+            {
+                WithWriter([&metadata](auto& writer) { return writer.write(metadata); });
+            }
         }
     }
 
@@ -407,12 +1049,149 @@ private:
     FileInfo m_fileInfo;
     StorageConfig m_config;                      ///< 配置
     std::unique_ptr<mcap::McapWriter> m_writer;  ///< MCAP写入器
+    std::unique_ptr<ParallelMcapWriter> m_parallelWriter;    ///< 多线程压缩的MCAP写入器(compression_threads 大于1时)
+    std::unique_ptr<ProtoStreamWriter> m_streamWriter;       ///< Protobuf流写入器(输出格式为 proto 时)
+    std::unique_ptr<MirrorWritable> m_mirror;                ///< 镜像写入目标(配置了镜像目录时)
+    std::unique_ptr<StreamWritable> m_streamSink;            ///< 流式输出目标(stream 后端)
+    std::unique_ptr<CatalogWriter> m_catalogWriter;          ///< 后台追加目录索引(配置了索引文件时)
+    uint32_t m_liveChunkCount = 0;                           ///< 上次实时落盘时已写出的块数
+    std::chrono::steady_clock::time_point m_lastLiveCommit;  ///< 上次实时落盘时间
 
     std::unordered_map<std::string, TopicInfo> m_topicInfos;  ///< 话题信息映射
+    std::unordered_map<std::string, mcap::SchemaId> m_schemaIds;  ///< 当前文件中已写入的模式
+    std::unordered_map<std::string, PayloadEncoder> m_encoders;   ///< 启用去重的话题编码器
+    std::vector<StoredAttachment> m_attachments;                  ///< 已添加的附件
+    std::vector<mcap::Metadata> m_metadata;                       ///< 已添加的元数据
     std::unique_ptr<ProtoImporterWrapper> m_importer;
     mutable std::mutex m_mutex;  ///< 互斥锁
 };
 
 using StoragePtr = std::shared_ptr<Storage>;
 
+/**
+ * @brief 存储后端注册表，按 storage.yaml 中的 backend 名称创建后端
+ *
+ * 内置 mcap、null、tee 三种后端，自定义后端在创建录制器之前调用 Register 注册。
+ */
+class StorageBackendRegistry
+{
+public:
+    using Creator = std::function<StorageBackendPtr(const StorageConfig&)>;
+
+    /**
+     * @brief 注册后端，同名时覆盖
+     * @param name 后端名称
+     * @param creator 创建函数
+     */
+    static void Register(const std::string& name, Creator creator)
+    {
+        std::lock_guard<std::mutex> lock(Mutex());
+        Creators()[name] = std::move(creator);
+    }
+
+    /**
+     * @brief 按配置中的后端名称创建后端
+     * @param config 存储配置
+     * @return 后端，名称未注册或创建失败时为空
+     */
+    static StorageBackendPtr Create(const StorageConfig& config) { return Create(config.backend, config); }
+
+    /**
+     * @brief 按名称创建后端
+     * @param name 后端名称
+     * @param config 存储配置
+     * @return 后端，名称未注册或创建失败时为空
+     */
+    static StorageBackendPtr Create(const std::string& name, const StorageConfig& config)
+    {
+        Creator creator;
+        {
+            std::lock_guard<std::mutex> lock(Mutex());
+            auto it = Creators().find(name);
+            if (it == Creators().end())
+            {
+                std::cerr << "未知的存储后端: " << name << std::endl;
+                return nullptr;
+            }
+            creator = it->second;
+        }
+        return creator(config);
+    }
+
+    /**
+     * @brief 获取已注册的后端名称
+     */
+    static std::vector<std::string> Names()
+    {
+        std::lock_guard<std::mutex> lock(Mutex());
+        std::vector<std::string> names;
+        for (const auto& [name, _] : Creators())
+        {
+            names.push_back(name);
+        }
+        std::sort(names.begin(), names.end());
+        return names;
+    }
+
+private:
+    static std::mutex& Mutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    static std::unordered_map<std::string, Creator>& Creators()
+    {
+        static std::unordered_map<std::string, Creator> creators = {
+            {"mcap", CreateFile},
+            {"null", [](const StorageConfig&) { return std::make_shared<NullStorageBackend>(); }},
+            {"stream", CreateStream},
+            {"tee", CreateTee},
+        };
+        return creators;
+    }
+
+    static StorageBackendPtr CreateFile(const StorageConfig& config)
+    {
+        StorageConfig fileConfig(config);
+        fileConfig.stream_target.clear();  // 流式输出目标只属于 stream 后端
+        return std::make_shared<Storage>(fileConfig);
+    }
+
+    static StorageBackendPtr CreateStream(const StorageConfig& config)
+    {
+        if (config.stream_target.empty())
+        {
+            std::cerr << "流式输出后端缺少 stream.target 配置" << std::endl;
+            return nullptr;
+        }
+        return std::make_shared<Storage>(config);
+    }
+
+    static StorageBackendPtr CreateTee(const StorageConfig& config)
+    {
+        std::vector<TeeStorageBackend::Target> targets;
+        for (const auto& teeTarget : config.tee_targets)
+        {
+            if (teeTarget.backend == "tee")
+            {
+                std::cerr << "多路存储不能嵌套" << std::endl;
+                return nullptr;
+            }
+            auto backend = Create(teeTarget.backend, config);
+            if (!backend)
+            {
+                return nullptr;
+            }
+            targets.push_back({std::move(backend), teeTarget.output_path});
+        }
+        if (targets.empty())
+        {
+            std::cerr << "多路存储未配置子后端(tee)" << std::endl;
+            return nullptr;
+        }
+        return std::make_shared<TeeStorageBackend>(std::move(targets));
+    }
+};
+
 }  // namespace openbag
\ No newline at end of file
@@ -0,0 +1,257 @@
+/**
+ * @copyright Copyright (c) 2025 openbag
+ *
+ * @author Zhao Jun(zwhy2025@gmail.com)
+ * @version 0.1
+ * @date 2025-05-22
+ *
+ * @file storage_backend.hpp
+ * @brief 存储后端接口，以及空后端和多路后端
+ *
+ * 录制器只通过 StorageBackend 接口写入，具体后端按 storage.yaml 的 backend 名称
+ * 从 StorageBackendRegistry 创建(见 storage.hpp)：
+ * - mcap: 写文件(Storage，格式按录制配置的 output_format)
+ * - null: 丢弃消息只计数，用于测量订阅和缓冲等上游环节的吞吐上限
+ * - stream: 把MCAP写入标准输出、命名管道或Unix域套接字(Storage + StreamWritable)
+ * - tee: 同时写入多个后端，如两块磁盘各写一份
+ */
+
+#pragma once
+
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "openbag/common.hpp"
+
+namespace openbag {
+
+/**
+ * @brief 存储后端接口
+ */
+class StorageBackend
+{
+public:
+    virtual ~StorageBackend() = default;
+
+    /**
+     * @brief 打开存储
+     * @param fileInfo 文件信息，成功后填充实际文件名
+     * @return 是否成功
+     */
+    virtual bool Open(FileInfo& fileInfo) = 0;
+
+    /**
+     * @brief 关闭存储
+     */
+    virtual void Close() = 0;
+
+    /**
+     * @brief 注册话题和消息类型
+     * @param topicInfo 话题信息
+     * @return 是否成功
+     */
+    virtual bool RegisterTopic(TopicInfo& topicInfo) = 0;
+
+    /**
+     * @brief 从文件添加附件
+     * @param info 附件信息
+     * @return 是否成功
+     */
+    virtual bool AddAttachmentFile(const AttachmentInfo& info) = 0;
+
+    /**
+     * @brief 添加元数据记录
+     * @param name 元数据名称
+     * @param values 键值对
+     * @return 是否成功
+     */
+    virtual bool AddMetadata(const std::string& name, const mcap::KeyValueMap& values) = 0;
+
+    /**
+     * @brief 写入一批消息
+     * @param messages 消息列表
+     * @return 是否全部成功
+     */
+    virtual bool WriteBatch(std::span<const MessagePtr> messages) = 0;
+
+    /**
+     * @brief 获取当前文件大小
+     * @return 文件大小(字节)
+     */
+    virtual uint64_t GetFileSize() const = 0;
+
+    /**
+     * @brief 空闲时调用，把已缓冲的数据写入文件(供跟随读取)，默认不做任何事
+     */
+    virtual void Flush() {}
+};
+
+using StorageBackendPtr = std::shared_ptr<StorageBackend>;
+
+/**
+ * @brief 空后端: 丢弃所有消息，只统计消息数和字节数
+ */
+class NullStorageBackend : public StorageBackend
+{
+public:
+    bool Open(FileInfo& fileInfo) override
+    {
+        fileInfo.is_open = true;
+        m_messages = 0;
+        m_bytes = 0;
+        return true;
+    }
+
+    void Close() override {}
+
+    bool RegisterTopic(TopicInfo& topicInfo) override { return true; }
+
+    bool AddAttachmentFile(const AttachmentInfo& info) override { return true; }
+
+    bool AddMetadata(const std::string& name, const mcap::KeyValueMap& values) override { return true; }
+
+    bool WriteBatch(std::span<const MessagePtr> messages) override
+    {
+        uint64_t bytes = 0;
+        for (const auto& message : messages)
+        {
+            if (message)
+            {
+                bytes += message->data.size();
+            }
+        }
+        m_messages += messages.size();
+        m_bytes += bytes;
+        return true;
+    }
+
+    uint64_t GetFileSize() const override { return m_bytes; }
+
+    /**
+     * @brief 获取已丢弃的消息数
+     */
+    uint64_t GetMessageCount() const { return m_messages; }
+
+private:
+    std::atomic<uint64_t> m_messages{0};  ///< 消息数
+    std::atomic<uint64_t> m_bytes{0};     ///< 负载字节数
+};
+
+/**
+ * @brief 多路后端: 每个操作依次转发给所有子后端，任一失败即返回失败
+ */
+class TeeStorageBackend : public StorageBackend
+{
+public:
+    /**
+     * @brief 子后端及其输出路径
+     */
+    struct Target
+    {
+        StorageBackendPtr backend;  ///< 子后端
+        std::string output_path;    ///< 输出路径，为空时沿用录制配置的路径
+    };
+
+    /**
+     * @brief 构造函数
+     * @param targets 子后端
+     */
+    explicit TeeStorageBackend(std::vector<Target> targets) : m_targets(std::move(targets)) {}
+
+    ~TeeStorageBackend() override { Close(); }
+
+    bool Open(FileInfo& fileInfo) override
+    {
+        for (size_t i = 0; i < m_targets.size(); ++i)
+        {
+            FileInfo targetInfo(fileInfo);
+            if (!m_targets[i].output_path.empty())
+            {
+                targetInfo.output_path = m_targets[i].output_path;
+            }
+            if (!m_targets[i].backend->Open(targetInfo))
+            {
+                std::cerr << "多路存储打开失败: 第 " << i + 1 << " 路" << std::endl;
+                for (size_t j = 0; j < i; ++j)
+                {
+                    m_targets[j].backend->Close();
+                }
+                return false;
+            }
+            if (i == 0)
+            {
+                fileInfo = targetInfo;
+            }
+        }
+        m_open = !m_targets.empty();
+        return m_open;
+    }
+
+    void Close() override
+    {
+        if (!m_open)
+        {
+            return;
+        }
+        for (auto& target : m_targets)
+        {
+            target.backend->Close();
+        }
+        m_open = false;
+    }
+
+    bool RegisterTopic(TopicInfo& topicInfo) override
+    {
+        return ForEach([&topicInfo](StorageBackend& backend) {
+            TopicInfo targetInfo(topicInfo);  // 各后端分配各自的通道ID
+            return backend.RegisterTopic(targetInfo);
+        });
+    }
+
+    bool AddAttachmentFile(const AttachmentInfo& info) override
+    {
+        return ForEach([&info](StorageBackend& backend) { return backend.AddAttachmentFile(info); });
+    }
+
+    bool AddMetadata(const std::string& name, const mcap::KeyValueMap& values) override
+    {
+        return ForEach([&name, &values](StorageBackend& backend) { return backend.AddMetadata(name, values); });
+    }
+
+    bool WriteBatch(std::span<const MessagePtr> messages) override
+    {
+        return ForEach([messages](StorageBackend& backend) { return backend.WriteBatch(messages); });
+    }
+
+    uint64_t GetFileSize() const override { return m_targets.empty() ? 0 : m_targets.front().backend->GetFileSize(); }
+
+    void Flush() override
+    {
+        for (auto& target : m_targets)
+        {
+            target.backend->Flush();
+        }
+    }
+
+private:
+    template <typename Func>
+    bool ForEach(Func&& func)
+    {
+        bool success = true;
+        for (auto& target : m_targets)
+        {
+            success = func(*target.backend) && success;
+        }
+        return success;
+    }
+
+    std::vector<Target> m_targets;  ///< 子后端
+    bool m_open = false;            ///< 是否已打开
+};
+
+}  // namespace openbag
@@ -0,0 +1,451 @@
+/**
+ * @copyright Copyright (c) 2025 openbag
+ *
+ * @author Zhao Jun(zwhy2025@gmail.com)
+ * @version 0.1
+ * @date 2025-05-22
+ *
+ * @file stream_writable.hpp
+ * @brief 流式输出: 把 MCAP 写入标准输出、命名管道或 Unix 域套接字，供本机的下游进程实时处理
+ *
+ * 输出目标:
+ * - "-": 标准输出。进程须在启动时(输出任何日志之前)调用 StreamWritable::ReserveStdout 预留标准输出，
+ *        之后的日志输出(std::cout)都写到标准错误，避免混入数据流
+ * - "unix:<路径>": 连接到下游进程监听的 Unix 域套接字
+ * - 其他: 命名管道路径，不存在时创建，打开时等待读端
+ *
+ * 写入器输出的字节按 kBlockSize 聚成块，由独立的I/O线程写出；Storage 在每个块写出后调用 Flush，
+ * 下游总能及时收到完整的块。写队列满时写入线程等待，下游的处理速度通过录制缓冲区向上游反压。
+ * 块在页对齐的匿名映射内存中聚合。输出是管道时用 vmsplice 把块所在的内存页直接挂入管道，
+ * 省去一次拷贝，随后立即 munmap：管道持有这些页的引用，页在下游读走之前不会被释放或复用，
+ * 本进程也不会再写入它们。其他输出用普通 write/send。
+ */
+
+#pragma once
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mcap/mcap.hpp>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+namespace openbag {
+
+constexpr const char* kStreamStdout = "-";          ///< 输出到标准输出
+constexpr const char* kStreamUnixPrefix = "unix:";  ///< Unix 域套接字目标前缀
+constexpr size_t kStreamBlockSize = 1024 * 1024;    ///< 聚合块大小
+
+/**
+ * @brief 页对齐的匿名映射内存块，容量不足时以 mremap 扩展
+ */
+class StreamBlock
+{
+public:
+    StreamBlock() = default;
+    ~StreamBlock() { Release(); }
+
+    StreamBlock(const StreamBlock&) = delete;
+    StreamBlock& operator=(const StreamBlock&) = delete;
+
+    /**
+     * @brief 追加数据
+     * @return 是否成功(映射内存失败时返回false)
+     */
+    bool Append(const void* data, size_t size)
+    {
+        if (m_size + size > m_capacity)
+        {
+            const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+            const size_t capacity = (std::max(m_size + size, kStreamBlockSize) + page - 1) / page * page;
+            void* mapped = m_data ? ::mremap(m_data, m_capacity, capacity, MREMAP_MAYMOVE) : ::mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (mapped == MAP_FAILED)
+            {
+                return false;
+            }
+            m_data = static_cast<char*>(mapped);
+            m_capacity = capacity;
+        }
+        std::memcpy(m_data + m_size, data, size);
+        m_size += size;
+        return true;
+    }
+
+    /**
+     * @brief 解除映射(vmsplice 之后调用，管道持有的页引用使数据在读走前保持有效)
+     */
+    void Release()
+    {
+        if (m_data)
+        {
+            ::munmap(m_data, m_capacity);
+            m_data = nullptr;
+        }
+        m_capacity = 0;
+    }
+
+    const char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+private:
+    char* m_data = nullptr;  ///< 映射内存
+    size_t m_size = 0;       ///< 数据长度
+    size_t m_capacity = 0;   ///< 映射长度
+};
+
+/**
+ * @brief 流式输出目标
+ */
+class StreamWritable : public mcap::IWritable
+{
+public:
+    static constexpr size_t kBlockSize = kStreamBlockSize;  ///< 聚合块大小
+    static constexpr int kPipeSize = 1024 * 1024;          ///< 尝试设置的管道容量
+
+    /**
+     * @brief 构造函数
+     * @param target 输出目标
+     * @param maxQueueBytes 写队列上限(字节)
+     */
+    StreamWritable(std::string target, uint64_t maxQueueBytes) : m_target(std::move(target)), m_maxQueueBytes(maxQueueBytes) {}
+
+    ~StreamWritable() override { end(); }
+
+    /**
+     * @brief 预留标准输出给数据流，并把进程的标准输出改写到标准错误
+     *
+     * 须在进程启动时、输出任何日志之前调用。不刷新标准输出的缓冲区，
+     * 此前缓冲的内容随重定向写到标准错误，不会混入数据流。
+     *
+     * @return 是否成功
+     */
+    static bool ReserveStdout()
+    {
+        int& fd = ReservedStdout();
+        if (fd >= 0)
+        {
+            return true;
+        }
+        fd = ::fcntl(STDOUT_FILENO, F_DUPFD_CLOEXEC, 0);
+        if (fd < 0 || ::dup2(STDERR_FILENO, STDOUT_FILENO) < 0)
+        {
+            std::cerr << "预留标准输出失败: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief 打开输出目标并启动I/O线程
+     * @return 是否成功
+     */
+    bool Open()
+    {
+        if (m_target == kStreamStdout)
+        {
+            if (ReservedStdout() < 0)
+            {
+                std::cerr << "输出到标准输出须先在进程启动时调用 StreamWritable::ReserveStdout" << std::endl;
+                return false;
+            }
+            m_fd = ::fcntl(ReservedStdout(), F_DUPFD_CLOEXEC, 0);
+        } else if (m_target.rfind(kStreamUnixPrefix, 0) == 0)
+        {
+            m_fd = ConnectUnix(m_target.substr(std::strlen(kStreamUnixPrefix)));
+        } else
+        {
+            if (::access(m_target.c_str(), F_OK) != 0 && ::mkfifo(m_target.c_str(), 0644) != 0)
+            {
+                std::cerr << "创建命名管道失败: " << m_target << " " << std::strerror(errno) << std::endl;
+                return false;
+            }
+            std::cout << "等待读端打开命名管道: " << m_target << std::endl;
+            m_fd = ::open(m_target.c_str(), O_WRONLY | O_CLOEXEC);
+        }
+
+        if (m_fd < 0)
+        {
+            std::cerr << "打开流式输出失败: " << m_target << " " << std::strerror(errno) << std::endl;
+            return false;
+        }
+
+        struct stat st;
+        if (::fstat(m_fd, &st) == 0 && S_ISFIFO(st.st_mode))
+        {
+            m_mode = Mode::Splice;
+            ::fcntl(m_fd, F_SETPIPE_SZ, kPipeSize);
+        } else if (S_ISSOCK(st.st_mode))
+        {
+            m_mode = Mode::Socket;
+        }
+
+        m_thread = std::thread(&StreamWritable::IoLoop, this);
+        return true;
+    }
+
+    /**
+     * @brief 写入数据(由 mcap::IWritable::write 调用)
+     */
+    void handleWrite(const std::byte* data, uint64_t size) override
+    {
+        m_size += size;
+        if (m_broken)
+        {
+            return;
+        }
+        if (!m_pending)
+        {
+            m_pending = std::make_unique<StreamBlock>();
+        }
+        if (!m_pending->Append(data, size))
+        {
+            std::cerr << "流式输出分配内存失败: " << m_target << " " << std::strerror(errno) << std::endl;
+            m_broken = true;
+            return;
+        }
+        if (m_pending->size() >= kBlockSize)
+        {
+            FlushPending();
+        }
+    }
+
+    /**
+     * @brief 把已聚合的数据交给I/O线程(块边界调用)，队列满时等待
+     */
+    void Flush() { FlushPending(); }
+
+    /**
+     * @brief 写出剩余数据并关闭输出
+     */
+    void end() override
+    {
+        if (m_ended)
+        {
+            return;
+        }
+        m_ended = true;
+        FlushPending();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_done = true;
+        }
+        m_cv.notify_all();
+        if (m_thread.joinable())
+        {
+            m_thread.join();
+        }
+    }
+
+    /**
+     * @brief 已写入的字节数
+     */
+    uint64_t size() const override { return m_size; }
+
+    /**
+     * @brief 下游是否已断开(之后的数据都被丢弃)
+     */
+    bool IsBroken() const { return m_broken; }
+
+    /**
+     * @brief 写队列满而等待下游的次数
+     */
+    uint64_t BackpressureWaits() const { return m_backpressureWaits; }
+
+private:
+    using Block = std::unique_ptr<StreamBlock>;
+
+    /**
+     * @brief 写出方式
+     */
+    enum class Mode
+    {
+        Write,   ///< 普通 write(重定向到文件的标准输出等)
+        Splice,  ///< vmsplice 挂入管道
+        Socket,  ///< send 到套接字
+    };
+
+    /**
+     * @brief ReserveStdout 预留的原标准输出，未预留时为 -1
+     */
+    static int& ReservedStdout()
+    {
+        static int fd = -1;
+        return fd;
+    }
+
+    static int ConnectUnix(const std::string& path)
+    {
+        sockaddr_un addr{};
+        if (path.size() >= sizeof(addr.sun_path))
+        {
+            errno = ENAMETOOLONG;
+            return -1;
+        }
+        const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0)
+        {
+            return -1;
+        }
+        addr.sun_family = AF_UNIX;
+        std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+        if (::connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0)
+        {
+            const int error = errno;
+            ::close(fd);
+            errno = error;
+            return -1;
+        }
+        return fd;
+    }
+
+    /**
+     * @brief 把聚合的数据作为一个块放入写队列
+     */
+    void FlushPending()
+    {
+        if (!m_pending || m_pending->empty() || !m_thread.joinable())
+        {
+            return;
+        }
+        Block block = std::move(m_pending);
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        // 空队列总能放入一个块: 块可能超过 kBlockSize(大消息)，也可能大于队列上限
+        const auto hasRoom = [&] { return m_queuedBytes == 0 || m_queuedBytes + block->size() <= m_maxQueueBytes; };
+        if (!hasRoom())
+        {
+            m_backpressureWaits++;
+            m_cv.wait(lock, [&] { return m_broken || hasRoom(); });
+        }
+        if (m_broken)
+        {
+            return;
+        }
+        m_queuedBytes += block->size();
+        m_queue.push_back(std::move(block));
+        lock.unlock();
+        m_cv.notify_all();
+    }
+
+    /**
+     * @brief I/O线程
+     */
+    void IoLoop()
+    {
+        // 下游断开时写入返回 EPIPE，信号只发给本线程且被屏蔽，不会终止进程
+        sigset_t pipeSet;
+        sigemptyset(&pipeSet);
+        sigaddset(&pipeSet, SIGPIPE);
+        ::pthread_sigmask(SIG_BLOCK, &pipeSet, nullptr);
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true)
+        {
+            m_cv.wait(lock, [this] { return m_done || !m_queue.empty(); });
+            if (m_queue.empty())
+            {
+                break;  // 写入结束且队列已写完
+            }
+
+            Block block = std::move(m_queue.front());
+            m_queue.pop_front();
+            lock.unlock();
+            const bool ok = WriteBlock(*block);
+            const size_t size = block->size();
+            block.reset();  // 立即解除映射，已挂入管道的页由管道持有
+            lock.lock();
+
+            m_queuedBytes -= size;
+            if (!ok)
+            {
+                std::cerr << "流式输出已断开: " << m_target << " " << std::strerror(errno) << std::endl;
+                m_broken = true;
+                m_queue.clear();
+                m_queuedBytes = 0;
+                m_cv.notify_all();
+                break;
+            }
+            m_cv.notify_all();
+        }
+        lock.unlock();
+
+        ::close(m_fd);
+        m_fd = -1;
+    }
+
+    /**
+     * @brief 写出一个块
+     */
+    bool WriteBlock(const StreamBlock& block)
+    {
+        const char* data = block.data();
+        const size_t size = block.size();
+        size_t done = 0;
+        while (done < size)
+        {
+            ssize_t n = 0;
+            if (m_mode == Mode::Splice)
+            {
+                iovec iov{const_cast<char*>(data + done), size - done};
+                n = ::vmsplice(m_fd, &iov, 1, 0);
+                if (n < 0 && (errno == EINVAL || errno == ENOSYS))
+                {
+                    m_mode = Mode::Write;  // 不支持 vmsplice 时退化为普通写入
+                    continue;
+                }
+            } else if (m_mode == Mode::Socket)
+            {
+                n = ::send(m_fd, data + done, size - done, MSG_NOSIGNAL);
+            } else
+            {
+                n = ::write(m_fd, data + done, size - done);
+            }
+
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                return false;
+            }
+            done += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    std::string m_target;                          ///< 输出目标
+    uint64_t m_maxQueueBytes;                      ///< 写队列上限
+    int m_fd = -1;                                 ///< 输出描述符
+    Mode m_mode = Mode::Write;                     ///< 写出方式
+    std::thread m_thread;                          ///< I/O线程
+    std::mutex m_mutex;                            ///< 队列互斥锁
+    std::condition_variable m_cv;                  ///< 队列条件变量
+    std::deque<Block> m_queue;                     ///< 写队列
+    uint64_t m_queuedBytes = 0;                    ///< 队列中的字节数
+    bool m_done = false;                           ///< 写入已结束
+    std::atomic<bool> m_broken{false};             ///< 下游已断开
+    std::atomic<uint64_t> m_backpressureWaits{0};  ///< 反压等待次数
+    Block m_pending;                               ///< 尚未入队的数据
+    uint64_t m_size = 0;                           ///< 已写入的字节数
+    bool m_ended = false;                          ///< 是否已结束
+};
+
+}  // namespace openbag
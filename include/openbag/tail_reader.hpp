@@ -0,0 +1,408 @@
+/**
+ * @copyright Copyright (c) 2025 openbag
+ *
+ * @author Zhao Jun(zwhy2025@gmail.com)
+ * @version 0.1
+ * @date 2025-05-22
+ *
+ * @file tail_reader.hpp
+ * @brief 跟随读取正在录制的 MCAP 文件
+ *
+ * 正在写入的文件还没有摘要，Reader::Open 只能回退到全文件扫描，且不跟随文件增长。
+ * TailReader 从上次读到的偏移开始，只解析文件中新增的完整记录(块、通道、模式、消息)，
+ * 写了一半的记录留到下次再读，已读过的部分不再重复扫描。
+ * 文件增长通过 inotify 通知，不可用时退化为定时轮询。
+ * 录制端配置 storage.yaml 的 live_flush_interval 后，块一写出即落盘，读取延迟约为该间隔。
+ */
+
+#pragma once
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "openbag/reader.hpp"
+
+namespace openbag {
+
+/**
+ * @brief 跟随读取器
+ */
+class TailReader
+{
+public:
+    using MessageHandler = std::function<void(const mcap::MessageView &)>;  ///< 消息回调，消息数据只在回调期间有效
+
+    static constexpr uint64_t kReadSize = 4 * 1024 * 1024;  ///< 单次读取的最大字节数
+
+    TailReader() = default;
+    TailReader(const TailReader &) = delete;
+    TailReader &operator=(const TailReader &) = delete;
+
+    ~TailReader() { Close(); }
+
+    /**
+     * @brief 打开文件，文件可以仍在写入中
+     * @param filename 文件名
+     * @return 是否成功
+     */
+    bool Open(const std::string &filename)
+    {
+        Close();
+        m_fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+        if (m_fd < 0)
+        {
+            std::cerr << "打开文件失败: " << filename << " " << std::strerror(errno) << std::endl;
+            return false;
+        }
+
+        m_notifyFd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (m_notifyFd >= 0 && ::inotify_add_watch(m_notifyFd, filename.c_str(), IN_MODIFY | IN_CLOSE_WRITE | IN_DELETE_SELF | IN_MOVE_SELF) < 0)
+        {
+            ::close(m_notifyFd);
+            m_notifyFd = -1;
+        }
+        if (m_notifyFd < 0)
+        {
+            std::cerr << "inotify 不可用，改为轮询: " << filename << std::endl;
+        }
+
+        m_filename = filename;
+        return true;
+    }
+
+    /**
+     * @brief 关闭文件
+     */
+    void Close()
+    {
+        if (m_notifyFd >= 0)
+        {
+            ::close(m_notifyFd);
+            m_notifyFd = -1;
+        }
+        if (m_fd >= 0)
+        {
+            ::close(m_fd);
+            m_fd = -1;
+        }
+        m_filename.clear();
+        m_buffer.clear();
+        m_bufferPos = 0;
+        m_offset = 0;
+        m_magicChecked = false;
+        m_finished = false;
+        m_error = false;
+        m_schemas.clear();
+        m_channels.clear();
+    }
+
+    /**
+     * @brief 解析文件中新增的完整记录，对每条消息调用回调
+     * @param handler 消息回调
+     * @return 本次读到的消息数
+     */
+    size_t Poll(const MessageHandler &handler)
+    {
+        size_t count = 0;
+        while (m_fd >= 0 && !m_finished && !m_error)
+        {
+            const uint64_t before = m_offset + (m_buffer.size() - m_bufferPos);
+            if (!Fill())
+            {
+                break;
+            }
+            count += Parse(handler);
+            if (m_offset + (m_buffer.size() - m_bufferPos) == before)
+            {
+                break;  // 没有新数据
+            }
+        }
+        return count;
+    }
+
+    /**
+     * @brief 等待文件增长
+     * @param timeoutMs 超时(毫秒)
+     * @return 是否收到了文件变化通知(轮询模式下超时后总是返回true)
+     */
+    bool WaitForData(int timeoutMs)
+    {
+        if (m_notifyFd < 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs));
+            return true;
+        }
+
+        pollfd pfd{m_notifyFd, POLLIN, 0};
+        if (::poll(&pfd, 1, timeoutMs) <= 0)
+        {
+            return false;
+        }
+        // 取走所有事件，只关心"有变化"
+        alignas(inotify_event) char events[4096];
+        while (::read(m_notifyFd, events, sizeof(events)) > 0)
+        {
+        }
+        return true;
+    }
+
+    /**
+     * @brief 等待并读取新消息
+     * @param handler 消息回调
+     * @param timeoutMs 没有新数据时的最长等待时间(毫秒)
+     * @return 读到的消息数
+     */
+    size_t Follow(const MessageHandler &handler, int timeoutMs)
+    {
+        size_t count = Poll(handler);
+        if (count == 0 && !m_finished && !m_error && WaitForData(timeoutMs))
+        {
+            count = Poll(handler);
+        }
+        return count;
+    }
+
+    /**
+     * @brief 是否已读到数据区结束(文件已完成写入)
+     */
+    bool IsFinished() const { return m_finished; }
+
+    /**
+     * @brief 是否遇到了无法继续的错误(文件格式错误或被截短)
+     */
+    bool HasError() const { return m_error; }
+
+    /**
+     * @brief 已解析到的文件偏移
+     */
+    uint64_t Offset() const { return m_offset; }
+
+    /**
+     * @brief 已读到的通道
+     */
+    const std::unordered_map<mcap::ChannelId, mcap::ChannelPtr> &GetChannels() const { return m_channels; }
+
+    /**
+     * @brief 已读到的模式
+     */
+    const std::unordered_map<mcap::SchemaId, mcap::SchemaPtr> &GetSchemas() const { return m_schemas; }
+
+private:
+    static constexpr uint64_t kRecordPrefixSize = 9;  ///< 记录头大小: 操作码(1) + 长度(8)
+
+    /**
+     * @brief 把文件中新增的字节追加到缓冲区
+     * @return 是否读取成功(没有新数据也算成功)
+     */
+    bool Fill()
+    {
+        struct stat st;
+        if (::fstat(m_fd, &st) != 0)
+        {
+            return false;
+        }
+        const uint64_t fileSize = static_cast<uint64_t>(st.st_size);
+        const uint64_t readOffset = m_offset + (m_buffer.size() - m_bufferPos);
+        if (fileSize < readOffset)
+        {
+            std::cerr << "文件被截短，停止跟随: " << m_filename << std::endl;
+            m_error = true;
+            return false;
+        }
+        if (fileSize == readOffset)
+        {
+            return true;
+        }
+
+        // 丢弃已解析的部分，缓冲区只保留尚不完整的记录
+        m_buffer.erase(m_buffer.begin(), m_buffer.begin() + static_cast<std::ptrdiff_t>(m_bufferPos));
+        m_bufferPos = 0;
+
+        const uint64_t length = std::min(fileSize - readOffset, kReadSize);
+        const size_t oldSize = m_buffer.size();
+        m_buffer.resize(oldSize + length);
+        uint64_t done = 0;
+        while (done < length)
+        {
+            const ssize_t n = ::pread(m_fd, m_buffer.data() + oldSize + done, length - done, static_cast<off_t>(readOffset + done));
+            if (n <= 0)
+            {
+                break;
+            }
+            done += static_cast<uint64_t>(n);
+        }
+        m_buffer.resize(oldSize + done);
+        return true;
+    }
+
+    /**
+     * @brief 解析缓冲区中的完整记录
+     * @return 读到的消息数
+     */
+    size_t Parse(const MessageHandler &handler)
+    {
+        if (!m_magicChecked)
+        {
+            if (m_buffer.size() - m_bufferPos < sizeof(mcap::Magic))
+            {
+                return 0;
+            }
+            if (std::memcmp(m_buffer.data() + m_bufferPos, mcap::Magic, sizeof(mcap::Magic)) != 0)
+            {
+                std::cerr << "不是MCAP文件: " << m_filename << std::endl;
+                m_error = true;
+                return 0;
+            }
+            Consume(sizeof(mcap::Magic));
+            m_magicChecked = true;
+        }
+
+        size_t count = 0;
+        while (!m_finished && !m_error && m_buffer.size() - m_bufferPos >= kRecordPrefixSize)
+        {
+            std::byte *prefix = m_buffer.data() + m_bufferPos;
+            mcap::Record record;
+            record.opcode = static_cast<mcap::OpCode>(prefix[0]);
+            std::memcpy(&record.dataSize, prefix + 1, sizeof(record.dataSize));
+            if (record.dataSize > m_buffer.size() - m_bufferPos - kRecordPrefixSize)
+            {
+                break;  // 记录尚未写完
+            }
+            record.data = prefix + kRecordPrefixSize;
+
+            if (record.opcode == mcap::OpCode::Chunk)
+            {
+                count += ParseChunk(prefix, record.recordSize(), handler);
+            } else
+            {
+                count += HandleRecord(record, mcap::RecordOffset(m_offset), handler);
+            }
+            Consume(record.recordSize());
+        }
+        return count;
+    }
+
+    /**
+     * @brief 解压块并处理块内记录
+     */
+    size_t ParseChunk(const std::byte *data, uint64_t size, const MessageHandler &handler)
+    {
+        mcap::ByteArray raw(data, data + size);
+        if (!Reader::DecompressChunk(raw, m_chunkRecords))
+        {
+            // 完整的块无法解压说明文件已损坏，停止跟随而不是跳过该块
+            std::cerr << "解压块失败，停止跟随, 偏移: " << m_offset << " " << m_filename << std::endl;
+            m_error = true;
+            return 0;
+        }
+
+        size_t count = 0;
+        uint64_t offset = 0;
+        while (offset + kRecordPrefixSize <= m_chunkRecords.size())
+        {
+            mcap::Record inner;
+            inner.opcode = static_cast<mcap::OpCode>(m_chunkRecords[offset]);
+            std::memcpy(&inner.dataSize, m_chunkRecords.data() + offset + 1, sizeof(inner.dataSize));
+            inner.data = m_chunkRecords.data() + offset + kRecordPrefixSize;
+            if (inner.dataSize > m_chunkRecords.size() - offset - kRecordPrefixSize)
+            {
+                std::cerr << "块内记录被截断, 偏移: " << m_offset + offset << std::endl;
+                break;
+            }
+            count += HandleRecord(inner, mcap::RecordOffset(offset, m_offset), handler);
+            offset += inner.recordSize();
+        }
+        return count;
+    }
+
+    /**
+     * @brief 处理一条记录
+     * @param record 记录
+     * @param recordOffset 记录位置(块内记录为块内偏移及块的文件偏移)
+     * @param handler 消息回调
+     * @return 是否为分发出去的消息(1或0)
+     */
+    size_t HandleRecord(const mcap::Record &record, const mcap::RecordOffset &recordOffset, const MessageHandler &handler)
+    {
+        switch (record.opcode)
+        {
+            case mcap::OpCode::Schema:
+            {
+                auto schema = std::make_shared<mcap::Schema>();
+                if (mcap::McapReader::ParseSchema(record, schema.get()).ok())
+                {
+                    m_schemas[schema->id] = schema;
+                }
+                return 0;
+            }
+            case mcap::OpCode::Channel:
+            {
+                auto channel = std::make_shared<mcap::Channel>();
+                if (mcap::McapReader::ParseChannel(record, channel.get()).ok())
+                {
+                    m_channels[channel->id] = channel;
+                }
+                return 0;
+            }
+            case mcap::OpCode::Message:
+            {
+                mcap::Message message;
+                if (!mcap::McapReader::ParseMessage(record, &message).ok())
+                {
+                    return 0;
+                }
+                auto channelIt = m_channels.find(message.channelId);
+                if (channelIt == m_channels.end())
+                {
+                    return 0;
+                }
+                auto schemaIt = m_schemas.find(channelIt->second->schemaId);
+                const mcap::SchemaPtr schema = schemaIt == m_schemas.end() ? nullptr : schemaIt->second;
+                if (handler)
+                {
+                    handler(mcap::MessageView(message, channelIt->second, schema, recordOffset));
+                }
+                return 1;
+            }
+            case mcap::OpCode::DataEnd:
+            case mcap::OpCode::Footer:
+                m_finished = true;
+                return 0;
+            default:
+                return 0;
+        }
+    }
+
+    void Consume(uint64_t size)
+    {
+        m_bufferPos += size;
+        m_offset += size;
+    }
+
+    std::string m_filename;                                          ///< 文件名
+    int m_fd = -1;                                                   ///< 文件描述符
+    int m_notifyFd = -1;                                             ///< inotify 描述符
+    mcap::ByteArray m_buffer;                                        ///< 已读取但未解析完的字节
+    size_t m_bufferPos = 0;                                          ///< 缓冲区中已解析的长度
+    uint64_t m_offset = 0;                                           ///< 已解析到的文件偏移
+    mcap::ByteArray m_chunkRecords;                                  ///< 解压后的块记录区(复用)
+    bool m_magicChecked = false;                                     ///< 是否已校验文件头魔数
+    bool m_finished = false;                                         ///< 是否已读到数据区结束
+    bool m_error = false;                                            ///< 是否遇到错误
+    std::unordered_map<mcap::SchemaId, mcap::SchemaPtr> m_schemas;   ///< 模式
+    std::unordered_map<mcap::ChannelId, mcap::ChannelPtr> m_channels;  ///< 通道
+};
+
+}  // namespace openbag
@@ -0,0 +1,155 @@
+/**
+ * @copyright Copyright (c) 2025 openbag
+ *
+ * @author Zhao Jun(zwhy2025@gmail.com)
+ * @version 0.1
+ * @date 2025-05-22
+ *
+ * @file transform.hpp
+ * @brief 回放话题重映射与消息变换钩子
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "openbag/common.hpp"
+
+namespace openbag {
+
+/**
+ * @brief 回放消息负载视图
+ *
+ * 默认直接引用读取器中的数据(零拷贝)，只有变换需要修改时才通过 Mutable()
+ * 复制到播放器复用的缓冲区，同一条消息的多个变换共享这一次复制。
+ */
+class PayloadView
+{
+public:
+    /**
+     * @brief 构造函数
+     * @param data 原始负载
+     * @param buffer 可写缓冲区(由调用方复用)
+     */
+    PayloadView(std::string_view data, std::string& buffer) : m_data(data), m_buffer(buffer) {}
+
+    /**
+     * @brief 获取当前负载
+     */
+    std::string_view Data() const { return m_modified ? std::string_view(m_buffer) : m_data; }
+
+    /**
+     * @brief 获取可写负载，首次调用时复制原始数据
+     */
+    std::string& Mutable()
+    {
+        if (!m_modified)
+        {
+            m_buffer.assign(m_data.data(), m_data.size());
+            m_modified = true;
+        }
+        return m_buffer;
+    }
+
+    /**
+     * @brief 整体替换负载
+     */
+    void Assign(std::string_view data)
+    {
+        m_buffer.assign(data.data(), data.size());
+        m_modified = true;
+    }
+
+    /**
+     * @brief 负载是否已被修改(已修改时数据在缓冲区中)
+     */
+    bool IsModified() const { return m_modified; }
+
+private:
+    std::string_view m_data;  ///< 原始负载
+    std::string& m_buffer;    ///< 可写缓冲区
+    bool m_modified = false;  ///< 是否已修改
+};
+
+/**
+ * @brief 变换钩子收到的消息信息
+ */
+struct PlaybackMessageInfo
+{
+    const std::string& topic;          ///< 原话题名
+    const std::string& publish_topic;  ///< 重映射后的发布话题名
+    uint64_t log_time;                 ///< 消息记录时间(纳秒)
+    uint64_t publish_time;             ///< 消息发布时间(纳秒)
+};
+
+/**
+ * @brief 消息变换钩子，在播放线程中调用，返回 false 时丢弃该消息
+ */
+using MessageTransform = std::function<bool(const PlaybackMessageInfo&, PayloadView&)>;
+
+/**
+ * @brief 话题重映射
+ *
+ * 按规则顺序取第一条匹配的规则；都不匹配时加上命名空间前缀(为空时保持原名)。
+ */
+class TopicRemapper
+{
+public:
+    TopicRemapper() = default;
+
+    /**
+     * @brief 构造函数
+     * @param rules 重映射规则
+     * @param topicNamespace 未匹配规则的话题统一添加的前缀
+     */
+    TopicRemapper(std::vector<TopicRemapRule> rules, std::string topicNamespace) : m_rules(std::move(rules)), m_namespace(std::move(topicNamespace))
+    {
+        while (!m_namespace.empty() && m_namespace.back() == '/')
+        {
+            m_namespace.pop_back();
+        }
+    }
+
+    /**
+     * @brief 计算话题的发布名称
+     * @param topic 原话题名
+     * @return 重映射后的话题名
+     */
+    std::string Remap(const std::string& topic) const
+    {
+        for (const auto& rule : m_rules)
+        {
+            if (rule.from.empty())
+            {
+                continue;
+            }
+            if (rule.from.back() == '/')
+            {
+                if (topic.compare(0, rule.from.size(), rule.from) == 0)
+                {
+                    return rule.to + topic.substr(rule.from.size());
+                }
+            } else if (topic == rule.from)
+            {
+                return rule.to;
+            }
+        }
+
+        if (m_namespace.empty())
+        {
+            return topic;
+        }
+        return !topic.empty() && topic.front() == '/' ? m_namespace + topic : m_namespace + "/" + topic;
+    }
+
+private:
+    std::vector<TopicRemapRule> m_rules;  ///< 重映射规则
+    std::string m_namespace;              ///< 命名空间前缀
+};
+
+}  // namespace openbag
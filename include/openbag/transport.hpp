@@ -15,6 +15,7 @@
 #include <memory>
 #include <string>
 #include <type_traits>
+#include <utility>
 
 namespace openbag {
 
@@ -66,6 +67,22 @@ public:
     virtual std::string GetTopicName() const = 0;
 };
 
+/**
+ * @brief 预先准备好的待发布消息
+ *
+ * 发布者在发布时刻之前完成拷贝、封装等准备工作，到发布时刻只需发送。
+ * 传输层可派生该类保存已封装好的传输层消息。
+ */
+class PreparedMessage
+{
+public:
+    virtual ~PreparedMessage() = default;
+
+    std::string data;  ///< 消息数据
+};
+
+using PreparedMessagePtr = std::unique_ptr<PreparedMessage>;
+
 /**
  * @brief 发布器基类接口
  */
@@ -86,6 +103,25 @@ public:
      * @return 是否发布成功
      */
     virtual bool Publish(const std::string& data) = 0;
+
+    /**
+     * @brief 准备待发布的消息(可在发布时刻之前、在其他线程调用)
+     * @param data 消息数据
+     * @return 准备好的消息，默认实现只保存数据
+     */
+    virtual PreparedMessagePtr Prepare(std::string data)
+    {
+        auto message = std::make_unique<PreparedMessage>();
+        message->data = std::move(data);
+        return message;
+    }
+
+    /**
+     * @brief 发布准备好的消息
+     * @param message 由本发布者 Prepare 得到的消息
+     * @return 是否发布成功
+     */
+    virtual bool PublishPrepared(PreparedMessage& message) { return Publish(message.data); }
 };
 
 /**
@@ -117,6 +153,41 @@ public:
      */
     virtual std::shared_ptr<OpenbagPublisherBase> CreatePublisher(const std::string& topic) = 0;
 
+    /**
+     * @brief 创建字节订阅者，回调收到消息序列化后的字节
+     *
+     * 不经过消息类型的传输层(如本机共享内存)重写该方法; 返回空时调用方使用 CreateSubscriber<std::string>
+     *
+     * @param topic 话题名称
+     * @param callback 回调函数
+     * @return 订阅者基类指针，传输层未重写时返回空
+     */
+    virtual std::shared_ptr<OpenbagSubscriberBase> CreateBytesSubscriber(const std::string& topic, std::function<void(const std::string&)> callback)
+    {
+        return nullptr;
+    }
+
+    /**
+     * @brief 创建原始数据订阅者(收到的是线上的序列化字节，不经过消息类型解析)
+     * @param topic 话题名称
+     * @param typeName 传输层类型名
+     * @param callback 回调函数
+     * @return 订阅者基类指针，传输层不支持时返回空
+     */
+    virtual std::shared_ptr<OpenbagSubscriberBase> CreateRawSubscriber(const std::string& topic, const std::string& typeName,
+                                                                       std::function<void(const std::string&)> callback)
+    {
+        return nullptr;
+    }
+
+    /**
+     * @brief 创建原始数据发布者(按原样发布序列化字节)
+     * @param topic 话题名称
+     * @param typeName 传输层类型名
+     * @return 发布者基类指针，传输层不支持时返回空
+     */
+    virtual std::shared_ptr<OpenbagPublisherBase> CreateRawPublisher(const std::string& topic, const std::string& typeName) { return nullptr; }
+
 protected:
     /**
      * @brief 内部创建订阅者方法 - 由子类实现
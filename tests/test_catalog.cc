@@ -0,0 +1,133 @@
+#include <cassert>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "openbag/catalog.hpp"
+#include "test_utils.hpp"
+
+using namespace openbag;
+
+namespace {
+
+constexpr size_t kFileCount = 100;
+constexpr size_t kTopicsPerFile = 200;  ///< 远多于固定布隆过滤器能区分的话题数
+
+/**
+ * @brief 第 i 个文件: 时间范围 [i*10, i*10+9]，独有话题 /t<i>_<n>(第0个话题消息数为0)，另有公共话题 /common
+ */
+CatalogEntry MakeEntry(const test::TempDir& dir, size_t i)
+{
+    CatalogEntry entry;
+    entry.path = dir.File("bag" + std::to_string(i) + ".mcap");
+    std::ofstream(entry.path).put('x');
+    entry.start_time = i * 10;
+    entry.end_time = i * 10 + 9;
+    entry.message_count = kTopicsPerFile;
+    for (size_t n = 0; n < kTopicsPerFile; ++n)
+    {
+        entry.topics.push_back({"/t" + std::to_string(i) + "_" + std::to_string(n), n == 0 ? 0u : 1u, i * 10, i * 10 + 5});
+    }
+    entry.topics.push_back({"/common", 1, i * 10, i * 10 + 9});
+    return entry;
+}
+
+void TestQuery()
+{
+    test::TempDir dir("catalog");
+    const auto catalogPath = dir.File("catalog.idx");
+    CatalogBuilder builder(catalogPath);
+    for (size_t i = 0; i < kFileCount; ++i)
+    {
+        assert(builder.Append(MakeEntry(dir, i)));
+    }
+
+    Catalog catalog;
+    assert(catalog.Open(catalogPath));
+    assert(catalog.GetFileCount() == kFileCount);
+
+    const auto common = catalog.Query("/common");
+    assert(common.size() == kFileCount);
+    assert(common.front() == dir.File("bag0.mcap") && common.back() == dir.File("bag" + std::to_string(kFileCount - 1) + ".mcap"));
+    assert(catalog.Query("/common", 15, 25).size() == 2);
+    assert(catalog.Query("", 0, 9).size() == 1);
+
+    // 话题只在一个文件中出现，时间范围按话题自身的范围判断
+    const auto unique = catalog.Query("/t5_7");
+    assert(unique.size() == 1 && unique[0] == dir.File("bag5.mcap"));
+    assert(catalog.Query("/t5_7", 56, 59).empty());
+    assert(catalog.Query("/t5_0").empty());
+    assert(catalog.Query("/missing").empty());
+
+    CatalogEntry entry;
+    assert(catalog.GetEntry(dir.File("bag5.mcap"), entry));
+    assert(entry.topics.size() == kTopicsPerFile + 1 && entry.start_time == 50 && entry.end_time == 59);
+}
+
+void TestRefreshAndPrune()
+{
+    test::TempDir dir("catalog_prune");
+    const auto catalogPath = dir.File("catalog.idx");
+    CatalogBuilder builder(catalogPath);
+    for (size_t i = 0; i < 3; ++i)
+    {
+        assert(builder.Append(MakeEntry(dir, i)));
+    }
+    Catalog catalog;
+    assert(catalog.Open(catalogPath));
+
+    // 同一路径的新记录覆盖旧记录，增量刷新后旧话题不再命中
+    CatalogEntry replaced;
+    replaced.path = dir.File("bag1.mcap");
+    replaced.start_time = 500;
+    replaced.end_time = 600;
+    replaced.message_count = 1;
+    replaced.topics.push_back({"/new", 1, 500, 600});
+    assert(builder.Append(replaced));
+    assert(catalog.Refresh());
+    assert(catalog.GetFileCount() == 3);
+    assert(catalog.Query("/t1_3").empty());
+    assert(catalog.Query("/new").size() == 1);
+    assert(catalog.Query("/common").size() == 2);
+
+    // 压缩去掉被覆盖的记录和文件已删除的记录，已打开的索引刷新后重新加载
+    std::filesystem::remove(dir.File("bag2.mcap"));
+    assert(builder.Prune() == 2);
+    assert(catalog.Refresh());
+    assert(catalog.GetFileCount() == 2);
+    assert(catalog.Query("/common").size() == 1);
+    assert(catalog.Query("/new").size() == 1);
+    assert(catalog.Query("/t2_3").empty());
+}
+
+void TestAddFile()
+{
+    test::TempDir dir("catalog_bag");
+    const auto bagPath = dir.File("test.mcap");
+    test::WriteTestBag(bagPath, 2, test::MakeTestMessages(2, 100));
+
+    CatalogBuilder builder(dir.File("catalog.idx"));
+    assert(builder.AddFile(bagPath));
+    Catalog catalog;
+    assert(catalog.Open(dir.File("catalog.idx")));
+    assert(catalog.Query("/topic_2").size() == 1);
+    assert(catalog.Query("/topic_3").empty());
+
+    CatalogEntry entry;
+    assert(catalog.GetEntry(catalog.Query("/topic_1")[0], entry));
+    assert(entry.message_count == 100 && entry.topics.size() == 2);
+}
+
+}  // namespace
+
+int main()
+{
+    TestQuery();
+    TestRefreshAndPrune();
+    TestAddFile();
+    std::cout << "test_catalog 通过" << std::endl;
+    return 0;
+}
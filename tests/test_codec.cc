@@ -0,0 +1,215 @@
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "openbag/codec.hpp"
+
+using namespace openbag;
+
+namespace {
+
+/**
+ * @brief 编码后写入文件的一条消息
+ */
+struct StoredMessage
+{
+    uint64_t log_time;
+    uint32_t sequence;
+    std::string stored;
+    std::string original;
+};
+
+mcap::Channel MakeChannel(const TopicInfo& info)
+{
+    mcap::Channel channel;
+    channel.id = 1;
+    channel.topic = "/test";
+    channel.messageEncoding = FramedEncoding("protobuf");
+    channel.metadata[kFramingMetadataKey] = kFramingVersion;
+    channel.metadata[kDedupMetadataKey] = DedupModeToString(info.dedup_mode);
+    if (info.delta_keyframe_interval > 0)
+    {
+        channel.metadata[kDeltaMetadataKey] = std::to_string(info.delta_keyframe_interval);
+    }
+    return channel;
+}
+
+std::vector<StoredMessage> EncodeAll(const TopicInfo& info, const std::vector<StoredMessage>& input)
+{
+    PayloadEncoder encoder(info);
+    std::vector<StoredMessage> output;
+    for (const auto& message : input)
+    {
+        std::string_view stored;
+        assert(encoder.Encode(message.original, message.log_time, message.sequence, stored));
+        output.push_back({message.log_time, message.sequence, std::string(stored), message.original});
+    }
+    return output;
+}
+
+/**
+ * @brief 模拟读取器: 返回文件中同一 logTime 的全部消息
+ */
+PayloadResolver::FetchFunc FetchFrom(const std::vector<StoredMessage>& messages, int* fetches = nullptr)
+{
+    return [&messages, fetches](const mcap::Channel&, uint64_t logTime, std::vector<StoredFrame>& frames) {
+        if (fetches)
+        {
+            (*fetches)++;
+        }
+        for (const auto& message : messages)
+        {
+            if (message.log_time == logTime)
+            {
+                frames.push_back({message.sequence, message.stored});
+            }
+        }
+        return !frames.empty();
+    };
+}
+
+void CheckSequential(const mcap::Channel& channel, const std::vector<StoredMessage>& messages, int* fetches = nullptr)
+{
+    PayloadResolver resolver(FetchFrom(messages, fetches));
+    for (const auto& message : messages)
+    {
+        std::string_view payload;
+        assert(resolver.Resolve(channel, message.log_time, message.sequence, message.stored, payload));
+        assert(payload == message.original);
+    }
+}
+
+void CheckRandomAccess(const mcap::Channel& channel, const std::vector<StoredMessage>& messages)
+{
+    PayloadResolver resolver(FetchFrom(messages));
+    for (size_t i = messages.size(); i-- > 0;)
+    {
+        resolver.Reset();
+        std::string_view payload;
+        assert(resolver.Resolve(channel, messages[i].log_time, messages[i].sequence, messages[i].stored, payload));
+        assert(payload == messages[i].original);
+    }
+}
+
+void TestReferenceRoundTrip()
+{
+    TopicInfo info;
+    info.dedup_mode = DedupMode::REFERENCE;
+    const auto messages = EncodeAll(info, {{100, 0, "", "AAAA"}, {200, 1, "", "AAAA"}, {300, 2, "", "BBBB"}, {400, 3, "", "AAAA"}});
+    assert(messages[0].stored[0] == static_cast<char>(FrameType::FULL));
+    assert(messages[1].stored[0] == static_cast<char>(FrameType::REFERENCE));
+    assert(messages[1].stored.size() == kReferenceFrameSize);
+    assert(messages[3].stored[0] == static_cast<char>(FrameType::FULL));
+
+    // 顺序读取时引用帧直接命中上一帧，不需要额外取回
+    int fetches = 0;
+    const auto channel = MakeChannel(info);
+    CheckSequential(channel, messages, &fetches);
+    assert(fetches == 0);
+    CheckRandomAccess(channel, messages);
+}
+
+void TestReferenceWithEqualTimestamps()
+{
+    // 同一 logTime 的多条不同负载，引用帧须按序列号和哈希找到正确的被引用帧
+    TopicInfo info;
+    info.dedup_mode = DedupMode::REFERENCE;
+    const auto messages = EncodeAll(info, {{100, 0, "", "AAAA"},
+                                           {100, 1, "", "AAAA"},
+                                           {100, 2, "", "BBBB"},
+                                           {100, 3, "", "BBBB"},
+                                           {100, 4, "", "AAAA"},
+                                           {100, 5, "", "CCCC"},
+                                           {100, 6, "", "CCCC"}});
+    const auto channel = MakeChannel(info);
+    CheckSequential(channel, messages);
+    CheckRandomAccess(channel, messages);
+}
+
+void TestReferenceToMismatchedFrameFails()
+{
+    TopicInfo info;
+    info.dedup_mode = DedupMode::REFERENCE;
+    auto messages = EncodeAll(info, {{100, 0, "", "CCCC"}, {100, 1, "", "CCCC"}});
+    messages[0].stored = "FXXXX";
+
+    PayloadResolver resolver(FetchFrom(messages));
+    std::string_view payload;
+    assert(!resolver.Resolve(MakeChannel(info), messages[1].log_time, messages[1].sequence, messages[1].stored, payload));
+}
+
+void TestUnsupportedFramingVersionFails()
+{
+    TopicInfo info;
+    info.dedup_mode = DedupMode::REFERENCE;
+    const auto messages = EncodeAll(info, {{100, 0, "", "AAAA"}});
+    auto channel = MakeChannel(info);
+    channel.metadata[kFramingMetadataKey] = "1";
+
+    PayloadResolver resolver(FetchFrom(messages));
+    std::string_view payload;
+    assert(!resolver.Resolve(channel, messages[0].log_time, messages[0].sequence, messages[0].stored, payload));
+}
+
+void TestDeltaRoundTrip()
+{
+    // 差分模式单独使用和与引用去重组合使用，部分消息共享 logTime
+    for (const auto mode : {DedupMode::NONE, DedupMode::REFERENCE})
+    {
+        TopicInfo info;
+        info.dedup_mode = mode;
+        info.delta_keyframe_interval = 3;
+        std::vector<StoredMessage> input;
+        for (uint32_t i = 0; i < 20; ++i)
+        {
+            input.push_back({100 + i / 10, i, "", "payload-" + std::to_string(i / 2 * 7 % 5) + std::string(i % 4, 'x')});
+        }
+        const auto messages = EncodeAll(info, input);
+
+        size_t deltas = 0;
+        for (const auto& message : messages)
+        {
+            if (message.stored[0] == static_cast<char>(FrameType::DELTA))
+            {
+                assert(message.stored.size() >= kDeltaHeaderSize);
+                deltas++;
+            }
+        }
+        assert(deltas > 0);
+
+        const auto channel = MakeChannel(info);
+        CheckSequential(channel, messages);
+        CheckRandomAccess(channel, messages);
+    }
+}
+
+void TestDeltaWithMismatchedKeyframeFails()
+{
+    // 同一 logTime 下关键帧被替换为其他内容时，差分帧须还原失败而不是返回错误的负载
+    TopicInfo info;
+    info.delta_keyframe_interval = 4;
+    auto messages = EncodeAll(info, {{100, 0, "", "keyframe-0"}, {100, 1, "", "keyframe-1"}});
+    assert(messages[1].stored[0] == static_cast<char>(FrameType::DELTA));
+    messages[0].stored = "Fkeyframe-X";
+
+    PayloadResolver resolver(FetchFrom(messages));
+    std::string_view payload;
+    assert(!resolver.Resolve(MakeChannel(info), messages[1].log_time, messages[1].sequence, messages[1].stored, payload));
+}
+
+}  // namespace
+
+int main()
+{
+    TestReferenceRoundTrip();
+    TestReferenceWithEqualTimestamps();
+    TestReferenceToMismatchedFrameFails();
+    TestUnsupportedFramingVersionFails();
+    TestDeltaRoundTrip();
+    TestDeltaWithMismatchedKeyframeFails();
+    std::cout << "test_codec 通过" << std::endl;
+    return 0;
+}
@@ -0,0 +1,96 @@
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "link/message_batch.hpp"
+
+using namespace Link;
+
+namespace {
+
+std::vector<uint8_t> Pack(const std::vector<std::string>& messages)
+{
+    std::vector<uint8_t> payload;
+    for (const auto& message : messages)
+    {
+        std::memcpy(BeginBatchFrame(payload, message.size()), message.data(), message.size());
+    }
+    return payload;
+}
+
+std::vector<std::string> Unpack(const std::vector<uint8_t>& payload, bool& complete)
+{
+    std::vector<std::string> messages;
+    complete = ForEachBatchFrame(payload.data(), payload.size(), [&messages](const uint8_t* data, size_t size) {
+        messages.emplace_back(reinterpret_cast<const char*>(data), size);
+    });
+    return messages;
+}
+
+void TestBatchType()
+{
+    assert(BatchType("proto") == "proto.batch");
+    assert(IsBatchType("proto.batch", "proto"));
+    assert(IsBatchType("string.batch", "string"));
+    assert(!IsBatchType("proto", "proto"));
+    assert(!IsBatchType("string.batch", "proto"));
+    assert(!IsBatchType("proto.batchx", "proto"));
+}
+
+void TestRoundTrip()
+{
+    // 覆盖空消息、1字节长度前缀的上限(127)和多字节长度前缀
+    const std::vector<std::string> messages = {"", "a", std::string(127, 'b'), std::string(128, 'c'), std::string(70000, 'd'), "end"};
+    const auto payload = Pack(messages);
+    assert(payload.size() == 1 + 1 + 1 + 1 + 127 + 2 + 128 + 3 + 70000 + 1 + 3);
+
+    bool complete = false;
+    assert(Unpack(payload, complete) == messages);
+    assert(complete);
+
+    const std::vector<uint8_t> empty;
+    assert(Unpack(empty, complete).empty());
+    assert(complete);
+}
+
+void TestMalformedPayload()
+{
+    const std::vector<std::string> messages = {"first", "second"};
+    auto payload = Pack(messages);
+    bool complete = true;
+
+    // 末尾消息被截断: 之前的消息照常访问，返回格式错误
+    payload.pop_back();
+    auto unpacked = Unpack(payload, complete);
+    assert(!complete);
+    assert(unpacked.size() == 1 && unpacked[0] == "first");
+
+    // 长度前缀未结束
+    const std::vector<uint8_t> unterminated = {0x80, 0x80};
+    assert(Unpack(unterminated, complete).empty());
+    assert(!complete);
+
+    // 长度前缀超过64位
+    const std::vector<uint8_t> overlong(11, 0xFF);
+    assert(Unpack(overlong, complete).empty());
+    assert(!complete);
+
+    // 长度超出负载
+    const std::vector<uint8_t> oversize = {0x05, 'a', 'b'};
+    assert(Unpack(oversize, complete).empty());
+    assert(!complete);
+}
+
+}  // namespace
+
+int main()
+{
+    TestBatchType();
+    TestRoundTrip();
+    TestMalformedPayload();
+    std::cout << "test_message_batch 通过" << std::endl;
+    return 0;
+}
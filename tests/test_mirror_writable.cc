@@ -0,0 +1,81 @@
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "openbag/mirror_writable.hpp"
+#include "test_utils.hpp"
+
+using namespace openbag;
+
+namespace {
+
+constexpr size_t kWriteSize = 3 * 1024 * 1024;  ///< 单次写入远大于 kBlockSize
+constexpr size_t kWriteCount = 8;
+
+/**
+ * @brief 写入测试数据并结束，返回写入的内容
+ */
+std::string WriteAll(MirrorWritable& writable)
+{
+    std::string expected;
+    for (size_t i = 0; i < kWriteCount; ++i)
+    {
+        const std::string data(kWriteSize, static_cast<char>('a' + i));
+        writable.write(reinterpret_cast<const std::byte*>(data.data()), data.size());
+        expected += data;
+    }
+    writable.write(reinterpret_cast<const std::byte*>("tail"), 4);
+    expected += "tail";
+    writable.end();
+    return expected;
+}
+
+void TestOversizeBlocks()
+{
+    // 队列上限为0或小于单个块时不能卡死，也不能因此把副镜像降级
+    for (const uint64_t maxQueueBytes : {uint64_t(0), uint64_t(1024), uint64_t(1024 * 1024)})
+    {
+        test::TempDir dir("mirror");
+        const std::vector<std::string> paths = {dir.File("a/test.mcap"), dir.File("b/test.mcap")};
+        test::RunWithTimeout("镜像写入超大块", std::chrono::seconds(60), [&] {
+            MirrorWritable writable(paths, maxQueueBytes);
+            assert(writable.Open());
+            const auto expected = WriteAll(writable);
+            assert(writable.size() == expected.size());
+            assert(writable.HealthyCount() == 2);
+            assert(writable.CompletePath() == paths[0]);
+            assert(test::ReadFile(paths[0]) == expected);
+            assert(test::ReadFile(paths[1]) == expected);
+        });
+    }
+}
+
+void TestUnwritableMirror()
+{
+    // 副镜像打不开时降级，主文件照常写完
+    test::TempDir dir("mirror_degraded");
+    std::ofstream(dir.File("blocker")).put('x');
+    const std::vector<std::string> paths = {dir.File("a/test.mcap"), dir.File("blocker/test.mcap")};
+    test::RunWithTimeout("镜像降级", std::chrono::seconds(60), [&] {
+        MirrorWritable writable(paths, 4 * 1024 * 1024);
+        assert(writable.Open());
+        assert(writable.HealthyCount() == 1);
+        const auto expected = WriteAll(writable);
+        assert(writable.CompletePath() == paths[0]);
+        assert(test::ReadFile(paths[0]) == expected);
+    });
+}
+
+}  // namespace
+
+int main()
+{
+    TestOversizeBlocks();
+    TestUnwritableMirror();
+    std::cout << "test_mirror_writable 通过" << std::endl;
+    return 0;
+}
@@ -0,0 +1,137 @@
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "mcap/reader.hpp"
+#include "openbag/parallel_writer.hpp"
+#include "test_utils.hpp"
+
+using namespace openbag;
+
+namespace {
+
+constexpr uint32_t kMessageCount = 5000;
+
+std::string MakePayload(uint32_t i)
+{
+    std::string payload(37 + i % 11, static_cast<char>('a' + i % 26));
+    std::memcpy(payload.data(), &i, sizeof(i));
+    return payload;
+}
+
+void WriteBag(const std::string& path, mcap::Compression compression)
+{
+    ParallelMcapWriter writer(4);
+    mcap::McapWriterOptions options("");
+    options.compression = compression;
+    options.chunkSize = 4000;
+    assert(writer.open(path, options).ok());
+
+    mcap::Channel a;
+    a.topic = "/a";
+    a.messageEncoding = "raw";
+    writer.addChannel(a);
+    mcap::Channel b;
+    b.topic = "/b";
+    b.messageEncoding = "raw";
+    writer.addChannel(b);
+
+    for (uint32_t i = 0; i < kMessageCount; ++i)
+    {
+        const auto payload = MakePayload(i);
+        mcap::Message message;
+        message.channelId = i % 3 == 0 ? b.id : a.id;
+        message.sequence = i;
+        message.logTime = 1000 + i;
+        message.publishTime = message.logTime;
+        message.data = reinterpret_cast<const std::byte*>(payload.data());
+        message.dataSize = payload.size();
+        assert(writer.write(message).ok());
+
+        if (i == kMessageCount / 2)
+        {
+            // 附件直接写在数据区，与压缩中的块交错，摘要中的附件索引须仍指向附件记录
+            const std::string data = "attachment";
+            mcap::Attachment attachment;
+            attachment.name = "note";
+            attachment.data = reinterpret_cast<const std::byte*>(data.data());
+            attachment.dataSize = data.size();
+            assert(writer.write(attachment).ok());
+        }
+    }
+
+    mcap::Metadata metadata;
+    metadata.name = "info";
+    metadata.metadata["key"] = "value";
+    assert(writer.write(metadata).ok());
+    assert(writer.statistics().messageCount == kMessageCount);
+    writer.close();
+    writer.close();
+}
+
+void TestRoundTrip(mcap::Compression compression)
+{
+    // 多线程压缩后块须按写入顺序落盘，摘要中的块索引、统计与数据区一致
+    test::TempDir dir("parallel_writer");
+    const auto path = dir.File("out.mcap");
+    WriteBag(path, compression);
+
+    mcap::McapReader reader;
+    assert(reader.open(path).ok());
+    assert(reader.readSummary(mcap::ReadSummaryMethod::NoFallbackScan).ok());
+
+    const auto statistics = reader.statistics();
+    assert(statistics.has_value());
+    assert(statistics->messageCount == kMessageCount);
+    assert(statistics->channelCount == 2);
+    assert(statistics->attachmentCount == 1);
+    assert(statistics->metadataCount == 1);
+    assert(statistics->chunkCount == reader.chunkIndexes().size());
+    assert(reader.chunkIndexes().size() > 1);
+    assert(reader.channels().size() == 2);
+
+    const auto file = test::ReadFile(path);
+    assert(reader.attachmentIndexes().size() == 1);
+    for (const auto& [name, index] : reader.attachmentIndexes())
+    {
+        assert(name == "note");
+        assert(index.offset < file.size() && file[index.offset] == static_cast<char>(mcap::OpCode::Attachment));
+    }
+    assert(reader.metadataIndexes().size() == 1);
+    for (const auto& [name, index] : reader.metadataIndexes())
+    {
+        assert(name == "info");
+        assert(index.offset < file.size() && file[index.offset] == static_cast<char>(mcap::OpCode::Metadata));
+    }
+    for (const auto& chunk : reader.chunkIndexes())
+    {
+        assert(chunk.chunkStartOffset < file.size() && file[chunk.chunkStartOffset] == static_cast<char>(mcap::OpCode::Chunk));
+    }
+
+    uint32_t next = 0;
+    for (const auto& view : reader.readMessages())
+    {
+        const auto expected = MakePayload(next);
+        assert(view.message.sequence == next);
+        assert(view.message.logTime == 1000 + next);
+        assert(view.channel->topic == (next % 3 == 0 ? "/b" : "/a"));
+        assert(std::string(reinterpret_cast<const char*>(view.message.data), view.message.dataSize) == expected);
+        next++;
+    }
+    assert(next == kMessageCount);
+    reader.close();
+}
+
+}  // namespace
+
+int main()
+{
+    TestRoundTrip(mcap::Compression::None);
+    TestRoundTrip(mcap::Compression::Lz4);
+    TestRoundTrip(mcap::Compression::Zstd);
+    std::cout << "test_parallel_writer 通过" << std::endl;
+    return 0;
+}
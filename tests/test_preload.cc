@@ -0,0 +1,109 @@
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "openbag/preload.hpp"
+#include "test_utils.hpp"
+
+using namespace openbag;
+
+namespace {
+
+void TestBuildSaveLoad()
+{
+    test::TempDir dir("preload");
+    const auto bagPath = dir.File("test.mcap");
+    const auto cachePath = dir.File("test.preload");
+    const auto messages = test::MakeTestMessages(3, 200);
+    test::WriteTestBag(bagPath, 3, messages);
+
+    Reader reader;
+    assert(reader.Open(bagPath));
+    const std::vector<mcap::ChannelId> channels = {1, 3};
+    PreloadedBag built;
+    assert(built.Build(reader, channels));
+
+    // 只包含所选通道，按时间排序，负载与原始消息一致
+    std::vector<const test::TestMessage*> expected;
+    for (const auto& message : messages)
+    {
+        if (message.channel_id != 2)
+        {
+            expected.push_back(&message);
+        }
+    }
+    assert(built.Size() == expected.size());
+    PreloadedBag::Cursor cursor(built);
+    size_t i = 0;
+    for (bool valid = cursor.SeekBegin(); valid; valid = cursor.Next(), ++i)
+    {
+        assert(cursor.LogTime() == expected[i]->log_time);
+        assert(cursor.ChannelId() == expected[i]->channel_id);
+        assert(cursor.Payload() == expected[i]->payload);
+    }
+    assert(i == expected.size());
+
+    assert(built.Save(cachePath, bagPath));
+    PreloadedBag loaded;
+    assert(loaded.Load(cachePath, bagPath, channels));
+    assert(loaded.Size() == built.Size());
+    assert(loaded.ArenaBytes() == built.ArenaBytes());
+    PreloadedBag::Cursor loadedCursor(loaded);
+    assert(loadedCursor.SeekEnd());
+    assert(loadedCursor.Payload() == expected.back()->payload);
+
+    // 通道列表不一致时缓存失效
+    assert(!loaded.Load(cachePath, bagPath, {1, 2}));
+}
+
+void TestCorruptCacheIsRejected()
+{
+    test::TempDir dir("preload_corrupt");
+    const auto bagPath = dir.File("test.mcap");
+    const auto cachePath = dir.File("test.preload");
+    test::WriteTestBag(bagPath, 2, test::MakeTestMessages(2, 50));
+
+    Reader reader;
+    assert(reader.Open(bagPath));
+    PreloadedBag bag;
+    assert(bag.Build(reader, {1, 2}));
+
+    // 文件头中的计划项数远大于文件实际内容，须在分配内存前拒绝
+    assert(bag.Save(cachePath, bagPath));
+    {
+        std::fstream file(cachePath, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(sizeof(kPreloadMagic) + sizeof(uint32_t) + 8 + 8 + 4);
+        const uint64_t entryCount = 1ULL << 60;
+        file.write(reinterpret_cast<const char*>(&entryCount), sizeof(entryCount));
+    }
+    PreloadedBag loaded;
+    assert(!loaded.Load(cachePath, bagPath, {1, 2}));
+
+    // 截断的缓存文件
+    assert(bag.Save(cachePath, bagPath));
+    std::filesystem::resize_file(cachePath, std::filesystem::file_size(cachePath) - 1);
+    assert(!loaded.Load(cachePath, bagPath, {1, 2}));
+
+    // 字节序标记不一致
+    assert(bag.Save(cachePath, bagPath));
+    {
+        std::fstream file(cachePath, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(sizeof(kPreloadMagic));
+        const uint32_t swapped = 0x04030201;
+        file.write(reinterpret_cast<const char*>(&swapped), sizeof(swapped));
+    }
+    assert(!loaded.Load(cachePath, bagPath, {1, 2}));
+}
+
+}  // namespace
+
+int main()
+{
+    TestBuildSaveLoad();
+    TestCorruptCacheIsRejected();
+    std::cout << "test_preload 通过" << std::endl;
+    return 0;
+}
@@ -0,0 +1,202 @@
+#include <cassert>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "openbag/proto_stream.hpp"
+#include "test_utils.hpp"
+
+using namespace openbag;
+
+namespace {
+
+constexpr size_t kMessageCount = 3000;
+constexpr size_t kPayloadSize = 1000;  ///< 消息总量超过 kFlushSize，产生多个索引项
+
+std::string PayloadFor(size_t i) { return std::string(kPayloadSize, static_cast<char>('a' + i % 26)) + std::to_string(i); }
+
+void WriteStream(const std::string& path)
+{
+    ProtoStreamWriter writer;
+    assert(writer.open(path).ok());
+
+    mcap::Schema schema;
+    schema.name = "test.Message";
+    schema.encoding = "protobuf";
+    schema.data = {std::byte{1}, std::byte{2}, std::byte{3}};
+    writer.addSchema(schema);
+    assert(schema.id == 1);
+
+    mcap::Channel channel;
+    channel.schemaId = schema.id;
+    channel.topic = "/test";
+    channel.messageEncoding = "protobuf";
+    channel.metadata = {{"key", "value"}};
+    writer.addChannel(channel);
+    assert(channel.id == 1);
+
+    for (size_t i = 0; i < kMessageCount; ++i)
+    {
+        const auto payload = PayloadFor(i);
+        mcap::Message message;
+        message.channelId = channel.id;
+        message.sequence = static_cast<uint32_t>(i);
+        message.logTime = 1000 + i;
+        message.publishTime = i % 2 == 0 ? message.logTime + 5 : message.logTime - 5;  // 发布时间可早于或晚于 logTime
+        message.data = reinterpret_cast<const std::byte*>(payload.data());
+        message.dataSize = payload.size();
+        assert(writer.write(message).ok());
+    }
+
+    const std::string content = "attachment";
+    mcap::Attachment attachment;
+    attachment.logTime = 1;
+    attachment.createTime = 2;
+    attachment.name = "calib";
+    attachment.mediaType = "text/plain";
+    attachment.data = reinterpret_cast<const std::byte*>(content.data());
+    attachment.dataSize = content.size();
+    assert(writer.write(attachment).ok());
+
+    mcap::Metadata metadata;
+    metadata.name = "info";
+    metadata.metadata = {{"robot", "r1"}};
+    assert(writer.write(metadata).ok());
+    writer.close();
+}
+
+/**
+ * @brief 顺序读取全部记录并校验内容，返回读到的消息数
+ */
+size_t ReadAndCheck(const std::string& path, bool& truncated)
+{
+    ProtoStreamReader reader;
+    assert(reader.Open(path));
+    ProtoStreamRecordType type;
+    std::string_view body;
+    size_t messages = 0;
+    while (reader.Next(type, body))
+    {
+        switch (type)
+        {
+            case ProtoStreamRecordType::SCHEMA:
+            {
+                mcap::Schema schema;
+                assert(ProtoStreamCodec::DecodeSchema(body, schema));
+                assert(schema.id == 1 && schema.name == "test.Message" && schema.encoding == "protobuf" && schema.data.size() == 3);
+                break;
+            }
+            case ProtoStreamRecordType::CHANNEL:
+            {
+                mcap::Channel channel;
+                assert(ProtoStreamCodec::DecodeChannel(body, channel));
+                assert(channel.id == 1 && channel.schemaId == 1 && channel.topic == "/test" && channel.metadata.at("key") == "value");
+                break;
+            }
+            case ProtoStreamRecordType::MESSAGE:
+            {
+                mcap::Message message;
+                assert(ProtoStreamCodec::DecodeMessage(body, message));
+                const size_t i = messages++;
+                assert(message.channelId == 1 && message.sequence == i && message.logTime == 1000 + i);
+                assert(message.publishTime == (i % 2 == 0 ? message.logTime + 5 : message.logTime - 5));
+                assert(std::string_view(reinterpret_cast<const char*>(message.data), message.dataSize) == PayloadFor(i));
+                break;
+            }
+            case ProtoStreamRecordType::ATTACHMENT:
+            {
+                mcap::Attachment attachment;
+                assert(ProtoStreamCodec::DecodeAttachment(body, attachment));
+                assert(attachment.name == "calib" && attachment.mediaType == "text/plain" && attachment.logTime == 1 && attachment.createTime == 2);
+                assert(std::string_view(reinterpret_cast<const char*>(attachment.data), attachment.dataSize) == "attachment");
+                break;
+            }
+            case ProtoStreamRecordType::METADATA:
+            {
+                mcap::Metadata metadata;
+                assert(ProtoStreamCodec::DecodeMetadata(body, metadata));
+                assert(metadata.name == "info" && metadata.metadata.at("robot") == "r1");
+                break;
+            }
+            default:
+                assert(false);
+        }
+    }
+    truncated = reader.IsTruncated();
+    return messages;
+}
+
+void TestRoundTrip()
+{
+    test::TempDir dir("proto_stream");
+    const auto path = dir.File("test.pbs");
+    WriteStream(path);
+    assert(ProtoStreamReader::IsProtoStream(path));
+
+    bool truncated = true;
+    assert(ReadAndCheck(path, truncated) == kMessageCount);
+    assert(!truncated);
+
+    // 索引项首尾相接地覆盖整个数据文件，从任一项的偏移开始都能读到完整记录
+    std::vector<ProtoStreamIndexEntry> entries;
+    assert(ProtoStreamReader::LoadIndex(path, entries));
+    assert(entries.size() > 1);
+    uint64_t offset = sizeof(kProtoStreamMagic);
+    uint64_t messages = 0;
+    for (const auto& entry : entries)
+    {
+        assert(entry.offset == offset);
+        offset += entry.length;
+        messages += entry.messages;
+    }
+    assert(offset == std::filesystem::file_size(path));
+    assert(messages == kMessageCount);
+
+    ProtoStreamReader reader;
+    assert(reader.Open(path));
+    assert(reader.Seek(entries[1].offset));
+    ProtoStreamRecordType type;
+    std::string_view body;
+    assert(reader.Next(type, body) && type == ProtoStreamRecordType::MESSAGE);
+}
+
+void TestTruncatedStream()
+{
+    test::TempDir dir("proto_stream_truncated");
+    const auto path = dir.File("test.pbs");
+    WriteStream(path);
+
+    // 末尾记录不完整: 之前的记录照常读取
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 3);
+    bool truncated = false;
+    assert(ReadAndCheck(path, truncated) == kMessageCount);
+    assert(truncated);
+
+    // 损坏的超大长度前缀按不完整记录处理，不按该长度分配内存
+    const auto corruptPath = dir.File("corrupt.pbs");
+    {
+        std::ofstream file(corruptPath, std::ios::binary);
+        file.write(kProtoStreamMagic, sizeof(kProtoStreamMagic));
+        const char record[] = {static_cast<char>(ProtoStreamRecordType::MESSAGE), '\xFF', '\xFF', '\xFF', '\xFF', '\xFF', '\xFF', '\xFF', '\x7F', 'x'};
+        file.write(record, sizeof(record));
+    }
+    ProtoStreamReader reader;
+    assert(reader.Open(corruptPath));
+    ProtoStreamRecordType type;
+    std::string_view body;
+    assert(!reader.Next(type, body));
+    assert(reader.IsTruncated());
+}
+
+}  // namespace
+
+int main()
+{
+    TestRoundTrip();
+    TestTruncatedStream();
+    std::cout << "test_proto_stream 通过" << std::endl;
+    return 0;
+}
@@ -0,0 +1,143 @@
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "openbag/reader.hpp"
+#include "test_utils.hpp"
+
+using namespace openbag;
+
+namespace {
+
+constexpr size_t kChannelCount = 3;
+constexpr size_t kMessageCount = 600;
+
+std::vector<const test::TestMessage*> MessagesOn(const std::vector<test::TestMessage>& messages, mcap::ChannelId channelId)
+{
+    std::vector<const test::TestMessage*> result;
+    for (const auto& message : messages)
+    {
+        if (message.channel_id == channelId)
+        {
+            result.push_back(&message);
+        }
+    }
+    return result;
+}
+
+void TestReadMessageAt(bool chunked)
+{
+    test::TempDir dir(chunked ? "reader_index" : "reader_index_unchunked");
+    const auto bagPath = dir.File("test.mcap");
+    const auto messages = test::MakeTestMessages(kChannelCount, kMessageCount);
+    test::WriteTestBag(bagPath, kChannelCount, messages, chunked);
+
+    Reader reader;
+    assert(reader.Open(bagPath));
+    assert(reader.BuildMessageIndex(false));
+
+    const auto expected = MessagesOn(messages, 2);
+    assert(reader.GetMessageCount("/topic_2") == expected.size());
+    assert(reader.GetMessageCount("/missing") == 0);
+
+    // 乱序读取第N条消息
+    for (size_t i = 0; i < expected.size(); i += 7)
+    {
+        const size_t index = (i * 31) % expected.size();
+        IndexedMessage message;
+        assert(reader.ReadMessageAt("/topic_2", index, message));
+        std::string_view payload;
+        assert(reader.ResolvePayload(message, payload));
+        assert(message.message.logTime == expected[index]->log_time);
+        assert(payload == expected[index]->payload);
+    }
+    IndexedMessage message;
+    assert(!reader.ReadMessageAt("/topic_2", expected.size(), message));
+
+    size_t nearest = 0;
+    assert(reader.FindNearestMessage("/topic_2", expected[10]->log_time + 1, nearest));
+    assert(nearest == 10);
+}
+
+void TestCloseWhilePrefetching()
+{
+    // 预读线程仍在解压块时关闭读取器，不能访问已关闭的文件或卡住
+    test::TempDir dir("reader_close");
+    const auto bagPath = dir.File("test.mcap");
+    test::WriteTestBag(bagPath, kChannelCount, test::MakeTestMessages(kChannelCount, kMessageCount));
+
+    test::RunWithTimeout("读取器预读时关闭", std::chrono::seconds(60), [&] {
+        for (int round = 0; round < 50; ++round)
+        {
+            Reader reader;
+            assert(reader.Open(bagPath));
+            assert(reader.BuildMessageIndex(false));
+            reader.SetChunkCacheCapacity(1024);
+            reader.Prefetch("/topic_1", static_cast<size_t>(round) % reader.GetMessageCount("/topic_1"), 100);
+            reader.Close();
+        }
+    });
+}
+
+void TestCursor(bool chunked)
+{
+    // 没有块索引的文件(消息直接写在数据区)同样支持双向遍历和按时间定位
+    test::TempDir dir(chunked ? "reader_cursor" : "reader_cursor_unchunked");
+    const auto bagPath = dir.File("test.mcap");
+    const auto messages = test::MakeTestMessages(kChannelCount, kMessageCount);
+    test::WriteTestBag(bagPath, kChannelCount, messages, chunked);
+
+    Reader reader;
+    assert(reader.Open(bagPath));
+    Reader::Cursor cursor(reader);
+    const auto check = [&](size_t i) {
+        std::string_view payload;
+        assert(cursor.Valid());
+        assert(cursor.Current().message.logTime == messages[i].log_time);
+        assert(cursor.Current().message.channelId == messages[i].channel_id);
+        assert(cursor.Current().channel && cursor.Current().channel->id == messages[i].channel_id);
+        assert(reader.ResolvePayload(cursor.Current(), payload));
+        assert(payload == messages[i].payload);
+    };
+
+    assert(cursor.SeekBegin());
+    for (size_t i = 0; i < messages.size(); ++i)
+    {
+        check(i);
+        assert(cursor.Next() == (i + 1 < messages.size()));
+    }
+    check(messages.size() - 1);
+
+    assert(cursor.SeekEnd());
+    for (size_t i = messages.size(); i-- > 0;)
+    {
+        check(i);
+        assert(cursor.Prev() == (i > 0));
+    }
+    check(0);
+
+    // 定位到第一条 logTime >= 目标时间的消息，超出范围时停在最后一条
+    assert(cursor.SeekTime(messages[123].log_time - 1));
+    check(123);
+    assert(cursor.Prev());
+    check(122);
+    assert(cursor.SeekTime(messages.back().log_time + 1000));
+    check(messages.size() - 1);
+}
+
+}  // namespace
+
+int main()
+{
+    TestReadMessageAt(true);
+    TestReadMessageAt(false);
+    TestCloseWhilePrefetching();
+    TestCursor(true);
+    TestCursor(false);
+    std::cout << "test_reader 通过" << std::endl;
+    return 0;
+}
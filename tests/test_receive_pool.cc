@@ -0,0 +1,247 @@
+#include <fastdds/dds/domain/DomainParticipant.hpp>
+#include <fastdds/dds/domain/DomainParticipantFactory.hpp>
+#include <fastdds/dds/publisher/DataWriter.hpp>
+#include <fastdds/dds/publisher/Publisher.hpp>
+#include <fastdds/dds/subscriber/DataReader.hpp>
+#include <fastdds/dds/subscriber/SampleInfo.hpp>
+#include <fastdds/dds/subscriber/Subscriber.hpp>
+#include <fastdds/dds/topic/TopicDataType.hpp>
+#include <fastdds/dds/topic/TypeSupport.hpp>
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "link/receive_pool.hpp"
+#include "test_utils.hpp"
+
+namespace dds = eprosima::fastdds::dds;
+
+namespace {
+
+/**
+ * @brief 测试样本: 一个计数值
+ */
+struct Counter
+{
+    uint32_t value = 0;
+};
+
+/**
+ * @brief 测试样本的类型支持: 4字节封装头(CDR_LE) + 小端 uint32
+ */
+class CounterType : public dds::TopicDataType
+{
+public:
+    CounterType()
+    {
+        setName("openbag_test::Counter");
+        m_typeSize = 8;
+        m_isGetKeyDefined = false;
+    }
+
+    bool serialize(void* data, eprosima::fastrtps::rtps::SerializedPayload_t* payload) override
+    {
+        const uint8_t header[4] = {0x00, 0x01, 0x00, 0x00};
+        std::memcpy(payload->data, header, sizeof(header));
+        std::memcpy(payload->data + sizeof(header), &static_cast<Counter*>(data)->value, sizeof(uint32_t));
+        payload->length = 8;
+        payload->encapsulation = CDR_LE;
+        return true;
+    }
+
+    bool deserialize(eprosima::fastrtps::rtps::SerializedPayload_t* payload, void* data) override
+    {
+        if (payload->length < 8)
+        {
+            return false;
+        }
+        std::memcpy(&static_cast<Counter*>(data)->value, payload->data + 4, sizeof(uint32_t));
+        return true;
+    }
+
+    std::function<uint32_t()> getSerializedSizeProvider(void*) override
+    {
+        return [] { return 8u; };
+    }
+
+    void* createData() override { return new Counter(); }
+
+    void deleteData(void* data) override { delete static_cast<Counter*>(data); }
+
+    bool getKey(void*, eprosima::fastrtps::rtps::InstanceHandle_t*, bool) override { return false; }
+};
+
+/**
+ * @brief 同一参与者内的一对读写端
+ */
+struct Endpoint
+{
+    dds::Topic* topic = nullptr;
+    dds::DataWriter* writer = nullptr;
+    dds::DataReader* reader = nullptr;
+    std::atomic<int> received{0};
+
+    /**
+     * @brief 取走读取器中的全部样本(在接收线程中调用)
+     */
+    void TakeAll()
+    {
+        Counter sample;
+        dds::SampleInfo info;
+        while (reader->take_next_sample(&sample, &info) == eprosima::fastrtps::types::ReturnCode_t::RETCODE_OK)
+        {
+            if (info.valid_data)
+            {
+                received++;
+            }
+        }
+    }
+
+    /**
+     * @brief 反复写入直到条件满足(读写端匹配需要时间，匹配前写入的样本会丢失)
+     */
+    void WriteUntil(const std::function<bool()>& done)
+    {
+        Counter sample;
+        while (!done())
+        {
+            sample.value++;
+            writer->write(&sample);
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+};
+
+/**
+ * @brief 测试用的DDS实体
+ */
+class DdsFixture
+{
+public:
+    DdsFixture() : m_type(new CounterType())
+    {
+        m_participant = dds::DomainParticipantFactory::get_instance()->create_participant(0, dds::PARTICIPANT_QOS_DEFAULT);
+        assert(m_participant);
+        m_type.register_type(m_participant);
+        m_publisher = m_participant->create_publisher(dds::PUBLISHER_QOS_DEFAULT);
+        m_subscriber = m_participant->create_subscriber(dds::SUBSCRIBER_QOS_DEFAULT);
+        assert(m_publisher && m_subscriber);
+    }
+
+    ~DdsFixture()
+    {
+        m_participant->delete_contained_entities();
+        dds::DomainParticipantFactory::get_instance()->delete_participant(m_participant);
+    }
+
+    DdsFixture(const DdsFixture&) = delete;
+    DdsFixture& operator=(const DdsFixture&) = delete;
+
+    void Create(const std::string& topicName, Endpoint& endpoint)
+    {
+        endpoint.topic = m_participant->create_topic(topicName, m_type.get_type_name(), dds::TOPIC_QOS_DEFAULT);
+        endpoint.writer = m_publisher->create_datawriter(endpoint.topic, dds::DATAWRITER_QOS_DEFAULT);
+        endpoint.reader = m_subscriber->create_datareader(endpoint.topic, dds::DATAREADER_QOS_DEFAULT);
+        assert(endpoint.topic && endpoint.writer && endpoint.reader);
+    }
+
+private:
+    dds::TypeSupport m_type;
+    dds::DomainParticipant* m_participant = nullptr;
+    dds::Publisher* m_publisher = nullptr;
+    dds::Subscriber* m_subscriber = nullptr;
+};
+
+void TestAttachDetachInsideHandler(DdsFixture& fixture)
+{
+    // 处理函数内挂载/卸载同一接收线程上的其他读取器(以前在持有线程锁时调用处理函数，会死锁)
+    auto& pool = Link::ReceiveThreadPool::Instance();
+    Endpoint a;
+    Endpoint b;
+    fixture.Create("openbag_test_pool_a", a);
+    fixture.Create("openbag_test_pool_b", b);
+
+    std::atomic<bool> attachedB{false};
+    std::atomic<bool> detachB{false};
+    std::atomic<bool> detachedB{false};
+    const bool attached = pool.Attach(a.reader, 0, [&] {
+        a.TakeAll();
+        if (!attachedB)
+        {
+            const bool ok = pool.Attach(b.reader, 0, [&b] { b.TakeAll(); });
+            assert(ok);
+            attachedB = true;
+        } else if (detachB && !detachedB)
+        {
+            pool.Detach(b.reader, 0);
+            detachedB = true;
+        }
+    });
+    assert(attached);
+
+    test::RunWithTimeout("处理函数内挂载和卸载", std::chrono::seconds(60), [&] {
+        a.WriteUntil([&] { return attachedB.load(); });
+        b.WriteUntil([&] { return b.received > 0; });
+        detachB = true;
+        a.WriteUntil([&] { return detachedB.load(); });
+    });
+    pool.Detach(a.reader, 0);
+}
+
+void TestDetachWaitsForRunningHandler(DdsFixture& fixture)
+{
+    // 在其他线程卸载时等待正在执行的处理函数返回，返回后不再调用
+    auto& pool = Link::ReceiveThreadPool::Instance();
+    Endpoint c;
+    fixture.Create("openbag_test_pool_c", c);
+
+    std::atomic<bool> inHandler{false};
+    std::atomic<bool> finished{false};
+    std::atomic<int> callsAfterDetach{0};
+    std::atomic<bool> detached{false};
+    const bool attached = pool.Attach(c.reader, 0, [&] {
+        if (detached)
+        {
+            callsAfterDetach++;
+        }
+        c.TakeAll();
+        if (!inHandler.exchange(true))
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            finished = true;
+        }
+    });
+    assert(attached);
+
+    test::RunWithTimeout("卸载等待处理函数", std::chrono::seconds(60), [&] {
+        c.WriteUntil([&] { return inHandler.load(); });
+        pool.Detach(c.reader, 0);
+        detached = true;
+        assert(finished);
+        Counter sample;
+        c.writer->write(&sample);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        assert(callsAfterDetach == 0);
+    });
+}
+
+}  // namespace
+
+int main()
+{
+    Link::ReceiveThreadPool::SetThreadCount(1);
+    {
+        DdsFixture fixture;
+        TestAttachDetachInsideHandler(fixture);
+        TestDetachWaitsForRunningHandler(fixture);
+    }
+    std::cout << "test_receive_pool 通过" << std::endl;
+    return 0;
+}
@@ -0,0 +1,107 @@
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "openbag/stream_writable.hpp"
+#include "test_utils.hpp"
+
+using namespace openbag;
+
+namespace {
+
+constexpr size_t kWriteSize = 3 * 1024 * 1024;  ///< 单次写入远大于 kBlockSize
+constexpr size_t kWriteCount = 8;
+
+/**
+ * @brief 从命名管道读取，最多读取 limit 字节后关闭读端
+ */
+std::string ReadFifo(const std::string& path, size_t limit)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    assert(fd >= 0);
+    std::string data;
+    std::string buffer(64 * 1024, '\0');
+    while (data.size() < limit)
+    {
+        const ssize_t n = ::read(fd, buffer.data(), buffer.size());
+        if (n <= 0)
+        {
+            break;
+        }
+        data.append(buffer.data(), static_cast<size_t>(n));
+        std::this_thread::sleep_for(std::chrono::microseconds(100));  // 慢速下游，制造反压
+    }
+    ::close(fd);
+    return data;
+}
+
+std::string WriteAll(StreamWritable& writable)
+{
+    std::string expected;
+    for (size_t i = 0; i < kWriteCount; ++i)
+    {
+        const std::string data(kWriteSize, static_cast<char>('a' + i));
+        writable.write(reinterpret_cast<const std::byte*>(data.data()), data.size());
+        writable.Flush();
+        expected += data;
+    }
+    writable.end();
+    return expected;
+}
+
+void TestOversizeBlocks()
+{
+    // 队列上限为0或小于单个块时不能卡死，数据完整按序到达下游
+    for (const uint64_t maxQueueBytes : {uint64_t(0), uint64_t(1024), uint64_t(4 * 1024 * 1024)})
+    {
+        test::TempDir dir("stream");
+        const auto fifo = dir.File("stream.fifo");
+        assert(::mkfifo(fifo.c_str(), 0644) == 0);
+        test::RunWithTimeout("流式输出超大块", std::chrono::seconds(60), [&] {
+            std::string received;
+            std::thread reader([&] { received = ReadFifo(fifo, SIZE_MAX); });
+            StreamWritable writable(fifo, maxQueueBytes);
+            assert(writable.Open());
+            const auto expected = WriteAll(writable);
+            reader.join();
+            assert(!writable.IsBroken());
+            assert(writable.size() == expected.size());
+            assert(received == expected);
+        });
+    }
+}
+
+void TestDownstreamDisconnect()
+{
+    // 下游中途断开时写入端标记为中断并正常结束，不因 SIGPIPE 退出
+    test::TempDir dir("stream_broken");
+    const auto fifo = dir.File("stream.fifo");
+    assert(::mkfifo(fifo.c_str(), 0644) == 0);
+    test::RunWithTimeout("流式输出下游断开", std::chrono::seconds(60), [&] {
+        std::thread reader([&] { ReadFifo(fifo, 1024 * 1024); });
+        StreamWritable writable(fifo, 1024 * 1024);
+        assert(writable.Open());
+        WriteAll(writable);
+        reader.join();
+        assert(writable.IsBroken());
+        assert(writable.size() == kWriteSize * kWriteCount);
+    });
+}
+
+}  // namespace
+
+int main()
+{
+    TestOversizeBlocks();
+    TestDownstreamDisconnect();
+    std::cout << "test_stream_writable 通过" << std::endl;
+    return 0;
+}
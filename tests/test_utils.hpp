@@ -0,0 +1,174 @@
+/**
+ * @copyright Copyright (c) 2025 openbag
+ *
+ * @author Zhao Jun(zwhy2025@gmail.com)
+ * @version 0.1
+ * @date 2025-05-22
+ *
+ * @file test_utils.hpp
+ * @brief 单元测试公用工具: 临时目录、超时检测、生成测试用 MCAP 文件
+ */
+
+#pragma once
+
+#include <unistd.h>
+
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "mcap/writer.hpp"
+
+namespace openbag::test {
+
+/**
+ * @brief 临时目录，析构时删除
+ */
+class TempDir
+{
+public:
+    /**
+     * @brief 构造函数
+     * @param name 目录名前缀(测试名称)
+     */
+    explicit TempDir(const std::string& name)
+        : m_path(std::filesystem::temp_directory_path() / ("openbag_" + name + "_" + std::to_string(::getpid())))
+    {
+        std::filesystem::remove_all(m_path);
+        std::filesystem::create_directories(m_path);
+    }
+
+    ~TempDir()
+    {
+        std::error_code ec;
+        std::filesystem::remove_all(m_path, ec);
+    }
+
+    TempDir(const TempDir&) = delete;
+    TempDir& operator=(const TempDir&) = delete;
+
+    /**
+     * @brief 目录下文件的路径
+     */
+    std::string File(const std::string& name) const { return (m_path / name).string(); }
+
+private:
+    std::filesystem::path m_path;
+};
+
+/**
+ * @brief 在限定时间内运行，超时视为卡死，直接以失败退出(卡住的线程无法回收)
+ * @param name 用例名称
+ * @param timeout 超时时间
+ * @param func 运行的函数
+ */
+template <typename Func>
+void RunWithTimeout(const char* name, std::chrono::seconds timeout, Func&& func)
+{
+    auto done = std::async(std::launch::async, std::forward<Func>(func));
+    if (done.wait_for(timeout) != std::future_status::ready)
+    {
+        std::cerr << name << " 超时未完成" << std::endl;
+        std::_Exit(1);
+    }
+    done.get();
+}
+
+/**
+ * @brief 读取整个文件
+ */
+inline std::string ReadFile(const std::string& path)
+{
+    std::error_code ec;
+    const auto size = std::filesystem::file_size(path, ec);
+    if (ec)
+    {
+        return std::string();
+    }
+    std::string data(size, '\0');
+    std::ifstream file(path, std::ios::binary);
+    file.read(data.data(), static_cast<std::streamsize>(data.size()));
+    return data;
+}
+
+/**
+ * @brief 测试消息
+ */
+struct TestMessage
+{
+    mcap::ChannelId channel_id = 0;  ///< 通道ID(从1开始)
+    uint64_t log_time = 0;           ///< 消息时间(纳秒)
+    uint32_t sequence = 0;           ///< 序列号
+    std::string payload;             ///< 负载
+};
+
+/**
+ * @brief 生成按时间递增、各通道轮流出现的测试消息
+ * @param channels 通道数
+ * @param count 消息总数
+ */
+inline std::vector<TestMessage> MakeTestMessages(size_t channels, size_t count)
+{
+    std::vector<TestMessage> messages;
+    for (size_t i = 0; i < count; ++i)
+    {
+        TestMessage message;
+        message.channel_id = static_cast<mcap::ChannelId>(i % channels + 1);
+        message.log_time = 1000 + i * 10;
+        message.sequence = static_cast<uint32_t>(i);
+        message.payload = "message-" + std::to_string(i) + std::string(i % 7, 'x');
+        messages.push_back(std::move(message));
+    }
+    return messages;
+}
+
+/**
+ * @brief 写入测试用 MCAP 文件，通道 /topic_<n> 的消息编码为 "raw"，没有 schema
+ * @param path 文件路径
+ * @param channels 通道数
+ * @param messages 消息
+ * @param chunked 是否分块(不分块时消息直接写在数据区，没有块索引)
+ * @param chunkSize 块大小
+ */
+inline void WriteTestBag(const std::string& path, size_t channels, const std::vector<TestMessage>& messages, bool chunked = true, uint64_t chunkSize = 256)
+{
+    mcap::McapWriterOptions options("");
+    options.noChunking = !chunked;
+    options.chunkSize = chunkSize;
+    options.compression = mcap::Compression::Lz4;
+
+    mcap::McapWriter writer;
+    const auto status = writer.open(path, options);
+    assert(status.ok());
+    for (size_t i = 0; i < channels; ++i)
+    {
+        mcap::Channel channel;
+        channel.topic = "/topic_" + std::to_string(i + 1);
+        channel.messageEncoding = "raw";
+        channel.schemaId = 0;
+        writer.addChannel(channel);
+        assert(channel.id == i + 1);
+    }
+    for (const auto& message : messages)
+    {
+        mcap::Message record;
+        record.channelId = message.channel_id;
+        record.sequence = message.sequence;
+        record.logTime = message.log_time;
+        record.publishTime = message.log_time;
+        record.data = reinterpret_cast<const std::byte*>(message.payload.data());
+        record.dataSize = message.payload.size();
+        assert(writer.write(record).ok());
+    }
+    writer.close();
+}
+
+}  // namespace openbag::test